@@ -26,8 +26,11 @@ static_assert(sizeof(u64) == 8, "uint64 must be 8 bytes big"); // NOLINT
 
 using ulong = unsigned long;
 
+// long is 4 bytes on Windows (LLP64), 8 bytes on 64-bit Linux and macOS (LP64)
+#if defined(_WIN32)
 static_assert(sizeof(long) == sizeof(s32), "long should be the same size as int32");
 static_assert(sizeof(ulong) == sizeof(u32), "ulong should be the same size as uint32");
+#endif
 
 using char8 = s8;
 using char16 = char16_t;
@@ -39,7 +42,9 @@ static_assert(sizeof(char16) == 2, "char16 must be 2 byte big"); // NOLINT
 static_assert(sizeof(char32) == 4, "char32 must be 4 byte big"); // NOLINT
 
 // with MSVC, wchar_t is 2 bytes big, while with clang and gcc, it's 4 bytes big
+#if defined(_WIN32)
 static_assert(sizeof(tchar) == 2, "tchar must be 2 bytes big");
+#endif
 
 using f32 = float;
 using f64 = double;
@@ -0,0 +1,756 @@
+#include "aabb_tree.h"
+
+#include "frustum_culler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace cera
+{
+    namespace internal
+    {
+        bounding_box combine(const bounding_box& a, const bounding_box& b)
+        {
+            return {
+                { std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z) },
+                { std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z) }
+            };
+        }
+
+        float surface_area(const bounding_box& box)
+        {
+            float dx = box.max.x - box.min.x;
+            float dy = box.max.y - box.min.y;
+            float dz = box.max.z - box.min.z;
+
+            return 2.0f * (dx * dy + dy * dz + dz * dx);
+        }
+
+        bool contains(const bounding_box& outer, const bounding_box& inner)
+        {
+            return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z
+                && outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+        }
+
+        bool overlaps(const bounding_box& a, const bounding_box& b)
+        {
+            return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+                && a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+        }
+
+        bool overlaps(const bounding_box& box, const bounding_sphere& sphere)
+        {
+            // Distance from the center to the closest point in the box.
+            float dx = std::max(std::max(box.min.x - sphere.center.x, 0.0f), sphere.center.x - box.max.x);
+            float dy = std::max(std::max(box.min.y - sphere.center.y, 0.0f), sphere.center.y - box.max.y);
+            float dz = std::max(std::max(box.min.z - sphere.center.z, 0.0f), sphere.center.z - box.max.z);
+
+            return dx * dx + dy * dy + dz * dz <= sphere.radius * sphere.radius;
+        }
+
+        /**
+         * Distance along the ray at which it enters the box, infinity when the box is missed.
+         */
+        float ray_entry(const bounding_box& box, const float3& origin, const float3& inverseDirection, float maxDistance)
+        {
+            float tx1 = (box.min.x - origin.x) * inverseDirection.x;
+            float tx2 = (box.max.x - origin.x) * inverseDirection.x;
+            float ty1 = (box.min.y - origin.y) * inverseDirection.y;
+            float ty2 = (box.max.y - origin.y) * inverseDirection.y;
+            float tz1 = (box.min.z - origin.z) * inverseDirection.z;
+            float tz2 = (box.max.z - origin.z) * inverseDirection.z;
+
+            float t_enter = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::max(std::min(tz1, tz2), 0.0f));
+            float t_exit = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::min(std::max(tz1, tz2), maxDistance));
+
+            return t_enter <= t_exit ? t_enter : std::numeric_limits<float>::infinity();
+        }
+
+        /**
+         * Stack of the tree traversals, kept on the call stack so queries do not allocate.
+         * A depth first traversal holds at most one entry per level plus one, balanced trees never
+         * exceed the fixed capacity. Only a tree degenerated by deferred moves spills to the heap.
+         */
+        template <typename T>
+        class traversal_stack
+        {
+        public:
+            traversal_stack()
+                : m_data(m_fixed)
+                , m_size(0)
+                , m_capacity(fixed_capacity)
+            {}
+
+            traversal_stack(const traversal_stack&) = delete;
+            traversal_stack& operator=(const traversal_stack&) = delete;
+
+            void push(const T& value)
+            {
+                if (m_size == m_capacity)
+                {
+                    grow();
+                }
+
+                m_data[m_size++] = value;
+            }
+
+            T pop()
+            {
+                assert(m_size > 0);
+                return m_data[--m_size];
+            }
+
+            bool empty() const
+            {
+                return m_size == 0;
+            }
+
+        private:
+            void grow()
+            {
+                if (m_heap.empty())
+                {
+                    m_heap.assign(m_fixed, m_fixed + m_size);
+                }
+
+                m_capacity *= 2;
+                m_heap.resize(m_capacity);
+                m_data = m_heap.data();
+            }
+
+            static constexpr u32 fixed_capacity = 64;
+
+            T m_fixed[fixed_capacity];
+            std::vector<T> m_heap;
+
+            T* m_data;
+            u32 m_size;
+            u32 m_capacity;
+        };
+    }
+
+    aabb_tree::aabb_tree(float margin)
+        : m_root(invalid_node)
+        , m_free_list(invalid_node)
+        , m_num_leaves(0)
+        , m_margin(margin)
+    {}
+
+    aabb_tree::proxy aabb_tree::insert(const bounding_box& box, u32 userData)
+    {
+        u32 leaf = allocate_node();
+
+        node& n = m_nodes[leaf];
+        n.box = fatten(box);
+        n.user_data = userData;
+        n.height = 0;
+
+        insert_leaf(leaf);
+        ++m_num_leaves;
+
+        return leaf;
+    }
+
+    void aabb_tree::remove(proxy leaf)
+    {
+        assert(leaf < m_nodes.size() && m_nodes[leaf].is_leaf() && m_nodes[leaf].height == 0);
+
+        remove_leaf(leaf);
+        free_node(leaf);
+        --m_num_leaves;
+    }
+
+    bool aabb_tree::move(proxy leaf, const bounding_box& box)
+    {
+        assert(leaf < m_nodes.size() && m_nodes[leaf].is_leaf());
+
+        if (internal::contains(m_nodes[leaf].box, box))
+        {
+            return false;
+        }
+
+        remove_leaf(leaf);
+        m_nodes[leaf].box = fatten(box);
+        insert_leaf(leaf);
+
+        return true;
+    }
+
+    bool aabb_tree::move_deferred(proxy leaf, const bounding_box& box)
+    {
+        assert(leaf < m_nodes.size() && m_nodes[leaf].is_leaf());
+
+        node& n = m_nodes[leaf];
+        if (internal::contains(n.box, box))
+        {
+            return false;
+        }
+
+        n.box = fatten(box);
+        if (!n.moved)
+        {
+            n.moved = true;
+            m_moved_leaves.push_back(leaf);
+        }
+
+        // Grow the ancestors right away so queries before the next refit() still find the proxy.
+        // The walk stops at the first ancestor that already contains the box, refit() shrinks them again.
+        for (u32 index = n.parent; index != invalid_node && !internal::contains(m_nodes[index].box, n.box); index = m_nodes[index].parent)
+        {
+            m_nodes[index].box = internal::combine(m_nodes[index].box, n.box);
+        }
+
+        return true;
+    }
+
+    void aabb_tree::refit()
+    {
+        if (m_moved_leaves.empty())
+        {
+            return;
+        }
+
+        // Collect every ancestor of a moved leaf once. The walk stops at ancestors that were already collected.
+        m_refit_nodes.clear();
+        for (u32 leaf : m_moved_leaves)
+        {
+            m_nodes[leaf].moved = false;
+
+            for (u32 index = m_nodes[leaf].parent; index != invalid_node && !m_nodes[index].moved; index = m_nodes[index].parent)
+            {
+                m_nodes[index].moved = true;
+                m_refit_nodes.push_back(index);
+            }
+        }
+
+        m_moved_leaves.clear();
+
+        // Children are always lower than their parent, refitting by increasing height visits children first.
+        std::sort(m_refit_nodes.begin(), m_refit_nodes.end(), [this](u32 a, u32 b)
+        {
+            return m_nodes[a].height < m_nodes[b].height;
+        });
+
+        for (u32 index : m_refit_nodes)
+        {
+            node& n = m_nodes[index];
+            n.box = internal::combine(m_nodes[n.child1].box, m_nodes[n.child2].box);
+            n.moved = false;
+        }
+    }
+
+    void aabb_tree::clear()
+    {
+        m_nodes.clear();
+        m_moved_leaves.clear();
+
+        m_root = invalid_node;
+        m_free_list = invalid_node;
+        m_num_leaves = 0;
+    }
+
+    u32 aabb_tree::get_user_data(proxy leaf) const
+    {
+        assert(leaf < m_nodes.size());
+        return m_nodes[leaf].user_data;
+    }
+
+    const bounding_box& aabb_tree::get_fat_bounds(proxy leaf) const
+    {
+        assert(leaf < m_nodes.size());
+        return m_nodes[leaf].box;
+    }
+
+    void aabb_tree::query(const bounding_box& box, std::vector<proxy>& results) const
+    {
+        if (m_root == invalid_node)
+        {
+            return;
+        }
+
+        internal::traversal_stack<u32> stack;
+        stack.push(m_root);
+
+        while (!stack.empty())
+        {
+            u32 index = stack.pop();
+            const node& n = m_nodes[index];
+
+            if (!internal::overlaps(n.box, box))
+            {
+                continue;
+            }
+
+            if (n.is_leaf())
+            {
+                results.push_back(index);
+            }
+            else
+            {
+                stack.push(n.child1);
+                stack.push(n.child2);
+            }
+        }
+    }
+
+    void aabb_tree::query(const bounding_sphere& sphere, std::vector<proxy>& results) const
+    {
+        if (m_root == invalid_node)
+        {
+            return;
+        }
+
+        internal::traversal_stack<u32> stack;
+        stack.push(m_root);
+
+        while (!stack.empty())
+        {
+            u32 index = stack.pop();
+            const node& n = m_nodes[index];
+
+            if (!internal::overlaps(n.box, sphere))
+            {
+                continue;
+            }
+
+            if (n.is_leaf())
+            {
+                results.push_back(index);
+            }
+            else
+            {
+                stack.push(n.child1);
+                stack.push(n.child2);
+            }
+        }
+    }
+
+    void aabb_tree::query(const frustum& frustum, std::vector<proxy>& results) const
+    {
+        if (m_root == invalid_node)
+        {
+            return;
+        }
+
+        constexpr u32 all_planes = (1u << frustum::num_planes) - 1;
+
+        // Every entry carries the planes its box still intersects, a parent inside a plane has all its children inside.
+        struct entry
+        {
+            u32 index;
+            u32 plane_mask;
+        };
+
+        internal::traversal_stack<entry> stack;
+        stack.push({ m_root, all_planes });
+
+        internal::traversal_stack<u32> subtree;
+
+        while (!stack.empty())
+        {
+            entry e = stack.pop();
+
+            const node& n = m_nodes[e.index];
+
+            float3 center = n.box.get_center();
+            float3 extents = n.box.get_extents();
+
+            bool outside = false;
+            u32 plane_mask = e.plane_mask;
+            for (u32 i = 0; i < frustum::num_planes && !outside; ++i)
+            {
+                if ((plane_mask & (1u << i)) == 0)
+                {
+                    continue;
+                }
+
+                const plane& p = frustum.planes[i];
+                float distance = center.x * p.normal.x + center.y * p.normal.y + center.z * p.normal.z + p.distance;
+                float radius = extents.x * std::fabs(p.normal.x) + extents.y * std::fabs(p.normal.y) + extents.z * std::fabs(p.normal.z);
+
+                if (distance + radius < 0.0f)
+                {
+                    outside = true;
+                }
+                else if (distance - radius >= 0.0f)
+                {
+                    plane_mask &= ~(1u << i);
+                }
+            }
+
+            if (outside)
+            {
+                continue;
+            }
+
+            if (n.is_leaf())
+            {
+                results.push_back(e.index);
+            }
+            else if (plane_mask == 0)
+            {
+                // Completely inside, add all leaves without further tests.
+                subtree.push(e.index);
+                while (!subtree.empty())
+                {
+                    u32 index = subtree.pop();
+
+                    const node& child = m_nodes[index];
+                    if (child.is_leaf())
+                    {
+                        results.push_back(index);
+                    }
+                    else
+                    {
+                        subtree.push(child.child1);
+                        subtree.push(child.child2);
+                    }
+                }
+            }
+            else
+            {
+                stack.push({ n.child1, plane_mask });
+                stack.push({ n.child2, plane_mask });
+            }
+        }
+    }
+
+    void aabb_tree::raycast(const float3& origin, const float3& direction, float maxDistance, const raycast_callback& callback) const
+    {
+        if (m_root == invalid_node)
+        {
+            return;
+        }
+
+        // Division by zero results in infinities which the slab test handles.
+        float3 inverse_direction = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+
+        struct entry
+        {
+            u32 index;
+            float distance;
+        };
+
+        internal::traversal_stack<entry> stack;
+
+        float root_distance = internal::ray_entry(m_nodes[m_root].box, origin, inverse_direction, maxDistance);
+        if (root_distance <= maxDistance)
+        {
+            stack.push({ m_root, root_distance });
+        }
+
+        while (!stack.empty())
+        {
+            entry e = stack.pop();
+
+            // The ray was shortened by a closer hit after this entry was pushed.
+            if (e.distance > maxDistance)
+            {
+                continue;
+            }
+
+            const node& n = m_nodes[e.index];
+            if (n.is_leaf())
+            {
+                maxDistance = std::min(maxDistance, callback(e.index, maxDistance));
+                continue;
+            }
+
+            float distance1 = internal::ray_entry(m_nodes[n.child1].box, origin, inverse_direction, maxDistance);
+            float distance2 = internal::ray_entry(m_nodes[n.child2].box, origin, inverse_direction, maxDistance);
+
+            // Push the far child first so the near child is visited first.
+            entry near_entry = { n.child1, distance1 };
+            entry far_entry = { n.child2, distance2 };
+            if (distance2 < distance1)
+            {
+                std::swap(near_entry, far_entry);
+            }
+
+            if (far_entry.distance <= maxDistance)
+            {
+                stack.push(far_entry);
+            }
+
+            if (near_entry.distance <= maxDistance)
+            {
+                stack.push(near_entry);
+            }
+        }
+    }
+
+    u32 aabb_tree::size() const
+    {
+        return m_num_leaves;
+    }
+
+    s32 aabb_tree::get_height() const
+    {
+        return m_root != invalid_node ? m_nodes[m_root].height : 0;
+    }
+
+    float aabb_tree::get_area_ratio() const
+    {
+        if (m_root == invalid_node)
+        {
+            return 0.0f;
+        }
+
+        float root_area = internal::surface_area(m_nodes[m_root].box);
+
+        float total_area = 0.0f;
+        for (const node& n : m_nodes)
+        {
+            if (n.height > 0)
+            {
+                total_area += internal::surface_area(n.box);
+            }
+        }
+
+        return root_area > 0.0f ? total_area / root_area : 0.0f;
+    }
+
+    u32 aabb_tree::allocate_node()
+    {
+        u32 index;
+        if (m_free_list != invalid_node)
+        {
+            index = m_free_list;
+            m_free_list = m_nodes[index].parent;
+        }
+        else
+        {
+            index = static_cast<u32>(m_nodes.size());
+            m_nodes.emplace_back();
+        }
+
+        node& n = m_nodes[index];
+        n.parent = invalid_node;
+        n.child1 = invalid_node;
+        n.child2 = invalid_node;
+        n.height = 0;
+        n.user_data = 0;
+        n.moved = false;
+
+        return index;
+    }
+
+    void aabb_tree::free_node(u32 index)
+    {
+        node& n = m_nodes[index];
+        n.parent = m_free_list;
+        n.height = -1;
+        n.moved = false;
+
+        m_free_list = index;
+    }
+
+    void aabb_tree::insert_leaf(u32 leaf)
+    {
+        // Structural changes invalidate the ancestors collected by refit.
+        refit();
+
+        if (m_root == invalid_node)
+        {
+            m_root = leaf;
+            m_nodes[leaf].parent = invalid_node;
+            return;
+        }
+
+        // Find the best sibling by descending into the child with the lowest surface area cost.
+        bounding_box leaf_box = m_nodes[leaf].box;
+
+        u32 index = m_root;
+        while (!m_nodes[index].is_leaf())
+        {
+            const node& n = m_nodes[index];
+
+            float area = internal::surface_area(n.box);
+            float combined_area = internal::surface_area(internal::combine(n.box, leaf_box));
+
+            // Cost of creating a new parent for this node and the leaf.
+            float cost = 2.0f * combined_area;
+
+            // Minimum cost of pushing the leaf further down the tree.
+            float inheritance_cost = 2.0f * (combined_area - area);
+
+            auto descend_cost = [&](u32 child) -> float
+            {
+                const node& c = m_nodes[child];
+                float new_area = internal::surface_area(internal::combine(leaf_box, c.box));
+
+                return c.is_leaf()
+                    ? new_area + inheritance_cost
+                    : new_area - internal::surface_area(c.box) + inheritance_cost;
+            };
+
+            float cost1 = descend_cost(n.child1);
+            float cost2 = descend_cost(n.child2);
+
+            if (cost < cost1 && cost < cost2)
+            {
+                break;
+            }
+
+            index = cost1 < cost2 ? n.child1 : n.child2;
+        }
+
+        u32 sibling = index;
+
+        // Create a new parent for the sibling and the leaf.
+        u32 old_parent = m_nodes[sibling].parent;
+        u32 new_parent = allocate_node();
+
+        node& p = m_nodes[new_parent];
+        p.parent = old_parent;
+        p.box = internal::combine(leaf_box, m_nodes[sibling].box);
+        p.height = m_nodes[sibling].height + 1;
+        p.child1 = sibling;
+        p.child2 = leaf;
+
+        if (old_parent != invalid_node)
+        {
+            node& op = m_nodes[old_parent];
+            (op.child1 == sibling ? op.child1 : op.child2) = new_parent;
+        }
+        else
+        {
+            m_root = new_parent;
+        }
+
+        m_nodes[sibling].parent = new_parent;
+        m_nodes[leaf].parent = new_parent;
+
+        fix_upwards(m_nodes[leaf].parent);
+    }
+
+    void aabb_tree::remove_leaf(u32 leaf)
+    {
+        refit();
+
+        if (leaf == m_root)
+        {
+            m_root = invalid_node;
+            return;
+        }
+
+        u32 parent = m_nodes[leaf].parent;
+        u32 grand_parent = m_nodes[parent].parent;
+        u32 sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+        // The sibling takes the place of the parent.
+        if (grand_parent != invalid_node)
+        {
+            node& gp = m_nodes[grand_parent];
+            (gp.child1 == parent ? gp.child1 : gp.child2) = sibling;
+            m_nodes[sibling].parent = grand_parent;
+
+            free_node(parent);
+
+            fix_upwards(grand_parent);
+        }
+        else
+        {
+            m_root = sibling;
+            m_nodes[sibling].parent = invalid_node;
+
+            free_node(parent);
+        }
+    }
+
+    u32 aabb_tree::balance(u32 index_a)
+    {
+        node& a = m_nodes[index_a];
+        if (a.is_leaf() || a.height < 2)
+        {
+            return index_a;
+        }
+
+        u32 index_b = a.child1;
+        u32 index_c = a.child2;
+        node& b = m_nodes[index_b];
+        node& c = m_nodes[index_c];
+
+        s32 balance = c.height - b.height;
+
+        // Rotate the higher child up, A becomes its child. The lower grandchild is moved below A.
+        auto rotate_up = [&](u32 index_up, node& up, node& other, bool upIsChild2) -> u32
+        {
+            u32 index_f = up.child1;
+            u32 index_g = up.child2;
+            node& f = m_nodes[index_f];
+            node& g = m_nodes[index_g];
+
+            up.child1 = index_a;
+            up.parent = a.parent;
+            a.parent = index_up;
+
+            if (up.parent != invalid_node)
+            {
+                node& parent = m_nodes[up.parent];
+                (parent.child1 == index_a ? parent.child1 : parent.child2) = index_up;
+            }
+            else
+            {
+                m_root = index_up;
+            }
+
+            // The higher grandchild stays below the rotated node.
+            u32 index_keep = f.height > g.height ? index_f : index_g;
+            u32 index_move = f.height > g.height ? index_g : index_f;
+            node& keep = m_nodes[index_keep];
+            node& moved = m_nodes[index_move];
+
+            up.child2 = index_keep;
+            (upIsChild2 ? a.child2 : a.child1) = index_move;
+            moved.parent = index_a;
+
+            a.box = internal::combine(other.box, moved.box);
+            up.box = internal::combine(a.box, keep.box);
+
+            a.height = 1 + std::max(other.height, moved.height);
+            up.height = 1 + std::max(a.height, keep.height);
+
+            return index_up;
+        };
+
+        if (balance > 1)
+        {
+            return rotate_up(index_c, c, b, true);
+        }
+
+        if (balance < -1)
+        {
+            return rotate_up(index_b, b, c, false);
+        }
+
+        return index_a;
+    }
+
+    void aabb_tree::fix_upwards(u32 index)
+    {
+        while (index != invalid_node)
+        {
+            index = balance(index);
+
+            node& n = m_nodes[index];
+            const node& child1 = m_nodes[n.child1];
+            const node& child2 = m_nodes[n.child2];
+
+            n.height = 1 + std::max(child1.height, child2.height);
+            n.box = internal::combine(child1.box, child2.box);
+
+            index = n.parent;
+        }
+    }
+
+    bounding_box aabb_tree::fatten(const bounding_box& box) const
+    {
+        return {
+            { box.min.x - m_margin, box.min.y - m_margin, box.min.z - m_margin },
+            { box.max.x + m_margin, box.max.y + m_margin, box.max.z + m_margin }
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "bounding_volume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cera
+{
+    namespace internal
+    {
+        const float3& position_at(const void* positions, size_t index, size_t stride)
+        {
+            return *reinterpret_cast<const float3*>(static_cast<const u8*>(positions) + index * stride);
+        }
+    }
+
+    bounding_box bounding_box::empty()
+    {
+        constexpr float max_float = std::numeric_limits<float>::max();
+
+        return { { max_float, max_float, max_float }, { -max_float, -max_float, -max_float } };
+    }
+
+    bool bounding_box::is_empty() const
+    {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    void bounding_box::expand(const float3& point)
+    {
+        min.x = std::min(min.x, point.x);
+        min.y = std::min(min.y, point.y);
+        min.z = std::min(min.z, point.z);
+        max.x = std::max(max.x, point.x);
+        max.y = std::max(max.y, point.y);
+        max.z = std::max(max.z, point.z);
+    }
+
+    float3 bounding_box::get_center() const
+    {
+        return { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f };
+    }
+
+    float3 bounding_box::get_extents() const
+    {
+        return { (max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f };
+    }
+
+    bounding_box compute_bounding_box(const void* positions, size_t count, size_t stride)
+    {
+        bounding_box box = bounding_box::empty();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            box.expand(internal::position_at(positions, i, stride));
+        }
+
+        return box;
+    }
+
+    bounding_sphere compute_bounding_sphere(const bounding_box& box, const void* positions, size_t count, size_t stride)
+    {
+        bounding_sphere sphere = { box.get_center(), 0.0f };
+
+        float max_distance_squared = 0.0f;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float3& position = internal::position_at(positions, i, stride);
+
+            float dx = position.x - sphere.center.x;
+            float dy = position.y - sphere.center.y;
+            float dz = position.z - sphere.center.z;
+
+            max_distance_squared = std::max(max_distance_squared, dx * dx + dy * dy + dz * dz);
+        }
+
+        sphere.radius = std::sqrt(max_distance_squared);
+
+        return sphere;
+    }
+
+    bool intersect_ray(const bounding_box& box, const float3& origin, const float3& direction, float maxDistance, float& distance)
+    {
+        // Slab test, division by zero results in infinities which compare correctly.
+        const float box_min[3] = { box.min.x, box.min.y, box.min.z };
+        const float box_max[3] = { box.max.x, box.max.y, box.max.z };
+        const float ray_origin[3] = { origin.x, origin.y, origin.z };
+        const float ray_direction[3] = { direction.x, direction.y, direction.z };
+
+        float t_enter = 0.0f;
+        float t_exit = maxDistance;
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            float inverse_direction = 1.0f / ray_direction[axis];
+            float t1 = (box_min[axis] - ray_origin[axis]) * inverse_direction;
+            float t2 = (box_max[axis] - ray_origin[axis]) * inverse_direction;
+
+            t_enter = std::max(t_enter, std::min(t1, t2));
+            t_exit = std::min(t_exit, std::max(t1, t2));
+        }
+
+        if (t_enter > t_exit)
+        {
+            return false;
+        }
+
+        distance = t_enter;
+
+        return true;
+    }
+
+    bounding_box transform(const bounding_box& box, const float4x4& matrix)
+    {
+        if (box.is_empty())
+        {
+            return box;
+        }
+
+        // Transform the center, the extents are projected on the axes with the absolute matrix (Arvo).
+        float3 center = box.get_center();
+        float3 extents = box.get_extents();
+
+        const float in_center[3] = { center.x, center.y, center.z };
+        const float in_extents[3] = { extents.x, extents.y, extents.z };
+
+        float out_center[3];
+        float out_extents[3];
+        for (u32 column = 0; column < 3; ++column)
+        {
+            out_center[column] = matrix.m[3][column];
+            out_extents[column] = 0.0f;
+
+            for (u32 row = 0; row < 3; ++row)
+            {
+                out_center[column] += in_center[row] * matrix.m[row][column];
+                out_extents[column] += in_extents[row] * std::fabs(matrix.m[row][column]);
+            }
+        }
+
+        return {
+            { out_center[0] - out_extents[0], out_center[1] - out_extents[1], out_center[2] - out_extents[2] },
+            { out_center[0] + out_extents[0], out_center[1] + out_extents[1], out_center[2] + out_extents[2] }
+        };
+    }
+
+    bounding_sphere transform(const bounding_sphere& sphere, const float4x4& matrix)
+    {
+        const float3& c = sphere.center;
+
+        bounding_sphere result;
+        result.center.x = c.x * matrix.m[0][0] + c.y * matrix.m[1][0] + c.z * matrix.m[2][0] + matrix.m[3][0];
+        result.center.y = c.x * matrix.m[0][1] + c.y * matrix.m[1][1] + c.z * matrix.m[2][1] + matrix.m[3][1];
+        result.center.z = c.x * matrix.m[0][2] + c.y * matrix.m[1][2] + c.z * matrix.m[2][2] + matrix.m[3][2];
+
+        // Rows 0-2 are the transformed axes, their length is the scale along that axis.
+        float max_scale_squared = 0.0f;
+        for (u32 row = 0; row < 3; ++row)
+        {
+            float length_squared = matrix.m[row][0] * matrix.m[row][0] + matrix.m[row][1] * matrix.m[row][1] + matrix.m[row][2] * matrix.m[row][2];
+            max_scale_squared = std::max(max_scale_squared, length_squared);
+        }
+
+        result.radius = sphere.radius * std::sqrt(max_scale_squared);
+
+        return result;
+    }
+}
\ No newline at end of file
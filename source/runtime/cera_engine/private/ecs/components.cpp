@@ -0,0 +1,35 @@
+#include "ecs/components.h"
+#include "ecs/registry.h"
+
+namespace cera
+{
+    namespace ecs
+    {
+        namespace internal
+        {
+            void update_world_bounds(world_transform& worldTransform, local_bounds& localBounds, world_bounds& worldBounds)
+            {
+                if (!localBounds.box.is_empty())
+                {
+                    worldBounds.box = transform(localBounds.box, worldTransform.matrix);
+                }
+                else
+                {
+                    worldBounds.box = bounding_box::empty();
+                }
+            }
+        }
+
+        void update_world_bounds(registry& registry, threading::thread_pool* threadPool)
+        {
+            if (threadPool)
+            {
+                registry.parallel_for_each<world_transform, local_bounds, world_bounds>(*threadPool, internal::update_world_bounds);
+            }
+            else
+            {
+                registry.for_each<world_transform, local_bounds, world_bounds>(internal::update_world_bounds);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "ecs/registry.h"
+
+#include "util/log.h"
+
+namespace cera
+{
+    namespace ecs
+    {
+        namespace internal
+        {
+            static component_type s_component_types[max_component_types];
+            static std::atomic<u32> s_num_component_types(0);
+
+            u32 register_component_type(const component_type& type)
+            {
+                u32 id = s_num_component_types++;
+                if (id >= max_component_types)
+                {
+                    log::error("Too many ECS component types");
+                    assert(false);
+                    return max_component_types - 1;
+                }
+
+                s_component_types[id] = type;
+
+                return id;
+            }
+
+            const component_type& get_component_type(u32 id)
+            {
+                assert(id < max_component_types);
+                return s_component_types[id];
+            }
+
+            size_t align_up(size_t value, size_t alignment)
+            {
+                return (value + alignment - 1) & ~(alignment - 1);
+            }
+        }
+
+        archetype::archetype(component_mask mask)
+            :m_mask(mask)
+            ,m_offsets()
+            ,m_chunk_capacity(0)
+            ,m_chunk_bytes(0)
+        {
+            for (u32 id = 0; id < max_component_types; ++id)
+            {
+                if ((mask >> id) & 1)
+                {
+                    m_component_ids.push_back(id);
+                }
+            }
+
+            size_t row_size = sizeof(entity);
+            for (u32 id : m_component_ids)
+            {
+                row_size += internal::get_component_type(id).size;
+            }
+
+            // Every array starts on a cache line, reserve the padding before dividing the chunk into rows.
+            size_t padding = (m_component_ids.size() + 1) * memory::cache_line_size;
+            m_chunk_capacity = static_cast<u32>(std::max<size_t>((chunk_size - padding) / row_size, 1));
+
+            size_t offset = internal::align_up(m_chunk_capacity * sizeof(entity), memory::cache_line_size);
+            for (u32 id : m_component_ids)
+            {
+                const internal::component_type& type = internal::get_component_type(id);
+                assert(type.alignment <= memory::cache_line_size);
+
+                m_offsets[id] = static_cast<u32>(offset);
+                offset = internal::align_up(offset + m_chunk_capacity * type.size, memory::cache_line_size);
+            }
+
+            // Larger than chunk_size only when a single row does not fit.
+            m_chunk_bytes = offset;
+        }
+
+        archetype::~archetype()
+        {
+            for (u32 c = 0; c < m_chunks.size(); ++c)
+            {
+                for (u32 row = 0; row < m_chunks[c]->count; ++row)
+                {
+                    destroy_row(c, row);
+                }
+            }
+        }
+
+        size_t archetype::size() const
+        {
+            // Only the last chunk can be partially filled.
+            return m_chunks.empty() ? 0 : (m_chunks.size() - 1) * m_chunk_capacity + m_chunks.back()->count;
+        }
+
+        void archetype::allocate_row(entity entity, u32& chunkIndex, u32& row)
+        {
+            if (m_chunks.empty() || m_chunks.back()->count == m_chunk_capacity)
+            {
+                std::unique_ptr<chunk> new_chunk = std::make_unique<chunk>();
+                new_chunk->data.resize(m_chunk_bytes);
+
+                m_chunks.push_back(std::move(new_chunk));
+            }
+
+            chunk& last = *m_chunks.back();
+
+            chunkIndex = static_cast<u32>(m_chunks.size() - 1);
+            row = last.count++;
+
+            get_entities(last)[row] = entity;
+        }
+
+        entity archetype::remove_row(u32 chunkIndex, u32 row)
+        {
+            chunk& last = *m_chunks.back();
+            u32 last_chunk_index = static_cast<u32>(m_chunks.size() - 1);
+            u32 last_row = last.count - 1;
+
+            entity moved_entity;
+            if (chunkIndex != last_chunk_index || row != last_row)
+            {
+                chunk& target = *m_chunks[chunkIndex];
+                for (u32 id : m_component_ids)
+                {
+                    const internal::component_type& type = internal::get_component_type(id);
+
+                    void* source = get_component(last_chunk_index, last_row, id);
+                    type.move_construct(get_component(chunkIndex, row, id), source);
+                    type.destroy(source);
+                }
+
+                moved_entity = get_entities(last)[last_row];
+                get_entities(target)[row] = moved_entity;
+            }
+
+            if (--last.count == 0)
+            {
+                m_chunks.pop_back();
+            }
+
+            return moved_entity;
+        }
+
+        void archetype::destroy_row(u32 chunkIndex, u32 row)
+        {
+            for (u32 id : m_component_ids)
+            {
+                internal::get_component_type(id).destroy(get_component(chunkIndex, row, id));
+            }
+        }
+
+        registry::registry()
+            :m_num_entities(0)
+        {}
+
+        registry::~registry() = default;
+
+        void registry::destroy(entity entity)
+        {
+            if (!is_alive(entity))
+            {
+                return;
+            }
+
+            entity_record& record = m_records[entity.index];
+
+            record.archetype->destroy_row(record.chunk, record.row);
+
+            ecs::entity moved_entity = record.archetype->remove_row(record.chunk, record.row);
+            if (moved_entity.index != ~0u)
+            {
+                m_records[moved_entity.index].chunk = record.chunk;
+                m_records[moved_entity.index].row = record.row;
+            }
+
+            record.archetype = nullptr;
+            ++record.generation;
+
+            m_free_indices.push_back(entity.index);
+            --m_num_entities;
+        }
+
+        bool registry::is_alive(entity entity) const
+        {
+            return entity.index < m_records.size() && m_records[entity.index].generation == entity.generation && m_records[entity.index].archetype != nullptr;
+        }
+
+        size_t registry::size() const
+        {
+            return m_num_entities;
+        }
+
+        size_t registry::get_num_archetypes() const
+        {
+            return m_archetype_list.size();
+        }
+
+        entity registry::allocate_entity()
+        {
+            ++m_num_entities;
+
+            if (!m_free_indices.empty())
+            {
+                u32 index = m_free_indices.back();
+                m_free_indices.pop_back();
+
+                return { index, m_records[index].generation };
+            }
+
+            m_records.emplace_back();
+
+            return { static_cast<u32>(m_records.size() - 1), 0 };
+        }
+
+        archetype& registry::get_archetype(component_mask mask)
+        {
+            auto it = m_archetypes.find(mask);
+            if (it != m_archetypes.end())
+            {
+                return *it->second;
+            }
+
+            std::unique_ptr<archetype> new_archetype = std::make_unique<archetype>(mask);
+            archetype& result = *new_archetype;
+
+            m_archetypes.emplace(mask, std::move(new_archetype));
+            m_archetype_list.push_back(&result);
+
+            return result;
+        }
+
+        const registry::entity_record& registry::move_entity(entity entity, u32 componentId, bool add)
+        {
+            entity_record& record = m_records[entity.index];
+            archetype& source = *record.archetype;
+
+            // Follow the cached edge, or find the target archetype and remember it for the next entity.
+            std::unordered_map<u32, archetype*>& edges = add ? source.m_add_edges : source.m_remove_edges;
+            auto it = edges.find(componentId);
+            if (it == edges.end())
+            {
+                component_mask bit = component_mask(1) << componentId;
+                it = edges.emplace(componentId, &get_archetype(add ? source.get_mask() | bit : source.get_mask() & ~bit)).first;
+            }
+
+            archetype& target = *it->second;
+
+            u32 target_chunk;
+            u32 target_row;
+            target.allocate_row(entity, target_chunk, target_row);
+
+            for (u32 id : source.get_component_ids())
+            {
+                const internal::component_type& type = internal::get_component_type(id);
+                void* component = source.get_component(record.chunk, record.row, id);
+
+                if (target.has_component(id))
+                {
+                    type.move_construct(target.get_component(target_chunk, target_row, id), component);
+                }
+
+                type.destroy(component);
+            }
+
+            ecs::entity moved_entity = source.remove_row(record.chunk, record.row);
+            if (moved_entity.index != ~0u)
+            {
+                m_records[moved_entity.index].chunk = record.chunk;
+                m_records[moved_entity.index].row = record.row;
+            }
+
+            record.archetype = &target;
+            record.chunk = target_chunk;
+            record.row = target_row;
+
+            return record;
+        }
+    }
+}
\ No newline at end of file
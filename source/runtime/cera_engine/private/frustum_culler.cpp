@@ -0,0 +1,265 @@
+#include "frustum_culler.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__)
+#define CERA_CULLING_AVX 1
+#include <immintrin.h>
+#else
+#define CERA_CULLING_AVX 0
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CERA_CULLING_SSE 1
+#include <xmmintrin.h>
+#else
+#define CERA_CULLING_SSE 0
+#endif
+
+namespace cera
+{
+    frustum frustum::from_view_projection(const float4x4& viewProjection)
+    {
+        const float (&m)[4][4] = viewProjection.m;
+
+        // Gribb/Hartmann, clip = p * M so the planes are combinations of the columns of M.
+        auto column_combination = [&m](u32 column, float sign) -> plane
+        {
+            return {
+                { m[0][3] + sign * m[0][column], m[1][3] + sign * m[1][column], m[2][3] + sign * m[2][column] },
+                m[3][3] + sign * m[3][column]
+            };
+        };
+
+        frustum result;
+        result.planes[0] = column_combination(0, 1.0f);     // left
+        result.planes[1] = column_combination(0, -1.0f);    // right
+        result.planes[2] = column_combination(1, 1.0f);     // bottom
+        result.planes[3] = column_combination(1, -1.0f);    // top
+        result.planes[4] = { { m[0][2], m[1][2], m[2][2] }, m[3][2] }; // near, depth >= 0
+        result.planes[5] = column_combination(2, -1.0f);    // far
+
+        for (plane& p : result.planes)
+        {
+            float length = std::sqrt(p.normal.x * p.normal.x + p.normal.y * p.normal.y + p.normal.z * p.normal.z);
+            if (length > 0.0f)
+            {
+                p.normal.x /= length;
+                p.normal.y /= length;
+                p.normal.z /= length;
+                p.distance /= length;
+            }
+        }
+
+        return result;
+    }
+
+    void frustum_culler::clear()
+    {
+        m_center_x.clear();
+        m_center_y.clear();
+        m_center_z.clear();
+        m_extents_x.clear();
+        m_extents_y.clear();
+        m_extents_z.clear();
+
+        m_num_boxes = 0;
+    }
+
+    void frustum_culler::reserve(size_t count)
+    {
+        count += batch_size;
+
+        m_center_x.reserve(count);
+        m_center_y.reserve(count);
+        m_center_z.reserve(count);
+        m_extents_x.reserve(count);
+        m_extents_y.reserve(count);
+        m_extents_z.reserve(count);
+    }
+
+    u32 frustum_culler::add(const bounding_box& box)
+    {
+        u32 index = m_num_boxes++;
+
+        // Arrays grow a full batch at a time so the SIMD paths never read past the end.
+        if (index % batch_size == 0)
+        {
+            size_t padded_size = index + batch_size;
+            m_center_x.resize(padded_size, 0.0f);
+            m_center_y.resize(padded_size, 0.0f);
+            m_center_z.resize(padded_size, 0.0f);
+            m_extents_x.resize(padded_size, 0.0f);
+            m_extents_y.resize(padded_size, 0.0f);
+            m_extents_z.resize(padded_size, 0.0f);
+        }
+
+        if (box.is_empty())
+        {
+            // Infinite extents make every plane test pass.
+            constexpr float infinity = std::numeric_limits<float>::infinity();
+
+            m_center_x[index] = 0.0f;
+            m_center_y[index] = 0.0f;
+            m_center_z[index] = 0.0f;
+            m_extents_x[index] = infinity;
+            m_extents_y[index] = infinity;
+            m_extents_z[index] = infinity;
+        }
+        else
+        {
+            float3 center = box.get_center();
+            float3 extents = box.get_extents();
+
+            m_center_x[index] = center.x;
+            m_center_y[index] = center.y;
+            m_center_z[index] = center.z;
+            m_extents_x[index] = extents.x;
+            m_extents_y[index] = extents.y;
+            m_extents_z[index] = extents.z;
+        }
+
+        return index;
+    }
+
+    size_t frustum_culler::size() const
+    {
+        return m_num_boxes;
+    }
+
+    u32 frustum_culler::cull(const frustum& frustum, std::vector<u8>& visibility) const
+    {
+        u32 padded_size = static_cast<u32>(m_center_x.size());
+
+        visibility.resize(padded_size);
+
+#if CERA_CULLING_AVX || CERA_CULLING_SSE
+        cull_simd(frustum, 0, padded_size, visibility.data());
+#else
+        cull_scalar(frustum, 0, padded_size, visibility.data());
+#endif
+
+        visibility.resize(m_num_boxes);
+
+        u32 num_visible = 0;
+        for (u8 visible : visibility)
+        {
+            num_visible += visible;
+        }
+
+        return num_visible;
+    }
+
+    void frustum_culler::cull_scalar(const frustum& frustum, u32 begin, u32 end, u8* visibility) const
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            bool outside = false;
+
+            for (const plane& p : frustum.planes)
+            {
+                // Distance of the center to the plane and the projected radius of the box on the plane normal.
+                float distance = m_center_x[i] * p.normal.x + m_center_y[i] * p.normal.y + m_center_z[i] * p.normal.z + p.distance;
+                float radius = m_extents_x[i] * std::fabs(p.normal.x) + m_extents_y[i] * std::fabs(p.normal.y) + m_extents_z[i] * std::fabs(p.normal.z);
+
+                outside |= distance + radius < 0.0f;
+            }
+
+            visibility[i] = outside ? 0 : 1;
+        }
+    }
+
+    void frustum_culler::cull_simd(const frustum& frustum, u32 begin, u32 end, u8* visibility) const
+    {
+#if CERA_CULLING_AVX
+        constexpr u32 lanes = 8;
+
+        __m256 plane_x[frustum::num_planes], plane_y[frustum::num_planes], plane_z[frustum::num_planes], plane_w[frustum::num_planes];
+        __m256 abs_x[frustum::num_planes], abs_y[frustum::num_planes], abs_z[frustum::num_planes];
+        for (u32 i = 0; i < frustum::num_planes; ++i)
+        {
+            const plane& p = frustum.planes[i];
+            plane_x[i] = _mm256_set1_ps(p.normal.x);
+            plane_y[i] = _mm256_set1_ps(p.normal.y);
+            plane_z[i] = _mm256_set1_ps(p.normal.z);
+            plane_w[i] = _mm256_set1_ps(p.distance);
+            abs_x[i] = _mm256_set1_ps(std::fabs(p.normal.x));
+            abs_y[i] = _mm256_set1_ps(std::fabs(p.normal.y));
+            abs_z[i] = _mm256_set1_ps(std::fabs(p.normal.z));
+        }
+
+        const __m256 zero = _mm256_setzero_ps();
+
+        for (u32 i = begin; i < end; i += lanes)
+        {
+            __m256 center_x = _mm256_load_ps(&m_center_x[i]);
+            __m256 center_y = _mm256_load_ps(&m_center_y[i]);
+            __m256 center_z = _mm256_load_ps(&m_center_z[i]);
+            __m256 extents_x = _mm256_load_ps(&m_extents_x[i]);
+            __m256 extents_y = _mm256_load_ps(&m_extents_y[i]);
+            __m256 extents_z = _mm256_load_ps(&m_extents_z[i]);
+
+            __m256 outside = zero;
+            for (u32 p = 0; p < frustum::num_planes; ++p)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(center_x, plane_x[p]), _mm256_mul_ps(center_y, plane_y[p])), _mm256_add_ps(_mm256_mul_ps(center_z, plane_z[p]), plane_w[p]));
+                __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(extents_x, abs_x[p]), _mm256_mul_ps(extents_y, abs_y[p])), _mm256_mul_ps(extents_z, abs_z[p]));
+
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+            }
+
+            u32 outside_mask = static_cast<u32>(_mm256_movemask_ps(outside));
+            for (u32 lane = 0; lane < lanes; ++lane)
+            {
+                visibility[i + lane] = ((outside_mask >> lane) & 1) ^ 1;
+            }
+        }
+#elif CERA_CULLING_SSE
+        constexpr u32 lanes = 4;
+
+        __m128 plane_x[frustum::num_planes], plane_y[frustum::num_planes], plane_z[frustum::num_planes], plane_w[frustum::num_planes];
+        __m128 abs_x[frustum::num_planes], abs_y[frustum::num_planes], abs_z[frustum::num_planes];
+        for (u32 i = 0; i < frustum::num_planes; ++i)
+        {
+            const plane& p = frustum.planes[i];
+            plane_x[i] = _mm_set1_ps(p.normal.x);
+            plane_y[i] = _mm_set1_ps(p.normal.y);
+            plane_z[i] = _mm_set1_ps(p.normal.z);
+            plane_w[i] = _mm_set1_ps(p.distance);
+            abs_x[i] = _mm_set1_ps(std::fabs(p.normal.x));
+            abs_y[i] = _mm_set1_ps(std::fabs(p.normal.y));
+            abs_z[i] = _mm_set1_ps(std::fabs(p.normal.z));
+        }
+
+        const __m128 zero = _mm_setzero_ps();
+
+        for (u32 i = begin; i < end; i += lanes)
+        {
+            __m128 center_x = _mm_load_ps(&m_center_x[i]);
+            __m128 center_y = _mm_load_ps(&m_center_y[i]);
+            __m128 center_z = _mm_load_ps(&m_center_z[i]);
+            __m128 extents_x = _mm_load_ps(&m_extents_x[i]);
+            __m128 extents_y = _mm_load_ps(&m_extents_y[i]);
+            __m128 extents_z = _mm_load_ps(&m_extents_z[i]);
+
+            __m128 outside = zero;
+            for (u32 p = 0; p < frustum::num_planes; ++p)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(center_x, plane_x[p]), _mm_mul_ps(center_y, plane_y[p])), _mm_add_ps(_mm_mul_ps(center_z, plane_z[p]), plane_w[p]));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extents_x, abs_x[p]), _mm_mul_ps(extents_y, abs_y[p])), _mm_mul_ps(extents_z, abs_z[p]));
+
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+            }
+
+            u32 outside_mask = static_cast<u32>(_mm_movemask_ps(outside));
+            for (u32 lane = 0; lane < lanes; ++lane)
+            {
+                visibility[i + lane] = ((outside_mask >> lane) & 1) ^ 1;
+            }
+        }
+#else
+        cull_scalar(frustum, begin, end, visibility);
+#endif
+    }
+}
\ No newline at end of file
@@ -282,7 +282,8 @@ namespace cera
         pipeline_state_stream.rasterizer_state = CD3DX12_RASTERIZER_DESC(rasterizer_desc);
         pipeline_state_stream.depth_stencil_state = CD3DX12_DEPTH_STENCIL_DESC(depth_stencil_desc);
 
-        m_pipeline_state_object = device.create_pipeline_state_object(pipeline_state_stream);
+        // The gui is skipped for the few frames it takes to compile, this keeps startup from stalling on the driver.
+        m_pipeline_state_object = device.create_pipeline_state_object_async(pipeline_state_stream);
     }
 
     gui::~gui()
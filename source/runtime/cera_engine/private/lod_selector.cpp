@@ -0,0 +1,154 @@
+#include "lod_selector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CERA_LOD_SSE 1
+#include <xmmintrin.h>
+#else
+#define CERA_LOD_SSE 0
+#endif
+
+namespace cera
+{
+    float lod_selector::get_projection_scale(const float4x4& projection, float viewportHeight)
+    {
+        // m[1][1] is 1 / tan(fovY / 2), a size of 1 at distance 1 covers m[1][1] / 2 of the viewport height.
+        return projection.m[1][1] * viewportHeight * 0.5f;
+    }
+
+    void lod_selector::clear()
+    {
+        m_center_x.clear();
+        m_center_y.clear();
+        m_center_z.clear();
+        m_radius.clear();
+        m_inverse_error_scale.clear();
+
+        m_lod_errors.clear();
+        m_num_lods.clear();
+        m_previous_lods.clear();
+
+        m_num_objects = 0;
+    }
+
+    void lod_selector::reserve(size_t count)
+    {
+        m_lod_errors.reserve(count);
+        m_num_lods.reserve(count);
+        m_previous_lods.reserve(count);
+        m_center_x.reserve(count);
+        m_center_y.reserve(count);
+        m_center_z.reserve(count);
+        m_radius.reserve(count);
+        m_inverse_error_scale.reserve(count);
+    }
+
+    u32 lod_selector::add(const bounding_sphere& worldSphere, float errorScale, const float* lodErrors, u32 numLods, u32 previousLod)
+    {
+        u32 index = m_num_objects++;
+
+        m_center_x.push_back(worldSphere.center.x);
+        m_center_y.push_back(worldSphere.center.y);
+        m_center_z.push_back(worldSphere.center.z);
+        m_radius.push_back(worldSphere.radius);
+
+        // A degenerate transform shrinks the object to nothing, any level is accurate enough.
+        m_inverse_error_scale.push_back(errorScale > 0.0f ? 1.0f / errorScale : std::numeric_limits<float>::max());
+
+        // Every mesh has at least its full detail level, a count of 0 selects level 0.
+        numLods = std::min(std::max(numLods, 1u), 255u);
+
+        m_lod_errors.push_back(lodErrors);
+        m_num_lods.push_back(static_cast<u8>(numLods));
+        m_previous_lods.push_back(static_cast<u8>(std::min(previousLod, numLods - 1)));
+
+        return index;
+    }
+
+    size_t lod_selector::size() const
+    {
+        return m_num_objects;
+    }
+
+    void lod_selector::select(const float3& cameraPosition, float projectionScale, float maxPixelError, float hysteresis, std::vector<u8>& lods) const
+    {
+        lods.resize(m_num_objects);
+
+        if (m_num_objects == 0)
+        {
+            return;
+        }
+
+        compute_allowed_errors(cameraPosition, maxPixelError / projectionScale);
+
+        float coarsen_factor = 1.0f - std::min(std::max(hysteresis, 0.0f), 1.0f);
+
+        for (u32 i = 0; i < m_num_objects; ++i)
+        {
+            const float* errors = m_lod_errors[i];
+            u32 num_lods = m_num_lods[i];
+            float allowed_error = m_allowed_errors[i];
+
+            // Refine until the error is acceptable, then coarsen while the next level stays clearly below the limit.
+            u32 lod = m_previous_lods[i];
+            while (lod > 0 && errors[lod] > allowed_error)
+            {
+                --lod;
+            }
+
+            while (lod + 1 < num_lods && errors[lod + 1] <= allowed_error * coarsen_factor)
+            {
+                ++lod;
+            }
+
+            lods[i] = static_cast<u8>(lod);
+        }
+    }
+
+    void lod_selector::compute_allowed_errors(const float3& cameraPosition, float errorPerDistance) const
+    {
+        m_allowed_errors.resize(m_num_objects);
+
+        // The allowed world space error grows linearly with the distance to the closest point of the sphere.
+        // Cameras inside a sphere allow no error at all.
+        u32 begin = 0;
+
+#if CERA_LOD_SSE
+        const __m128 camera_x = _mm_set1_ps(cameraPosition.x);
+        const __m128 camera_y = _mm_set1_ps(cameraPosition.y);
+        const __m128 camera_z = _mm_set1_ps(cameraPosition.z);
+        const __m128 error_per_distance = _mm_set1_ps(errorPerDistance);
+        const __m128 zero = _mm_setzero_ps();
+
+        u32 simd_end = m_num_objects - m_num_objects % batch_size;
+        for (; begin < simd_end; begin += batch_size)
+        {
+            __m128 dx = _mm_sub_ps(_mm_load_ps(&m_center_x[begin]), camera_x);
+            __m128 dy = _mm_sub_ps(_mm_load_ps(&m_center_y[begin]), camera_y);
+            __m128 dz = _mm_sub_ps(_mm_load_ps(&m_center_z[begin]), camera_z);
+
+            __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            distance = _mm_max_ps(_mm_sub_ps(distance, _mm_load_ps(&m_radius[begin])), zero);
+
+            __m128 allowed_error = _mm_mul_ps(_mm_mul_ps(distance, error_per_distance), _mm_load_ps(&m_inverse_error_scale[begin]));
+
+            _mm_store_ps(&m_allowed_errors[begin], allowed_error);
+        }
+#endif
+
+        // Objects that do not fill a batch, or all objects without SSE.
+        for (u32 i = begin; i < m_num_objects; ++i)
+        {
+            float dx = m_center_x[i] - cameraPosition.x;
+            float dy = m_center_y[i] - cameraPosition.y;
+            float dz = m_center_z[i] - cameraPosition.z;
+
+            float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - m_radius[i], 0.0f);
+
+            m_allowed_errors[i] = distance * errorPerDistance * m_inverse_error_scale[i];
+        }
+    }
+}
\ No newline at end of file
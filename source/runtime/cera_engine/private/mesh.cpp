@@ -3,11 +3,33 @@
 #include "render/index_buffer.h"
 #include "render/vertex_buffer.h"
 #include "render/command_list.h"
+#include "render/geometry_allocation.h"
+
+#include "util/log.h"
+
+#include <atomic>
+#include <cassert>
 
 namespace cera
 {
+    namespace internal
+    {
+        u32 next_mesh_id()
+        {
+            static std::atomic<u32> s_next_mesh_id(0);
+
+            return s_next_mesh_id.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
     mesh::mesh()
         :m_primitive_topology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+        ,m_lod_errors(1, 0.0f)
+        ,m_base_vertex(0)
+        ,m_num_vertices(0)
+        ,m_id(internal::next_mesh_id())
+        ,m_bounding_box(bounding_box::empty())
+        ,m_bounding_sphere({ { 0.0f, 0.0f, 0.0f }, 0.0f })
     {}
 
     mesh::~mesh() = default;
@@ -50,18 +72,31 @@ namespace cera
         return m_index_buffer;
     }
 
-    size_t mesh::get_index_count() const
+    size_t mesh::get_index_count(u32 lod) const
     {
+        const index_range* range = find_index_range(lod);
+        if (range)
+        {
+            return range->num_indices;
+        }
+
         size_t index_count = 0;
-        if (m_index_buffer)
+
+        auto index_buffer = get_lod_index_buffer(lod);
+        if (index_buffer)
         {
-            index_count = m_index_buffer->get_num_indices();
+            index_count = index_buffer->get_num_indices();
         }
         return index_count;
     }
 
     size_t mesh::get_vertex_count() const
     {
+        if (m_num_vertices > 0)
+        {
+            return m_num_vertices;
+        }
+
         size_t vertex_count = 0;
 
         // To count the number of vertices in the mesh, just take the number of vertices in the first vertex buffer.
@@ -74,7 +109,189 @@ namespace cera
         return vertex_count;
     }
 
-    void mesh::draw(command_list& commandList, u32 instanceCount, u32 startInstance)
+    void mesh::set_vertex_range(u32 baseVertex, u32 numVertices)
+    {
+        m_base_vertex = baseVertex;
+        m_num_vertices = numVertices;
+    }
+
+    u32 mesh::get_base_vertex() const
+    {
+        return m_base_vertex;
+    }
+
+    void mesh::set_index_range(u32 lod, u32 firstIndex, u32 numIndices)
+    {
+        assert(lod < get_num_lods());
+
+        // Levels without a range so far keep drawing their whole index buffer.
+        while (m_index_ranges.size() < get_num_lods())
+        {
+            u32 level = static_cast<u32>(m_index_ranges.size());
+            auto index_buffer = get_lod_index_buffer(level);
+            m_index_ranges.push_back({ 0, index_buffer ? static_cast<u32>(index_buffer->get_num_indices()) : 0 });
+        }
+
+        m_index_ranges[lod] = { firstIndex, numIndices };
+    }
+
+    u32 mesh::get_first_index(u32 lod) const
+    {
+        const index_range* range = find_index_range(lod);
+        return range ? range->first_index : 0;
+    }
+
+    void mesh::set_geometry(const std::shared_ptr<const geometry_allocation>& geometry)
+    {
+        m_geometry = geometry;
+
+        set_vertex_buffer(0, geometry->get_vertex_buffer());
+        set_index_buffer(geometry->get_index_buffer());
+    }
+
+    const std::shared_ptr<const geometry_allocation>& mesh::get_geometry() const
+    {
+        return m_geometry;
+    }
+
+    bool mesh::has_same_bindings(u32 lod, const mesh& other, u32 otherLod) const
+    {
+        // Sorted draws of the same mesh and level are adjacent, skip comparing their buffers.
+        if (this == &other && lod == otherLod)
+        {
+            return true;
+        }
+
+        return m_primitive_topology == other.m_primitive_topology
+            && m_vertex_buffers == other.m_vertex_buffers
+            && get_lod_index_buffer(lod) == other.get_lod_index_buffer(otherLod);
+    }
+
+    u32 mesh::get_id() const
+    {
+        return m_id;
+    }
+
+    void mesh::set_bounds(const bounding_box& box, const bounding_sphere& sphere)
+    {
+        m_bounding_box = box;
+        m_bounding_sphere = sphere;
+    }
+
+    const bounding_box& mesh::get_bounding_box() const
+    {
+        return m_bounding_box;
+    }
+
+    const bounding_sphere& mesh::get_bounding_sphere() const
+    {
+        return m_bounding_sphere;
+    }
+
+    bool mesh::has_bounds() const
+    {
+        return !m_bounding_box.is_empty();
+    }
+
+    void mesh::set_position_quantization(const position_quantization& quantization)
+    {
+        m_position_quantization = quantization;
+    }
+
+    const position_quantization& mesh::get_position_quantization() const
+    {
+        return m_position_quantization;
+    }
+
+    bool mesh::add_lod(const std::shared_ptr<index_buffer>& indexBuffer, float error)
+    {
+        if (!m_index_buffer || !indexBuffer)
+        {
+            log::error("Levels of detail require an index buffer");
+            return false;
+        }
+
+        if (error < m_lod_errors.back())
+        {
+            log::error("Levels of detail must be added with increasing error");
+            return false;
+        }
+
+        m_lod_index_buffers.push_back(indexBuffer);
+        m_lod_errors.push_back(error);
+
+        if (!m_index_ranges.empty())
+        {
+            m_index_ranges.push_back({ 0, static_cast<u32>(indexBuffer->get_num_indices()) });
+        }
+
+        return true;
+    }
+
+    void mesh::clear_lods()
+    {
+        m_lod_index_buffers.clear();
+        m_lod_errors.resize(1);
+
+        if (m_index_ranges.size() > 1)
+        {
+            m_index_ranges.resize(1);
+        }
+    }
+
+    u32 mesh::get_num_lods() const
+    {
+        return static_cast<u32>(m_lod_errors.size());
+    }
+
+    std::shared_ptr<index_buffer> mesh::get_lod_index_buffer(u32 lod) const
+    {
+        if (lod == 0 || lod > m_lod_index_buffers.size())
+        {
+            return m_index_buffer;
+        }
+
+        return m_lod_index_buffers[lod - 1];
+    }
+
+    float mesh::get_lod_error(u32 lod) const
+    {
+        assert(lod < m_lod_errors.size());
+        return m_lod_errors[lod];
+    }
+
+    const float* mesh::get_lod_errors() const
+    {
+        return m_lod_errors.data();
+    }
+
+    void mesh::set_occluder(const std::shared_ptr<const occluder_geometry>& occluder)
+    {
+        m_occluder = occluder;
+    }
+
+    const std::shared_ptr<const occluder_geometry>& mesh::get_occluder() const
+    {
+        return m_occluder;
+    }
+
+    void mesh::set_meshlets(std::vector<meshlet> meshlets)
+    {
+        m_meshlets = std::move(meshlets);
+    }
+
+    const std::vector<meshlet>& mesh::get_meshlets() const
+    {
+        return m_meshlets;
+    }
+
+    void mesh::draw(command_list& commandList, u32 instanceCount, u32 startInstance, u32 lod) const
+    {
+        bind(commandList, lod);
+        draw_bound(commandList, instanceCount, startInstance, lod);
+    }
+
+    void mesh::bind(command_list& commandList, u32 lod) const
     {
         commandList.set_primitive_topology(get_primitive_topology());
 
@@ -83,17 +300,40 @@ namespace cera
             commandList.set_vertex_buffer(vertexBuffer.first, vertexBuffer.second);
         }
 
-        auto indexCount = get_index_count();
+        if (get_index_count(lod) > 0)
+        {
+            commandList.set_index_buffer(get_lod_index_buffer(lod));
+        }
+    }
+
+    void mesh::draw_bound(command_list& commandList, u32 instanceCount, u32 startInstance, u32 lod) const
+    {
+        auto indexCount = get_index_count(lod);
         auto vertexCount = get_vertex_count();
 
         if (indexCount > 0)
         {
-            commandList.set_index_buffer(m_index_buffer);
-            commandList.draw_indexed(indexCount, instanceCount, 0u, 0u, startInstance);
+            commandList.draw_indexed(indexCount, instanceCount, get_first_index(lod), m_base_vertex, startInstance);
         }
         else if (vertexCount > 0)
         {
-            commandList.draw(vertexCount, instanceCount, 0u, startInstance);
+            commandList.draw(vertexCount, instanceCount, m_base_vertex, startInstance);
+        }
+    }
+
+    void mesh::draw_bound_range(command_list& commandList, u32 firstIndex, u32 indexCount, u32 instanceCount, u32 startInstance) const
+    {
+        commandList.draw_indexed(indexCount, instanceCount, get_first_index(0) + firstIndex, m_base_vertex, startInstance);
+    }
+
+    const mesh::index_range* mesh::find_index_range(u32 lod) const
+    {
+        if (m_index_ranges.empty())
+        {
+            return nullptr;
         }
+
+        // Levels out of range fall back to level 0, like get_lod_index_buffer.
+        return &m_index_ranges[lod < m_index_ranges.size() ? lod : 0];
     }
 }
\ No newline at end of file
@@ -0,0 +1,360 @@
+#include "mesh_cache_file.h"
+#include "model_importer.h"
+
+#include "util/hash.h"
+#include "util/log.h"
+
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace cera
+{
+    namespace internal
+    {
+        static_assert(std::is_trivially_copyable_v<meshlet>, "Meshlets are stored as raw bytes in mesh caches");
+        static_assert(sizeof(mesh_cache_file::node_record) == 88 && sizeof(mesh_cache_file::mesh_record) == 120 && sizeof(mesh_cache_file::lod_record) == 16,
+            "Changing the records changes the file format, bump mesh_cache_file::version");
+
+        u64 get_mesh_cache_tables_size(const mesh_cache_file::header& header)
+        {
+            return header.node_count * sizeof(mesh_cache_file::node_record)
+                + header.mesh_count * sizeof(mesh_cache_file::mesh_record)
+                + header.lod_count * sizeof(mesh_cache_file::lod_record)
+                + header.link_count * sizeof(u32)
+                + header.names_size;
+        }
+
+        u64 align_mesh_cache_offset(u64 offset)
+        {
+            return (offset + mesh_cache_file::data_alignment - 1) & ~(mesh_cache_file::data_alignment - 1);
+        }
+
+        // Append a buffer to the data section at the next aligned offset.
+        u64 append_mesh_cache_data(blob& data, const void* source, size_t size)
+        {
+            u64 offset = align_mesh_cache_offset(data.size());
+            data.resize(offset + size);
+            if (size > 0)
+            {
+                memcpy(data.data() + offset, source, size);
+            }
+
+            return offset;
+        }
+
+        bool is_in_mesh_cache_range(u64 offset, u64 count, u64 elementSize, u64 size)
+        {
+            // Counts and element sizes are 32 bit, their product can not overflow.
+            return offset <= size && count * elementSize <= size - offset;
+        }
+
+        template<typename T>
+        void write_mesh_cache_records(std::byte*& destination, const std::vector<T>& records)
+        {
+            if (!records.empty())
+            {
+                memcpy(destination, records.data(), records.size() * sizeof(T));
+                destination += records.size() * sizeof(T);
+            }
+        }
+
+        template<typename T>
+        void read_mesh_cache_records(const u8*& source, u32 count, std::vector<T>& records)
+        {
+            records.resize(count);
+            if (count > 0)
+            {
+                memcpy(records.data(), source, count * sizeof(T));
+                source += count * sizeof(T);
+            }
+        }
+    }
+
+    namespace mesh_cache_io
+    {
+        blob serialize(const cooked_model& model)
+        {
+            std::vector<mesh_cache_file::node_record> nodes;
+            std::vector<mesh_cache_file::mesh_record> meshes;
+            std::vector<mesh_cache_file::lod_record> lods;
+            std::vector<u32> links(model.root_nodes.begin(), model.root_nodes.end());
+            std::string names;
+            blob buffers;
+
+            for (const imported_node& node : model.nodes)
+            {
+                mesh_cache_file::node_record& record = nodes.emplace_back();
+                memcpy(record.local_transform, node.local_transform.m, sizeof(record.local_transform));
+
+                record.name_offset = static_cast<u32>(names.size());
+                record.name_size = static_cast<u32>(node.name.size());
+                names += node.name;
+
+                record.first_mesh = static_cast<u32>(links.size());
+                record.mesh_count = static_cast<u32>(node.meshes.size());
+                links.insert(links.end(), node.meshes.begin(), node.meshes.end());
+
+                record.first_child = static_cast<u32>(links.size());
+                record.child_count = static_cast<u32>(node.children.size());
+                links.insert(links.end(), node.children.begin(), node.children.end());
+            }
+
+            for (const cooked_mesh& mesh : model.meshes)
+            {
+                mesh_cache_file::mesh_record& record = meshes.emplace_back();
+                record.format = static_cast<u32>(mesh.format);
+                record.vertex_stride = mesh.vertex_stride;
+                record.vertex_count = mesh.num_vertices;
+                record.index_size = mesh.index_size;
+                record.index_count = mesh.index_size ? static_cast<u32>(mesh.indices.size() / mesh.index_size) : 0;
+                record.first_lod = static_cast<u32>(lods.size());
+                record.lod_count = static_cast<u32>(mesh.lods.size());
+                record.meshlet_count = static_cast<u32>(mesh.meshlets.size());
+
+                memcpy(record.box, &mesh.box, sizeof(record.box));
+                memcpy(record.sphere, &mesh.sphere, sizeof(record.sphere));
+                memcpy(record.quantization_scale, mesh.quantization.scale, sizeof(record.quantization_scale));
+                memcpy(record.quantization_offset, mesh.quantization.offset, sizeof(record.quantization_offset));
+
+                record.vertex_offset = internal::append_mesh_cache_data(buffers, mesh.vertices.data(), mesh.vertices.size());
+                record.index_offset = internal::append_mesh_cache_data(buffers, mesh.indices.data(), mesh.indices.size());
+                record.meshlet_offset = internal::append_mesh_cache_data(buffers, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(meshlet));
+
+                for (const cooked_lod& lod : mesh.lods)
+                {
+                    mesh_cache_file::lod_record& lod_record = lods.emplace_back();
+                    lod_record.index_count = mesh.index_size ? static_cast<u32>(lod.indices.size() / mesh.index_size) : 0;
+                    lod_record.error = lod.error;
+                    lod_record.index_offset = internal::append_mesh_cache_data(buffers, lod.indices.data(), lod.indices.size());
+                }
+            }
+
+            mesh_cache_file::header header = {};
+            header.magic = mesh_cache_file::magic;
+            header.version = mesh_cache_file::version;
+            header.node_count = static_cast<u32>(nodes.size());
+            header.mesh_count = static_cast<u32>(meshes.size());
+            header.lod_count = static_cast<u32>(lods.size());
+            header.link_count = static_cast<u32>(links.size());
+            header.root_count = static_cast<u32>(model.root_nodes.size());
+            header.names_size = names.size();
+            header.data_offset = internal::align_mesh_cache_offset(sizeof(header) + internal::get_mesh_cache_tables_size(header));
+            header.data_size = buffers.size();
+
+            blob data(header.data_offset + header.data_size);
+
+            std::byte* dst = data.data() + sizeof(header);
+            internal::write_mesh_cache_records(dst, nodes);
+            internal::write_mesh_cache_records(dst, meshes);
+            internal::write_mesh_cache_records(dst, lods);
+            internal::write_mesh_cache_records(dst, links);
+            memcpy(dst, names.data(), names.size());
+
+            if (!buffers.empty())
+            {
+                memcpy(data.data() + header.data_offset, buffers.data(), buffers.size());
+            }
+
+            header.checksum = hash::fnv1a(data.data() + sizeof(header), internal::get_mesh_cache_tables_size(header));
+            memcpy(data.data(), &header, sizeof(header));
+
+            return data;
+        }
+
+        bool read(const u8* data, size_t size, cooked_model_view& model)
+        {
+            model = cooked_model_view();
+
+            mesh_cache_file::header header;
+            if (size < sizeof(header))
+            {
+                return false;
+            }
+
+            memcpy(&header, data, sizeof(header));
+
+            if (header.magic != mesh_cache_file::magic || header.version != mesh_cache_file::version)
+            {
+                return false;
+            }
+
+            // Guard against overflow before validating the sections.
+            if (header.names_size > size)
+            {
+                return false;
+            }
+
+            u64 tables_size = internal::get_mesh_cache_tables_size(header);
+            if (tables_size > size - sizeof(header) || header.data_offset < sizeof(header) + tables_size
+                || header.data_offset % mesh_cache_file::data_alignment != 0 || header.data_offset > size || header.data_size > size - header.data_offset)
+            {
+                return false;
+            }
+
+            if (hash::fnv1a(data + sizeof(header), tables_size) != header.checksum)
+            {
+                return false;
+            }
+
+            std::vector<mesh_cache_file::node_record> nodes;
+            std::vector<mesh_cache_file::mesh_record> meshes;
+            std::vector<mesh_cache_file::lod_record> lods;
+            std::vector<u32> links;
+
+            const u8* src = data + sizeof(header);
+            internal::read_mesh_cache_records(src, header.node_count, nodes);
+            internal::read_mesh_cache_records(src, header.mesh_count, meshes);
+            internal::read_mesh_cache_records(src, header.lod_count, lods);
+            internal::read_mesh_cache_records(src, header.link_count, links);
+            const char* names = reinterpret_cast<const char*>(src);
+
+            const u8* buffers = data + header.data_offset;
+
+            cooked_model_view result;
+            result.meshes.resize(meshes.size());
+            for (size_t i = 0; i < meshes.size(); ++i)
+            {
+                const mesh_cache_file::mesh_record& record = meshes[i];
+
+                bool valid_format = (record.format == static_cast<u32>(vertex_format::pos_color) || record.format == static_cast<u32>(vertex_format::packed_pos_color))
+                    && record.vertex_stride > 0 && (record.index_size == sizeof(u16) || record.index_size == sizeof(u32));
+
+                if (!valid_format || record.first_lod > lods.size() || record.lod_count > lods.size() - record.first_lod
+                    || !internal::is_in_mesh_cache_range(record.vertex_offset, record.vertex_count, record.vertex_stride, header.data_size)
+                    || !internal::is_in_mesh_cache_range(record.index_offset, record.index_count, record.index_size, header.data_size)
+                    || !internal::is_in_mesh_cache_range(record.meshlet_offset, record.meshlet_count, sizeof(meshlet), header.data_size))
+                {
+                    return false;
+                }
+
+                cooked_mesh_view& view = result.meshes[i];
+                view.format = static_cast<vertex_format>(record.format);
+                view.vertex_stride = record.vertex_stride;
+                view.num_vertices = record.vertex_count;
+                view.vertices = buffers + record.vertex_offset;
+                view.index_size = record.index_size;
+                view.num_indices = record.index_count;
+                view.indices = buffers + record.index_offset;
+                view.meshlets = reinterpret_cast<const meshlet*>(buffers + record.meshlet_offset);
+                view.num_meshlets = record.meshlet_count;
+
+                memcpy(&view.box, record.box, sizeof(record.box));
+                memcpy(&view.sphere, record.sphere, sizeof(record.sphere));
+                memcpy(view.quantization.scale, record.quantization_scale, sizeof(record.quantization_scale));
+                memcpy(view.quantization.offset, record.quantization_offset, sizeof(record.quantization_offset));
+
+                for (u32 l = record.first_lod; l < record.first_lod + record.lod_count; ++l)
+                {
+                    if (!internal::is_in_mesh_cache_range(lods[l].index_offset, lods[l].index_count, record.index_size, header.data_size))
+                    {
+                        return false;
+                    }
+
+                    view.lods.push_back({ buffers + lods[l].index_offset, lods[l].index_count, lods[l].error });
+                }
+            }
+
+            // Nodes form a tree, a node with two parents could form a cycle.
+            std::vector<u8> has_parent(nodes.size(), 0);
+
+            auto is_valid_link_range = [&links](u32 first, u32 count)
+            {
+                return first <= links.size() && count <= links.size() - first;
+            };
+
+            if (!is_valid_link_range(0, header.root_count))
+            {
+                return false;
+            }
+
+            for (u32 i = 0; i < header.root_count; ++i)
+            {
+                if (links[i] >= nodes.size() || has_parent[links[i]])
+                {
+                    return false;
+                }
+
+                has_parent[links[i]] = 1;
+                result.root_nodes.push_back(links[i]);
+            }
+
+            result.nodes.resize(nodes.size());
+            for (size_t i = 0; i < nodes.size(); ++i)
+            {
+                const mesh_cache_file::node_record& record = nodes[i];
+                if (record.name_offset > header.names_size || record.name_size > header.names_size - record.name_offset
+                    || !is_valid_link_range(record.first_mesh, record.mesh_count) || !is_valid_link_range(record.first_child, record.child_count))
+                {
+                    return false;
+                }
+
+                imported_node& node = result.nodes[i];
+                node.name.assign(names + record.name_offset, record.name_size);
+                memcpy(node.local_transform.m, record.local_transform, sizeof(record.local_transform));
+
+                for (u32 l = record.first_mesh; l < record.first_mesh + record.mesh_count; ++l)
+                {
+                    if (links[l] >= meshes.size())
+                    {
+                        return false;
+                    }
+
+                    node.meshes.push_back(links[l]);
+                }
+
+                for (u32 l = record.first_child; l < record.first_child + record.child_count; ++l)
+                {
+                    if (links[l] >= nodes.size() || has_parent[links[l]])
+                    {
+                        return false;
+                    }
+
+                    has_parent[links[l]] = 1;
+                    node.children.push_back(links[l]);
+                }
+            }
+
+            model = std::move(result);
+
+            return true;
+        }
+
+        bool save(const std::filesystem::path& path, const cooked_model& model)
+        {
+            blob data = serialize(model);
+
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            if (!stream)
+            {
+                return false;
+            }
+
+            stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+            return stream.good();
+        }
+
+        bool cook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, vertex_format format, threading::thread_pool* threadPool)
+        {
+            model_importer importer(threadPool);
+
+            imported_model model;
+            if (!importer.load(sourcePath, model))
+            {
+                return false;
+            }
+
+            cooked_model cooked;
+            mesh_cooker::cook_model(model, format, threadPool, cooked);
+
+            if (!save(cachePath, cooked))
+            {
+                log::error("Failed to write mesh cache: {}", cachePath.string());
+                return false;
+            }
+
+            return true;
+        }
+    }
+}
\ No newline at end of file
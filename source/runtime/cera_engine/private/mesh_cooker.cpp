@@ -0,0 +1,332 @@
+#include "mesh_cooker.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "vertex_welder.h"
+
+#include "util/threading/thread_pool.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace cera
+{
+    namespace internal
+    {
+        // Meshes with fewer triangles are cheap enough to always draw at full detail.
+        constexpr size_t min_lod_triangles = 512;
+        // Meshes with fewer triangles are always drawn as a whole.
+        constexpr size_t min_meshlet_triangles = 512;
+
+        // Largest vertex count drawn with 16 bit indices. The index 0xFFFF is left unused, it cuts strips when primitive restart is enabled.
+        constexpr size_t max_16_bit_index_vertices = 0xFFFF;
+
+        // Layout of vertex_pos_color and vertex_packed_pos_color, the vertex types are not visible without the graphics API.
+        constexpr u32 pos_color_stride = 6 * sizeof(float);
+        constexpr u32 packed_pos_color_stride = 4 * sizeof(u16) + sizeof(u32);
+        constexpr size_t packed_color_offset = 4 * sizeof(u16);
+
+        // Vertex of imported models while they are cooked.
+        struct cooker_vertex
+        {
+            float3 position;
+            float3 color;
+        };
+
+        optimizer_input make_cooker_optimizer_input(const cooker_input& input, u32* indices, size_t numIndices)
+        {
+            optimizer_input optimizer;
+            optimizer.vertices = input.vertices;
+            optimizer.num_vertices = input.num_vertices;
+            optimizer.vertex_stride = input.vertex_stride;
+            optimizer.position_offset = input.position_offset;
+            optimizer.indices = indices;
+            optimizer.num_indices = numIndices;
+
+            return optimizer;
+        }
+
+        /**
+         * Store indices with the smallest index format that can address all vertices.
+         * 16 bit indices halve the memory and bandwidth of the index buffer.
+         */
+        blob narrow_indices(const u32* indices, size_t numIndices, u32 indexSize)
+        {
+            blob data(numIndices * indexSize);
+            if (indexSize == sizeof(u32))
+            {
+                memcpy(data.data(), indices, data.size());
+                return data;
+            }
+
+            for (size_t i = 0; i < numIndices; ++i)
+            {
+                u16 index = static_cast<u16>(indices[i]);
+                memcpy(data.data() + i * sizeof(u16), &index, sizeof(u16));
+            }
+
+            return data;
+        }
+
+        /**
+         * Encode the vertices in the requested format, packed positions are quantized to the bounds of the mesh.
+         */
+        void encode_vertices(const cooker_input& input, vertex_format format, cooked_mesh& mesh)
+        {
+            const u8* vertices = static_cast<const u8*>(input.vertices);
+
+            mesh.format = format;
+            mesh.num_vertices = static_cast<u32>(input.num_vertices);
+
+            if (format == vertex_format::pos_color)
+            {
+                mesh.vertex_stride = pos_color_stride;
+                mesh.vertices.resize(input.num_vertices * pos_color_stride);
+
+                for (size_t i = 0; i < input.num_vertices; ++i)
+                {
+                    std::byte* vertex = mesh.vertices.data() + i * pos_color_stride;
+                    memcpy(vertex, vertices + i * input.vertex_stride + input.position_offset, sizeof(float3));
+                    memcpy(vertex + sizeof(float3), vertices + i * input.vertex_stride + input.color_offset, sizeof(float3));
+                }
+
+                return;
+            }
+
+            mesh.vertex_stride = packed_pos_color_stride;
+            mesh.vertices.resize(input.num_vertices * packed_pos_color_stride);
+
+            mesh.quantization = vertex_encoder::compute_position_quantization(vertices + input.position_offset, input.num_vertices, input.vertex_stride);
+            vertex_encoder::encode_positions_unorm16(vertices + input.position_offset, input.num_vertices, input.vertex_stride, mesh.quantization, mesh.vertices.data(), packed_pos_color_stride);
+            vertex_encoder::encode_colors_rgba8(vertices + input.color_offset, input.num_vertices, input.vertex_stride, 3, mesh.vertices.data() + packed_color_offset, packed_pos_color_stride);
+        }
+
+        /**
+         * Merge vertices with equal positions and colors. Shapes that split their faces and imported meshes
+         * that were split by normals or texture coordinates, which are not cooked, share their vertices again.
+         */
+        bool weld_cooker_input(const cooker_input& input, cooker_input& welded)
+        {
+            welded = input;
+
+            u8* vertices = static_cast<u8*>(input.vertices);
+
+            welder_input welder_input;
+            welder_input.num_vertices = input.num_vertices;
+            welder_input.attributes.push_back({ vertices + input.position_offset, input.vertex_stride, 3, 0.0f });
+            welder_input.attributes.push_back({ vertices + input.color_offset, input.vertex_stride, 3, 0.0f });
+            welder_input.indices = input.indices;
+            welder_input.num_indices = input.num_indices;
+
+            vertex_welder welder;
+            welder_result result;
+            if (!welder.weld(welder_input, result))
+            {
+                return false;
+            }
+
+            if (result.num_indices == 0)
+            {
+                log::error("Mesh has no triangles with an area");
+                return false;
+            }
+
+            welded.num_vertices = result.num_vertices;
+            welded.num_indices = result.num_indices;
+
+            return true;
+        }
+
+        /**
+         * Simplify the mesh to a chain of levels of detail, every level halves the triangle count.
+         * Levels share the vertices of the mesh, only their triangles are reordered.
+         */
+        void cook_lods(const cooker_input& input, cooked_mesh& mesh)
+        {
+            if (input.num_indices / 3 < min_lod_triangles)
+            {
+                return;
+            }
+
+            simplifier_input simplifier_input;
+            simplifier_input.vertices = input.vertices;
+            simplifier_input.num_vertices = input.num_vertices;
+            simplifier_input.vertex_stride = input.vertex_stride;
+            simplifier_input.position_offset = input.position_offset;
+            simplifier_input.attribute_offset = input.color_offset;
+            simplifier_input.num_attributes = 3;
+            simplifier_input.indices = input.indices;
+            simplifier_input.num_indices = input.num_indices;
+
+            mesh_simplifier simplifier;
+            std::vector<simplified_lod> lods;
+            simplifier.generate_lods(simplifier_input, { 0.5f, 0.25f, 0.125f }, lods);
+
+            mesh_optimizer optimizer;
+            for (simplified_lod& lod : lods)
+            {
+                optimizer.optimize_triangles(make_cooker_optimizer_input(input, lod.indices.data(), lod.indices.size()));
+
+                cooked_lod& cooked = mesh.lods.emplace_back();
+                cooked.indices = narrow_indices(lod.indices.data(), lod.indices.size(), mesh.index_size);
+                cooked.error = lod.error;
+            }
+        }
+    }
+
+    namespace mesh_cooker
+    {
+        bool cook_mesh(const cooker_input& input, vertex_format format, bool optimized, cooked_mesh& mesh)
+        {
+            mesh = cooked_mesh();
+
+            if (!input.vertices || input.num_vertices == 0 || !input.indices || input.num_indices == 0 || input.num_indices % 3 != 0
+                || input.vertex_stride < input.position_offset + sizeof(float3) || input.vertex_stride < input.color_offset + sizeof(float3))
+            {
+                log::error("Invalid mesh cooker input");
+                return false;
+            }
+
+            cooker_input welded;
+            if (!internal::weld_cooker_input(input, welded))
+            {
+                return false;
+            }
+
+            if (!optimized)
+            {
+                mesh_optimizer optimizer;
+                if (!optimizer.optimize(internal::make_cooker_optimizer_input(welded, welded.indices, welded.num_indices)))
+                {
+                    return false;
+                }
+            }
+
+            // Meshlets reorder the triangles, they are built before the indices are stored.
+            if (welded.num_indices / 3 >= internal::min_meshlet_triangles)
+            {
+                meshlet_builder_input meshlet_input;
+                meshlet_input.vertices = welded.vertices;
+                meshlet_input.num_vertices = welded.num_vertices;
+                meshlet_input.vertex_stride = welded.vertex_stride;
+                meshlet_input.position_offset = welded.position_offset;
+                meshlet_input.indices = welded.indices;
+                meshlet_input.num_indices = welded.num_indices;
+
+                meshlet_builder builder;
+                builder.build(meshlet_input, mesh.meshlets);
+            }
+
+            internal::encode_vertices(welded, format, mesh);
+
+            mesh.index_size = welded.num_vertices <= internal::max_16_bit_index_vertices ? sizeof(u16) : sizeof(u32);
+            mesh.indices = internal::narrow_indices(welded.indices, welded.num_indices, mesh.index_size);
+
+            const void* positions = static_cast<const u8*>(welded.vertices) + welded.position_offset;
+            mesh.box = compute_bounding_box(positions, welded.num_vertices, welded.vertex_stride);
+            mesh.sphere = compute_bounding_sphere(mesh.box, positions, welded.num_vertices, welded.vertex_stride);
+
+            internal::cook_lods(welded, mesh);
+
+            return true;
+        }
+
+        void cook_model(const imported_model& model, vertex_format format, threading::thread_pool* threadPool, cooked_model& cooked)
+        {
+            cooked.meshes.clear();
+            cooked.meshes.resize(model.meshes.size());
+            cooked.nodes = model.nodes;
+            cooked.root_nodes = model.root_nodes;
+
+            // Every thread takes the next mesh until all meshes are cooked.
+            std::atomic<size_t> next_mesh(0);
+            auto cook_meshes = [&model, &cooked, &next_mesh, format]()
+            {
+                std::vector<internal::cooker_vertex> vertices;
+                std::vector<u32> indices;
+
+                for (size_t i = next_mesh++; i < model.meshes.size(); i = next_mesh++)
+                {
+                    const imported_mesh& imported = model.meshes[i];
+
+                    vertices.resize(imported.positions.size());
+                    for (size_t v = 0; v < vertices.size(); ++v)
+                    {
+                        vertices[v] = { imported.positions[v], imported.color };
+                    }
+
+                    indices = imported.indices;
+
+                    cooker_input input;
+                    input.vertices = vertices.data();
+                    input.num_vertices = vertices.size();
+                    input.vertex_stride = sizeof(internal::cooker_vertex);
+                    input.position_offset = offsetof(internal::cooker_vertex, position);
+                    input.color_offset = offsetof(internal::cooker_vertex, color);
+                    input.indices = indices.data();
+                    input.num_indices = indices.size();
+
+                    // Meshes that fail to cook stay empty and are skipped when the model is uploaded.
+                    cook_mesh(input, format, false, cooked.meshes[i]);
+                }
+            };
+
+            if (threadPool)
+            {
+                size_t num_tasks = std::min<size_t>(threadPool->get_num_threads(), model.meshes.size());
+                for (size_t i = 0; i < num_tasks; ++i)
+                {
+                    threadPool->submit(cook_meshes);
+                }
+            }
+
+            cook_meshes();
+
+            if (threadPool)
+            {
+                threadPool->wait_idle();
+            }
+        }
+
+        cooked_mesh_view get_view(const cooked_mesh& mesh)
+        {
+            cooked_mesh_view view;
+            view.format = mesh.format;
+            view.vertex_stride = mesh.vertex_stride;
+            view.num_vertices = mesh.num_vertices;
+            view.vertices = mesh.vertices.data();
+            view.index_size = mesh.index_size;
+            view.num_indices = mesh.index_size ? static_cast<u32>(mesh.indices.size() / mesh.index_size) : 0;
+            view.indices = mesh.indices.data();
+
+            for (const cooked_lod& lod : mesh.lods)
+            {
+                view.lods.push_back({ lod.indices.data(), static_cast<u32>(lod.indices.size() / mesh.index_size), lod.error });
+            }
+
+            view.meshlets = mesh.meshlets.data();
+            view.num_meshlets = static_cast<u32>(mesh.meshlets.size());
+            view.box = mesh.box;
+            view.sphere = mesh.sphere;
+            view.quantization = mesh.quantization;
+
+            return view;
+        }
+
+        cooked_model_view get_view(const cooked_model& model)
+        {
+            cooked_model_view view;
+            view.meshes.reserve(model.meshes.size());
+            for (const cooked_mesh& mesh : model.meshes)
+            {
+                view.meshes.push_back(get_view(mesh));
+            }
+
+            view.nodes = model.nodes;
+            view.root_nodes = model.root_nodes;
+
+            return view;
+        }
+    }
+}
\ No newline at end of file
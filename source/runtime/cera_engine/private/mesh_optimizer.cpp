@@ -0,0 +1,498 @@
+#include "mesh_optimizer.h"
+
+#include "util/threading/thread_pool.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace cera
+{
+    namespace internal
+    {
+        constexpr u32 invalid_vertex = ~0u;
+
+        // Vertex fetches are simulated with a cache of 64 byte lines, small enough to be shared by many vertex shader waves.
+        constexpr size_t fetch_line_size = 64;
+        constexpr u32 fetch_cache_lines = 64;
+
+        inline void read_optimizer_position(const optimizer_input& input, u32 vertex, float* position)
+        {
+            memcpy(position, static_cast<const u8*>(input.vertices) + vertex * input.vertex_stride + input.position_offset, 3 * sizeof(float));
+        }
+
+        /**
+         * A FIFO cache simulated with timestamps. An entry is cached while fewer than size entries were inserted after it.
+         */
+        struct fifo_cache
+        {
+            std::vector<u32> times;
+            u32 time;
+            u32 size;
+
+            fifo_cache(size_t numEntries, u32 cacheSize)
+                :times(numEntries, 0)
+                ,time(cacheSize + 1)
+                ,size(cacheSize)
+            {}
+
+            // Returns true on a miss, the entry is inserted.
+            bool access(u32 entry)
+            {
+                if (time - times[entry] > size)
+                {
+                    times[entry] = time++;
+                    return true;
+                }
+                return false;
+            }
+
+            // Evict all entries.
+            void flush()
+            {
+                time += size + 1;
+            }
+        };
+    }
+
+    mesh_optimizer::mesh_optimizer(const mesh_optimizer_settings& settings)
+        :m_settings(settings)
+    {}
+
+    bool mesh_optimizer::optimize(const optimizer_input& input, mesh_optimizer_statistics* before, mesh_optimizer_statistics* after)
+    {
+        if (!validate(input))
+        {
+            return false;
+        }
+
+        if (before)
+        {
+            *before = analyze(input, m_settings.cache_size);
+        }
+
+        optimize_vertex_cache(input);
+        optimize_overdraw(input);
+        optimize_vertex_fetch(input);
+
+        if (after)
+        {
+            *after = analyze(input, m_settings.cache_size);
+        }
+
+        return true;
+    }
+
+    bool mesh_optimizer::optimize_triangles(const optimizer_input& input)
+    {
+        if (!validate(input))
+        {
+            return false;
+        }
+
+        optimize_vertex_cache(input);
+        optimize_overdraw(input);
+
+        return true;
+    }
+
+    void mesh_optimizer::optimize(const std::vector<optimizer_input>& inputs, const mesh_optimizer_settings& settings, threading::thread_pool* threadPool)
+    {
+        // Every thread owns an optimizer and takes the next mesh until all meshes are done.
+        std::atomic<size_t> next_input(0);
+        auto optimize_inputs = [&inputs, &settings, &next_input]()
+        {
+            mesh_optimizer optimizer(settings);
+
+            for (size_t i = next_input++; i < inputs.size(); i = next_input++)
+            {
+                optimizer.optimize(inputs[i]);
+            }
+        };
+
+        if (threadPool)
+        {
+            size_t num_tasks = std::min<size_t>(threadPool->get_num_threads(), inputs.size());
+            for (size_t i = 0; i < num_tasks; ++i)
+            {
+                threadPool->submit(optimize_inputs);
+            }
+        }
+
+        optimize_inputs();
+
+        if (threadPool)
+        {
+            threadPool->wait_idle();
+        }
+    }
+
+    mesh_optimizer_statistics mesh_optimizer::analyze(const optimizer_input& input, u32 cacheSize)
+    {
+        mesh_optimizer_statistics statistics;
+
+        if (input.num_indices == 0 || input.vertex_stride == 0)
+        {
+            return statistics;
+        }
+
+        internal::fifo_cache vertex_cache(input.num_vertices, cacheSize);
+
+        size_t num_lines = (input.num_vertices * input.vertex_stride + internal::fetch_line_size - 1) / internal::fetch_line_size;
+        internal::fifo_cache fetch_cache(num_lines, internal::fetch_cache_lines);
+
+        std::vector<u8> referenced(input.num_vertices, 0);
+
+        size_t num_transformed = 0;
+        size_t num_referenced = 0;
+        size_t num_fetched_lines = 0;
+
+        for (size_t i = 0; i < input.num_indices; ++i)
+        {
+            u32 vertex = input.indices[i];
+
+            if (!referenced[vertex])
+            {
+                referenced[vertex] = 1;
+                ++num_referenced;
+            }
+
+            if (!vertex_cache.access(vertex))
+            {
+                continue;
+            }
+
+            ++num_transformed;
+
+            // Only transformed vertices are fetched, a vertex can straddle two lines.
+            size_t first_line = vertex * input.vertex_stride / internal::fetch_line_size;
+            size_t last_line = ((vertex + 1) * input.vertex_stride - 1) / internal::fetch_line_size;
+            for (size_t line = first_line; line <= last_line; ++line)
+            {
+                num_fetched_lines += fetch_cache.access(static_cast<u32>(line)) ? 1 : 0;
+            }
+        }
+
+        statistics.acmr = static_cast<float>(num_transformed) / static_cast<float>(input.num_indices / 3);
+        statistics.atvr = static_cast<float>(num_transformed) / static_cast<float>(num_referenced);
+        statistics.overfetch = static_cast<float>(num_fetched_lines * internal::fetch_line_size) / static_cast<float>(num_referenced * input.vertex_stride);
+
+        return statistics;
+    }
+
+    bool mesh_optimizer::validate(const optimizer_input& input) const
+    {
+        if (!input.vertices || !input.indices || input.num_indices % 3 != 0 || input.vertex_stride < input.position_offset + 3 * sizeof(float) || m_settings.cache_size < 3)
+        {
+            log::error("Invalid mesh optimizer input");
+            return false;
+        }
+
+        for (size_t i = 0; i < input.num_indices; ++i)
+        {
+            if (input.indices[i] >= input.num_vertices)
+            {
+                log::error("Mesh optimizer input indexes a vertex out of range");
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void mesh_optimizer::optimize_vertex_cache(const optimizer_input& input)
+    {
+        u32 num_vertices = static_cast<u32>(input.num_vertices);
+        u32 num_triangles = static_cast<u32>(input.num_indices / 3);
+
+        m_indices.assign(input.indices, input.indices + input.num_indices);
+
+        // Triangles around every vertex, a degenerate triangle is listed once for every corner.
+        m_live_triangles.assign(num_vertices, 0);
+        for (u32 vertex : m_indices)
+        {
+            ++m_live_triangles[vertex];
+        }
+
+        m_adjacency_offsets.resize(num_vertices + 1);
+        m_adjacency_offsets[0] = 0;
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            m_adjacency_offsets[vertex + 1] = m_adjacency_offsets[vertex] + m_live_triangles[vertex];
+        }
+
+        m_adjacency.resize(m_indices.size());
+        m_cache_times.assign(m_adjacency_offsets.begin(), m_adjacency_offsets.end() - 1);
+        for (u32 i = 0; i < m_indices.size(); ++i)
+        {
+            m_adjacency[m_cache_times[m_indices[i]]++] = i / 3;
+        }
+
+        m_cache_times.assign(num_vertices, 0);
+        m_emitted.assign(num_triangles, 0);
+        m_dead_ends.clear();
+
+        u32 cache_size = m_settings.cache_size;
+        u32 time = cache_size + 1;
+        u32 cursor = 0;
+        size_t num_emitted_indices = 0;
+
+        u32 fanning_vertex = num_vertices > 0 ? 0 : internal::invalid_vertex;
+        while (fanning_vertex != internal::invalid_vertex)
+        {
+            m_candidates.clear();
+
+            // Emit all remaining triangles around the fanning vertex.
+            for (u32 i = m_adjacency_offsets[fanning_vertex]; i < m_adjacency_offsets[fanning_vertex + 1]; ++i)
+            {
+                u32 triangle = m_adjacency[i];
+                if (m_emitted[triangle])
+                {
+                    continue;
+                }
+
+                m_emitted[triangle] = 1;
+
+                for (u32 corner = 0; corner < 3; ++corner)
+                {
+                    u32 vertex = m_indices[triangle * 3 + corner];
+                    input.indices[num_emitted_indices++] = vertex;
+
+                    m_dead_ends.push_back(vertex);
+                    m_candidates.push_back(vertex);
+                    --m_live_triangles[vertex];
+
+                    if (time - m_cache_times[vertex] > cache_size)
+                    {
+                        m_cache_times[vertex] = time++;
+                    }
+                }
+            }
+
+            fanning_vertex = get_next_vertex(time, cursor);
+        }
+    }
+
+    u32 mesh_optimizer::get_next_vertex(u32 time, u32& cursor)
+    {
+        u32 cache_size = m_settings.cache_size;
+
+        // Prefer the oldest candidate that stays in the cache while its remaining triangles are emitted.
+        u32 best_vertex = internal::invalid_vertex;
+        s32 best_priority = -1;
+        for (u32 vertex : m_candidates)
+        {
+            if (m_live_triangles[vertex] == 0)
+            {
+                continue;
+            }
+
+            s32 priority = 0;
+            u32 age = time - m_cache_times[vertex];
+            if (age + 2 * m_live_triangles[vertex] <= cache_size)
+            {
+                priority = static_cast<s32>(age);
+            }
+
+            if (priority > best_priority)
+            {
+                best_priority = priority;
+                best_vertex = vertex;
+            }
+        }
+
+        if (best_vertex != internal::invalid_vertex)
+        {
+            return best_vertex;
+        }
+
+        // Dead end, continue with a recently used vertex before jumping to an unvisited part of the mesh.
+        while (!m_dead_ends.empty())
+        {
+            u32 vertex = m_dead_ends.back();
+            m_dead_ends.pop_back();
+
+            if (m_live_triangles[vertex] > 0)
+            {
+                return vertex;
+            }
+        }
+
+        while (cursor < m_live_triangles.size())
+        {
+            if (m_live_triangles[cursor] > 0)
+            {
+                return cursor;
+            }
+            ++cursor;
+        }
+
+        return internal::invalid_vertex;
+    }
+
+    void mesh_optimizer::optimize_overdraw(const optimizer_input& input)
+    {
+        size_t num_triangles = input.num_indices / 3;
+        if (m_settings.overdraw_threshold < 1.0f || num_triangles < 2)
+        {
+            return;
+        }
+
+        m_indices.assign(input.indices, input.indices + input.num_indices);
+
+        internal::fifo_cache cache(input.num_vertices, m_settings.cache_size);
+
+        size_t num_misses = 0;
+        for (u32 vertex : m_indices)
+        {
+            num_misses += cache.access(vertex) ? 1 : 0;
+        }
+
+        float max_cluster_acmr = m_settings.overdraw_threshold * static_cast<float>(num_misses) / static_cast<float>(num_triangles);
+
+        // Cut the triangles into clusters that are drawn with a cold cache. A cluster ends as soon as
+        // its own miss ratio is low enough, drawing the clusters in any order keeps the ratio of the mesh
+        // below the threshold.
+        m_cluster_offsets.clear();
+        m_cluster_offsets.push_back(0);
+
+        cache.flush();
+        size_t cluster_misses = 0;
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                cluster_misses += cache.access(m_indices[triangle * 3 + corner]) ? 1 : 0;
+            }
+
+            size_t cluster_triangles = triangle + 1 - m_cluster_offsets.back();
+            if (triangle + 1 < num_triangles && static_cast<float>(cluster_misses) <= max_cluster_acmr * static_cast<float>(cluster_triangles))
+            {
+                m_cluster_offsets.push_back(static_cast<u32>(triangle + 1));
+                cache.flush();
+                cluster_misses = 0;
+            }
+        }
+
+        m_cluster_offsets.push_back(static_cast<u32>(num_triangles));
+
+        size_t num_clusters = m_cluster_offsets.size() - 1;
+        if (num_clusters < 2)
+        {
+            return;
+        }
+
+        // Area weighted centroid and normal of every cluster, and the centroid of the mesh.
+        m_cluster_data.assign(num_clusters * 6, 0.0f);
+        float mesh_centroid[3] = { 0.0f, 0.0f, 0.0f };
+        float mesh_area = 0.0f;
+
+        for (size_t cluster = 0; cluster < num_clusters; ++cluster)
+        {
+            float* centroid = &m_cluster_data[cluster * 6];
+            float* normal = centroid + 3;
+            float cluster_area = 0.0f;
+
+            for (u32 triangle = m_cluster_offsets[cluster]; triangle < m_cluster_offsets[cluster + 1]; ++triangle)
+            {
+                float p0[3], p1[3], p2[3];
+                internal::read_optimizer_position(input, m_indices[triangle * 3 + 0], p0);
+                internal::read_optimizer_position(input, m_indices[triangle * 3 + 1], p1);
+                internal::read_optimizer_position(input, m_indices[triangle * 3 + 2], p2);
+
+                float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+                float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+                for (u32 axis = 0; axis < 3; ++axis)
+                {
+                    centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) * (area / 3.0f);
+                    normal[axis] += n[axis];
+                }
+                cluster_area += area;
+            }
+
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                mesh_centroid[axis] += centroid[axis];
+                centroid[axis] = cluster_area > 0.0f ? centroid[axis] / cluster_area : 0.0f;
+            }
+            mesh_area += cluster_area;
+        }
+
+        for (u32 axis = 0; axis < 3; ++axis)
+        {
+            mesh_centroid[axis] = mesh_area > 0.0f ? mesh_centroid[axis] / mesh_area : 0.0f;
+        }
+
+        // Clusters that face away from the center of the mesh are drawn first.
+        m_cluster_keys.resize(num_clusters);
+        m_cluster_order.resize(num_clusters);
+        for (size_t cluster = 0; cluster < num_clusters; ++cluster)
+        {
+            const float* centroid = &m_cluster_data[cluster * 6];
+            const float* normal = centroid + 3;
+            float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            float key = 0.0f;
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                key += (centroid[axis] - mesh_centroid[axis]) * normal[axis];
+            }
+
+            m_cluster_keys[cluster] = length > 0.0f ? key / length : 0.0f;
+            m_cluster_order[cluster] = static_cast<u32>(cluster);
+        }
+
+        std::stable_sort(m_cluster_order.begin(), m_cluster_order.end(), [this](u32 a, u32 b) { return m_cluster_keys[a] > m_cluster_keys[b]; });
+
+        size_t num_written_indices = 0;
+        for (u32 cluster : m_cluster_order)
+        {
+            size_t first_index = m_cluster_offsets[cluster] * 3;
+            size_t num_cluster_indices = (m_cluster_offsets[cluster + 1] - m_cluster_offsets[cluster]) * 3;
+
+            memcpy(input.indices + num_written_indices, m_indices.data() + first_index, num_cluster_indices * sizeof(u32));
+            num_written_indices += num_cluster_indices;
+        }
+    }
+
+    void mesh_optimizer::optimize_vertex_fetch(const optimizer_input& input)
+    {
+        u32 num_vertices = static_cast<u32>(input.num_vertices);
+
+        // Number the vertices in the order the triangles reference them.
+        m_remap.assign(num_vertices, internal::invalid_vertex);
+        u32 next_vertex = 0;
+
+        for (size_t i = 0; i < input.num_indices; ++i)
+        {
+            u32& new_vertex = m_remap[input.indices[i]];
+            if (new_vertex == internal::invalid_vertex)
+            {
+                new_vertex = next_vertex++;
+            }
+
+            input.indices[i] = new_vertex;
+        }
+
+        for (u32& new_vertex : m_remap)
+        {
+            if (new_vertex == internal::invalid_vertex)
+            {
+                new_vertex = next_vertex++;
+            }
+        }
+
+        u8* vertex_data = static_cast<u8*>(input.vertices);
+        m_vertex_data.assign(vertex_data, vertex_data + input.num_vertices * input.vertex_stride);
+
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            memcpy(vertex_data + m_remap[vertex] * input.vertex_stride, m_vertex_data.data() + vertex * input.vertex_stride, input.vertex_stride);
+        }
+    }
+}
\ No newline at end of file
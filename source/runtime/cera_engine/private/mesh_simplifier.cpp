@@ -0,0 +1,718 @@
+#include "mesh_simplifier.h"
+
+#include "util/threading/thread_pool.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace cera
+{
+    namespace internal
+    {
+        u32 hash_floats(const float* values, u32 count)
+        {
+            // Murmur style mixing of the bit patterns, equal bit patterns are welded.
+            u32 hash = 0;
+            for (u32 i = 0; i < count; ++i)
+            {
+                u32 bits;
+                memcpy(&bits, &values[i], sizeof(bits));
+
+                bits *= 0x5bd1e995;
+                bits ^= bits >> 24;
+                bits *= 0x5bd1e995;
+
+                hash *= 0x5bd1e995;
+                hash ^= bits;
+            }
+            return hash;
+        }
+
+        /**
+         * Map every vertex to the first vertex with the same key.
+         * The table is an open addressing hash table of vertex indices.
+         */
+        template <typename Hash, typename Equal>
+        void build_vertex_remap(u32 numVertices, const Hash& hash, const Equal& equal, std::vector<u32>& table, std::vector<u32>& remap)
+        {
+            constexpr u32 empty = ~0u;
+
+            u32 table_size = 1;
+            while (table_size < numVertices * 2)
+            {
+                table_size *= 2;
+            }
+
+            table.assign(table_size, empty);
+            remap.resize(numVertices);
+
+            for (u32 vertex = 0; vertex < numVertices; ++vertex)
+            {
+                u32 slot = hash(vertex) & (table_size - 1);
+                while (table[slot] != empty && !equal(table[slot], vertex))
+                {
+                    slot = (slot + 1) & (table_size - 1);
+                }
+
+                if (table[slot] == empty)
+                {
+                    table[slot] = vertex;
+                }
+
+                remap[vertex] = table[slot];
+            }
+        }
+
+        struct vec3
+        {
+            float x, y, z;
+        };
+
+        inline vec3 load_vec3(const std::vector<float>& positions, u32 vertex)
+        {
+            return { positions[vertex * 3 + 0], positions[vertex * 3 + 1], positions[vertex * 3 + 2] };
+        }
+
+        inline vec3 sub(const vec3& a, const vec3& b)
+        {
+            return { a.x - b.x, a.y - b.y, a.z - b.z };
+        }
+
+        inline vec3 cross(const vec3& a, const vec3& b)
+        {
+            return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        }
+
+        inline float dot(const vec3& a, const vec3& b)
+        {
+            return a.x * b.x + a.y * b.y + a.z * b.z;
+        }
+    }
+
+    mesh_simplifier::mesh_simplifier(const mesh_simplifier_settings& settings)
+        :m_settings(settings)
+        ,m_scale(1.0f)
+        ,m_num_attributes(0)
+        ,m_mark(0)
+    {}
+
+    bool mesh_simplifier::generate_lods(const simplifier_input& input, const std::vector<float>& ratios, std::vector<simplified_lod>& lods)
+    {
+        lods.clear();
+
+        if (!prepare(input))
+        {
+            return false;
+        }
+
+        // Errors are compared squared and relative to the size of the mesh.
+        float max_error = m_settings.max_error * m_settings.max_error;
+        float error = 0.0f;
+
+        size_t num_input_triangles = input.num_indices / 3;
+        size_t previous_index_count = m_indices.size();
+
+        for (float ratio : ratios)
+        {
+            size_t target_index_count = static_cast<size_t>(static_cast<double>(num_input_triangles) * std::max(ratio, 0.0f)) * 3;
+
+            simplify(target_index_count, max_error, error);
+
+            if (m_indices.size() >= previous_index_count)
+            {
+                break;
+            }
+
+            simplified_lod lod;
+            lod.indices = m_indices;
+            lod.error = std::sqrt(error) / m_scale;
+            lods.push_back(std::move(lod));
+
+            previous_index_count = m_indices.size();
+
+            // The next levels would stop at the same point.
+            if (m_indices.size() > target_index_count)
+            {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    void mesh_simplifier::generate_lods(const std::vector<simplifier_input>& inputs, const std::vector<float>& ratios, const mesh_simplifier_settings& settings, std::vector<std::vector<simplified_lod>>& lods, threading::thread_pool* threadPool)
+    {
+        lods.clear();
+        lods.resize(inputs.size());
+
+        // Every thread owns a simplifier and takes the next mesh until all meshes are done.
+        std::atomic<size_t> next_input(0);
+        auto simplify_inputs = [&inputs, &ratios, &settings, &lods, &next_input]()
+        {
+            mesh_simplifier simplifier(settings);
+
+            for (size_t i = next_input++; i < inputs.size(); i = next_input++)
+            {
+                simplifier.generate_lods(inputs[i], ratios, lods[i]);
+            }
+        };
+
+        if (threadPool)
+        {
+            size_t num_tasks = std::min<size_t>(threadPool->get_num_threads(), inputs.size());
+            for (size_t i = 0; i < num_tasks; ++i)
+            {
+                threadPool->submit(simplify_inputs);
+            }
+        }
+
+        simplify_inputs();
+
+        if (threadPool)
+        {
+            threadPool->wait_idle();
+        }
+    }
+
+    bool mesh_simplifier::prepare(const simplifier_input& input)
+    {
+        if (!input.vertices || !input.indices || input.num_indices % 3 != 0 || input.vertex_stride < input.position_offset + 3 * sizeof(float))
+        {
+            log::error("Invalid mesh simplifier input");
+            return false;
+        }
+
+        u32 num_vertices = static_cast<u32>(input.num_vertices);
+        const u8* vertex_data = static_cast<const u8*>(input.vertices);
+
+        // Scale positions to the unit cube so errors do not depend on the size of the mesh.
+        m_positions.resize(num_vertices * 3);
+
+        float min_position[3] = { 0.0f, 0.0f, 0.0f };
+        float max_position[3] = { 0.0f, 0.0f, 0.0f };
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            float* position = &m_positions[vertex * 3];
+            memcpy(position, vertex_data + vertex * input.vertex_stride + input.position_offset, 3 * sizeof(float));
+
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                min_position[axis] = vertex == 0 ? position[axis] : std::min(min_position[axis], position[axis]);
+                max_position[axis] = vertex == 0 ? position[axis] : std::max(max_position[axis], position[axis]);
+            }
+        }
+
+        float extent = std::max(max_position[0] - min_position[0], std::max(max_position[1] - min_position[1], max_position[2] - min_position[2]));
+        m_scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+        m_num_attributes = input.num_attributes;
+        m_attributes.resize(static_cast<size_t>(num_vertices) * m_num_attributes);
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            memcpy(&m_attributes[static_cast<size_t>(vertex) * m_num_attributes], vertex_data + vertex * input.vertex_stride + input.attribute_offset, m_num_attributes * sizeof(float));
+        }
+
+        // Weld vertices before scaling, only bitwise equal vertices are the same vertex.
+        const u32 num_attributes = m_num_attributes;
+        internal::build_vertex_remap(num_vertices,
+            [this, num_attributes](u32 vertex)
+            {
+                return internal::hash_floats(&m_positions[vertex * 3], 3) ^ internal::hash_floats(&m_attributes[static_cast<size_t>(vertex) * num_attributes], num_attributes);
+            },
+            [this, num_attributes](u32 a, u32 b)
+            {
+                return memcmp(&m_positions[a * 3], &m_positions[b * 3], 3 * sizeof(float)) == 0
+                    && memcmp(&m_attributes[static_cast<size_t>(a) * num_attributes], &m_attributes[static_cast<size_t>(b) * num_attributes], num_attributes * sizeof(float)) == 0;
+            },
+            m_hash_table, m_remap);
+
+        internal::build_vertex_remap(num_vertices,
+            [this](u32 vertex)
+            {
+                return internal::hash_floats(&m_positions[vertex * 3], 3);
+            },
+            [this](u32 a, u32 b)
+            {
+                return memcmp(&m_positions[a * 3], &m_positions[b * 3], 3 * sizeof(float)) == 0;
+            },
+            m_hash_table, m_position_remap);
+
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                m_positions[vertex * 3 + axis] = (m_positions[vertex * 3 + axis] - min_position[axis]) * m_scale;
+            }
+        }
+
+        // Triangles that became degenerate by welding are dropped.
+        m_indices.clear();
+        m_indices.reserve(input.num_indices);
+        for (size_t i = 0; i < input.num_indices; i += 3)
+        {
+            u32 a = input.indices[i + 0];
+            u32 b = input.indices[i + 1];
+            u32 c = input.indices[i + 2];
+
+            if (a >= num_vertices || b >= num_vertices || c >= num_vertices)
+            {
+                log::error("Mesh simplifier input contains an index out of range");
+                return false;
+            }
+
+            a = m_remap[a];
+            b = m_remap[b];
+            c = m_remap[c];
+
+            if (a != b && b != c && c != a)
+            {
+                m_indices.push_back(a);
+                m_indices.push_back(b);
+                m_indices.push_back(c);
+            }
+        }
+
+        build_adjacency();
+        classify_vertices();
+        compute_quadrics();
+
+        // Remap is reused to record collapses.
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            m_remap[vertex] = vertex;
+        }
+        m_touched.assign(num_vertices, 0);
+        m_vertex_marks.assign(num_vertices, 0);
+        m_mark = 0;
+
+        return true;
+    }
+
+    void mesh_simplifier::build_adjacency()
+    {
+        u32 num_vertices = static_cast<u32>(m_positions.size() / 3);
+
+        m_adjacency_offsets.assign(num_vertices + 1, 0);
+        for (u32 index : m_indices)
+        {
+            ++m_adjacency_offsets[index + 1];
+        }
+
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            m_adjacency_offsets[vertex + 1] += m_adjacency_offsets[vertex];
+        }
+
+        // Fill using the offsets as insertion points, shifted back afterwards.
+        m_adjacency.resize(m_indices.size());
+        for (size_t i = 0; i < m_indices.size(); ++i)
+        {
+            m_adjacency[m_adjacency_offsets[m_indices[i]]++] = static_cast<u32>(i / 3);
+        }
+
+        for (u32 vertex = num_vertices; vertex > 0; --vertex)
+        {
+            m_adjacency_offsets[vertex] = m_adjacency_offsets[vertex - 1];
+        }
+        m_adjacency_offsets[0] = 0;
+    }
+
+    void mesh_simplifier::classify_vertices()
+    {
+        u32 num_vertices = static_cast<u32>(m_positions.size() / 3);
+
+        m_vertex_kinds.assign(num_vertices, vertex_kind_manifold);
+
+        // Welded vertices that still share a position have different attributes, they form a seam.
+        std::vector<u32>& position_count = m_hash_table;
+        position_count.assign(num_vertices, 0);
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            if (m_remap[vertex] == vertex)
+            {
+                ++position_count[m_position_remap[vertex]];
+            }
+        }
+
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            if (position_count[m_position_remap[vertex]] > 1)
+            {
+                m_vertex_kinds[vertex] = vertex_kind_locked;
+            }
+        }
+
+        // An edge used by one triangle is a border, an edge used more than once per direction is non-manifold.
+        auto count_half_edges = [this](u32 from, u32 to)
+        {
+            u32 count = 0;
+            for (u32 i = m_adjacency_offsets[from]; i < m_adjacency_offsets[from + 1]; ++i)
+            {
+                const u32* triangle = &m_indices[m_adjacency[i] * 3];
+                for (u32 corner = 0; corner < 3; ++corner)
+                {
+                    count += triangle[corner] == from && triangle[(corner + 1) % 3] == to ? 1 : 0;
+                }
+            }
+            return count;
+        };
+
+        for (size_t i = 0; i < m_indices.size(); i += 3)
+        {
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                u32 a = m_indices[i + corner];
+                u32 b = m_indices[i + (corner + 1) % 3];
+
+                u32 num_forward = count_half_edges(a, b);
+                u32 num_backward = count_half_edges(b, a);
+
+                if (num_forward > 1 || num_backward > 1)
+                {
+                    m_vertex_kinds[a] = vertex_kind_locked;
+                    m_vertex_kinds[b] = vertex_kind_locked;
+                }
+                else if (num_backward == 0)
+                {
+                    vertex_kind kind = m_settings.lock_border ? vertex_kind_locked : vertex_kind_border;
+                    m_vertex_kinds[a] = std::max(m_vertex_kinds[a], kind);
+                    m_vertex_kinds[b] = std::max(m_vertex_kinds[b], kind);
+                }
+            }
+        }
+    }
+
+    void mesh_simplifier::compute_quadrics()
+    {
+        u32 num_vertices = static_cast<u32>(m_positions.size() / 3);
+
+        m_quadrics.assign(num_vertices, quadric{});
+
+        for (size_t i = 0; i < m_indices.size(); i += 3)
+        {
+            internal::vec3 p0 = internal::load_vec3(m_positions, m_indices[i + 0]);
+            internal::vec3 p1 = internal::load_vec3(m_positions, m_indices[i + 1]);
+            internal::vec3 p2 = internal::load_vec3(m_positions, m_indices[i + 2]);
+
+            internal::vec3 normal = internal::cross(internal::sub(p1, p0), internal::sub(p2, p0));
+            float length = std::sqrt(internal::dot(normal, normal));
+            if (length == 0.0f)
+            {
+                continue;
+            }
+
+            normal = { normal.x / length, normal.y / length, normal.z / length };
+            float distance = -internal::dot(normal, p0);
+
+            // Planes are weighted by the area of their triangle.
+            float weight = length * 0.5f;
+
+            quadric q;
+            q.a00 = normal.x * normal.x * weight;
+            q.a11 = normal.y * normal.y * weight;
+            q.a22 = normal.z * normal.z * weight;
+            q.a01 = normal.x * normal.y * weight;
+            q.a02 = normal.x * normal.z * weight;
+            q.a12 = normal.y * normal.z * weight;
+            q.b0 = normal.x * distance * weight;
+            q.b1 = normal.y * distance * weight;
+            q.b2 = normal.z * distance * weight;
+            q.c = distance * distance * weight;
+            q.weight = weight;
+
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                quadric& target = m_quadrics[m_indices[i + corner]];
+                target.a00 += q.a00;
+                target.a11 += q.a11;
+                target.a22 += q.a22;
+                target.a01 += q.a01;
+                target.a02 += q.a02;
+                target.a12 += q.a12;
+                target.b0 += q.b0;
+                target.b1 += q.b1;
+                target.b2 += q.b2;
+                target.c += q.c;
+                target.weight += q.weight;
+            }
+        }
+    }
+
+    void mesh_simplifier::simplify(size_t targetIndexCount, float maxError, float& error)
+    {
+        while (m_indices.size() > targetIndexCount)
+        {
+            build_adjacency();
+            collect_collapses();
+
+            if (m_collapses.empty())
+            {
+                break;
+            }
+
+            sort_collapses();
+
+            size_t num_triangles_to_remove = (m_indices.size() - targetIndexCount + 2) / 3;
+            if (perform_collapses(num_triangles_to_remove, maxError, error) == 0)
+            {
+                break;
+            }
+
+            compact_indices();
+        }
+    }
+
+    void mesh_simplifier::collect_collapses()
+    {
+        m_collapses.clear();
+
+        // Every interior edge is seen once per direction, a vertex is only collapsed along its outgoing half-edges.
+        for (size_t i = 0; i < m_indices.size(); i += 3)
+        {
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                u32 vertex = m_indices[i + corner];
+                u32 target = m_indices[i + (corner + 1) % 3];
+
+                vertex_kind kind = m_vertex_kinds[vertex];
+                if (kind == vertex_kind_locked || (kind == vertex_kind_border && m_vertex_kinds[target] == vertex_kind_manifold))
+                {
+                    continue;
+                }
+
+                collapse c;
+                c.vertex = vertex;
+                c.target = target;
+                c.error = get_collapse_error(vertex, target);
+                c.cost = c.error + get_attribute_distance(vertex, target);
+
+                m_collapses.push_back(c);
+            }
+        }
+    }
+
+    void mesh_simplifier::sort_collapses()
+    {
+        // Counting sort on the top bits of the costs, positive floats order like their bit patterns.
+        constexpr u32 sort_bits = 15;
+        constexpr u32 sort_shift = 31 - sort_bits;
+
+        auto get_bucket = [](float cost)
+        {
+            u32 bits;
+            memcpy(&bits, &cost, sizeof(bits));
+            return (bits & 0x7fffffff) >> sort_shift;
+        };
+
+        m_collapse_buckets.assign((1u << sort_bits) + 1, 0);
+        for (const collapse& c : m_collapses)
+        {
+            ++m_collapse_buckets[get_bucket(c.cost) + 1];
+        }
+
+        for (size_t i = 1; i < m_collapse_buckets.size(); ++i)
+        {
+            m_collapse_buckets[i] += m_collapse_buckets[i - 1];
+        }
+
+        m_collapse_order.resize(m_collapses.size());
+        for (size_t i = 0; i < m_collapses.size(); ++i)
+        {
+            m_collapse_order[m_collapse_buckets[get_bucket(m_collapses[i].cost)]++] = static_cast<u32>(i);
+        }
+    }
+
+    size_t mesh_simplifier::perform_collapses(size_t numTrianglesToRemove, float maxError, float& error)
+    {
+        size_t num_removed = 0;
+        size_t num_collapses = 0;
+
+        for (u32 collapse_index : m_collapse_order)
+        {
+            if (num_removed >= numTrianglesToRemove)
+            {
+                break;
+            }
+
+            const collapse& c = m_collapses[collapse_index];
+            if (c.error > maxError)
+            {
+                // Costs include attributes, later collapses can still have a smaller geometric error.
+                continue;
+            }
+
+            // Every vertex takes part in one collapse per pass, the costs of the others are outdated.
+            if (m_touched[c.vertex] || m_touched[c.target])
+            {
+                continue;
+            }
+
+            u32 num_shared_triangles = 0;
+            if (!can_collapse(c.vertex, c.target, num_shared_triangles))
+            {
+                continue;
+            }
+
+            m_remap[c.vertex] = c.target;
+            m_touched[c.vertex] = 1;
+            m_touched[c.target] = 1;
+
+            quadric& target = m_quadrics[c.target];
+            const quadric& source = m_quadrics[c.vertex];
+            target.a00 += source.a00;
+            target.a11 += source.a11;
+            target.a22 += source.a22;
+            target.a01 += source.a01;
+            target.a02 += source.a02;
+            target.a12 += source.a12;
+            target.b0 += source.b0;
+            target.b1 += source.b1;
+            target.b2 += source.b2;
+            target.c += source.c;
+            target.weight += source.weight;
+
+            error = std::max(error, c.error);
+            num_removed += num_shared_triangles;
+            ++num_collapses;
+        }
+
+        return num_collapses;
+    }
+
+    bool mesh_simplifier::can_collapse(u32 vertex, u32 target, u32& numSharedTriangles)
+    {
+        internal::vec3 target_position = internal::load_vec3(m_positions, target);
+        internal::vec3 vertex_position = internal::load_vec3(m_positions, vertex);
+
+        numSharedTriangles = 0;
+
+        // Neighbours of the vertex are marked to find the neighbours it shares with the target.
+        ++m_mark;
+
+        for (u32 i = m_adjacency_offsets[vertex]; i < m_adjacency_offsets[vertex + 1]; ++i)
+        {
+            const u32* triangle = &m_indices[m_adjacency[i] * 3];
+
+            // Neighbours collapsed earlier in this pass are read at their new position.
+            u32 corners[3] = { m_remap[triangle[0]], m_remap[triangle[1]], m_remap[triangle[2]] };
+            if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+            {
+                continue;
+            }
+
+            u32 corner = corners[0] == vertex ? 0 : (corners[1] == vertex ? 1 : 2);
+            u32 next = corners[(corner + 1) % 3];
+            u32 previous = corners[(corner + 2) % 3];
+
+            m_vertex_marks[next] = m_mark;
+            m_vertex_marks[previous] = m_mark;
+
+            if (next == target || previous == target)
+            {
+                ++numSharedTriangles;
+                continue;
+            }
+
+            internal::vec3 p1 = internal::load_vec3(m_positions, next);
+            internal::vec3 p2 = internal::load_vec3(m_positions, previous);
+
+            internal::vec3 normal_before = internal::cross(internal::sub(p1, vertex_position), internal::sub(p2, vertex_position));
+            internal::vec3 normal_after = internal::cross(internal::sub(p1, target_position), internal::sub(p2, target_position));
+
+            // Rejecting rotations above ~75 degrees instead of only flips avoids slivers that fold over later.
+            float length_squared = internal::dot(normal_before, normal_before) * internal::dot(normal_after, normal_after);
+            if (internal::dot(normal_before, normal_after) <= 0.25f * std::sqrt(length_squared))
+            {
+                return false;
+            }
+        }
+
+        // Border vertices only move along the border.
+        if (numSharedTriangles == 0 || (m_vertex_kinds[vertex] == vertex_kind_border && numSharedTriangles != 1))
+        {
+            return false;
+        }
+
+        // Link condition, the only common neighbours are the opposite corners of the shared triangles.
+        // Otherwise the collapse pinches the surface into non-manifold edges.
+        u32 num_common_neighbours = 0;
+        for (u32 i = m_adjacency_offsets[target]; i < m_adjacency_offsets[target + 1]; ++i)
+        {
+            const u32* triangle = &m_indices[m_adjacency[i] * 3];
+
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                u32 neighbour = m_remap[triangle[corner]];
+                if (neighbour != target && neighbour != vertex && m_vertex_marks[neighbour] == m_mark)
+                {
+                    // Count every neighbour once.
+                    m_vertex_marks[neighbour] = 0;
+                    ++num_common_neighbours;
+                }
+            }
+        }
+
+        return num_common_neighbours <= numSharedTriangles;
+    }
+
+    void mesh_simplifier::compact_indices()
+    {
+        size_t write = 0;
+        for (size_t i = 0; i < m_indices.size(); i += 3)
+        {
+            u32 a = m_remap[m_indices[i + 0]];
+            u32 b = m_remap[m_indices[i + 1]];
+            u32 c = m_remap[m_indices[i + 2]];
+
+            if (a != b && b != c && c != a)
+            {
+                m_indices[write++] = a;
+                m_indices[write++] = b;
+                m_indices[write++] = c;
+            }
+        }
+        m_indices.resize(write);
+
+        for (size_t vertex = 0; vertex < m_remap.size(); ++vertex)
+        {
+            m_remap[vertex] = static_cast<u32>(vertex);
+        }
+        std::fill(m_touched.begin(), m_touched.end(), 0);
+    }
+
+    float mesh_simplifier::get_collapse_error(u32 vertex, u32 target) const
+    {
+        const quadric& q = m_quadrics[vertex];
+        if (q.weight <= 0.0f)
+        {
+            return 0.0f;
+        }
+
+        internal::vec3 p = internal::load_vec3(m_positions, target);
+
+        float error = q.a00 * p.x * p.x + q.a11 * p.y * p.y + q.a22 * p.z * p.z
+            + 2.0f * (q.a01 * p.x * p.y + q.a02 * p.x * p.z + q.a12 * p.y * p.z)
+            + 2.0f * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z)
+            + q.c;
+
+        // Mean squared distance to the planes of the triangles merged into this vertex.
+        return std::fabs(error) / q.weight;
+    }
+
+    float mesh_simplifier::get_attribute_distance(u32 vertex, u32 target) const
+    {
+        const float* a = &m_attributes[static_cast<size_t>(vertex) * m_num_attributes];
+        const float* b = &m_attributes[static_cast<size_t>(target) * m_num_attributes];
+
+        float distance = 0.0f;
+        for (u32 i = 0; i < m_num_attributes; ++i)
+        {
+            distance += (a[i] - b[i]) * (a[i] - b[i]);
+        }
+
+        return distance * m_settings.attribute_weight * m_settings.attribute_weight;
+    }
+}
\ No newline at end of file
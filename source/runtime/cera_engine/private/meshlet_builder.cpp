@@ -0,0 +1,318 @@
+#include "meshlet_builder.h"
+#include "frustum_culler.h"
+
+#include "util/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace cera
+{
+    namespace internal
+    {
+        // Normal cones wider than this, measured as the cosine between the axis and the furthest normal, are never culled.
+        constexpr float min_cone_spread_cosine = 0.1f;
+
+        inline float3 read_meshlet_position(const meshlet_builder_input& input, u32 vertex)
+        {
+            float3 position;
+            memcpy(&position, static_cast<const u8*>(input.vertices) + vertex * input.vertex_stride + input.position_offset, sizeof(position));
+            return position;
+        }
+
+        inline float3 get_triangle_normal(const float3& p0, const float3& p1, const float3& p2)
+        {
+            float3 e0 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+            float3 e1 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+            return { e0.y * e1.z - e0.z * e1.y, e0.z * e1.x - e0.x * e1.z, e0.x * e1.y - e0.y * e1.x };
+        }
+
+        inline float get_length(const float3& v)
+        {
+            return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        }
+    }
+
+    meshlet_builder::meshlet_builder(const meshlet_builder_settings& settings)
+        :m_settings(settings)
+    {}
+
+    bool meshlet_builder::build(const meshlet_builder_input& input, std::vector<meshlet>& meshlets)
+    {
+        meshlets.clear();
+
+        if (!input.vertices || !input.indices || input.num_indices % 3 != 0 || input.vertex_stride < input.position_offset + 3 * sizeof(float)
+            || m_settings.max_vertices < 3 || m_settings.max_triangles < 1)
+        {
+            log::error("Invalid meshlet builder input");
+            return false;
+        }
+
+        for (size_t i = 0; i < input.num_indices; ++i)
+        {
+            if (input.indices[i] >= input.num_vertices)
+            {
+                log::error("Meshlet builder input indexes a vertex out of range");
+                return false;
+            }
+        }
+
+        m_indices.assign(input.indices, input.indices + input.num_indices);
+        build_adjacency(input);
+
+        u32 num_triangles = static_cast<u32>(input.num_indices / 3);
+
+        m_used.assign(num_triangles, 0);
+        m_vertex_meshlets.assign(input.num_vertices, 0);
+
+        size_t num_written_indices = 0;
+        u32 seed_cursor = 0;
+
+        while (true)
+        {
+            while (seed_cursor < num_triangles && m_used[seed_cursor])
+            {
+                ++seed_cursor;
+            }
+
+            if (seed_cursor == num_triangles)
+            {
+                break;
+            }
+
+            meshlet& current = meshlets.emplace_back();
+            current.first_index = static_cast<u32>(num_written_indices);
+            current.index_count = 0;
+            current.vertex_count = 0;
+
+            u32 meshlet_stamp = static_cast<u32>(meshlets.size());
+            u32 triangle = seed_cursor;
+
+            m_candidates.clear();
+
+            while (true)
+            {
+                m_used[triangle] = 1;
+
+                for (u32 corner = 0; corner < 3; ++corner)
+                {
+                    u32 vertex = m_indices[triangle * 3 + corner];
+                    if (m_vertex_meshlets[vertex] != meshlet_stamp)
+                    {
+                        m_vertex_meshlets[vertex] = meshlet_stamp;
+                        ++current.vertex_count;
+                    }
+
+                    input.indices[num_written_indices++] = vertex;
+                }
+
+                current.index_count += 3;
+
+                if (current.index_count / 3 >= m_settings.max_triangles)
+                {
+                    break;
+                }
+
+                add_candidates(triangle);
+
+                // Take the neighbour that adds the fewest vertices, the earliest one on ties. Used candidates are dropped.
+                u32 best_triangle = ~0u;
+                u32 best_new_vertices = 4;
+                size_t num_candidates = 0;
+                for (u32 candidate : m_candidates)
+                {
+                    if (m_used[candidate])
+                    {
+                        continue;
+                    }
+
+                    m_candidates[num_candidates++] = candidate;
+
+                    u32 new_vertices = 0;
+                    for (u32 corner = 0; corner < 3; ++corner)
+                    {
+                        new_vertices += m_vertex_meshlets[m_indices[candidate * 3 + corner]] != meshlet_stamp ? 1 : 0;
+                    }
+
+                    if (new_vertices < best_new_vertices || (new_vertices == best_new_vertices && candidate < best_triangle))
+                    {
+                        best_new_vertices = new_vertices;
+                        best_triangle = candidate;
+                    }
+                }
+                m_candidates.resize(num_candidates);
+
+                if (best_triangle == ~0u || current.vertex_count + best_new_vertices > m_settings.max_vertices)
+                {
+                    break;
+                }
+
+                triangle = best_triangle;
+            }
+
+            compute_bounds(input, current);
+        }
+
+        return true;
+    }
+
+    void meshlet_builder::build_adjacency(const meshlet_builder_input& input)
+    {
+        u32 num_vertices = static_cast<u32>(input.num_vertices);
+
+        m_adjacency_offsets.assign(num_vertices + 1, 0);
+        for (u32 vertex : m_indices)
+        {
+            ++m_adjacency_offsets[vertex + 1];
+        }
+
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            m_adjacency_offsets[vertex + 1] += m_adjacency_offsets[vertex];
+        }
+
+        // Fill with a running cursor per vertex, the offsets are restored afterwards.
+        m_adjacency.resize(m_indices.size());
+        for (u32 i = 0; i < m_indices.size(); ++i)
+        {
+            m_adjacency[m_adjacency_offsets[m_indices[i]]++] = i / 3;
+        }
+
+        for (u32 vertex = num_vertices; vertex > 0; --vertex)
+        {
+            m_adjacency_offsets[vertex] = m_adjacency_offsets[vertex - 1];
+        }
+        m_adjacency_offsets[0] = 0;
+    }
+
+    void meshlet_builder::add_candidates(u32 triangle)
+    {
+        for (u32 corner = 0; corner < 3; ++corner)
+        {
+            u32 vertex = m_indices[triangle * 3 + corner];
+            for (u32 i = m_adjacency_offsets[vertex]; i < m_adjacency_offsets[vertex + 1]; ++i)
+            {
+                if (!m_used[m_adjacency[i]])
+                {
+                    m_candidates.push_back(m_adjacency[i]);
+                }
+            }
+        }
+    }
+
+    void meshlet_builder::compute_bounds(const meshlet_builder_input& input, meshlet& meshlet) const
+    {
+        const u32* indices = input.indices + meshlet.first_index;
+
+        bounding_box box = bounding_box::empty();
+        for (u32 i = 0; i < meshlet.index_count; ++i)
+        {
+            box.expand(internal::read_meshlet_position(input, indices[i]));
+        }
+
+        meshlet.sphere.center = box.get_center();
+        meshlet.sphere.radius = 0.0f;
+
+        // Sum of the unit normals of the triangles, degenerate triangles have no direction.
+        float3 axis = { 0.0f, 0.0f, 0.0f };
+        for (u32 i = 0; i < meshlet.index_count; i += 3)
+        {
+            float3 p[3];
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                p[corner] = internal::read_meshlet_position(input, indices[i + corner]);
+
+                float3 offset = { p[corner].x - meshlet.sphere.center.x, p[corner].y - meshlet.sphere.center.y, p[corner].z - meshlet.sphere.center.z };
+                meshlet.sphere.radius = std::max(meshlet.sphere.radius, internal::get_length(offset));
+            }
+
+            float3 normal = internal::get_triangle_normal(p[0], p[1], p[2]);
+            float length = internal::get_length(normal);
+            if (length > 0.0f)
+            {
+                axis.x += normal.x / length;
+                axis.y += normal.y / length;
+                axis.z += normal.z / length;
+            }
+        }
+
+        float axis_length = internal::get_length(axis);
+        if (axis_length == 0.0f)
+        {
+            meshlet.cone_axis = { 0.0f, 0.0f, 0.0f };
+            meshlet.cone_cutoff = 1.0f;
+            return;
+        }
+
+        meshlet.cone_axis = { axis.x / axis_length, axis.y / axis_length, axis.z / axis_length };
+
+        // Cosine between the axis and the furthest normal.
+        float min_cosine = 1.0f;
+        for (u32 i = 0; i < meshlet.index_count; i += 3)
+        {
+            float3 normal = internal::get_triangle_normal(
+                internal::read_meshlet_position(input, indices[i + 0]),
+                internal::read_meshlet_position(input, indices[i + 1]),
+                internal::read_meshlet_position(input, indices[i + 2]));
+
+            float length = internal::get_length(normal);
+            if (length > 0.0f)
+            {
+                float cosine = (normal.x * meshlet.cone_axis.x + normal.y * meshlet.cone_axis.y + normal.z * meshlet.cone_axis.z) / length;
+                min_cosine = std::min(min_cosine, cosine);
+            }
+        }
+
+        meshlet.cone_cutoff = min_cosine <= internal::min_cone_spread_cosine ? 1.0f : std::sqrt(1.0f - min_cosine * min_cosine);
+    }
+
+    u32 cull_meshlets(const std::vector<meshlet>& meshlets, const float3& cameraPosition, const frustum& objectFrustum, std::vector<meshlet_index_range>& ranges, u32& numBackfacing)
+    {
+        ranges.clear();
+        numBackfacing = 0;
+
+        u32 num_visible = 0;
+        for (const meshlet& m : meshlets)
+        {
+            const float3& center = m.sphere.center;
+
+            float3 view = { center.x - cameraPosition.x, center.y - cameraPosition.y, center.z - cameraPosition.z };
+            float view_dot_axis = view.x * m.cone_axis.x + view.y * m.cone_axis.y + view.z * m.cone_axis.z;
+            if (view_dot_axis > m.cone_cutoff * internal::get_length(view) + m.sphere.radius)
+            {
+                ++numBackfacing;
+                continue;
+            }
+
+            bool inside = true;
+            for (const plane& p : objectFrustum.planes)
+            {
+                if (p.normal.x * center.x + p.normal.y * center.y + p.normal.z * center.z + p.distance < -m.sphere.radius)
+                {
+                    inside = false;
+                    break;
+                }
+            }
+
+            if (!inside)
+            {
+                continue;
+            }
+
+            ++num_visible;
+
+            // Meshlets are stored back to back, neighbours merge into one draw.
+            if (!ranges.empty() && ranges.back().first_index + ranges.back().index_count == m.first_index)
+            {
+                ranges.back().index_count += m.index_count;
+            }
+            else
+            {
+                ranges.push_back({ m.first_index, m.index_count });
+            }
+        }
+
+        return num_visible;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "model_importer.h"
+
+#include "util/file_mapping.h"
+#include "util/threading/thread_pool.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+
+namespace cera
+{
+    void imported_model::clear()
+    {
+        meshes.clear();
+        nodes.clear();
+        root_nodes.clear();
+    }
+
+    size_t imported_model::get_num_vertices() const
+    {
+        size_t num_vertices = 0;
+        for (const imported_mesh& mesh : meshes)
+        {
+            num_vertices += mesh.positions.size();
+        }
+
+        return num_vertices;
+    }
+
+    size_t imported_model::get_num_triangles() const
+    {
+        size_t num_triangles = 0;
+        for (const imported_mesh& mesh : meshes)
+        {
+            num_triangles += mesh.indices.size() / 3;
+        }
+
+        return num_triangles;
+    }
+
+    model_importer::model_importer(threading::thread_pool* threadPool)
+        :m_thread_pool(threadPool)
+    {}
+
+    bool model_importer::load(const std::filesystem::path& path, imported_model& model)
+    {
+        model.clear();
+
+        auto start_time = std::chrono::steady_clock::now();
+
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+        if (extension != ".obj" && extension != ".gltf" && extension != ".glb")
+        {
+            log::error("Unsupported model format: {}", path.string());
+            return false;
+        }
+
+        file_mapping file;
+        if (!file.open(path))
+        {
+            return false;
+        }
+
+        const u8* data = file.get_data();
+        bool result = extension == ".obj"
+            ? parse_obj(reinterpret_cast<const char*>(data), file.get_size(), model)
+            : parse_gltf(data, file.get_size(), path.parent_path(), model);
+
+        if (!result)
+        {
+            log::error("Failed to import model: {}", path.string());
+            return false;
+        }
+
+        m_statistics.import_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+        return true;
+    }
+
+    const model_import_statistics& model_importer::get_statistics() const
+    {
+        return m_statistics;
+    }
+
+    void model_importer::parallel_for(size_t count, const std::function<void(size_t)>& function)
+    {
+        // Every thread takes the next index until all indices are done.
+        std::atomic<size_t> next_index(0);
+        auto run = [count, &function, &next_index]()
+        {
+            for (size_t i = next_index++; i < count; i = next_index++)
+            {
+                function(i);
+            }
+        };
+
+        if (m_thread_pool && count > 1)
+        {
+            size_t num_tasks = std::min<size_t>(m_thread_pool->get_num_threads(), count - 1);
+            for (size_t i = 0; i < num_tasks; ++i)
+            {
+                m_thread_pool->submit(run);
+            }
+
+            run();
+            m_thread_pool->wait_idle();
+        }
+        else
+        {
+            run();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,690 @@
+#include "model_importer.h"
+
+#include "util/file_mapping.h"
+#include "util/json_document.h"
+#include "util/log.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace cera
+{
+    namespace internal
+    {
+        constexpr u32 glb_magic = 0x46546C67;            // "glTF"
+        constexpr u32 glb_json_chunk = 0x4E4F534A;       // "JSON"
+        constexpr u32 glb_binary_chunk = 0x004E4942;     // "BIN\0"
+        constexpr size_t glb_header_size = 12;
+        constexpr size_t glb_chunk_header_size = 8;
+
+        constexpr u32 gltf_unsigned_byte = 5121;
+        constexpr u32 gltf_unsigned_short = 5123;
+        constexpr u32 gltf_unsigned_int = 5125;
+        constexpr u32 gltf_float = 5126;
+
+        constexpr u32 gltf_triangles = 4;
+
+        struct gltf_buffer
+        {
+            const u8* data = nullptr;
+            size_t size = 0;
+        };
+
+        // Elements of an accessor, read in place from a buffer.
+        struct gltf_accessor
+        {
+            const u8* data = nullptr;
+            size_t count = 0;
+            size_t stride = 0;
+            u32 component_type = 0;
+            u32 num_components = 0;
+        };
+
+        struct gltf_primitive
+        {
+            const json_value* primitive;
+            std::string_view name;
+        };
+
+        u32 get_gltf_component_size(u32 componentType)
+        {
+            switch (componentType)
+            {
+            case 5120:
+            case 5121:
+                return 1;
+            case 5122:
+            case 5123:
+                return 2;
+            case 5125:
+            case 5126:
+                return 4;
+            default:
+                return 0;
+            }
+        }
+
+        u32 get_gltf_num_components(std::string_view type)
+        {
+            constexpr std::pair<std::string_view, u32> types[] =
+            {
+                { "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 }, { "MAT2", 4 }, { "MAT3", 9 }, { "MAT4", 16 }
+            };
+
+            for (const auto& [name, num_components] : types)
+            {
+                if (name == type)
+                {
+                    return num_components;
+                }
+            }
+
+            return 0;
+        }
+
+        u32 get_gltf_index(const json_document& document, const json_value& object, std::string_view name)
+        {
+            double index = document.get_number(object, name, -1.0);
+            return index >= 0.0 && index < 4294967295.0 ? static_cast<u32>(index) : ~0u;
+        }
+
+        /**
+         * Read a count, offset or length. Converting a number that does not fit a size_t is undefined,
+         * negative, fractional and non-finite numbers and numbers beyond 2^53 are rejected.
+         */
+        bool get_gltf_size(const json_document& document, const json_value& object, std::string_view name, size_t& value)
+        {
+            double number = document.get_number(object, name, 0.0);
+            if (!std::isfinite(number) || number < 0.0 || number != std::floor(number)
+                || number >= 9007199254740992.0 || number > static_cast<double>(std::numeric_limits<size_t>::max()))
+            {
+                return false;
+            }
+
+            value = static_cast<size_t>(number);
+
+            return true;
+        }
+
+        /**
+         * Decode a base64 data URI, buffers embedded in the json are the only ones that are copied.
+         */
+        bool decode_gltf_data_uri(std::string_view uri, std::vector<u8>& data)
+        {
+            size_t separator = uri.find(";base64,");
+            if (separator == std::string_view::npos)
+            {
+                return false;
+            }
+
+            std::string_view encoded = uri.substr(separator + 8);
+
+            data.clear();
+            data.reserve(encoded.size() / 4 * 3);
+
+            u32 bits = 0;
+            u32 num_bits = 0;
+            for (char c : encoded)
+            {
+                u32 value;
+                if (c >= 'A' && c <= 'Z')
+                {
+                    value = c - 'A';
+                }
+                else if (c >= 'a' && c <= 'z')
+                {
+                    value = c - 'a' + 26;
+                }
+                else if (c >= '0' && c <= '9')
+                {
+                    value = c - '0' + 52;
+                }
+                else if (c == '+' || c == '/')
+                {
+                    value = c == '+' ? 62 : 63;
+                }
+                else if (c == '=')
+                {
+                    break;
+                }
+                else
+                {
+                    return false;
+                }
+
+                bits = (bits << 6) | value;
+                num_bits += 6;
+                if (num_bits >= 8)
+                {
+                    num_bits -= 8;
+                    data.push_back(static_cast<u8>(bits >> num_bits));
+                }
+            }
+
+            return true;
+        }
+
+        bool resolve_gltf_accessor(const json_document& document, const std::vector<gltf_buffer>& buffers, u32 index, gltf_accessor& accessor)
+        {
+            const json_value& root = document.get_root();
+
+            const json_value* accessors = document.find_member(root, "accessors");
+            const json_value* accessor_value = accessors ? document.get_element(*accessors, index) : nullptr;
+            if (!accessor_value || document.find_member(*accessor_value, "sparse"))
+            {
+                return false;
+            }
+
+            const json_value* buffer_views = document.find_member(root, "bufferViews");
+            const json_value* view = buffer_views ? document.get_element(*buffer_views, get_gltf_index(document, *accessor_value, "bufferView")) : nullptr;
+            if (!view)
+            {
+                return false;
+            }
+
+            u32 buffer = get_gltf_index(document, *view, "buffer");
+            if (buffer >= buffers.size())
+            {
+                return false;
+            }
+
+            size_t component_type = 0;
+            if (!get_gltf_size(document, *accessor_value, "count", accessor.count) || !get_gltf_size(document, *accessor_value, "componentType", component_type))
+            {
+                return false;
+            }
+
+            // Unknown component types have a size of 0 and are rejected below.
+            accessor.component_type = component_type <= std::numeric_limits<u32>::max() ? static_cast<u32>(component_type) : 0;
+            accessor.num_components = get_gltf_num_components(document.get_string(*accessor_value, "type"));
+
+            size_t element_size = static_cast<size_t>(get_gltf_component_size(accessor.component_type)) * accessor.num_components;
+            if (element_size == 0)
+            {
+                return false;
+            }
+
+            size_t view_offset = 0;
+            size_t view_length = 0;
+            size_t accessor_offset = 0;
+            if (!get_gltf_size(document, *view, "byteOffset", view_offset) || !get_gltf_size(document, *view, "byteLength", view_length)
+                || !get_gltf_size(document, *accessor_value, "byteOffset", accessor_offset) || !get_gltf_size(document, *view, "byteStride", accessor.stride))
+            {
+                return false;
+            }
+
+            if (accessor.stride == 0)
+            {
+                accessor.stride = element_size;
+            }
+            else if (accessor.stride < element_size)
+            {
+                // Elements must not overlap.
+                return false;
+            }
+
+            // The last element has to end inside of the view, and the view inside of the buffer.
+            if (view_offset > buffers[buffer].size || view_length > buffers[buffer].size - view_offset)
+            {
+                return false;
+            }
+
+            // Written with divisions, (count - 1) * stride overflows for huge counts.
+            if (accessor.count > 0)
+            {
+                if (accessor_offset > view_length || element_size > view_length - accessor_offset)
+                {
+                    return false;
+                }
+
+                if (accessor.count - 1 > (view_length - accessor_offset - element_size) / accessor.stride)
+                {
+                    return false;
+                }
+            }
+
+            accessor.data = buffers[buffer].data + view_offset + accessor_offset;
+
+            return true;
+        }
+
+        bool read_gltf_float3(const gltf_accessor& accessor, std::vector<float3>& values)
+        {
+            if (accessor.component_type != gltf_float || accessor.num_components != 3)
+            {
+                return false;
+            }
+
+            values.resize(accessor.count);
+            if (accessor.stride == sizeof(float3))
+            {
+                memcpy(values.data(), accessor.data, accessor.count * sizeof(float3));
+                return true;
+            }
+
+            for (size_t i = 0; i < accessor.count; ++i)
+            {
+                memcpy(&values[i], accessor.data + i * accessor.stride, sizeof(float3));
+            }
+
+            return true;
+        }
+
+        bool read_gltf_indices(const gltf_accessor& accessor, std::vector<u32>& indices)
+        {
+            if (accessor.num_components != 1)
+            {
+                return false;
+            }
+
+            indices.resize(accessor.count);
+            for (size_t i = 0; i < accessor.count; ++i)
+            {
+                const u8* element = accessor.data + i * accessor.stride;
+                switch (accessor.component_type)
+                {
+                case gltf_unsigned_byte:
+                    indices[i] = *element;
+                    break;
+                case gltf_unsigned_short:
+                {
+                    u16 index;
+                    memcpy(&index, element, sizeof(index));
+                    indices[i] = index;
+                    break;
+                }
+                case gltf_unsigned_int:
+                    memcpy(&indices[i], element, sizeof(u32));
+                    break;
+                default:
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool decode_gltf_primitive(const json_document& document, const std::vector<gltf_buffer>& buffers, const gltf_primitive& primitive, imported_mesh& mesh)
+        {
+            const json_value* attributes = document.find_member(*primitive.primitive, "attributes");
+            if (!attributes)
+            {
+                return false;
+            }
+
+            gltf_accessor accessor;
+            if (!resolve_gltf_accessor(document, buffers, get_gltf_index(document, *attributes, "POSITION"), accessor) || !read_gltf_float3(accessor, mesh.positions))
+            {
+                return false;
+            }
+
+            if (document.find_member(*attributes, "NORMAL"))
+            {
+                if (!resolve_gltf_accessor(document, buffers, get_gltf_index(document, *attributes, "NORMAL"), accessor) || !read_gltf_float3(accessor, mesh.normals)
+                    || mesh.normals.size() != mesh.positions.size())
+                {
+                    return false;
+                }
+            }
+
+            if (document.find_member(*primitive.primitive, "indices"))
+            {
+                if (!resolve_gltf_accessor(document, buffers, get_gltf_index(document, *primitive.primitive, "indices"), accessor) || !read_gltf_indices(accessor, mesh.indices))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                mesh.indices.resize(mesh.positions.size());
+                for (u32 i = 0; i < mesh.indices.size(); ++i)
+                {
+                    mesh.indices[i] = i;
+                }
+            }
+
+            if (mesh.indices.size() % 3 != 0)
+            {
+                return false;
+            }
+
+            for (u32 index : mesh.indices)
+            {
+                if (index >= mesh.positions.size())
+                {
+                    return false;
+                }
+            }
+
+            mesh.name = std::string(primitive.name);
+
+            const json_value* materials = document.find_member(document.get_root(), "materials");
+            const json_value* material = materials ? document.get_element(*materials, get_gltf_index(document, *primitive.primitive, "material")) : nullptr;
+            const json_value* pbr = material ? document.find_member(*material, "pbrMetallicRoughness") : nullptr;
+            const json_value* base_color = pbr ? document.find_member(*pbr, "baseColorFactor") : nullptr;
+            if (base_color && base_color->num_children >= 3)
+            {
+                mesh.color.x = static_cast<float>(document.get_element(*base_color, 0)->number);
+                mesh.color.y = static_cast<float>(document.get_element(*base_color, 1)->number);
+                mesh.color.z = static_cast<float>(document.get_element(*base_color, 2)->number);
+            }
+
+            return true;
+        }
+
+        /**
+         * glTF matrices are column major and transform column vectors. Stored row by row they are the transpose,
+         * which is the same matrix for row vectors.
+         */
+        float4x4 get_gltf_transform(const json_document& document, const json_value& node)
+        {
+            float4x4 transform = float4x4::identity();
+
+            const json_value* matrix = document.find_member(node, "matrix");
+            if (matrix && matrix->num_children == 16)
+            {
+                for (u32 i = 0; i < 16; ++i)
+                {
+                    transform.m[i / 4][i % 4] = static_cast<float>(document.get_element(*matrix, i)->number);
+                }
+
+                return transform;
+            }
+
+            float t[3] = { 0.0f, 0.0f, 0.0f };
+            float r[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            float s[3] = { 1.0f, 1.0f, 1.0f };
+
+            auto read = [&document, &node](std::string_view name, float* values, u32 count)
+            {
+                const json_value* array = document.find_member(node, name);
+                if (array && array->num_children == count)
+                {
+                    for (u32 i = 0; i < count; ++i)
+                    {
+                        values[i] = static_cast<float>(document.get_element(*array, i)->number);
+                    }
+                }
+            };
+
+            read("translation", t, 3);
+            read("rotation", r, 4);
+            read("scale", s, 3);
+
+            // Scale, then rotate, then translate.
+            float x = r[0], y = r[1], z = r[2], w = r[3];
+            float rotation[3][3] =
+            {
+                { 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w) },
+                { 2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w) },
+                { 2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y) }
+            };
+
+            for (u32 row = 0; row < 3; ++row)
+            {
+                for (u32 column = 0; column < 3; ++column)
+                {
+                    transform.m[row][column] = rotation[row][column] * s[row];
+                }
+            }
+
+            transform.m[3][0] = t[0];
+            transform.m[3][1] = t[1];
+            transform.m[3][2] = t[2];
+
+            return transform;
+        }
+    }
+
+    bool model_importer::parse_gltf(const u8* data, size_t size, const std::filesystem::path& directory, imported_model& model)
+    {
+        model.clear();
+        m_statistics = model_import_statistics();
+
+        auto start_time = std::chrono::steady_clock::now();
+
+        std::string_view json_text(reinterpret_cast<const char*>(data), size);
+        std::vector<internal::gltf_buffer> buffers;
+
+        // Binary chunk of a GLB container, it is the first buffer.
+        internal::gltf_buffer binary_chunk;
+
+        u32 magic = 0;
+        if (size >= internal::glb_header_size)
+        {
+            memcpy(&magic, data, sizeof(magic));
+        }
+
+        if (magic == internal::glb_magic)
+        {
+            size_t offset = internal::glb_header_size;
+            bool has_json = false;
+
+            while (offset + internal::glb_chunk_header_size <= size)
+            {
+                u32 chunk_header[2];
+                memcpy(chunk_header, data + offset, sizeof(chunk_header));
+                offset += internal::glb_chunk_header_size;
+
+                if (chunk_header[0] > size - offset)
+                {
+                    log::error("GLB chunk exceeds the file");
+                    return false;
+                }
+
+                if (chunk_header[1] == internal::glb_json_chunk && !has_json)
+                {
+                    json_text = std::string_view(reinterpret_cast<const char*>(data + offset), chunk_header[0]);
+                    has_json = true;
+                }
+                else if (chunk_header[1] == internal::glb_binary_chunk && !binary_chunk.data)
+                {
+                    binary_chunk.data = data + offset;
+                    binary_chunk.size = chunk_header[0];
+                }
+
+                // Chunks are aligned to 4 bytes.
+                offset += (static_cast<size_t>(chunk_header[0]) + 3) & ~size_t(3);
+            }
+
+            if (!has_json)
+            {
+                log::error("GLB file has no json chunk");
+                return false;
+            }
+        }
+
+        json_document document;
+        if (!document.parse(json_text))
+        {
+            log::error("Malformed glTF json");
+            return false;
+        }
+
+        const json_value& root = document.get_root();
+
+        // Buffer files stay mapped until all primitives are decoded.
+        std::vector<file_mapping> buffer_files;
+        std::vector<std::vector<u8>> embedded_buffers;
+
+        m_statistics.num_bytes = size;
+
+        const json_value* buffer_list = document.find_member(root, "buffers");
+        size_t num_buffers = buffer_list ? buffer_list->num_children : 0;
+        for (size_t i = 0; i < num_buffers; ++i)
+        {
+            const json_value& buffer = *document.get_element(*buffer_list, i);
+            std::string_view uri = document.get_string(buffer, "uri");
+
+            internal::gltf_buffer& resolved = buffers.emplace_back();
+            if (uri.empty())
+            {
+                resolved = binary_chunk;
+            }
+            else if (uri.substr(0, 5) == "data:")
+            {
+                std::vector<u8>& decoded = embedded_buffers.emplace_back();
+                if (!internal::decode_gltf_data_uri(uri, decoded))
+                {
+                    log::error("Unsupported glTF data uri");
+                    return false;
+                }
+
+                resolved.data = decoded.data();
+                resolved.size = decoded.size();
+            }
+            else
+            {
+                file_mapping& file = buffer_files.emplace_back();
+                if (!file.open(directory / std::filesystem::u8path(uri)))
+                {
+                    return false;
+                }
+
+                resolved.data = file.get_data();
+                resolved.size = file.get_size();
+                m_statistics.num_bytes += file.get_size();
+            }
+
+            size_t byte_length = 0;
+            if (!resolved.data || !internal::get_gltf_size(document, buffer, "byteLength", byte_length) || byte_length > resolved.size)
+            {
+                log::error("glTF buffer {} is smaller than its byte length", i);
+                return false;
+            }
+        }
+
+        // Every triangle primitive becomes a mesh, the primitives of a glTF mesh are listed per mesh.
+        std::vector<internal::gltf_primitive> primitives;
+        std::vector<std::vector<u32>> mesh_primitives;
+
+        const json_value* mesh_list = document.find_member(root, "meshes");
+        size_t num_meshes = mesh_list ? mesh_list->num_children : 0;
+        mesh_primitives.resize(num_meshes);
+        for (size_t i = 0; i < num_meshes; ++i)
+        {
+            const json_value& mesh = *document.get_element(*mesh_list, i);
+            const json_value* primitive_list = document.find_member(mesh, "primitives");
+            size_t num_primitives = primitive_list ? primitive_list->num_children : 0;
+
+            for (size_t p = 0; p < num_primitives; ++p)
+            {
+                const json_value* primitive = document.get_element(*primitive_list, p);
+                if (static_cast<u32>(document.get_number(*primitive, "mode", internal::gltf_triangles)) != internal::gltf_triangles)
+                {
+                    continue;
+                }
+
+                mesh_primitives[i].push_back(static_cast<u32>(primitives.size()));
+                primitives.push_back({ primitive, document.get_string(mesh, "name") });
+            }
+        }
+
+        model.meshes.resize(primitives.size());
+
+        std::atomic<bool> valid_primitives(true);
+        parallel_for(primitives.size(), [&](size_t i)
+        {
+            if (!internal::decode_gltf_primitive(document, buffers, primitives[i], model.meshes[i]))
+            {
+                valid_primitives = false;
+            }
+        });
+
+        if (!valid_primitives)
+        {
+            log::error("Malformed glTF mesh primitive");
+            model.clear();
+            return false;
+        }
+
+        const json_value* node_list = document.find_member(root, "nodes");
+        size_t num_nodes = node_list ? node_list->num_children : 0;
+
+        // Nodes form a tree, a node with two parents could form a cycle.
+        std::vector<u8> has_parent(num_nodes, 0);
+
+        model.nodes.resize(num_nodes);
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            const json_value& node = *document.get_element(*node_list, i);
+            imported_node& imported = model.nodes[i];
+
+            imported.name = std::string(document.get_string(node, "name"));
+            imported.local_transform = internal::get_gltf_transform(document, node);
+
+            if (document.find_member(node, "mesh"))
+            {
+                u32 mesh = internal::get_gltf_index(document, node, "mesh");
+                if (mesh >= num_meshes)
+                {
+                    log::error("glTF node {} references a mesh out of range", i);
+                    model.clear();
+                    return false;
+                }
+
+                imported.meshes = mesh_primitives[mesh];
+            }
+
+            const json_value* children = document.find_member(node, "children");
+            size_t num_children = children ? children->num_children : 0;
+            for (size_t c = 0; c < num_children; ++c)
+            {
+                const json_value* child_value = document.get_element(*children, c);
+                double child = child_value->type == json_type::number ? child_value->number : -1.0;
+                if (child < 0.0 || child >= num_nodes || has_parent[static_cast<size_t>(child)])
+                {
+                    log::error("glTF node {} has an invalid child", i);
+                    model.clear();
+                    return false;
+                }
+
+                has_parent[static_cast<size_t>(child)] = 1;
+                imported.children.push_back(static_cast<u32>(child));
+            }
+        }
+
+        // The default scene lists the root nodes, without scenes every node without a parent is a root.
+        const json_value* scene_list = document.find_member(root, "scenes");
+        const json_value* scene = scene_list ? document.get_element(*scene_list, static_cast<size_t>(document.get_number(root, "scene", 0.0))) : nullptr;
+        const json_value* scene_nodes = scene ? document.find_member(*scene, "nodes") : nullptr;
+
+        if (scene_nodes)
+        {
+            for (size_t i = 0; i < scene_nodes->num_children; ++i)
+            {
+                const json_value* node_value = document.get_element(*scene_nodes, i);
+                double node = node_value->type == json_type::number ? node_value->number : -1.0;
+                if (node < 0.0 || node >= num_nodes || has_parent[static_cast<size_t>(node)])
+                {
+                    log::error("glTF scene has an invalid root node");
+                    model.clear();
+                    return false;
+                }
+
+                has_parent[static_cast<size_t>(node)] = 1;
+                model.root_nodes.push_back(static_cast<u32>(node));
+            }
+        }
+        else
+        {
+            for (u32 i = 0; i < num_nodes; ++i)
+            {
+                if (!has_parent[i])
+                {
+                    model.root_nodes.push_back(i);
+                }
+            }
+        }
+
+        m_statistics.num_vertices = model.get_num_vertices();
+        m_statistics.num_triangles = model.get_num_triangles();
+        m_statistics.import_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+        return true;
+    }
+}
\ No newline at end of file
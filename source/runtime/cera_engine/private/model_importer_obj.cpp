@@ -0,0 +1,608 @@
+#include "model_importer.h"
+
+#include "util/threading/thread_pool.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+namespace cera
+{
+    namespace internal
+    {
+        // Files are split into chunks of at least this size, smaller chunks cost more to stitch than they save.
+        constexpr size_t min_obj_chunk_size = 1 << 20;
+        // More chunks than threads keep all threads busy when chunks take uneven time.
+        constexpr size_t obj_chunks_per_thread = 4;
+
+        constexpr u32 obj_no_normal = ~0u;
+
+        // Negative OBJ indices count back from the last element read, they are stored relative to the start of their chunk.
+        constexpr u32 obj_relative_position = 1;
+        constexpr u32 obj_relative_normal = 2;
+        constexpr u32 obj_has_normal = 4;
+
+        struct obj_corner
+        {
+            s32 position;
+            s32 normal;
+            u32 flags;
+        };
+
+        struct obj_resolved_corner
+        {
+            u32 position;
+            u32 normal;
+        };
+
+        // An object or group statement, it starts a new mesh.
+        struct obj_group
+        {
+            std::string_view name;
+            size_t first_corner;
+        };
+
+        struct obj_chunk
+        {
+            const char* begin = nullptr;
+            const char* end = nullptr;
+
+            std::vector<float3> positions;
+            std::vector<float3> normals;
+            // Three corners per triangle, polygons are split into fans.
+            std::vector<obj_corner> corners;
+            std::vector<obj_group> groups;
+
+            bool valid = true;
+
+            // Number of elements in all previous chunks.
+            size_t first_position = 0;
+            size_t first_normal = 0;
+            size_t first_corner = 0;
+        };
+
+        struct obj_mesh_range
+        {
+            std::string_view name;
+            size_t first_corner;
+            size_t end_corner;
+        };
+
+        // Exact powers of ten, a mantissa below 2^53 scaled by one of them is correctly rounded.
+        constexpr double obj_powers_of_ten[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        inline bool is_obj_space(char c)
+        {
+            return c == ' ' || c == '\t';
+        }
+
+        inline bool is_obj_digit(char c)
+        {
+            return static_cast<unsigned char>(c - '0') < 10;
+        }
+
+        inline void skip_obj_spaces(const char*& cursor, const char* end)
+        {
+            while (cursor < end && is_obj_space(*cursor))
+            {
+                ++cursor;
+            }
+        }
+
+        /**
+         * Parse a decimal float without the locale handling of strtof.
+         * At most 19 significant digits are used, which is more than a float can hold.
+         */
+        bool parse_obj_float(const char*& cursor, const char* end, float& value)
+        {
+            const char* c = cursor;
+
+            bool negative = false;
+            if (c < end && (*c == '-' || *c == '+'))
+            {
+                negative = *c == '-';
+                ++c;
+            }
+
+            u64 mantissa = 0;
+            s32 exponent = 0;
+            u32 num_digits = 0;
+            bool has_digits = false;
+
+            for (; c < end && is_obj_digit(*c); ++c)
+            {
+                has_digits = true;
+                if (num_digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*c - '0');
+                    num_digits += mantissa != 0 ? 1 : 0;
+                }
+                else
+                {
+                    ++exponent;
+                }
+            }
+
+            if (c < end && *c == '.')
+            {
+                ++c;
+                for (; c < end && is_obj_digit(*c); ++c)
+                {
+                    has_digits = true;
+                    if (num_digits < 19)
+                    {
+                        mantissa = mantissa * 10 + (*c - '0');
+                        num_digits += mantissa != 0 ? 1 : 0;
+                        --exponent;
+                    }
+                }
+            }
+
+            if (!has_digits)
+            {
+                return false;
+            }
+
+            if (c < end && (*c == 'e' || *c == 'E'))
+            {
+                ++c;
+
+                bool negative_exponent = false;
+                if (c < end && (*c == '-' || *c == '+'))
+                {
+                    negative_exponent = *c == '-';
+                    ++c;
+                }
+
+                if (c == end || !is_obj_digit(*c))
+                {
+                    return false;
+                }
+
+                s32 explicit_exponent = 0;
+                for (; c < end && is_obj_digit(*c); ++c)
+                {
+                    explicit_exponent = std::min(explicit_exponent * 10 + (*c - '0'), 10000);
+                }
+
+                exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+            }
+
+            double result = static_cast<double>(mantissa);
+            if (exponent < 0)
+            {
+                result = -exponent <= 22 ? result / obj_powers_of_ten[-exponent] : result * std::pow(10.0, exponent);
+            }
+            else if (exponent > 0)
+            {
+                result = exponent <= 22 ? result * obj_powers_of_ten[exponent] : result * std::pow(10.0, exponent);
+            }
+
+            value = static_cast<float>(negative ? -result : result);
+            cursor = c;
+
+            return true;
+        }
+
+        bool parse_obj_int(const char*& cursor, const char* end, s32& value)
+        {
+            const char* c = cursor;
+
+            bool negative = false;
+            if (c < end && (*c == '-' || *c == '+'))
+            {
+                negative = *c == '-';
+                ++c;
+            }
+
+            if (c == end || !is_obj_digit(*c))
+            {
+                return false;
+            }
+
+            s64 result = 0;
+            for (; c < end && is_obj_digit(*c); ++c)
+            {
+                result = std::min<s64>(result * 10 + (*c - '0'), 0x7FFFFFFF);
+            }
+
+            value = static_cast<s32>(negative ? -result : result);
+            cursor = c;
+
+            return true;
+        }
+
+        bool parse_obj_float3(const char*& cursor, const char* end, float3& value)
+        {
+            skip_obj_spaces(cursor, end);
+            if (!parse_obj_float(cursor, end, value.x))
+            {
+                return false;
+            }
+
+            skip_obj_spaces(cursor, end);
+            if (!parse_obj_float(cursor, end, value.y))
+            {
+                return false;
+            }
+
+            skip_obj_spaces(cursor, end);
+            return parse_obj_float(cursor, end, value.z);
+        }
+
+        /**
+         * Parse a face corner "v", "v/vt", "v//vn" or "v/vt/vn", texture coordinates are skipped.
+         */
+        bool parse_obj_corner(const char*& cursor, const char* end, const obj_chunk& chunk, obj_corner& corner)
+        {
+            s32 position;
+            if (!parse_obj_int(cursor, end, position) || position == 0)
+            {
+                return false;
+            }
+
+            corner.flags = 0;
+            corner.position = position > 0 ? position - 1 : static_cast<s32>(chunk.positions.size()) + position;
+            corner.flags |= position < 0 ? obj_relative_position : 0;
+            corner.normal = 0;
+
+            if (cursor < end && *cursor == '/')
+            {
+                ++cursor;
+
+                s32 texcoord;
+                if (cursor < end && *cursor != '/' && !parse_obj_int(cursor, end, texcoord))
+                {
+                    return false;
+                }
+
+                if (cursor < end && *cursor == '/')
+                {
+                    ++cursor;
+
+                    s32 normal;
+                    if (!parse_obj_int(cursor, end, normal) || normal == 0)
+                    {
+                        return false;
+                    }
+
+                    corner.normal = normal > 0 ? normal - 1 : static_cast<s32>(chunk.normals.size()) + normal;
+                    corner.flags |= obj_has_normal | (normal < 0 ? obj_relative_normal : 0);
+                }
+            }
+
+            return true;
+        }
+
+        std::string_view get_obj_name(const char* cursor, const char* end)
+        {
+            skip_obj_spaces(cursor, end);
+            while (end > cursor && is_obj_space(end[-1]))
+            {
+                --end;
+            }
+
+            return std::string_view(cursor, end - cursor);
+        }
+
+        bool parse_obj_line(const char* cursor, const char* end, obj_chunk& chunk)
+        {
+            skip_obj_spaces(cursor, end);
+            if (cursor == end || *cursor == '#')
+            {
+                return true;
+            }
+
+            const char* keyword = cursor;
+            while (cursor < end && !is_obj_space(*cursor))
+            {
+                ++cursor;
+            }
+
+            std::string_view statement(keyword, cursor - keyword);
+
+            if (statement == "v")
+            {
+                return parse_obj_float3(cursor, end, chunk.positions.emplace_back());
+            }
+
+            if (statement == "vn")
+            {
+                return parse_obj_float3(cursor, end, chunk.normals.emplace_back());
+            }
+
+            if (statement == "f")
+            {
+                obj_corner first;
+                obj_corner previous;
+                u32 num_corners = 0;
+
+                while (true)
+                {
+                    skip_obj_spaces(cursor, end);
+                    if (cursor == end)
+                    {
+                        break;
+                    }
+
+                    obj_corner corner;
+                    if (!parse_obj_corner(cursor, end, chunk, corner))
+                    {
+                        return false;
+                    }
+
+                    if (num_corners == 0)
+                    {
+                        first = corner;
+                    }
+                    else if (num_corners >= 2)
+                    {
+                        chunk.corners.push_back(first);
+                        chunk.corners.push_back(previous);
+                        chunk.corners.push_back(corner);
+                    }
+
+                    previous = corner;
+                    ++num_corners;
+                }
+
+                return num_corners >= 3;
+            }
+
+            if (statement == "o" || statement == "g")
+            {
+                chunk.groups.push_back({ get_obj_name(cursor, end), chunk.corners.size() });
+            }
+
+            // Texture coordinates, materials, smoothing groups, lines and points are not imported.
+            return true;
+        }
+
+        void parse_obj_chunk(obj_chunk& chunk)
+        {
+            const char* cursor = chunk.begin;
+            while (cursor < chunk.end)
+            {
+                const char* line_end = static_cast<const char*>(memchr(cursor, '\n', chunk.end - cursor));
+                if (!line_end)
+                {
+                    line_end = chunk.end;
+                }
+
+                const char* content_end = line_end > cursor && line_end[-1] == '\r' ? line_end - 1 : line_end;
+                if (!parse_obj_line(cursor, content_end, chunk))
+                {
+                    chunk.valid = false;
+                    return;
+                }
+
+                cursor = line_end + 1;
+            }
+        }
+
+        // Open addressing table from a position and normal pair to the vertex created for it.
+        class obj_vertex_table
+        {
+        public:
+            explicit obj_vertex_table(size_t numCorners)
+            {
+                size_t capacity = 16;
+                while (capacity < numCorners * 2)
+                {
+                    capacity *= 2;
+                }
+
+                m_keys.assign(capacity, empty_key);
+                m_vertices.resize(capacity);
+                m_mask = capacity - 1;
+            }
+
+            // @returns true when the pair was not in the table yet and is now mapped to newVertex.
+            bool insert(u64 key, u32 newVertex, u32& vertex)
+            {
+                size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & m_mask;
+                while (m_keys[slot] != empty_key)
+                {
+                    if (m_keys[slot] == key)
+                    {
+                        vertex = m_vertices[slot];
+                        return false;
+                    }
+
+                    slot = (slot + 1) & m_mask;
+                }
+
+                m_keys[slot] = key;
+                m_vertices[slot] = newVertex;
+                vertex = newVertex;
+
+                return true;
+            }
+
+        private:
+            static constexpr u64 empty_key = ~0ull;
+
+            std::vector<u64> m_keys;
+            std::vector<u32> m_vertices;
+            size_t m_mask;
+        };
+
+        /**
+         * Create the vertices of one mesh, every distinct position and normal pair becomes one vertex.
+         */
+        void build_obj_mesh(const std::vector<float3>& positions, const std::vector<float3>& normals, const std::vector<obj_resolved_corner>& corners, const obj_mesh_range& range, imported_mesh& mesh)
+        {
+            size_t num_corners = range.end_corner - range.first_corner;
+
+            bool has_normals = false;
+            for (size_t i = range.first_corner; i < range.end_corner && !has_normals; ++i)
+            {
+                has_normals = corners[i].normal != obj_no_normal;
+            }
+
+            mesh.name = std::string(range.name);
+            mesh.indices.resize(num_corners);
+
+            obj_vertex_table table(num_corners);
+            for (size_t i = 0; i < num_corners; ++i)
+            {
+                const obj_resolved_corner& corner = corners[range.first_corner + i];
+
+                u64 key = (static_cast<u64>(corner.position) << 32) | corner.normal;
+
+                u32 vertex;
+                if (table.insert(key, static_cast<u32>(mesh.positions.size()), vertex))
+                {
+                    mesh.positions.push_back(positions[corner.position]);
+                    if (has_normals)
+                    {
+                        mesh.normals.push_back(corner.normal != obj_no_normal ? normals[corner.normal] : float3{ 0.0f, 0.0f, 0.0f });
+                    }
+                }
+
+                mesh.indices[i] = vertex;
+            }
+        }
+    }
+
+    bool model_importer::parse_obj(const char* text, size_t size, imported_model& model)
+    {
+        model.clear();
+        m_statistics = model_import_statistics();
+
+        auto start_time = std::chrono::steady_clock::now();
+
+        // Split the file at line boundaries.
+        size_t num_threads = m_thread_pool ? m_thread_pool->get_num_threads() + 1 : 1;
+        size_t num_chunks = std::clamp<size_t>(size / internal::min_obj_chunk_size, 1, num_threads * internal::obj_chunks_per_thread);
+
+        std::vector<internal::obj_chunk> chunks(num_chunks);
+
+        const char* end = text + size;
+        const char* chunk_begin = text;
+        for (size_t i = 0; i < num_chunks; ++i)
+        {
+            const char* chunk_end = i + 1 == num_chunks ? end : text + size / num_chunks * (i + 1);
+            if (chunk_end < chunk_begin)
+            {
+                chunk_end = chunk_begin;
+            }
+
+            const char* line_end = static_cast<const char*>(memchr(chunk_end, '\n', end - chunk_end));
+            chunk_end = line_end ? line_end + 1 : end;
+
+            chunks[i].begin = chunk_begin;
+            chunks[i].end = chunk_end;
+            chunk_begin = chunk_end;
+        }
+
+        parallel_for(num_chunks, [&chunks](size_t i) { internal::parse_obj_chunk(chunks[i]); });
+
+        size_t num_positions = 0;
+        size_t num_normals = 0;
+        size_t num_corners = 0;
+        for (internal::obj_chunk& chunk : chunks)
+        {
+            if (!chunk.valid)
+            {
+                log::error("Malformed OBJ statement");
+                return false;
+            }
+
+            chunk.first_position = num_positions;
+            chunk.first_normal = num_normals;
+            chunk.first_corner = num_corners;
+
+            num_positions += chunk.positions.size();
+            num_normals += chunk.normals.size();
+            num_corners += chunk.corners.size();
+        }
+
+        // Gather the chunks into one stream and resolve the corners to absolute indices.
+        std::vector<float3> positions(num_positions);
+        std::vector<float3> normals(num_normals);
+        std::vector<internal::obj_resolved_corner> corners(num_corners);
+
+        std::atomic<bool> valid_indices(true);
+        parallel_for(num_chunks, [&](size_t i)
+        {
+            const internal::obj_chunk& chunk = chunks[i];
+
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.first_position);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.first_normal);
+
+            for (size_t c = 0; c < chunk.corners.size(); ++c)
+            {
+                const internal::obj_corner& corner = chunk.corners[c];
+
+                s64 position = corner.position + ((corner.flags & internal::obj_relative_position) ? static_cast<s64>(chunk.first_position) : 0);
+                s64 normal = corner.normal + ((corner.flags & internal::obj_relative_normal) ? static_cast<s64>(chunk.first_normal) : 0);
+
+                bool has_normal = (corner.flags & internal::obj_has_normal) != 0;
+                if (position < 0 || position >= static_cast<s64>(num_positions) || (has_normal && (normal < 0 || normal >= static_cast<s64>(num_normals))))
+                {
+                    valid_indices = false;
+                    return;
+                }
+
+                corners[chunk.first_corner + c] = { static_cast<u32>(position), has_normal ? static_cast<u32>(normal) : internal::obj_no_normal };
+            }
+        });
+
+        if (!valid_indices)
+        {
+            log::error("OBJ face references a vertex out of range");
+            return false;
+        }
+
+        // Every object and group statement starts a mesh, statements without faces in between are dropped.
+        std::vector<internal::obj_mesh_range> ranges;
+        std::string_view current_name;
+        size_t current_first_corner = 0;
+        for (const internal::obj_chunk& chunk : chunks)
+        {
+            for (const internal::obj_group& group : chunk.groups)
+            {
+                size_t first_corner = chunk.first_corner + group.first_corner;
+                if (first_corner > current_first_corner)
+                {
+                    ranges.push_back({ current_name, current_first_corner, first_corner });
+                }
+
+                current_name = group.name;
+                current_first_corner = first_corner;
+            }
+        }
+
+        if (num_corners > current_first_corner)
+        {
+            ranges.push_back({ current_name, current_first_corner, num_corners });
+        }
+
+        model.meshes.resize(ranges.size());
+        parallel_for(ranges.size(), [&](size_t i) { internal::build_obj_mesh(positions, normals, corners, ranges[i], model.meshes[i]); });
+
+        // OBJ files have no hierarchy, all meshes hang off one root node.
+        imported_node& root = model.nodes.emplace_back();
+        for (u32 i = 0; i < model.meshes.size(); ++i)
+        {
+            root.meshes.push_back(i);
+        }
+        model.root_nodes.push_back(0);
+
+        m_statistics.num_bytes = size;
+        m_statistics.num_vertices = model.get_num_vertices();
+        m_statistics.num_triangles = model.get_num_triangles();
+        m_statistics.import_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,457 @@
+#include "occlusion_culler.h"
+
+#include "util/threading/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CERA_OCCLUSION_SSE 1
+#include <xmmintrin.h>
+#else
+#define CERA_OCCLUSION_SSE 0
+#endif
+
+namespace cera
+{
+    namespace internal
+    {
+        // Triangles closer than this clip space depth are clipped, keeps the perspective divide stable.
+        constexpr float near_clip_epsilon = 1e-5f;
+    }
+
+    occlusion_culler::occlusion_culler(u32 width, u32 height)
+        : m_width(std::max((width + tile_width - 1) / tile_width, 1u) * tile_width)
+        , m_height(std::max((height + tile_height - 1) / tile_height, 1u) * tile_height)
+        , m_view_projection(float4x4::identity())
+    {
+        static_assert(tile_width % block_size == 0 && tile_height % block_size == 0, "Tiles must contain whole blocks.");
+        static_assert(tile_width % 4 == 0, "Tiles are rasterized 4 pixels at a time.");
+
+        m_num_tiles_x = m_width / tile_width;
+        m_num_tiles_y = m_height / tile_height;
+
+        m_depth.resize(m_width * m_height, 1.0f);
+        m_block_depth.resize((m_width / block_size) * (m_height / block_size), 1.0f);
+        m_tile_triangles.resize(m_num_tiles_x * m_num_tiles_y);
+    }
+
+    void occlusion_culler::begin_frame(const float4x4& viewProjection)
+    {
+        m_view_projection = viewProjection;
+
+        std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+        std::fill(m_block_depth.begin(), m_block_depth.end(), 1.0f);
+
+        m_triangles.clear();
+        for (auto& triangles : m_tile_triangles)
+        {
+            triangles.clear();
+        }
+    }
+
+    void occlusion_culler::add_occluder(const occluder_geometry& geometry, const float4x4& worldTransform)
+    {
+        float4x4 world_view_projection = multiply(worldTransform, m_view_projection);
+        const float (&m)[4][4] = world_view_projection.m;
+
+        m_clip_vertices.resize(geometry.positions.size());
+        for (size_t i = 0; i < geometry.positions.size(); ++i)
+        {
+            const float3& p = geometry.positions[i];
+
+            clip_vertex& v = m_clip_vertices[i];
+            v.x = p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0];
+            v.y = p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1];
+            v.z = p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2];
+            v.w = p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3];
+        }
+
+        for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3)
+        {
+            add_triangle(m_clip_vertices[geometry.indices[i + 0]], m_clip_vertices[geometry.indices[i + 1]], m_clip_vertices[geometry.indices[i + 2]]);
+        }
+    }
+
+    void occlusion_culler::rasterize(threading::thread_pool* threadPool)
+    {
+        u32 num_tiles = m_num_tiles_x * m_num_tiles_y;
+
+        if (threadPool && threadPool->get_num_threads() > 0)
+        {
+            // Tiles do not share pixels or cache lines, every tile is an independent task.
+            for (u32 tile = 1; tile < num_tiles; ++tile)
+            {
+                if (!m_tile_triangles[tile].empty())
+                {
+                    threadPool->submit([this, tile]() { rasterize_tile(tile); });
+                }
+            }
+
+            rasterize_tile(0);
+
+            threadPool->wait_idle();
+        }
+        else
+        {
+            for (u32 tile = 0; tile < num_tiles; ++tile)
+            {
+                rasterize_tile(tile);
+            }
+        }
+
+        build_block_depth();
+    }
+
+    bool occlusion_culler::is_visible(const bounding_box& worldBox) const
+    {
+        if (worldBox.is_empty())
+        {
+            return true;
+        }
+
+        const float (&m)[4][4] = m_view_projection.m;
+
+        float min_x = static_cast<float>(m_width);
+        float min_y = static_cast<float>(m_height);
+        float max_x = 0.0f;
+        float max_y = 0.0f;
+        float min_depth = 1.0f;
+
+        for (u32 corner = 0; corner < 8; ++corner)
+        {
+            float x = (corner & 1) ? worldBox.max.x : worldBox.min.x;
+            float y = (corner & 2) ? worldBox.max.y : worldBox.min.y;
+            float z = (corner & 4) ? worldBox.max.z : worldBox.min.z;
+
+            float clip_x = x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0];
+            float clip_y = x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1];
+            float clip_z = x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2];
+            float clip_w = x * m[0][3] + y * m[1][3] + z * m[2][3] + m[3][3];
+
+            // Boxes crossing the near plane cover an unbounded part of the screen.
+            if (clip_z < internal::near_clip_epsilon || clip_w < internal::near_clip_epsilon)
+            {
+                return true;
+            }
+
+            float inverse_w = 1.0f / clip_w;
+            float screen_x = (clip_x * inverse_w * 0.5f + 0.5f) * m_width;
+            float screen_y = (0.5f - clip_y * inverse_w * 0.5f) * m_height;
+
+            min_x = std::min(min_x, screen_x);
+            max_x = std::max(max_x, screen_x);
+            min_y = std::min(min_y, screen_y);
+            max_y = std::max(max_y, screen_y);
+            min_depth = std::min(min_depth, clip_z * inverse_w);
+        }
+
+        // Pixels whose center can be covered by the box, clamped before converting to avoid overflows.
+        s32 x0 = static_cast<s32>(std::max(std::floor(min_x - 0.5f), 0.0f));
+        s32 y0 = static_cast<s32>(std::max(std::floor(min_y - 0.5f), 0.0f));
+        s32 x1 = static_cast<s32>(std::min(std::ceil(max_x - 0.5f), m_width - 1.0f));
+        s32 y1 = static_cast<s32>(std::min(std::ceil(max_y - 0.5f), m_height - 1.0f));
+
+        if (x0 > x1 || y0 > y1)
+        {
+            // Outside of the screen, this is left to frustum culling.
+            return true;
+        }
+
+        // The box is hidden when it is behind the farthest occluder depth of every pixel it covers.
+        u32 blocks_per_row = m_width / block_size;
+        bool hidden_by_blocks = true;
+        for (s32 by = y0 / block_size; by <= y1 / static_cast<s32>(block_size) && hidden_by_blocks; ++by)
+        {
+            for (s32 bx = x0 / block_size; bx <= x1 / static_cast<s32>(block_size); ++bx)
+            {
+                if (m_block_depth[by * blocks_per_row + bx] >= min_depth)
+                {
+                    hidden_by_blocks = false;
+                    break;
+                }
+            }
+        }
+
+        if (hidden_by_blocks)
+        {
+            return false;
+        }
+
+        // Blocks extend past the box, test the covered pixels.
+        for (s32 y = y0; y <= y1; ++y)
+        {
+            const float* row = m_depth.data() + y * m_width;
+            for (s32 x = x0; x <= x1; ++x)
+            {
+                if (row[x] >= min_depth)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    u32 occlusion_culler::get_width() const
+    {
+        return m_width;
+    }
+
+    u32 occlusion_culler::get_height() const
+    {
+        return m_height;
+    }
+
+    const float* occlusion_culler::get_depth_buffer() const
+    {
+        return m_depth.data();
+    }
+
+    u32 occlusion_culler::get_num_triangles() const
+    {
+        return static_cast<u32>(m_triangles.size());
+    }
+
+    void occlusion_culler::add_triangle(const clip_vertex& v0, const clip_vertex& v1, const clip_vertex& v2)
+    {
+        const clip_vertex* vertices[3] = { &v0, &v1, &v2 };
+
+        u32 num_inside = 0;
+        for (const clip_vertex* v : vertices)
+        {
+            num_inside += v->z >= internal::near_clip_epsilon ? 1 : 0;
+        }
+
+        if (num_inside == 3)
+        {
+            add_screen_triangle(v0, v1, v2);
+            return;
+        }
+
+        if (num_inside == 0)
+        {
+            return;
+        }
+
+        // Sutherland-Hodgman against the near plane, results in a triangle or a quad.
+        clip_vertex polygon[4];
+        u32 num_vertices = 0;
+
+        for (u32 i = 0; i < 3; ++i)
+        {
+            const clip_vertex& a = *vertices[i];
+            const clip_vertex& b = *vertices[(i + 1) % 3];
+
+            bool a_inside = a.z >= internal::near_clip_epsilon;
+            bool b_inside = b.z >= internal::near_clip_epsilon;
+
+            if (a_inside)
+            {
+                polygon[num_vertices++] = a;
+            }
+
+            if (a_inside != b_inside)
+            {
+                float t = (internal::near_clip_epsilon - a.z) / (b.z - a.z);
+
+                clip_vertex& v = polygon[num_vertices++];
+                v.x = a.x + (b.x - a.x) * t;
+                v.y = a.y + (b.y - a.y) * t;
+                v.z = internal::near_clip_epsilon;
+                v.w = a.w + (b.w - a.w) * t;
+            }
+        }
+
+        for (u32 i = 1; i + 1 < num_vertices; ++i)
+        {
+            add_screen_triangle(polygon[0], polygon[i], polygon[i + 1]);
+        }
+    }
+
+    void occlusion_culler::add_screen_triangle(const clip_vertex& v0, const clip_vertex& v1, const clip_vertex& v2)
+    {
+        const clip_vertex* vertices[3] = { &v0, &v1, &v2 };
+
+        screen_triangle triangle;
+        for (u32 i = 0; i < 3; ++i)
+        {
+            const clip_vertex& v = *vertices[i];
+            if (v.w < internal::near_clip_epsilon)
+            {
+                return;
+            }
+
+            float inverse_w = 1.0f / v.w;
+            triangle.x[i] = (v.x * inverse_w * 0.5f + 0.5f) * m_width;
+            triangle.y[i] = (0.5f - v.y * inverse_w * 0.5f) * m_height;
+            triangle.z[i] = v.z * inverse_w;
+        }
+
+        float min_x = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+        float max_x = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+        float min_y = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+        float max_y = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+
+        if (max_x < 0.0f || max_y < 0.0f || min_x >= m_width || min_y >= m_height)
+        {
+            return;
+        }
+
+        u32 index = static_cast<u32>(m_triangles.size());
+        m_triangles.push_back(triangle);
+
+        // Bin the triangle into every tile its bounds overlap.
+        // Clamp before converting, vertices close to the near plane project far outside of the screen.
+        u32 tile_x0 = static_cast<u32>(std::max(min_x, 0.0f)) / tile_width;
+        u32 tile_y0 = static_cast<u32>(std::max(min_y, 0.0f)) / tile_height;
+        u32 tile_x1 = static_cast<u32>(std::min(max_x, m_width - 1.0f)) / tile_width;
+        u32 tile_y1 = static_cast<u32>(std::min(max_y, m_height - 1.0f)) / tile_height;
+
+        for (u32 tile_y = tile_y0; tile_y <= tile_y1; ++tile_y)
+        {
+            for (u32 tile_x = tile_x0; tile_x <= tile_x1; ++tile_x)
+            {
+                m_tile_triangles[tile_y * m_num_tiles_x + tile_x].push_back(index);
+            }
+        }
+    }
+
+    void occlusion_culler::rasterize_tile(u32 tile)
+    {
+        u32 tile_x = tile % m_num_tiles_x;
+        u32 tile_y = tile / m_num_tiles_x;
+
+        for (u32 index : m_tile_triangles[tile])
+        {
+            rasterize_triangle(m_triangles[index], tile_x, tile_y);
+        }
+    }
+
+    void occlusion_culler::rasterize_triangle(const screen_triangle& triangle, u32 tileX, u32 tileY)
+    {
+        float x0 = triangle.x[0], y0 = triangle.y[0];
+        float x1 = triangle.x[1], y1 = triangle.y[1];
+        float x2 = triangle.x[2], y2 = triangle.y[2];
+        float z0 = triangle.z[0], z1 = triangle.z[1], z2 = triangle.z[2];
+
+        float area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+        if (area == 0.0f || !std::isfinite(area))
+        {
+            return;
+        }
+
+        // Both windings are rasterized, make the edge functions positive inside.
+        if (area < 0.0f)
+        {
+            std::swap(x1, x2);
+            std::swap(y1, y2);
+            std::swap(z1, z2);
+            area = -area;
+        }
+
+        // Edge function of edge a->b: A * x + B * y + C, positive on the inside.
+        float edge_a[3] = { y0 - y1, y1 - y2, y2 - y0 };
+        float edge_b[3] = { x1 - x0, x2 - x1, x0 - x2 };
+        float edge_c[3] = { (y1 - y0) * x0 - (x1 - x0) * y0, (y2 - y1) * x1 - (x2 - x1) * y1, (y0 - y2) * x2 - (x0 - x2) * y2 };
+
+        // Depth is linear in screen space.
+        float dz_dx = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+        float dz_dy = ((x1 - x0) * (z2 - z0) - (x2 - x0) * (z1 - z0)) / area;
+        float z_c = z0 - dz_dx * x0 - dz_dy * y0;
+
+        // Pixels of the tile covered by the bounds of the triangle, the first column is aligned to 4 pixels.
+        s32 tile_x0 = static_cast<s32>(tileX * tile_width);
+        s32 tile_y0 = static_cast<s32>(tileY * tile_height);
+
+        s32 tile_x1 = tile_x0 + static_cast<s32>(tile_width) - 1;
+        s32 tile_y1 = tile_y0 + static_cast<s32>(tile_height) - 1;
+
+        s32 px0 = static_cast<s32>(std::max(std::floor(std::min({ x0, x1, x2 })), static_cast<float>(tile_x0))) & ~3;
+        s32 py0 = static_cast<s32>(std::max(std::floor(std::min({ y0, y1, y2 })), static_cast<float>(tile_y0)));
+        s32 px1 = static_cast<s32>(std::min(std::ceil(std::max({ x0, x1, x2 })), static_cast<float>(tile_x1)));
+        s32 py1 = static_cast<s32>(std::min(std::ceil(std::max({ y0, y1, y2 })), static_cast<float>(tile_y1)));
+
+        for (s32 py = py0; py <= py1; ++py)
+        {
+            float* row = m_depth.data() + py * m_width;
+            float center_y = py + 0.5f;
+
+#if CERA_OCCLUSION_SSE
+            __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+            __m128 row_e0 = _mm_set1_ps(edge_b[0] * center_y + edge_c[0]);
+            __m128 row_e1 = _mm_set1_ps(edge_b[1] * center_y + edge_c[1]);
+            __m128 row_e2 = _mm_set1_ps(edge_b[2] * center_y + edge_c[2]);
+            __m128 row_z = _mm_set1_ps(dz_dy * center_y + z_c);
+
+            __m128 a0 = _mm_set1_ps(edge_a[0]);
+            __m128 a1 = _mm_set1_ps(edge_a[1]);
+            __m128 a2 = _mm_set1_ps(edge_a[2]);
+            __m128 dz = _mm_set1_ps(dz_dx);
+            __m128 zero = _mm_setzero_ps();
+
+            for (s32 px = px0; px <= px1; px += 4)
+            {
+                __m128 center_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(px)), lane_offsets);
+
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, center_x), row_e0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, center_x), row_e1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, center_x), row_e2);
+
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0)
+                {
+                    continue;
+                }
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(dz, center_x), row_z);
+                __m128 depth = _mm_load_ps(row + px);
+                __m128 closer = _mm_min_ps(depth, z);
+
+                _mm_store_ps(row + px, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, depth)));
+            }
+#else
+            for (s32 px = px0; px <= px1; ++px)
+            {
+                float center_x = px + 0.5f;
+
+                float e0 = edge_a[0] * center_x + edge_b[0] * center_y + edge_c[0];
+                float e1 = edge_a[1] * center_x + edge_b[1] * center_y + edge_c[1];
+                float e2 = edge_a[2] * center_x + edge_b[2] * center_y + edge_c[2];
+
+                if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+                {
+                    float z = dz_dx * center_x + dz_dy * center_y + z_c;
+                    row[px] = std::min(row[px], z);
+                }
+            }
+#endif
+        }
+    }
+
+    void occlusion_culler::build_block_depth()
+    {
+        u32 blocks_per_row = m_width / block_size;
+        u32 blocks_per_column = m_height / block_size;
+
+        for (u32 by = 0; by < blocks_per_column; ++by)
+        {
+            for (u32 bx = 0; bx < blocks_per_row; ++bx)
+            {
+                float max_depth = 0.0f;
+                for (u32 y = 0; y < block_size; ++y)
+                {
+                    const float* row = m_depth.data() + (by * block_size + y) * m_width + bx * block_size;
+                    for (u32 x = 0; x < block_size; ++x)
+                    {
+                        max_depth = std::max(max_depth, row[x]);
+                    }
+                }
+
+                m_block_depth[by * blocks_per_row + bx] = max_depth;
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -17,9 +17,12 @@
 #include "render/constant_buffer_view.h"
 #include "render/unordered_access_view.h"
 #include "render/constant_buffer.h"
+#include "render/indirect_draw_arguments.h"
 
 #include "util/log.h"
 
+#include <algorithm>
+
 namespace cera
 {
     namespace adaptors
@@ -56,6 +59,8 @@ namespace cera
         , m_d3d_command_list_type(type)
         , m_root_signature(nullptr)
         , m_pipeline_state(nullptr)
+        , m_skip_draws(false)
+        , m_num_skipped_draws(0)
     {
         log::info("Created a new CommandList of type: {0} - Instance nr: {1}", conversions::to_string(type), instance_nr());
 
@@ -263,6 +268,41 @@ namespace cera
         return byte_address_buffer;
     }
 
+    bool command_list::copy_buffer_region(const std::shared_ptr<buffer>& dstBuffer, size_t dstOffset, size_t bufferSize, const void* bufferData)
+    {
+        assert(dstBuffer);
+
+        if (bufferSize == 0)
+        {
+            return true;
+        }
+
+        transition_barrier(dstBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
+        flush_resource_barriers();
+
+        // Staged through the pages of the upload buffer instead of a committed resource per copy, the pages are
+        // reused once the command list is reset. Ranges larger than a page are copied one page at a time.
+        size_t max_bytes_per_upload = m_upload_buffer->get_page_size();
+
+        const u8* data = static_cast<const u8*>(bufferData);
+        for (size_t offset = 0; offset < bufferSize;)
+        {
+            size_t upload_size = std::min(max_bytes_per_upload, bufferSize - offset);
+
+            auto heap_allocation = m_upload_buffer->allocate(upload_size, sizeof(u32));
+            memcpy(heap_allocation.CPU, data + offset, upload_size);
+
+            m_d3d_command_list->CopyBufferRegion(dstBuffer->get_d3d_resource().Get(), dstOffset + offset, heap_allocation.resource, heap_allocation.offset, upload_size);
+
+            offset += upload_size;
+        }
+
+        // Add a reference to the buffer so it stays in scope until the command list is reset.
+        track_resource(dstBuffer);
+
+        return true;
+    }
+
     void command_list::set_primitive_topology(D3D_PRIMITIVE_TOPOLOGY primitiveTopology)
     {
         m_d3d_command_list->IASetPrimitiveTopology(primitiveTopology);
@@ -333,6 +373,17 @@ namespace cera
         m_d3d_command_list->SetGraphicsRootConstantBufferView(rootParameterIndex, heap_allocation.GPU);
     }
 
+    void command_list::set_graphics_dynamic_structured_buffer(u32 rootParameterIndex, size_t numElements, size_t elementSize, const void* bufferData)
+    {
+        size_t buffer_size = numElements * elementSize;
+
+        // Shader resource views in the root signature need a 4-byte aligned address.
+        auto heap_allocation = m_upload_buffer->allocate(buffer_size, sizeof(u32));
+        memcpy(heap_allocation.CPU, bufferData, buffer_size);
+
+        m_d3d_command_list->SetGraphicsRootShaderResourceView(rootParameterIndex, heap_allocation.GPU);
+    }
+
     void command_list::set_graphics_32_bit_constants(u32 rootParameterIndex, u32 numConstants, const void* constants)
     {
         m_d3d_command_list->SetGraphicsRoot32BitConstants(rootParameterIndex, numConstants, constants, 0);
@@ -430,7 +481,15 @@ namespace cera
     {
         assert(pipelineState);
 
-        auto d3d_pipeline_state = pipelineState->get_d3d_pipeline_state_object().Get();
+        const pipeline_state_object* bindable_pipeline_state = pipelineState->get_bindable_pipeline_state();
+
+        m_skip_draws = bindable_pipeline_state == nullptr;
+        if (m_skip_draws)
+        {
+            return;
+        }
+
+        auto d3d_pipeline_state = bindable_pipeline_state->get_d3d_pipeline_state_object().Get();
         if (m_pipeline_state != d3d_pipeline_state)
         {
             m_pipeline_state = d3d_pipeline_state;
@@ -445,12 +504,15 @@ namespace cera
     {
         assert(rootSignature);
 
+        // Root signatures are shared by the device for identical descriptions,
+        // comparing the d3d object is enough to skip rebinding the same root signature.
         auto d3d_root_signature = rootSignature->get_d3d_root_signature().Get();
         if (m_root_signature != d3d_root_signature)
         {
             m_root_signature = d3d_root_signature;
 
-            for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+            // Only CBV_SRV_UAV and SAMPLER descriptors can be placed in descriptor tables.
+            for (u32 i = 0; i < root_signature_layout::num_descriptor_heap_types; ++i)
             {
                 m_dynamic_descriptor_heap[i]->parse_root_signature(rootSignature);
             }
@@ -641,6 +703,12 @@ namespace cera
 
     void command_list::draw(u32 vertexCount, u32 instanceCount, u32 startVertex, u32 startInstance)
     {
+        if (m_skip_draws)
+        {
+            ++m_num_skipped_draws;
+            return;
+        }
+
         flush_resource_barriers();
 
         for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
@@ -653,6 +721,12 @@ namespace cera
 
     void command_list::draw_indexed(u32 indexCount, u32 instanceCount, u32 startIndex, int32_t baseVertex, u32 startInstance)
     {
+        if (m_skip_draws)
+        {
+            ++m_num_skipped_draws;
+            return;
+        }
+
         flush_resource_barriers();
 
         for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
@@ -663,6 +737,61 @@ namespace cera
         m_d3d_command_list->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
     }
 
+    void command_list::execute_indirect(const indirect_draw_arguments& arguments, u32 rootParameterIndex)
+    {
+        u32 num_commands = arguments.get_num_commands();
+        if (num_commands == 0)
+        {
+            return;
+        }
+
+        if (m_skip_draws)
+        {
+            m_num_skipped_draws += num_commands;
+            return;
+        }
+
+        wrl::ComPtr<ID3D12CommandSignature> command_signature = m_device.create_draw_indexed_command_signature(m_root_signature, rootParameterIndex, arguments.get_num_root_constants());
+        if (!command_signature)
+        {
+            log::error("Skipped {} indirect draws without a command signature", num_commands);
+            return;
+        }
+
+        flush_resource_barriers();
+
+        for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+        {
+            m_dynamic_descriptor_heap[i]->commit_staged_descriptors_for_draw(*this);
+        }
+
+        // Upload pages stay in the GENERIC_READ state, which includes INDIRECT_ARGUMENT.
+        // The upload buffer allocates from fixed size pages, upload at most one page of commands at a time.
+        u32 stride = arguments.get_stride();
+        u32 max_commands_per_upload = static_cast<u32>(m_upload_buffer->get_page_size() / stride);
+
+        const u8* data = static_cast<const u8*>(arguments.get_data());
+        for (u32 first_command = 0; first_command < num_commands;)
+        {
+            u32 command_count = std::min(max_commands_per_upload, num_commands - first_command);
+            size_t upload_size = static_cast<size_t>(command_count) * stride;
+
+            auto heap_allocation = m_upload_buffer->allocate(upload_size, sizeof(u32));
+            memcpy(heap_allocation.CPU, data + static_cast<size_t>(first_command) * stride, upload_size);
+
+            m_d3d_command_list->ExecuteIndirect(command_signature.Get(), command_count, heap_allocation.resource, heap_allocation.offset, nullptr, 0);
+
+            first_command += command_count;
+        }
+
+        track_resource(command_signature);
+    }
+
+    u32 command_list::get_num_skipped_draws() const
+    {
+        return m_num_skipped_draws;
+    }
+
     bool command_list::close(const std::shared_ptr<command_list>& pendingCommandList)
     {
         // Flush any remaining barriers.
@@ -717,6 +846,8 @@ namespace cera
 
         m_root_signature = nullptr;
         m_pipeline_state = nullptr;
+        m_skip_draws = false;
+        m_num_skipped_draws = 0;
 
         return true;
     }
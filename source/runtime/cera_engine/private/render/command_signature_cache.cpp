@@ -0,0 +1,45 @@
+#include "render/command_signature_cache.h"
+
+namespace cera
+{
+    wrl::ComPtr<ID3D12CommandSignature> command_signature_cache::find(u64 hash) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_command_signatures.find(hash);
+        return it != m_command_signatures.end() ? it->second : nullptr;
+    }
+
+    wrl::ComPtr<ID3D12CommandSignature> command_signature_cache::insert(u64 hash, const wrl::ComPtr<ID3D12CommandSignature>& commandSignature)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto result = m_command_signatures.emplace(hash, commandSignature);
+        return result.first->second;
+    }
+
+    wrl::ComPtr<ID3D12CommandSignature> command_signature_cache::find(ID3D12RootSignature* rootSignature, u64 layoutHash) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_foreign_command_signatures.find(rootSignature);
+        if (it == m_foreign_command_signatures.end())
+        {
+            return nullptr;
+        }
+
+        auto command_signature = it->second.command_signatures.find(layoutHash);
+        return command_signature != it->second.command_signatures.end() ? command_signature->second : nullptr;
+    }
+
+    wrl::ComPtr<ID3D12CommandSignature> command_signature_cache::insert(ID3D12RootSignature* rootSignature, u64 layoutHash, const wrl::ComPtr<ID3D12CommandSignature>& commandSignature)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        foreign_root_signature& entry = m_foreign_command_signatures[rootSignature];
+        entry.root_signature = rootSignature;
+
+        auto result = entry.command_signatures.emplace(layoutHash, commandSignature);
+        return result.first->second;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "device/windows_types.h"
+
+#include "render/d3dx12_declarations.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace cera
+{
+    /**
+     * Device level cache of command signatures used by indirect draws.
+     * Command signatures are keyed by the hash of their layout and root signature, every
+     * batch of indirect draws with the same layout reuses the same instance.
+     * Root signatures that were not created by the device have no hash, their command signatures
+     * are keyed by the root signature itself, which the cache keeps alive so its address is not reused.
+     */
+    class command_signature_cache
+    {
+    public:
+        /**
+         * Find a previously created command signature.
+         * @returns nullptr when no command signature with the given hash was created.
+         */
+        wrl::ComPtr<ID3D12CommandSignature> find(u64 hash) const;
+
+        /**
+         * Register a created command signature.
+         * When another thread registered a command signature with the same hash first,
+         * that instance is returned instead.
+         */
+        wrl::ComPtr<ID3D12CommandSignature> insert(u64 hash, const wrl::ComPtr<ID3D12CommandSignature>& commandSignature);
+
+        /**
+         * Same as above for command signatures of a root signature without a hash.
+         * @param layoutHash Hash of the arguments of the command signature.
+         */
+        wrl::ComPtr<ID3D12CommandSignature> find(ID3D12RootSignature* rootSignature, u64 layoutHash) const;
+        wrl::ComPtr<ID3D12CommandSignature> insert(ID3D12RootSignature* rootSignature, u64 layoutHash, const wrl::ComPtr<ID3D12CommandSignature>& commandSignature);
+
+    private:
+        struct foreign_root_signature
+        {
+            wrl::ComPtr<ID3D12RootSignature> root_signature;
+            std::unordered_map<u64, wrl::ComPtr<ID3D12CommandSignature>> command_signatures;
+        };
+
+        mutable std::mutex m_mutex;
+
+        std::unordered_map<u64, wrl::ComPtr<ID3D12CommandSignature>> m_command_signatures;
+        std::unordered_map<ID3D12RootSignature*, foreign_root_signature> m_foreign_command_signatures;
+    };
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "render/d3dx12_call.h"
 #include "render/command_queue.h"
 #include "render/descriptor_allocator.h"
+#include "render/geometry_pool.h"
 #include "render/vertex_buffer.h"
 #include "render/index_buffer.h"
 #include "render/byte_address_buffer.h"
@@ -11,13 +12,19 @@
 #include "render/shader_resource_view.h"
 #include "render/unordered_access_view.h"
 #include "render/root_signature.h"
+#include "render/root_signature_cache.h"
+#include "render/command_signature_cache.h"
+#include "render/indirect_draw_arguments.h"
 #include "render/command_list.h"
 #include "render/texture.h"
 #include "render/pipeline_state_object.h"
+#include "render/pipeline_state_cache.h"
 #include "render/swapchain.h"
 
 #include "util/memory_helpers.h"
+#include "util/hash.h"
 #include "util/log.h"
+#include "util/threading/thread_pool.h"
 
 #include <dxgi1_5.h>
 #include <dxgidebug.h>
@@ -192,8 +199,11 @@ namespace cera
         class make_pipeline_state_object : public pipeline_state_object
         {
         public:
-            make_pipeline_state_object(device& device, const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
-                : pipeline_state_object(device, desc)
+            make_pipeline_state_object(device& device, Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState, u64 hash)
+                : pipeline_state_object(device, pipelineState, hash)
+            {}
+            make_pipeline_state_object(device& device, u64 hash, const std::shared_ptr<pipeline_state_object>& fallback)
+                : pipeline_state_object(device, hash, fallback)
             {}
 
             ~make_pipeline_state_object() override = default;
@@ -284,6 +294,16 @@ namespace cera
             ~make_descriptor_allocator() override = default;
         };
 
+        class make_geometry_pool : public geometry_pool
+        {
+        public:
+            make_geometry_pool(device& device)
+                : geometry_pool(device)
+            {}
+
+            ~make_geometry_pool() override = default;
+        };
+
         class make_command_queue : public command_queue
         {
         public:
@@ -391,6 +411,8 @@ namespace cera
             }
         }
 
+        m_geometry_pool = std::make_unique<adaptors::make_geometry_pool>(*this);
+
         // Check features.
         {
             D3D12_FEATURE_DATA_ROOT_SIGNATURE feature_data;
@@ -403,9 +425,19 @@ namespace cera
 
             m_highest_root_signature_version = feature_data.HighestVersion;
         }
+
+        m_root_signature_cache = std::make_unique<root_signature_cache>();
+        m_command_signature_cache = std::make_unique<command_signature_cache>();
+        m_pipeline_state_cache = std::make_unique<pipeline_state_cache>(*this);
+        // Driver compilation is mostly single threaded, a couple of threads keeps a burst of new pipelines short
+        // without competing with the render thread.
+        m_pipeline_state_compile_pool = std::make_unique<threading::thread_pool>(2, "cera pso compiler");
     }
 
-    device::~device() = default;
+    device::~device()
+    {
+        m_pipeline_state_compile_pool->wait_idle();
+    }
 
     IDXGIAdapter4* device::get_dxgi_adapter() const
     {
@@ -441,6 +473,8 @@ namespace cera
 
     void device::flush()
     {
+        m_pipeline_state_compile_pool->wait_idle();
+
         m_direct_command_queue->flush();
         m_compute_command_queue->flush();
         m_copy_command_queue->flush();
@@ -464,6 +498,21 @@ namespace cera
         }
     }
 
+    geometry_allocation device::allocate_geometry(u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices)
+    {
+        return m_geometry_pool->allocate(vertexStride, indexFormat, numVertices, numIndices);
+    }
+
+    void device::release_stale_geometry()
+    {
+        m_geometry_pool->release_stale_ranges();
+    }
+
+    geometry_pool_stats device::get_geometry_pool_stats() const
+    {
+        return m_geometry_pool->get_stats();
+    }
+
     std::shared_ptr<constant_buffer> device::create_constant_buffer(Microsoft::WRL::ComPtr<ID3D12Resource> resource)
     {
         std::shared_ptr<constant_buffer> constant_buffer = std::make_shared<adaptors::make_constant_buffer>(*this, resource);
@@ -532,18 +581,184 @@ namespace cera
 
     std::shared_ptr<root_signature> device::create_root_signature(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc)
     {
-        std::shared_ptr<root_signature> root_signature = std::make_shared<adaptors::make_root_signature>(*this, rootSignatureDesc);
+        u64 hash = root_signature::compute_hash(rootSignatureDesc);
+
+        std::shared_ptr<root_signature> root_signature = m_root_signature_cache->find(hash);
+        if (root_signature)
+        {
+            return root_signature;
+        }
+
+        root_signature = std::make_shared<adaptors::make_root_signature>(*this, rootSignatureDesc);
+        if (!root_signature->get_d3d_root_signature())
+        {
+            // Failed root signatures are not cached, the error is reported on every attempt.
+            return root_signature;
+        }
+
+        return m_root_signature_cache->insert(hash, root_signature);
+    }
+
+    wrl::ComPtr<ID3D12CommandSignature> device::create_draw_indexed_command_signature(ID3D12RootSignature* rootSignature, u32 rootParameterIndex, u32 numRootConstants)
+    {
+        static_assert(sizeof(draw_indexed_arguments) == sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), "Draw arguments must match D3D12_DRAW_INDEXED_ARGUMENTS.");
+
+        // A root signature is only required when the commands change root arguments.
+        ID3D12RootSignature* command_root_signature = numRootConstants > 0 ? rootSignature : nullptr;
+        if (numRootConstants > 0 && command_root_signature == nullptr)
+        {
+            log::error("Indirect draws with root constants require a root signature");
+            return nullptr;
+        }
+
+        // Root signatures are identified by their hash, root signatures that were not created
+        // by the device have none and are identified by their address instead.
+        u64 root_signature_hash = root_signature::get_hash(command_root_signature);
+        bool foreign = command_root_signature != nullptr && root_signature_hash == 0;
+
+        u64 layout_hash = hash::combine(numRootConstants > 0 ? rootParameterIndex : 0, numRootConstants);
+        u64 hash = hash::combine(root_signature_hash, layout_hash);
+
+        wrl::ComPtr<ID3D12CommandSignature> cached = foreign ? m_command_signature_cache->find(command_root_signature, layout_hash) : m_command_signature_cache->find(hash);
+        if (cached)
+        {
+            return cached;
+        }
+
+        D3D12_INDIRECT_ARGUMENT_DESC argument_descs[2] = {};
+        u32 num_argument_descs = 0;
+
+        if (numRootConstants > 0)
+        {
+            argument_descs[num_argument_descs].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+            argument_descs[num_argument_descs].Constant.RootParameterIndex = rootParameterIndex;
+            argument_descs[num_argument_descs].Constant.DestOffsetIn32BitValues = 0;
+            argument_descs[num_argument_descs].Constant.Num32BitValuesToSet = numRootConstants;
+            ++num_argument_descs;
+        }
+
+        // The draw has to be the last argument of a command.
+        argument_descs[num_argument_descs].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+        ++num_argument_descs;
+
+        D3D12_COMMAND_SIGNATURE_DESC command_signature_desc = {};
+        command_signature_desc.ByteStride = indirect_draw_arguments(numRootConstants).get_stride();
+        command_signature_desc.NumArgumentDescs = num_argument_descs;
+        command_signature_desc.pArgumentDescs = argument_descs;
+        command_signature_desc.NodeMask = 0;
+
+        wrl::ComPtr<ID3D12CommandSignature> command_signature;
+        if (DX_FAILED(m_d3d12_device->CreateCommandSignature(&command_signature_desc, command_root_signature, IID_PPV_ARGS(&command_signature))))
+        {
+            log::error("Failed to create a command signature with {} root constants", numRootConstants);
+            return nullptr;
+        }
 
-        return root_signature;
+        return foreign ? m_command_signature_cache->insert(command_root_signature, layout_hash, command_signature) : m_command_signature_cache->insert(hash, command_signature);
     }
 
     std::shared_ptr<pipeline_state_object> device::do_create_pipeline_state_object(const D3D12_PIPELINE_STATE_STREAM_DESC& pipelineStateStreamDesc)
     {
-        std::shared_ptr<pipeline_state_object> pipeline_state_object = std::make_shared<adaptors::make_pipeline_state_object>(*this, pipelineStateStreamDesc);
+        scoped_timing_sample timing_sample(m_pipeline_state_creation_histogram);
+
+        pipeline_state_hash hash = hash_pipeline_state_stream(pipelineStateStreamDesc);
+
+        std::shared_ptr<pipeline_state_object> pipeline_state_object = m_pipeline_state_cache->find(hash.value);
+        if (pipeline_state_object)
+        {
+            // The same pipeline state might still be compiling in the background.
+            pipeline_state_object->wait();
+            if (!pipeline_state_object->has_failed())
+            {
+                return pipeline_state_object;
+            }
+
+            // A failed background compilation is not cached, try again.
+            m_pipeline_state_cache->remove(hash.value, pipeline_state_object);
+        }
+
+        pipeline_state_stream_copy stream_copy(pipelineStateStreamDesc);
+        if (!stream_copy.is_valid())
+        {
+            log::error("Unable to parse pipeline state stream");
+            return nullptr;
+        }
+
+        wrl::ComPtr<ID3D12PipelineState> d3d_pipeline_state = m_pipeline_state_cache->load_or_create(hash, stream_copy);
+        if (!d3d_pipeline_state)
+        {
+            return nullptr;
+        }
+
+        pipeline_state_object = std::make_shared<adaptors::make_pipeline_state_object>(*this, d3d_pipeline_state, hash.value);
+
+        return m_pipeline_state_cache->insert(hash.value, pipeline_state_object);
+    }
+
+    std::shared_ptr<pipeline_state_object> device::do_create_pipeline_state_object_async(const D3D12_PIPELINE_STATE_STREAM_DESC& pipelineStateStreamDesc, const std::shared_ptr<pipeline_state_object>& fallback)
+    {
+        scoped_timing_sample timing_sample(m_pipeline_state_creation_histogram);
+
+        pipeline_state_hash hash = hash_pipeline_state_stream(pipelineStateStreamDesc);
+
+        std::shared_ptr<pipeline_state_object> pipeline_state_object = m_pipeline_state_cache->find(hash.value);
+        if (pipeline_state_object && !pipeline_state_object->has_failed())
+        {
+            return pipeline_state_object;
+        }
+
+        auto stream_copy = std::make_shared<pipeline_state_stream_copy>(pipelineStateStreamDesc);
+        if (!stream_copy->is_valid())
+        {
+            log::error("Unable to parse pipeline state stream");
+            return nullptr;
+        }
+
+        std::shared_ptr<cera::pipeline_state_object> pending_pipeline_state_object = std::make_shared<adaptors::make_pipeline_state_object>(*this, hash.value, fallback);
+
+        if (pipeline_state_object)
+        {
+            // Failed to compile before, replace it with a new attempt.
+            m_pipeline_state_cache->remove(hash.value, pipeline_state_object);
+        }
+
+        pipeline_state_object = m_pipeline_state_cache->insert(hash.value, pending_pipeline_state_object);
+        if (pipeline_state_object != pending_pipeline_state_object)
+        {
+            // Another thread requested the same pipeline state first.
+            return pipeline_state_object;
+        }
+
+        m_pipeline_state_compile_pool->submit([this, hash, stream_copy, pending_pipeline_state_object]()
+        {
+            wrl::ComPtr<ID3D12PipelineState> d3d_pipeline_state = m_pipeline_state_cache->load_or_create(hash, *stream_copy);
+            if (!d3d_pipeline_state)
+            {
+                // Users keep the failed instance and its fallback, the next request compiles the pipeline state again.
+                m_pipeline_state_cache->remove(hash.value, pending_pipeline_state_object);
+            }
+
+            pending_pipeline_state_object->complete(d3d_pipeline_state);
+        });
 
         return pipeline_state_object;
     }
 
+    const timing_histogram& device::get_pipeline_state_creation_histogram() const
+    {
+        return m_pipeline_state_creation_histogram;
+    }
+
+    bool device::load_pipeline_state_cache(const std::wstring& path)
+    {
+        return m_pipeline_state_cache->load_from_disk(path);
+    }
+
+    bool device::save_pipeline_state_cache(const std::wstring& path)
+    {
+        return m_pipeline_state_cache->save_to_disk(path);
+    }
+
     std::shared_ptr<constant_buffer_view> device::create_constant_buffer_view(const std::shared_ptr<constant_buffer>& constant_buffer, size_t offset)
     {
         std::shared_ptr<constant_buffer_view> constant_buffer_view = std::make_shared<adaptors::make_constant_buffer_view>(*this, constant_buffer, offset);
@@ -129,31 +129,28 @@ namespace cera
         // command list.
         m_stale_descriptor_table_bit_mask = 0;
 
-        const auto& root_signature_desc = rootSignature->get_d3d_root_signature_description();
+        // The layout is computed when the root signature is created, only the
+        // descriptor table cache has to point into the descriptor handle cache.
+        const root_signature_layout& layout = rootSignature->get_layout();
 
         // Get a bit mask that represents the root parameter indices that match the
         // descriptor heap type for this dynamic descriptor heap.
         m_descriptor_table_bit_mask = rootSignature->get_descriptor_table_bit_mask(m_descriptor_heap_type);
         u32 descriptor_table_bit_mask = m_descriptor_table_bit_mask;
 
-        u32 current_offset = 0;
         DWORD root_index;
-        while (_BitScanForward(&root_index, descriptor_table_bit_mask) && root_index < root_signature_desc.NumParameters)
+        while (_BitScanForward(&root_index, descriptor_table_bit_mask))
         {
-            u32 num_descriptors = rootSignature->get_num_descriptors(root_index);
-
             descriptor_table_cache& descriptor_table_cache = m_descriptor_table_cache[root_index];
-            descriptor_table_cache.num_descriptors = num_descriptors;
-            descriptor_table_cache.base_descriptor = m_descriptor_handle_cache.get() + current_offset;
-
-            current_offset += num_descriptors;
+            descriptor_table_cache.num_descriptors = layout.num_descriptors_per_table[root_index];
+            descriptor_table_cache.base_descriptor = m_descriptor_handle_cache.get() + layout.descriptor_table_offset[root_index];
 
             // Flip the descriptor table bit so it's not scanned again for the current index.
             descriptor_table_bit_mask ^= (1 << root_index);
         }
 
         // Make sure the maximum number of descriptors per descriptor heap has not been exceeded.
-        assert(current_offset <= m_num_descriptors_per_heap && "The root signature requires more than the maximum number of descriptors per descriptor heap. Consider increasing the maximum number of descriptors per descriptor heap.");
+        assert((m_descriptor_table_bit_mask == 0 || layout.num_descriptors[m_descriptor_heap_type] <= m_num_descriptors_per_heap) && "The root signature requires more than the maximum number of descriptors per descriptor heap. Consider increasing the maximum number of descriptors per descriptor heap.");
     }
 
     void dynamic_descriptor_heap::reset()
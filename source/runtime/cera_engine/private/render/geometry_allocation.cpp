@@ -0,0 +1,132 @@
+#include "render/geometry_allocation.h"
+#include "render/geometry_pool_page.h"
+
+#include <utility>
+
+namespace cera
+{
+    geometry_allocation::geometry_allocation()
+        : m_base_vertex(0)
+        , m_num_vertices(0)
+        , m_first_index(0)
+        , m_num_indices(0)
+        , m_page(nullptr)
+    {
+
+    }
+
+    geometry_allocation::geometry_allocation(u32 baseVertex, u32 numVertices, u32 firstIndex, u32 numIndices, std::shared_ptr<geometry_pool_page> page)
+        : m_base_vertex(baseVertex)
+        , m_num_vertices(numVertices)
+        , m_first_index(firstIndex)
+        , m_num_indices(numIndices)
+        , m_page(page)
+    {
+
+    }
+
+    geometry_allocation::~geometry_allocation()
+    {
+        free();
+    }
+
+    geometry_allocation::geometry_allocation(geometry_allocation&& allocation)
+        : m_base_vertex(std::exchange(allocation.m_base_vertex, 0))
+        , m_num_vertices(std::exchange(allocation.m_num_vertices, 0))
+        , m_first_index(std::exchange(allocation.m_first_index, 0))
+        , m_num_indices(std::exchange(allocation.m_num_indices, 0))
+        , m_page(std::exchange(allocation.m_page, nullptr))
+    {
+
+    }
+
+    geometry_allocation& geometry_allocation::operator=(geometry_allocation&& other)
+    {
+        // Free this allocation if it points to anything.
+        free();
+
+        m_base_vertex = std::exchange(other.m_base_vertex, 0);
+        m_num_vertices = std::exchange(other.m_num_vertices, 0);
+        m_first_index = std::exchange(other.m_first_index, 0);
+        m_num_indices = std::exchange(other.m_num_indices, 0);
+        m_page = std::exchange(other.m_page, nullptr);
+
+        return *this;
+    }
+
+    bool geometry_allocation::is_null() const
+    {
+        return m_page == nullptr;
+    }
+
+    bool geometry_allocation::is_valid() const
+    {
+        return !is_null();
+    }
+
+    std::shared_ptr<vertex_buffer> geometry_allocation::get_vertex_buffer() const
+    {
+        return m_page ? m_page->get_vertex_buffer() : nullptr;
+    }
+
+    std::shared_ptr<index_buffer> geometry_allocation::get_index_buffer() const
+    {
+        return m_page ? m_page->get_index_buffer() : nullptr;
+    }
+
+    u32 geometry_allocation::get_vertex_stride() const
+    {
+        return m_page ? m_page->get_vertex_stride() : 0;
+    }
+
+    DXGI_FORMAT geometry_allocation::get_index_format() const
+    {
+        return m_page ? m_page->get_index_format() : DXGI_FORMAT_UNKNOWN;
+    }
+
+    u32 geometry_allocation::get_base_vertex() const
+    {
+        return m_base_vertex;
+    }
+
+    u32 geometry_allocation::get_num_vertices() const
+    {
+        return m_num_vertices;
+    }
+
+    u32 geometry_allocation::get_first_index() const
+    {
+        return m_first_index;
+    }
+
+    u32 geometry_allocation::get_num_indices() const
+    {
+        return m_num_indices;
+    }
+
+    size_t geometry_allocation::get_vertex_offset() const
+    {
+        return static_cast<size_t>(m_base_vertex) * get_vertex_stride();
+    }
+
+    size_t geometry_allocation::get_index_offset() const
+    {
+        size_t index_size = get_index_format() == DXGI_FORMAT_R16_UINT ? 2 : 4;
+
+        return static_cast<size_t>(m_first_index) * index_size;
+    }
+
+    void geometry_allocation::free()
+    {
+        if (!is_null())
+        {
+            m_page->free(std::move(*this));
+
+            m_base_vertex = 0;
+            m_num_vertices = 0;
+            m_first_index = 0;
+            m_num_indices = 0;
+            m_page.reset();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "render/geometry_pool.h"
+#include "render/geometry_pool_page.h"
+#include "render/device.h"
+
+#include <algorithm>
+
+namespace cera
+{
+    namespace internal
+    {
+        struct make_geometry_pool_page : public geometry_pool_page
+        {
+        public:
+            make_geometry_pool_page(device& device, u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices)
+                : geometry_pool_page(device, vertexStride, indexFormat, numVertices, numIndices)
+            {}
+
+            ~make_geometry_pool_page() override = default;
+        };
+    }
+
+    geometry_pool::geometry_pool(device& device, u32 numVerticesPerPage, u32 numIndicesPerPage)
+        : m_device(device)
+        , m_num_vertices_per_page(numVerticesPerPage)
+        , m_num_indices_per_page(numIndicesPerPage)
+    {
+
+    }
+
+    geometry_pool::~geometry_pool()
+    {
+
+    }
+
+    geometry_allocation geometry_pool::allocate(u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices)
+    {
+        if (numVertices == 0)
+        {
+            return geometry_allocation();
+        }
+
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        for (const std::shared_ptr<geometry_pool_page>& page : m_page_pool)
+        {
+            if (page->get_vertex_stride() != vertexStride || page->get_index_format() != indexFormat)
+            {
+                continue;
+            }
+
+            geometry_allocation allocation = page->allocate(numVertices, numIndices);
+            if (allocation.is_valid())
+            {
+                return allocation;
+            }
+        }
+
+        // No page of this layout could satisfy the request.
+        auto new_page = create_page(vertexStride, indexFormat, std::max(m_num_vertices_per_page, numVertices), std::max(m_num_indices_per_page, numIndices));
+
+        return new_page->allocate(numVertices, numIndices);
+    }
+
+    void geometry_pool::release_stale_ranges()
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        for (const std::shared_ptr<geometry_pool_page>& page : m_page_pool)
+        {
+            page->release_stale_ranges();
+        }
+    }
+
+    geometry_pool_stats geometry_pool::get_stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        geometry_pool_stats stats;
+        stats.num_pages = static_cast<u32>(m_page_pool.size());
+        stats.num_resources = stats.num_pages * 2;
+
+        for (const std::shared_ptr<geometry_pool_page>& page : m_page_pool)
+        {
+            stats.num_allocations += page->get_num_allocations();
+            stats.num_vertices += page->get_num_vertices();
+            stats.num_allocated_vertices += page->get_num_vertices() - page->get_num_free_vertices();
+            stats.num_indices += page->get_num_indices();
+            stats.num_allocated_indices += page->get_num_indices() - page->get_num_free_indices();
+        }
+
+        return stats;
+    }
+
+    std::shared_ptr<geometry_pool_page> geometry_pool::create_page(u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices)
+    {
+        auto new_page = std::make_shared<internal::make_geometry_pool_page>(m_device, vertexStride, indexFormat, numVertices, numIndices);
+
+        m_page_pool.emplace_back(new_page);
+
+        return new_page;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "render/geometry_pool_page.h"
+#include "render/device.h"
+#include "render/vertex_buffer.h"
+#include "render/index_buffer.h"
+
+namespace cera
+{
+    geometry_pool_page::geometry_pool_page(device& device, u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices)
+        : m_vertex_stride(vertexStride)
+        , m_index_format(indexFormat)
+        , m_vertex_buffer(device.create_vertex_buffer(numVertices, vertexStride))
+        , m_index_buffer(device.create_index_buffer(numIndices, indexFormat))
+        , m_vertex_allocator(numVertices)
+        , m_index_allocator(numIndices)
+        , m_num_allocations(0)
+    {
+        m_vertex_buffer->set_resource_name(L"Geometry Pool Vertices (Page)");
+        m_index_buffer->set_resource_name(L"Geometry Pool Indices (Page)");
+    }
+
+    geometry_pool_page::~geometry_pool_page() = default;
+
+    u32 geometry_pool_page::get_vertex_stride() const
+    {
+        return m_vertex_stride;
+    }
+
+    DXGI_FORMAT geometry_pool_page::get_index_format() const
+    {
+        return m_index_format;
+    }
+
+    const std::shared_ptr<vertex_buffer>& geometry_pool_page::get_vertex_buffer() const
+    {
+        return m_vertex_buffer;
+    }
+
+    const std::shared_ptr<index_buffer>& geometry_pool_page::get_index_buffer() const
+    {
+        return m_index_buffer;
+    }
+
+    bool geometry_pool_page::has_space(u32 numVertices, u32 numIndices) const
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        return m_vertex_allocator.has_space(numVertices) && m_index_allocator.has_space(numIndices);
+    }
+
+    geometry_allocation geometry_pool_page::allocate(u32 numVertices, u32 numIndices)
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        u32 base_vertex = m_vertex_allocator.allocate(numVertices);
+        if (base_vertex == offset_allocator::invalid_offset)
+        {
+            return geometry_allocation();
+        }
+
+        u32 first_index = m_index_allocator.allocate(numIndices);
+        if (first_index == offset_allocator::invalid_offset)
+        {
+            // Both ranges are needed, give the vertices back and try another page.
+            m_vertex_allocator.free(base_vertex, numVertices);
+            return geometry_allocation();
+        }
+
+        ++m_num_allocations;
+
+        return geometry_allocation(base_vertex, numVertices, first_index, numIndices, shared_from_this());
+    }
+
+    void geometry_pool_page::free(geometry_allocation&& allocation)
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        // Don't return the ranges directly, the GPU may still draw them until the frame has completed.
+        m_stale_ranges.push({ allocation.get_base_vertex(), allocation.get_num_vertices(), allocation.get_first_index(), allocation.get_num_indices() });
+    }
+
+    void geometry_pool_page::release_stale_ranges()
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        while (!m_stale_ranges.empty())
+        {
+            const stale_range_info& stale_range = m_stale_ranges.front();
+
+            m_vertex_allocator.free(stale_range.base_vertex, stale_range.num_vertices);
+            m_index_allocator.free(stale_range.first_index, stale_range.num_indices);
+            --m_num_allocations;
+
+            m_stale_ranges.pop();
+        }
+    }
+
+    u32 geometry_pool_page::get_num_vertices() const
+    {
+        return m_vertex_allocator.get_size();
+    }
+
+    u32 geometry_pool_page::get_num_indices() const
+    {
+        return m_index_allocator.get_size();
+    }
+
+    u32 geometry_pool_page::get_num_free_vertices() const
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        return m_vertex_allocator.get_num_free();
+    }
+
+    u32 geometry_pool_page::get_num_free_indices() const
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        return m_index_allocator.get_num_free();
+    }
+
+    u32 geometry_pool_page::get_num_allocations() const
+    {
+        std::lock_guard<std::mutex> lock(m_allocation_mutex);
+
+        return m_num_allocations;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "render/d3dx12_declarations.h"
+#include "render/geometry_allocation.h"
+#include "render/offset_allocator.h"
+
+#include "util/types.h"
+
+#include <memory>
+#include <mutex>
+#include <queue>
+
+namespace cera
+{
+    class device;
+    class vertex_buffer;
+    class index_buffer;
+
+    /**
+     * A vertex buffer and an index buffer (page for the geometry_pool class), suballocated by two offset allocators.
+     * All vertices of a page have the same stride and all indices the same format.
+     */
+    class geometry_pool_page : public std::enable_shared_from_this<geometry_pool_page>
+    {
+    public:
+        u32 get_vertex_stride() const;
+        DXGI_FORMAT get_index_format() const;
+
+        const std::shared_ptr<vertex_buffer>& get_vertex_buffer() const;
+        const std::shared_ptr<index_buffer>& get_index_buffer() const;
+
+        /**
+         * Check to see if this page has contiguous ranges large enough to satisfy the request.
+         */
+        bool has_space(u32 numVertices, u32 numIndices) const;
+
+        /**
+         * Allocate a range of vertices and a range of indices from this page.
+         * If the allocation cannot be satisfied, then a NULL allocation is returned.
+         */
+        geometry_allocation allocate(u32 numVertices, u32 numIndices);
+
+        /**
+         * Return an allocation back to the page.
+         * The ranges may still be read by command lists in flight, they are put on a stale queue and
+         * returned to the page by release_stale_ranges.
+         */
+        void free(geometry_allocation&& allocation);
+
+        /**
+         * Return the stale ranges back to the page.
+         */
+        void release_stale_ranges();
+
+        u32 get_num_vertices() const;
+        u32 get_num_indices() const;
+        u32 get_num_free_vertices() const;
+        u32 get_num_free_indices() const;
+        u32 get_num_allocations() const;
+
+    protected:
+        geometry_pool_page(device& device, u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices);
+        virtual ~geometry_pool_page();
+
+    private:
+        struct stale_range_info
+        {
+            u32 base_vertex;
+            u32 num_vertices;
+            u32 first_index;
+            u32 num_indices;
+        };
+
+        std::queue<stale_range_info> m_stale_ranges;
+
+    private:
+        u32 m_vertex_stride;
+        DXGI_FORMAT m_index_format;
+
+        std::shared_ptr<vertex_buffer> m_vertex_buffer;
+        std::shared_ptr<index_buffer> m_index_buffer;
+
+        offset_allocator m_vertex_allocator;
+        offset_allocator m_index_allocator;
+
+        u32 m_num_allocations;
+
+        mutable std::mutex m_allocation_mutex;
+    };
+}
\ No newline at end of file
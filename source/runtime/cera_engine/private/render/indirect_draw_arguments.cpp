@@ -0,0 +1,109 @@
+#include "render/indirect_draw_arguments.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace cera
+{
+    namespace internal
+    {
+        constexpr u32 num_draw_argument_values = sizeof(draw_indexed_arguments) / sizeof(u32);
+    }
+
+    indirect_draw_arguments::indirect_draw_arguments(u32 numRootConstants)
+        : m_num_root_constants(numRootConstants)
+        , m_command_size(numRootConstants + internal::num_draw_argument_values)
+    {
+
+    }
+
+    void indirect_draw_arguments::clear()
+    {
+        m_data.clear();
+    }
+
+    void indirect_draw_arguments::reserve(u32 numCommands)
+    {
+        m_data.reserve(static_cast<size_t>(numCommands) * m_command_size);
+    }
+
+    void indirect_draw_arguments::add_draw(const draw_indexed_arguments& arguments, const u32* rootConstants)
+    {
+        assert(rootConstants != nullptr || m_num_root_constants == 0);
+
+        size_t offset = m_data.size();
+        m_data.resize(offset + m_command_size);
+
+        u32* command = m_data.data() + offset;
+        if (m_num_root_constants > 0)
+        {
+            memcpy(command, rootConstants, m_num_root_constants * sizeof(u32));
+        }
+        memcpy(command + m_num_root_constants, &arguments, sizeof(draw_indexed_arguments));
+    }
+
+    void indirect_draw_arguments::add_draw(const draw_indexed_arguments& arguments, u32 rootConstant)
+    {
+        assert(m_num_root_constants == 1);
+
+        add_draw(arguments, &rootConstant);
+    }
+
+    u32 indirect_draw_arguments::get_num_root_constants() const
+    {
+        return m_num_root_constants;
+    }
+
+    u32 indirect_draw_arguments::get_stride() const
+    {
+        return m_command_size * sizeof(u32);
+    }
+
+    u32 indirect_draw_arguments::get_arguments_offset() const
+    {
+        return m_num_root_constants * sizeof(u32);
+    }
+
+    u32 indirect_draw_arguments::get_num_commands() const
+    {
+        return static_cast<u32>(m_data.size() / m_command_size);
+    }
+
+    bool indirect_draw_arguments::empty() const
+    {
+        return m_data.empty();
+    }
+
+    const void* indirect_draw_arguments::get_data() const
+    {
+        return m_data.data();
+    }
+
+    size_t indirect_draw_arguments::get_size() const
+    {
+        return m_data.size() * sizeof(u32);
+    }
+
+    draw_indexed_arguments indirect_draw_arguments::get_arguments(u32 command) const
+    {
+        assert(command < get_num_commands());
+
+        const u32* values = m_data.data() + static_cast<size_t>(command) * m_command_size + m_num_root_constants;
+
+        draw_indexed_arguments arguments;
+        arguments.index_count_per_instance = values[0];
+        arguments.instance_count = values[1];
+        arguments.start_index_location = values[2];
+        arguments.base_vertex_location = static_cast<s32>(values[3]);
+        arguments.start_instance_location = values[4];
+
+        return arguments;
+    }
+
+    const u32* indirect_draw_arguments::get_root_constants(u32 command) const
+    {
+        assert(command < get_num_commands());
+
+        return m_data.data() + static_cast<size_t>(command) * m_command_size;
+    }
+}
\ No newline at end of file
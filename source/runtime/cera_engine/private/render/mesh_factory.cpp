@@ -4,41 +4,195 @@
 #include "render/index_buffer.h"
 #include "render/vertex_types.h"
 #include "render/command_list.h"
+#include "render/geometry_allocation.h"
 #include "mesh.h"
+#include "mesh_cache_file.h"
+#include "mesh_cooker.h"
+#include "model_importer.h"
 #include "scene_node.h"
 #include "scene.h"
 
+#include "util/file_mapping.h"
+#include "util/hash.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
 namespace cera
 {
+    // Descriptions are compared and hashed bitwise, they must not have padding.
+    static_assert(sizeof(procedural_mesh_desc) == 8 * sizeof(u32), "Procedural mesh descriptions must not have padding");
+
+    procedural_mesh_desc procedural_mesh_desc::cube(DirectX::XMFLOAT3 color, float size, vertex_format format)
+    {
+        procedural_mesh_desc desc;
+        desc.shape = procedural_shape::cube;
+        desc.color = color;
+        desc.size = size;
+        desc.format = format;
+
+        return desc;
+    }
+
+    procedural_mesh_desc procedural_mesh_desc::sphere(DirectX::XMFLOAT3 color, float radius, u32 tessellation, vertex_format format)
+    {
+        procedural_mesh_desc desc;
+        desc.shape = procedural_shape::sphere;
+        desc.color = color;
+        desc.size = radius;
+        desc.tessellation = tessellation;
+        desc.format = format;
+
+        return desc;
+    }
+
+    procedural_mesh_desc procedural_mesh_desc::cylinder(DirectX::XMFLOAT3 color, float radius, float height, u32 tessellation, vertex_format format)
+    {
+        procedural_mesh_desc desc;
+        desc.shape = procedural_shape::cylinder;
+        desc.color = color;
+        desc.size = radius;
+        desc.height = height;
+        desc.tessellation = tessellation;
+        desc.format = format;
+
+        return desc;
+    }
+
+    procedural_mesh_desc procedural_mesh_desc::plane(DirectX::XMFLOAT3 color, float width, float height, vertex_format format)
+    {
+        procedural_mesh_desc desc;
+        desc.shape = procedural_shape::plane;
+        desc.color = color;
+        desc.size = width;
+        desc.height = height;
+        desc.format = format;
+
+        return desc;
+    }
+
+    bool procedural_mesh_desc::operator==(const procedural_mesh_desc& other) const
+    {
+        return memcmp(this, &other, sizeof(procedural_mesh_desc)) == 0;
+    }
+
+    u64 procedural_mesh_desc::get_hash() const
+    {
+        return hash::fnv1a_value(*this);
+    }
+
     namespace mesh_factory
     {
         using vertex_collection = std::vector<vertex_pos_color>;
-        using index_collection = std::vector<uint16_t>;
+        // Shapes are generated with 32 bit indices, they are narrowed to 16 bit when they are cooked if the vertex count allows it.
+        using index_collection = std::vector<u32>;
+
+        // The mesh cooker writes vertices without seeing the vertex types.
+        static_assert(sizeof(vertex_pos_color) == 6 * sizeof(float) && offsetof(vertex_pos_color, color) == 3 * sizeof(float), "Cooked vertex layout mismatch");
+        static_assert(sizeof(vertex_packed_pos_color) == 4 * sizeof(u16) + sizeof(u32) && offsetof(vertex_packed_pos_color, color) == 4 * sizeof(u16), "Cooked vertex layout mismatch");
 
         namespace internal
         {
-            std::shared_ptr<scene> create_scene(const std::shared_ptr<command_list>& commandList, const vertex_collection& vertices, const index_collection& indices)
+            /**
+             * Record the upload of a cooked mesh into the geometry pool, buffers are copied straight from the view into upload memory.
+             * The levels of detail follow level 0 in the index range of the mesh.
+             */
+            std::shared_ptr<mesh> upload_mesh(command_list& commandList, const cooked_mesh_view& view)
             {
-                if (vertices.empty())
+                DXGI_FORMAT index_format = view.index_size == sizeof(u16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+                u32 num_indices = view.num_indices;
+                for (const cooked_lod_view& lod : view.lods)
+                {
+                    num_indices += lod.num_indices;
+                }
+
+                auto geometry = std::make_shared<geometry_allocation>(commandList.get_device()->allocate_geometry(view.vertex_stride, index_format, view.num_vertices, num_indices));
+                if (geometry->is_null())
                 {
+                    log::error("Failed to allocate {} vertices in the geometry pool", view.num_vertices);
                     return nullptr;
                 }
 
-                auto new_vertex_buffer = commandList->copy_vertex_buffer(vertices);
-                auto new_index_Buffer = commandList->copy_index_buffer(indices);
+                commandList.copy_buffer_region(geometry->get_vertex_buffer(), geometry->get_vertex_offset(), static_cast<size_t>(view.num_vertices) * view.vertex_stride, view.vertices);
+
+                // Levels are gathered behind level 0 so all indices are uploaded with one copy.
+                const void* index_data = view.indices;
+                blob gathered_indices;
+                if (!view.lods.empty())
+                {
+                    gathered_indices.resize(static_cast<size_t>(num_indices) * view.index_size);
+
+                    std::byte* dst = gathered_indices.data();
+                    memcpy(dst, view.indices, static_cast<size_t>(view.num_indices) * view.index_size);
+                    dst += static_cast<size_t>(view.num_indices) * view.index_size;
+
+                    for (const cooked_lod_view& lod : view.lods)
+                    {
+                        memcpy(dst, lod.indices, static_cast<size_t>(lod.num_indices) * view.index_size);
+                        dst += static_cast<size_t>(lod.num_indices) * view.index_size;
+                    }
+
+                    index_data = gathered_indices.data();
+                }
+
+                commandList.copy_buffer_region(geometry->get_index_buffer(), geometry->get_index_offset(), static_cast<size_t>(num_indices) * view.index_size, index_data);
 
                 auto new_mesh = std::make_shared<mesh>();
+                new_mesh->set_geometry(geometry);
+                new_mesh->set_vertex_range(geometry->get_base_vertex(), view.num_vertices);
+                new_mesh->set_position_quantization(view.quantization);
+                new_mesh->set_bounds(view.box, view.sphere);
 
-                new_mesh->set_vertex_buffer(0, new_vertex_buffer);
-                new_mesh->set_index_buffer(new_index_Buffer);
+                if (view.num_meshlets > 0)
+                {
+                    new_mesh->set_meshlets(std::vector<meshlet>(view.meshlets, view.meshlets + view.num_meshlets));
+                }
 
-                auto new_node = std::make_shared<scene_node>();
-                new_node->add_mesh(new_mesh);
+                // Levels index the same vertices, they use the index format of the mesh.
+                for (const cooked_lod_view& lod : view.lods)
+                {
+                    new_mesh->add_lod(geometry->get_index_buffer(), lod.error);
+                }
 
-                auto new_scene = std::make_shared<scene>();
-                new_scene->set_root_node(new_node);
+                u32 first_index = geometry->get_first_index();
+                new_mesh->set_index_range(0, first_index, view.num_indices);
+                first_index += view.num_indices;
 
-                return new_scene;
+                for (u32 lod = 0; lod < view.lods.size(); ++lod)
+                {
+                    new_mesh->set_index_range(lod + 1, first_index, view.lods[lod].num_indices);
+                    first_index += view.lods[lod].num_indices;
+                }
+
+                return new_mesh;
+            }
+
+            std::shared_ptr<scene_node> create_model_node(const std::vector<imported_node>& nodes, u32 node, const std::vector<std::shared_ptr<mesh>>& meshes)
+            {
+                const imported_node& imported = nodes[node];
+
+                auto new_node = std::make_shared<scene_node>(DirectX::XMLoadFloat4x4A(reinterpret_cast<const DirectX::XMFLOAT4X4A*>(&imported.local_transform)));
+                new_node->set_name(imported.name);
+
+                for (u32 mesh : imported.meshes)
+                {
+                    if (meshes[mesh])
+                    {
+                        new_node->add_mesh(meshes[mesh]);
+                    }
+                }
+
+                for (u32 child : imported.children)
+                {
+                    new_node->add_child(create_model_node(nodes, child, meshes));
+                }
+
+                return new_node;
             }
 
             // Definition for inline functions.
@@ -53,20 +207,21 @@ namespace cera
                 return v;
             }
 
-            void create_cylinder_cap(vertex_collection& vertices, index_collection& indices, size_t tessellation, float height, float radius, bool isTop, DirectX::XMFLOAT3 color)
+            void create_cylinder_cap(vertex_collection& vertices, index_collection& indices, u32 tessellation, float height, float radius, bool isTop, DirectX::XMFLOAT3 color)
             {
                 // Create cap indices.
-                for (size_t i = 0; i < tessellation - 2; i++)
+                u32 vbase = static_cast<u32>(vertices.size());
+
+                for (u32 i = 0; i < tessellation - 2; i++)
                 {
-                    size_t i1 = (i + 1) % tessellation;
-                    size_t i2 = (i + 2) % tessellation;
+                    u32 i1 = (i + 1) % tessellation;
+                    u32 i2 = (i + 2) % tessellation;
 
                     if (isTop)
                     {
                         std::swap(i1, i2);
                     }
 
-                    size_t vbase = vertices.size();
                     indices.push_back(vbase + i2);
                     indices.push_back(vbase + i1);
                     indices.push_back(vbase);
@@ -81,142 +236,393 @@ namespace cera
                 }
 
                 // Create cap vertices.
-                for (size_t i = 0; i < tessellation; i++)
+                for (u32 i = 0; i < tessellation; i++)
                 {
                     DirectX::XMVECTOR circle_vector = get_circle_vector(i, tessellation);
                     DirectX::XMVECTOR position = DirectX::XMVectorAdd(DirectX::XMVectorScale(circle_vector, radius), DirectX::XMVectorScale(normal, height));
                     vertices.emplace_back(position, DirectX::XMLoadFloat3(&color));
                 }
             }
-        }
 
-        /**
-         * Create a cube.
-         *
-         * @param size The size of one side of the cube.
-         * @param reverseWinding Whether to reverse the winding order of the triangles (useful for skyboxes).
-         */
-        std::shared_ptr<scene> create_cube(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color, float size)
-        {
-            // Cube is centered at 0,0,0.
-            float s = size * 0.5f;
-
-            // 8 vertex position
-            DirectX::XMFLOAT3 p[8] = 
-            { 
-                { +s, +s, -s }, 
-                { +s, +s, +s },
-                { +s, -s, +s },
-                { +s, -s, -s },
-                { -s, +s, +s },
-                { -s, +s, -s }, 
-                { -s, -s, -s }, 
-                { -s, -s, +s }
-            };
+            void generate_cube(const procedural_mesh_desc& desc, vertex_collection& vertices, index_collection& indices)
+            {
+                const DirectX::XMFLOAT3& color = desc.color;
+                float size = desc.size;
+
+                // Cube is centered at 0,0,0.
+                float s = size * 0.5f;
+
+                // 8 vertex position
+                DirectX::XMFLOAT3 p[8] = 
+                { 
+                    { +s, +s, -s }, 
+                    { +s, +s, +s },
+                    { +s, -s, +s },
+                    { +s, -s, -s },
+                    { -s, +s, +s },
+                    { -s, +s, -s }, 
+                    { -s, -s, -s }, 
+                    { -s, -s, +s }
+                };
+
+                // Indices for the vertex positions.
+                uint16_t i[24] = {
+                    0, 1, 2, 3,  // +X
+                    4, 5, 6, 7,  // -X
+                    4, 1, 0, 5,  // +Y
+                    2, 7, 6, 3,  // -Y
+                    1, 4, 7, 2,  // +Z
+                    5, 0, 3, 6   // -Z
+                };
+
+                vertices.reserve(24);
+                indices.reserve(36);
+
+                for (u32 f = 0; f < 6; ++f)  // For each face of the cube.
+                {
+                    // Four vertices per face.
+                    vertices.emplace_back(p[i[f * 4 + 0]], color);
+                    vertices.emplace_back(p[i[f * 4 + 1]], color);
+                    vertices.emplace_back(p[i[f * 4 + 2]], color);
+                    vertices.emplace_back(p[i[f * 4 + 3]], color);
+
+                    // First triangle.
+                    indices.emplace_back(f * 4 + 0);
+                    indices.emplace_back(f * 4 + 1);
+                    indices.emplace_back(f * 4 + 2);
+
+                    // Second triangle
+                    indices.emplace_back(f * 4 + 2);
+                    indices.emplace_back(f * 4 + 3);
+                    indices.emplace_back(f * 4 + 0);
+                }
+            }
 
-            // Indices for the vertex positions.
-            uint16_t i[24] = {
-                0, 1, 2, 3,  // +X
-                4, 5, 6, 7,  // -X
-                4, 1, 0, 5,  // +Y
-                2, 7, 6, 3,  // -Y
-                1, 4, 7, 2,  // +Z
-                5, 0, 3, 6   // -Z
-            };
+            void generate_sphere(const procedural_mesh_desc& desc, vertex_collection& vertices, index_collection& indices)
+            {
+                const DirectX::XMFLOAT3& color = desc.color;
+                float radius = desc.size;
+                u32 tessellation = desc.tessellation;
 
-            vertex_collection vertices;
-            index_collection indices;
+                size_t vertical_segments = tessellation;
+                size_t horizontal_segments = static_cast<size_t>(tessellation) * 2;
 
-            for (uint16_t f = 0; f < 6; ++f)  // For each face of the cube.
-            {
-                // Four vertices per face.
-                vertices.emplace_back(p[i[f * 4 + 0]], color);
-                vertices.emplace_back(p[i[f * 4 + 1]], color);
-                vertices.emplace_back(p[i[f * 4 + 2]], color);
-                vertices.emplace_back(p[i[f * 4 + 3]], color);
-
-                // First triangle.
-                indices.emplace_back(f * 4 + 0);
-                indices.emplace_back(f * 4 + 1);
-                indices.emplace_back(f * 4 + 2);
-
-                // Second triangle
-                indices.emplace_back(f * 4 + 2);
-                indices.emplace_back(f * 4 + 3);
-                indices.emplace_back(f * 4 + 0);
+                // One ring of vertices per latitude, two triangles per vertex of every ring but the last.
+                vertices.reserve((vertical_segments + 1) * (horizontal_segments + 1));
+                indices.reserve(vertical_segments * (horizontal_segments + 1) * 6);
+
+                // Create rings of vertices at progressively higher latitudes.
+                for (size_t i = 0; i <= vertical_segments; i++)
+                {
+                    float v = 1 - (float)i / vertical_segments;
+
+                    float latitude = (i * DirectX::XM_PI / vertical_segments) - DirectX::XM_PIDIV2;
+                    float dy, dxz;
+
+                    DirectX::XMScalarSinCos(&dy, &dxz, latitude);
+
+                    // Create a single ring of vertices at this latitude.
+                    for (size_t j = 0; j <= horizontal_segments; j++)
+                    {
+                        float u = (float)j / horizontal_segments;
+
+                        float longitude = j * DirectX::XM_2PI / horizontal_segments;
+                        float dx, dz;
+
+                        DirectX::XMScalarSinCos(&dx, &dz, longitude);
+
+                        dx *= dxz;
+                        dz *= dxz;
+
+                        auto normal = DirectX::XMVectorSet(dx, dy, dz, 0);
+                        auto position = DirectX::operator*(radius, normal);
+
+                        vertices.emplace_back(position, DirectX::XMLoadFloat3(&color));
+                    }
+                }
+
+                // Fill the index buffer with triangles joining each pair of latitude rings.
+                size_t stride = horizontal_segments + 1;
+
+                for (size_t i = 0; i < vertical_segments; i++)
+                {
+                    for (size_t j = 0; j <= horizontal_segments; j++)
+                    {
+                        u32 current_row = static_cast<u32>(i * stride);
+                        u32 next_row = static_cast<u32>((i + 1) * stride);
+                        u32 current_column = static_cast<u32>(j);
+                        u32 next_column = static_cast<u32>((j + 1) % stride);
+
+                        indices.push_back(current_row + next_column);
+                        indices.push_back(next_row + current_column);
+                        indices.push_back(current_row + current_column);
+
+                        indices.push_back(next_row + next_column);
+                        indices.push_back(next_row + current_column);
+                        indices.push_back(current_row + next_column);
+                    }
+                }
             }
 
-            return internal::create_scene(commandList, vertices, indices);
-        }
+            void generate_cylinder(const procedural_mesh_desc& desc, vertex_collection& vertices, index_collection& indices)
+            {
+                const DirectX::XMFLOAT3& color = desc.color;
+                float radius = desc.size;
+                float height = desc.height / 2;
+                u32 tessellation = desc.tessellation;
 
-        /**
-         * Create a sphere.
-         *
-         * @param radius Radius of the sphere.
-         * @param tessellation Determines how smooth the sphere is.
-         * @param reverseWinding Whether to reverse the winding order of the triangles (useful for sydomes).
-         */
-        std::shared_ptr<scene> create_sphere(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color, float radius, uint32_t tessellation)
-        {
-            assert(tessellation > 3 && "tessellation parameter out of range");
+                // Two vertices per side segment and one per cap vertex, two triangles per side segment and a fan per cap.
+                vertices.reserve((tessellation + 1) * 2 + tessellation * 2);
+                indices.reserve((tessellation + 1) * 6 + (tessellation - 2) * 6);
+
+                DirectX::XMVECTOR top_offset = DirectX::XMVectorScale(DirectX::g_XMIdentityR1, height);
+
+                u32 stride = tessellation + 1;
 
-            vertex_collection vertices;
-            index_collection  indices;
+                DirectX::XMVECTOR simd_color = DirectX::XMLoadFloat3(&color);
 
-            size_t vertical_segments = tessellation;
-            size_t horizontal_segments = tessellation * 2;
+                // Create a ring of triangles around the outside of the cylinder.
+                for (u32 i = 0; i <= tessellation; i++)
+                {
+                    DirectX::XMVECTOR normal = internal::get_circle_vector(i, tessellation);
+                    DirectX::XMVECTOR side_offset = DirectX::XMVectorScale(normal, radius);
+
+                    float u = float(i) / float(tessellation);
+
+                    vertices.emplace_back(DirectX::XMVectorAdd(side_offset, top_offset), simd_color);
+                    vertices.emplace_back(DirectX::XMVectorSubtract(side_offset, top_offset), simd_color);
+
+                    indices.push_back(i * 2 + 1);
+                    indices.push_back((i * 2 + 2) % (stride * 2));
+                    indices.push_back(i * 2);
+
+                    indices.push_back((i * 2 + 3) % (stride * 2));
+                    indices.push_back((i * 2 + 2) % (stride * 2));
+                    indices.push_back(i * 2 + 1);
+                }
+
+                // Create flat triangle fan caps to seal the top and bottom.
+                internal::create_cylinder_cap(vertices, indices, tessellation, height, radius, true, color);
+                internal::create_cylinder_cap(vertices, indices, tessellation, height, radius, false, color);
+            }
 
-            // Create rings of vertices at progressively higher latitudes.
-            for (size_t i = 0; i <= vertical_segments; i++)
+            void generate_plane(const procedural_mesh_desc& desc, vertex_collection& vertices, index_collection& indices)
             {
-                float v = 1 - (float)i / vertical_segments;
+                const DirectX::XMFLOAT3& color = desc.color;
+                float width = desc.size;
+                float height = desc.height;
 
-                float latitude = (i * DirectX::XM_PI / vertical_segments) - DirectX::XM_PIDIV2;
-                float dy, dxz;
+                // clang-format off
+                // Define a plane that is aligned with the X-Z plane and the normal is facing up in the Y-axis.
+                vertices = 
+                {
+                    vertex_pos_color(DirectX::XMFLOAT3(-0.5f * width, 0.0f, 0.5f * height), color),  // 0
+                    vertex_pos_color(DirectX::XMFLOAT3(0.5f * width, 0.0f, 0.5f * height), color),   // 1
+                    vertex_pos_color(DirectX::XMFLOAT3(0.5f * width, 0.0f, -0.5f * height), color),  // 2
+                    vertex_pos_color(DirectX::XMFLOAT3(-0.5f * width, 0.0f, -0.5f * height), color)  // 3
+                };
 
-                DirectX::XMScalarSinCos(&dy, &dxz, latitude);
+                indices = { 1, 3, 0, 2, 3, 1 };
+            }
 
-                // Create a single ring of vertices at this latitude.
-                for (size_t j = 0; j <= horizontal_segments; j++)
+            /**
+             * Generate the triangles of a shape.
+             *
+             * @returns false when the parameters describe no valid shape.
+             */
+            bool generate_shape(const procedural_mesh_desc& desc, vertex_collection& vertices, index_collection& indices)
+            {
+                bool valid = desc.size > 0.0f;
+                switch (desc.shape)
                 {
-                    float u = (float)j / horizontal_segments;
+                case procedural_shape::cube:
+                    if (valid)
+                    {
+                        generate_cube(desc, vertices, indices);
+                    }
+                    break;
+                case procedural_shape::sphere:
+                    valid = valid && desc.tessellation > 3;
+                    if (valid)
+                    {
+                        generate_sphere(desc, vertices, indices);
+                    }
+                    break;
+                case procedural_shape::cylinder:
+                    valid = valid && desc.height > 0.0f && desc.tessellation > 3;
+                    if (valid)
+                    {
+                        generate_cylinder(desc, vertices, indices);
+                    }
+                    break;
+                case procedural_shape::plane:
+                    valid = valid && desc.height > 0.0f;
+                    if (valid)
+                    {
+                        generate_plane(desc, vertices, indices);
+                    }
+                    break;
+                default:
+                    valid = false;
+                    break;
+                }
 
-                    float longitude = j * DirectX::XM_2PI / horizontal_segments;
-                    float dx, dz;
+                if (!valid)
+                {
+                    log::error("Invalid procedural mesh description, shape {}", static_cast<u32>(desc.shape));
+                }
 
-                    DirectX::XMScalarSinCos(&dx, &dz, longitude);
+                return valid;
+            }
 
-                    dx *= dxz;
-                    dz *= dxz;
+            /**
+             * Generate and cook a shape. Generated shapes are simple and closed, they are their own occluder.
+             */
+            bool cook_shape(const procedural_mesh_desc& desc, cooked_mesh& cooked, std::shared_ptr<occluder_geometry>& occluder)
+            {
+                vertex_collection vertices;
+                index_collection indices;
+                if (!generate_shape(desc, vertices, indices))
+                {
+                    return false;
+                }
 
-                    auto normal = DirectX::XMVectorSet(dx, dy, dz, 0);
-                    auto position = DirectX::operator*(radius, normal);
+                cooker_input input;
+                input.vertices = vertices.data();
+                input.num_vertices = vertices.size();
+                input.vertex_stride = sizeof(vertex_pos_color);
+                input.position_offset = offsetof(vertex_pos_color, position);
+                input.color_offset = offsetof(vertex_pos_color, color);
+                input.indices = indices.data();
+                input.num_indices = indices.size();
+
+                // Shapes are generated ring by ring, they are reordered for the vertex caches when they are cooked.
+                if (!mesh_cooker::cook_mesh(input, desc.format, false, cooked))
+                {
+                    return false;
+                }
 
-                    vertices.emplace_back(position, DirectX::XMLoadFloat3(&color));
+                // Welding shrinks the shape, the vertices and indices past the cooked counts are stale.
+                vertices.erase(vertices.begin() + cooked.num_vertices, vertices.end());
+                indices.resize(cooked.indices.size() / cooked.index_size);
+
+                auto new_occluder = std::make_shared<occluder_geometry>();
+                new_occluder->positions.reserve(vertices.size());
+                for (const vertex_pos_color& vertex : vertices)
+                {
+                    new_occluder->positions.push_back({ vertex.position.x, vertex.position.y, vertex.position.z });
                 }
+                new_occluder->indices = std::move(indices);
+                occluder = std::move(new_occluder);
+
+                return true;
             }
 
-            // Fill the index buffer with triangles joining each pair of latitude rings.
-            size_t stride = horizontal_segments + 1;
+            std::shared_ptr<scene> create_shape_scene(const std::shared_ptr<mesh>& shape)
+            {
+                if (!shape)
+                {
+                    return nullptr;
+                }
+
+                auto new_node = std::make_shared<scene_node>();
+                new_node->add_mesh(shape);
+
+                auto new_scene = std::make_shared<scene>();
+                new_scene->set_root_node(new_node);
 
-            for (size_t i = 0; i < vertical_segments; i++)
+                return new_scene;
+            }
+
+            // Shapes of one vertex layout and index size, they share a vertex buffer and an index buffer.
+            struct shape_batch
+            {
+                vertex_format format;
+                u32 vertex_stride;
+                u32 index_size;
+
+                blob vertex_data;
+                blob index_data;
+
+                // The shapes of a batch share one allocation, it is freed with the last of their meshes.
+                std::shared_ptr<geometry_allocation> geometry;
+            };
+
+            struct packed_shape
             {
-                for (size_t j = 0; j <= horizontal_segments; j++)
+                // Empty when the shape could not be cooked.
+                cooked_mesh cooked;
+                std::shared_ptr<occluder_geometry> occluder;
+
+                size_t batch = 0;
+                u32 base_vertex = 0;
+                // First index of every level of detail in the index buffer of the batch.
+                std::vector<u32> first_indices;
+            };
+
+            /**
+             * Append the buffers of a cooked shape to the batch of its vertex layout and index size.
+             */
+            void pack_shape(std::vector<shape_batch>& batches, packed_shape& shape)
+            {
+                const cooked_mesh& cooked = shape.cooked;
+
+                auto it = std::find_if(batches.begin(), batches.end(), [&cooked](const shape_batch& batch)
                 {
-                    size_t nextI = i + 1;
-                    size_t nextJ = (j + 1) % stride;
+                    return batch.format == cooked.format && batch.index_size == cooked.index_size;
+                });
+
+                if (it == batches.end())
+                {
+                    shape_batch& new_batch = batches.emplace_back();
+                    new_batch.format = cooked.format;
+                    new_batch.vertex_stride = cooked.vertex_stride;
+                    new_batch.index_size = cooked.index_size;
+
+                    it = std::prev(batches.end());
+                }
 
-                    indices.push_back(i * stride + nextJ);
-                    indices.push_back(nextI * stride + j);
-                    indices.push_back(i * stride + j);
+                shape_batch& batch = *it;
+                shape.batch = static_cast<size_t>(it - batches.begin());
 
-                    indices.push_back(nextI * stride + nextJ);
-                    indices.push_back(nextI * stride + j);
-                    indices.push_back(i * stride + nextJ);
+                shape.base_vertex = static_cast<u32>(batch.vertex_data.size() / batch.vertex_stride);
+                batch.vertex_data.insert(batch.vertex_data.end(), cooked.vertices.begin(), cooked.vertices.end());
+
+                // Indices stay relative to the shape, the base vertex is added when the shape is drawn.
+                shape.first_indices.push_back(static_cast<u32>(batch.index_data.size() / batch.index_size));
+                batch.index_data.insert(batch.index_data.end(), cooked.indices.begin(), cooked.indices.end());
+
+                for (const cooked_lod& lod : cooked.lods)
+                {
+                    shape.first_indices.push_back(static_cast<u32>(batch.index_data.size() / batch.index_size));
+                    batch.index_data.insert(batch.index_data.end(), lod.indices.begin(), lod.indices.end());
                 }
             }
+        }
 
-            return internal::create_scene(commandList, vertices, indices);
+        /**
+         * Create a cube.
+         *
+         * @param size The size of one side of the cube.
+         * @param reverseWinding Whether to reverse the winding order of the triangles (useful for skyboxes).
+         * @param format Vertex layout of the mesh.
+         */
+        std::shared_ptr<scene> create_cube(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color, float size, vertex_format format)
+        {
+            return internal::create_shape_scene(create_mesh(commandList, procedural_mesh_desc::cube(color, size, format)));
+        }
+
+        /**
+         * Create a sphere.
+         *
+         * @param radius Radius of the sphere.
+         * @param tessellation Determines how smooth the sphere is.
+         * @param reverseWinding Whether to reverse the winding order of the triangles (useful for sydomes).
+         * @param format Vertex layout of the mesh.
+         */
+        std::shared_ptr<scene> create_sphere(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color, float radius, uint32_t tessellation, vertex_format format)
+        {
+            return internal::create_shape_scene(create_mesh(commandList, procedural_mesh_desc::sphere(color, radius, tessellation, format)));
         }
 
         /**
@@ -226,71 +632,199 @@ namespace cera
          * @param hight The height of the cylinder.
          * @param tessellation How smooth the cylinder will be.
          * @param reverseWinding Whether to reverse the winding order of the triangles.
+         * @param format Vertex layout of the mesh.
          */
-        std::shared_ptr<scene> create_cylinder(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color, float radius, float height, uint32_t tessellation)
+        std::shared_ptr<scene> create_cylinder(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color, float radius, float height, uint32_t tessellation, vertex_format format)
         {
-            assert(tessellation > 3 && "tessellation parameter out of range");
+            return internal::create_shape_scene(create_mesh(commandList, procedural_mesh_desc::cylinder(color, radius, height, tessellation, format)));
+        }
 
-            vertex_collection vertices;
-            index_collection  indices;
+        /**
+         * Create a plane.
+         *
+         * @param width The width of the plane.
+         * @param height The height of the plane.
+         * @reverseWinding Whether to reverse the winding order of the plane.
+         * @param format Vertex layout of the mesh.
+         */
+        std::shared_ptr<scene> create_plane(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color, float width, float height, vertex_format format)
+        {
+            return internal::create_shape_scene(create_mesh(commandList, procedural_mesh_desc::plane(color, width, height, format)));
+        }
 
-            height /= 2;
+        /**
+         * Create the mesh of a shape in its own range of the geometry pool.
+         */
+        std::shared_ptr<mesh> create_mesh(const std::shared_ptr<command_list>& commandList, const procedural_mesh_desc& desc)
+        {
+            cooked_mesh cooked;
+            std::shared_ptr<occluder_geometry> occluder;
+            if (!internal::cook_shape(desc, cooked, occluder))
+            {
+                return nullptr;
+            }
 
-            DirectX::XMVECTOR top_offset = DirectX::XMVectorScale(DirectX::g_XMIdentityR1, height);
+            auto new_mesh = internal::upload_mesh(*commandList, mesh_cooker::get_view(cooked));
+            if (new_mesh)
+            {
+                new_mesh->set_occluder(occluder);
+            }
 
-            size_t stride = tessellation + 1;
+            return new_mesh;
+        }
 
-            DirectX::XMVECTOR simd_color = DirectX::XMLoadFloat3(&color);
+        /**
+         * Create the meshes of many shapes, packed into shared buffers.
+         */
+        void create_meshes(const std::shared_ptr<command_list>& commandList, const std::vector<procedural_mesh_desc>& descs, std::vector<std::shared_ptr<mesh>>& meshes)
+        {
+            meshes.assign(descs.size(), nullptr);
 
-            // Create a ring of triangles around the outside of the cylinder.
-            for (size_t i = 0; i <= tessellation; i++)
+            // Equal descriptions are cooked once and share their mesh.
+            std::unordered_map<procedural_mesh_desc, size_t, procedural_mesh_desc_hasher> shape_indices;
+            std::vector<size_t> desc_shapes(descs.size());
+
+            std::vector<internal::packed_shape> shapes;
+            std::vector<internal::shape_batch> batches;
+
+            for (size_t i = 0; i < descs.size(); ++i)
             {
-                DirectX::XMVECTOR normal = internal::get_circle_vector(i, tessellation);
-                DirectX::XMVECTOR side_offset = DirectX::XMVectorScale(normal, radius);
+                auto inserted = shape_indices.emplace(descs[i], shapes.size());
+                desc_shapes[i] = inserted.first->second;
+                if (!inserted.second)
+                {
+                    continue;
+                }
 
-                float u = float(i) / float(tessellation);
+                internal::packed_shape& shape = shapes.emplace_back();
+                if (internal::cook_shape(descs[i], shape.cooked, shape.occluder))
+                {
+                    internal::pack_shape(batches, shape);
+                }
+            }
 
-                vertices.emplace_back(DirectX::XMVectorAdd(side_offset, top_offset), simd_color);
-                vertices.emplace_back(DirectX::XMVectorSubtract(side_offset, top_offset), simd_color);
+            // Every batch is one allocation of the geometry pool, uploaded with one copy per buffer.
+            for (internal::shape_batch& batch : batches)
+            {
+                DXGI_FORMAT index_format = batch.index_size == sizeof(u16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 
-                indices.push_back(i * 2 + 1);
-                indices.push_back((i * 2 + 2) % (stride * 2));
-                indices.push_back(i * 2);
+                u32 num_vertices = static_cast<u32>(batch.vertex_data.size() / batch.vertex_stride);
+                u32 num_indices = static_cast<u32>(batch.index_data.size() / batch.index_size);
 
-                indices.push_back((i * 2 + 3) % (stride * 2));
-                indices.push_back((i * 2 + 2) % (stride * 2));
-                indices.push_back(i * 2 + 1);
+                batch.geometry = std::make_shared<geometry_allocation>(commandList->get_device()->allocate_geometry(batch.vertex_stride, index_format, num_vertices, num_indices));
+                if (batch.geometry->is_null())
+                {
+                    log::error("Failed to allocate {} vertices in the geometry pool", num_vertices);
+                    continue;
+                }
+
+                commandList->copy_buffer_region(batch.geometry->get_vertex_buffer(), batch.geometry->get_vertex_offset(), batch.vertex_data.size(), batch.vertex_data.data());
+                commandList->copy_buffer_region(batch.geometry->get_index_buffer(), batch.geometry->get_index_offset(), batch.index_data.size(), batch.index_data.data());
             }
 
-            // Create flat triangle fan caps to seal the top and bottom.
-            internal::create_cylinder_cap(vertices, indices, tessellation, height, radius, true, color);
-            internal::create_cylinder_cap(vertices, indices, tessellation, height, radius, false, color);
+            std::vector<std::shared_ptr<mesh>> shape_meshes(shapes.size());
+            for (size_t i = 0; i < shapes.size(); ++i)
+            {
+                internal::packed_shape& shape = shapes[i];
+                cooked_mesh& cooked = shape.cooked;
+                if (cooked.num_vertices == 0 || batches[shape.batch].geometry->is_null())
+                {
+                    continue;
+                }
+
+                const geometry_allocation& geometry = *batches[shape.batch].geometry;
+
+                auto new_mesh = std::make_shared<mesh>();
+                new_mesh->set_geometry(batches[shape.batch].geometry);
+                new_mesh->set_vertex_range(geometry.get_base_vertex() + shape.base_vertex, cooked.num_vertices);
+                new_mesh->set_position_quantization(cooked.quantization);
+                new_mesh->set_bounds(cooked.box, cooked.sphere);
+                new_mesh->set_meshlets(std::move(cooked.meshlets));
+                new_mesh->set_occluder(shape.occluder);
+
+                for (const cooked_lod& lod : cooked.lods)
+                {
+                    new_mesh->add_lod(geometry.get_index_buffer(), lod.error);
+                }
+
+                new_mesh->set_index_range(0, geometry.get_first_index() + shape.first_indices[0], static_cast<u32>(cooked.indices.size() / cooked.index_size));
+                for (u32 lod = 0; lod < cooked.lods.size(); ++lod)
+                {
+                    new_mesh->set_index_range(lod + 1, geometry.get_first_index() + shape.first_indices[lod + 1], static_cast<u32>(cooked.lods[lod].indices.size() / cooked.index_size));
+                }
+
+                shape_meshes[i] = new_mesh;
+            }
 
-            return internal::create_scene(commandList, vertices, indices);
+            for (size_t i = 0; i < descs.size(); ++i)
+            {
+                meshes[i] = shape_meshes[desc_shapes[i]];
+            }
         }
 
+
         /**
-         * Create a plane.
+         * Create a scene from an imported model.
          *
-         * @param width The width of the plane.
-         * @param height The height of the plane.
-         * @reverseWinding Whether to reverse the winding order of the plane.
+         * @param format Vertex layout of the meshes.
+         * @param threadPool When set, the meshes are cooked in parallel.
+         */
+        std::shared_ptr<scene> create_model(const std::shared_ptr<command_list>& commandList, const imported_model& model, vertex_format format, threading::thread_pool* threadPool)
+        {
+            // Cooking is the most expensive step of the upload, meshes are cooked in parallel before they are recorded.
+            cooked_model cooked;
+            mesh_cooker::cook_model(model, format, threadPool, cooked);
+
+            return create_model(commandList, mesh_cooker::get_view(cooked));
+        }
+
+        /**
+         * Create a scene from a cooked model.
          */
-        std::shared_ptr<scene> create_plane(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color, float width, float height)
+        std::shared_ptr<scene> create_model(const std::shared_ptr<command_list>& commandList, const cooked_model_view& model)
         {
-            // clang-format off
-            // Define a plane that is aligned with the X-Z plane and the normal is facing up in the Y-axis.
-            vertex_collection vertices = 
+            // Imported meshes are no occluders, they are not guaranteed to be closed and have unbounded triangle counts.
+            std::vector<std::shared_ptr<mesh>> meshes(model.meshes.size());
+            for (size_t i = 0; i < model.meshes.size(); ++i)
             {
-                vertex_pos_color(DirectX::XMFLOAT3(-0.5f * width, 0.0f, 0.5f * height), color),  // 0
-                vertex_pos_color(DirectX::XMFLOAT3(0.5f * width, 0.0f, 0.5f * height), color),   // 1
-                vertex_pos_color(DirectX::XMFLOAT3(0.5f * width, 0.0f, -0.5f * height), color),  // 2
-                vertex_pos_color(DirectX::XMFLOAT3(-0.5f * width, 0.0f, -0.5f * height), color)  // 3
-            };
-            
-            index_collection indices = { 1, 3, 0, 2, 3, 1 };
+                if (model.meshes[i].num_indices > 0)
+                {
+                    meshes[i] = internal::upload_mesh(*commandList, model.meshes[i]);
+                }
+            }
+
+            auto root_node = std::make_shared<scene_node>();
+            for (u32 node : model.root_nodes)
+            {
+                root_node->add_child(internal::create_model_node(model.nodes, node, meshes));
+            }
+
+            auto new_scene = std::make_shared<scene>();
+            new_scene->set_root_node(root_node);
+
+            return new_scene;
+        }
+
+        /**
+         * Create a scene from a mesh cache file.
+         */
+        std::shared_ptr<scene> load_model(const std::shared_ptr<command_list>& commandList, const std::filesystem::path& path)
+        {
+            file_mapping file;
+            if (!file.open(path))
+            {
+                return nullptr;
+            }
+
+            cooked_model_view model;
+            if (!mesh_cache_io::read(file.get_data(), file.get_size(), model))
+            {
+                log::error("Invalid mesh cache: {}", path.string());
+                return nullptr;
+            }
 
-            return internal::create_scene(commandList, vertices, indices);
+            // Buffers are copied into upload memory while they are recorded, the file can be unmapped afterwards.
+            return create_model(commandList, model);
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "render/offset_allocator.h"
+
+#include <cassert>
+#include <iterator>
+
+namespace cera
+{
+    offset_allocator::offset_allocator(u32 size)
+        : m_size(size)
+        , m_num_free(size)
+    {
+        if (size > 0)
+        {
+            add_free_range(0, size);
+        }
+    }
+
+    u32 offset_allocator::allocate(u32 size)
+    {
+        if (size == 0)
+        {
+            return 0;
+        }
+
+        // The smallest free range that fits keeps the large ranges for large requests.
+        auto smallest_range_it = m_free_list_by_size.lower_bound(size);
+        if (smallest_range_it == m_free_list_by_size.end())
+        {
+            return invalid_offset;
+        }
+
+        u32 range_size = smallest_range_it->first;
+        auto offset_it = smallest_range_it->second;
+        u32 offset = offset_it->first;
+
+        m_free_list_by_size.erase(smallest_range_it);
+        m_free_list_by_offset.erase(offset_it);
+
+        if (range_size > size)
+        {
+            add_free_range(offset + size, range_size - size);
+        }
+
+        m_num_free -= size;
+
+        return offset;
+    }
+
+    void offset_allocator::free(u32 offset, u32 size)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+
+        assert(offset + size <= m_size);
+
+        m_num_free += size;
+
+        auto next_range_it = m_free_list_by_offset.upper_bound(offset);
+
+        if (next_range_it != m_free_list_by_offset.begin())
+        {
+            auto previous_range_it = std::prev(next_range_it);
+            assert(previous_range_it->first + previous_range_it->second.size <= offset);
+
+            if (previous_range_it->first + previous_range_it->second.size == offset)
+            {
+                offset = previous_range_it->first;
+                size += previous_range_it->second.size;
+
+                m_free_list_by_size.erase(previous_range_it->second.by_size_it);
+                m_free_list_by_offset.erase(previous_range_it);
+            }
+        }
+
+        if (next_range_it != m_free_list_by_offset.end() && offset + size == next_range_it->first)
+        {
+            size += next_range_it->second.size;
+
+            m_free_list_by_size.erase(next_range_it->second.by_size_it);
+            m_free_list_by_offset.erase(next_range_it);
+        }
+
+        add_free_range(offset, size);
+    }
+
+    bool offset_allocator::has_space(u32 size) const
+    {
+        return size == 0 || m_free_list_by_size.lower_bound(size) != m_free_list_by_size.end();
+    }
+
+    u32 offset_allocator::get_size() const
+    {
+        return m_size;
+    }
+
+    u32 offset_allocator::get_num_free() const
+    {
+        return m_num_free;
+    }
+
+    u32 offset_allocator::get_num_free_ranges() const
+    {
+        return static_cast<u32>(m_free_list_by_offset.size());
+    }
+
+    void offset_allocator::add_free_range(u32 offset, u32 size)
+    {
+        auto offset_it = m_free_list_by_offset.emplace(offset, free_range_info{ size, {} }).first;
+        offset_it->second.by_size_it = m_free_list_by_size.emplace(size, offset_it);
+    }
+}
\ No newline at end of file
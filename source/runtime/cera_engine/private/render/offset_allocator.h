@@ -0,0 +1,66 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <map>
+
+namespace cera
+{
+    /**
+     * Allocates ranges of a fixed size space, used to suballocate large buffers.
+     *
+     * Free ranges are kept in two maps like the free list of the descriptor_allocator_page: by offset to merge a
+     * freed range with its neighbours and by size to find the smallest free range that fits a request.
+     */
+    class offset_allocator
+    {
+    public:
+        static constexpr u32 invalid_offset = ~0u;
+
+        explicit offset_allocator(u32 size);
+
+        /**
+         * Allocate a range, empty ranges are placed at offset 0 and take no space.
+         *
+         * @returns invalid_offset when no free range is large enough.
+         */
+        u32 allocate(u32 size);
+
+        /**
+         * Return a range, it is merged with the free ranges next to it.
+         */
+        void free(u32 offset, u32 size);
+
+        bool has_space(u32 size) const;
+
+        u32 get_size() const;
+        u32 get_num_free() const;
+
+        /**
+         * Number of separate free ranges, 1 when the free space is not fragmented.
+         */
+        u32 get_num_free_ranges() const;
+
+    private:
+        void add_free_range(u32 offset, u32 size);
+
+    private:
+        struct free_range_info;
+
+        using free_list_by_offset = std::map<u32, free_range_info>;
+        // Several ranges can have the same size.
+        using free_list_by_size = std::multimap<u32, free_list_by_offset::iterator>;
+
+        struct free_range_info
+        {
+            u32 size;
+            free_list_by_size::iterator by_size_it;
+        };
+
+        free_list_by_offset m_free_list_by_offset;
+        free_list_by_size m_free_list_by_size;
+
+        u32 m_size;
+        u32 m_num_free;
+    };
+}
\ No newline at end of file
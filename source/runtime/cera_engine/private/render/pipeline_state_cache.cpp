@@ -0,0 +1,643 @@
+#include "render/pipeline_state_cache.h"
+#include "render/pipeline_state_cache_file.h"
+#include "render/pipeline_state_object.h"
+#include "render/root_signature.h"
+#include "render/device.h"
+#include "render/d3dx12_call.h"
+
+#include "util/hash.h"
+#include "util/log.h"
+
+#include <cstdio>
+
+namespace cera
+{
+    namespace internal
+    {
+        u64 hash_shader_bytecode(const D3D12_SHADER_BYTECODE& bytecode)
+        {
+            u64 hash = hash::fnv1a_value(static_cast<u64>(bytecode.BytecodeLength));
+            if (bytecode.pShaderBytecode != nullptr)
+            {
+                hash = hash::fnv1a(bytecode.pShaderBytecode, bytecode.BytecodeLength, hash);
+            }
+
+            return hash;
+        }
+
+        u64 hash_semantic_name(const char* semanticName, u64 seed)
+        {
+            return semanticName != nullptr
+                ? hash::fnv1a(std::string_view(semanticName), seed)
+                : seed;
+        }
+
+        u64 hash_depth_stencil_op(const D3D12_DEPTH_STENCILOP_DESC& desc, u64 seed)
+        {
+            u64 hash = hash::fnv1a_value(desc.StencilFailOp, seed);
+            hash = hash::fnv1a_value(desc.StencilDepthFailOp, hash);
+            hash = hash::fnv1a_value(desc.StencilPassOp, hash);
+            hash = hash::fnv1a_value(desc.StencilFunc, hash);
+
+            return hash;
+        }
+
+        u64 hash_render_target_blend(const D3D12_RENDER_TARGET_BLEND_DESC& desc, u64 seed)
+        {
+            u64 hash = hash::fnv1a_value(desc.BlendEnable, seed);
+            hash = hash::fnv1a_value(desc.LogicOpEnable, hash);
+            hash = hash::fnv1a_value(desc.SrcBlend, hash);
+            hash = hash::fnv1a_value(desc.DestBlend, hash);
+            hash = hash::fnv1a_value(desc.BlendOp, hash);
+            hash = hash::fnv1a_value(desc.SrcBlendAlpha, hash);
+            hash = hash::fnv1a_value(desc.DestBlendAlpha, hash);
+            hash = hash::fnv1a_value(desc.BlendOpAlpha, hash);
+            hash = hash::fnv1a_value(desc.LogicOp, hash);
+            hash = hash::fnv1a_value(desc.RenderTargetWriteMask, hash);
+
+            return hash;
+        }
+
+        /**
+         * Walks a pipeline state stream and hashes each subobject by content.
+         * Subobject hashes are stored per subobject type and combined in type order
+         * so the layout of the stream struct does not matter.
+         */
+        class pipeline_state_stream_hasher : public ID3DX12PipelineParserCallbacks
+        {
+        public:
+            pipeline_state_stream_hasher()
+                : m_subobject_hashes{ 0 }
+                , m_subobject_seen{ false }
+                , m_persistent(true)
+                , m_valid(true)
+            {}
+
+            pipeline_state_hash result() const
+            {
+                pipeline_state_hash hash;
+
+                u64 value = hash::fnv1a_offset_basis;
+                for (u32 i = 0; i < D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MAX_VALID; ++i)
+                {
+                    if (m_subobject_seen[i])
+                    {
+                        value = hash::combine(value, i);
+                        value = hash::combine(value, m_subobject_hashes[i]);
+                    }
+                }
+
+                hash.value = value;
+                hash.persistent = m_persistent && m_valid;
+
+                return hash;
+            }
+
+            // ID3DX12PipelineParserCallbacks
+            void FlagsCb(D3D12_PIPELINE_STATE_FLAGS flags) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS, hash::fnv1a_value(flags));
+            }
+            void NodeMaskCb(UINT nodeMask) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK, hash::fnv1a_value(nodeMask));
+            }
+            void RootSignatureCb(ID3D12RootSignature* rootSignature) override
+            {
+                u64 root_signature_hash = root_signature::get_hash(rootSignature);
+                if (root_signature_hash == 0 && rootSignature != nullptr)
+                {
+                    // Unknown root signature, the pointer is the only identity we have.
+                    root_signature_hash = hash::fnv1a_value(reinterpret_cast<uintptr_t>(rootSignature));
+                    m_persistent = false;
+                }
+
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE, root_signature_hash);
+            }
+            void InputLayoutCb(const D3D12_INPUT_LAYOUT_DESC& inputLayout) override
+            {
+                u64 hash = hash::fnv1a_value(inputLayout.NumElements);
+                for (u32 i = 0; i < inputLayout.NumElements; ++i)
+                {
+                    const D3D12_INPUT_ELEMENT_DESC& element = inputLayout.pInputElementDescs[i];
+
+                    hash = hash_semantic_name(element.SemanticName, hash);
+                    hash = hash::fnv1a_value(element.SemanticIndex, hash);
+                    hash = hash::fnv1a_value(element.Format, hash);
+                    hash = hash::fnv1a_value(element.InputSlot, hash);
+                    hash = hash::fnv1a_value(element.AlignedByteOffset, hash);
+                    hash = hash::fnv1a_value(element.InputSlotClass, hash);
+                    hash = hash::fnv1a_value(element.InstanceDataStepRate, hash);
+                }
+
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT, hash);
+            }
+            void IBStripCutValueCb(D3D12_INDEX_BUFFER_STRIP_CUT_VALUE value) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE, hash::fnv1a_value(value));
+            }
+            void PrimitiveTopologyTypeCb(D3D12_PRIMITIVE_TOPOLOGY_TYPE type) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY, hash::fnv1a_value(type));
+            }
+            void VSCb(const D3D12_SHADER_BYTECODE& bytecode) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS, hash_shader_bytecode(bytecode));
+            }
+            void GSCb(const D3D12_SHADER_BYTECODE& bytecode) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS, hash_shader_bytecode(bytecode));
+            }
+            void StreamOutputCb(const D3D12_STREAM_OUTPUT_DESC& streamOutput) override
+            {
+                u64 hash = hash::fnv1a_value(streamOutput.NumEntries);
+                for (u32 i = 0; i < streamOutput.NumEntries; ++i)
+                {
+                    const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+
+                    hash = hash::fnv1a_value(entry.Stream, hash);
+                    hash = hash_semantic_name(entry.SemanticName, hash);
+                    hash = hash::fnv1a_value(entry.SemanticIndex, hash);
+                    hash = hash::fnv1a_value(entry.StartComponent, hash);
+                    hash = hash::fnv1a_value(entry.ComponentCount, hash);
+                    hash = hash::fnv1a_value(entry.OutputSlot, hash);
+                }
+
+                hash = hash::fnv1a_value(streamOutput.NumStrides, hash);
+                if (streamOutput.NumStrides > 0)
+                {
+                    hash = hash::fnv1a(streamOutput.pBufferStrides, streamOutput.NumStrides * sizeof(UINT), hash);
+                }
+                hash = hash::fnv1a_value(streamOutput.RasterizedStream, hash);
+
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT, hash);
+            }
+            void HSCb(const D3D12_SHADER_BYTECODE& bytecode) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS, hash_shader_bytecode(bytecode));
+            }
+            void DSCb(const D3D12_SHADER_BYTECODE& bytecode) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS, hash_shader_bytecode(bytecode));
+            }
+            void PSCb(const D3D12_SHADER_BYTECODE& bytecode) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS, hash_shader_bytecode(bytecode));
+            }
+            void CSCb(const D3D12_SHADER_BYTECODE& bytecode) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS, hash_shader_bytecode(bytecode));
+            }
+            void BlendStateCb(const D3D12_BLEND_DESC& blendDesc) override
+            {
+                // The write mask of a render target is 8-bit, hash member by member to skip the padding.
+                u64 hash = hash::fnv1a_value(blendDesc.AlphaToCoverageEnable);
+                hash = hash::fnv1a_value(blendDesc.IndependentBlendEnable, hash);
+                for (const D3D12_RENDER_TARGET_BLEND_DESC& render_target : blendDesc.RenderTarget)
+                {
+                    hash = hash_render_target_blend(render_target, hash);
+                }
+
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND, hash);
+            }
+            void DepthStencilStateCb(const D3D12_DEPTH_STENCIL_DESC& depthStencilDesc) override
+            {
+                D3D12_DEPTH_STENCIL_DESC1 depth_stencil_desc1 = {};
+                depth_stencil_desc1.DepthEnable = depthStencilDesc.DepthEnable;
+                depth_stencil_desc1.DepthWriteMask = depthStencilDesc.DepthWriteMask;
+                depth_stencil_desc1.DepthFunc = depthStencilDesc.DepthFunc;
+                depth_stencil_desc1.StencilEnable = depthStencilDesc.StencilEnable;
+                depth_stencil_desc1.StencilReadMask = depthStencilDesc.StencilReadMask;
+                depth_stencil_desc1.StencilWriteMask = depthStencilDesc.StencilWriteMask;
+                depth_stencil_desc1.FrontFace = depthStencilDesc.FrontFace;
+                depth_stencil_desc1.BackFace = depthStencilDesc.BackFace;
+                depth_stencil_desc1.DepthBoundsTestEnable = FALSE;
+
+                DepthStencilState1Cb(depth_stencil_desc1);
+            }
+            void DepthStencilState1Cb(const D3D12_DEPTH_STENCIL_DESC1& depthStencilDesc) override
+            {
+                // The stencil masks are 8-bit, hash member by member to skip the padding.
+                u64 hash = hash::fnv1a_value(depthStencilDesc.DepthEnable);
+                hash = hash::fnv1a_value(depthStencilDesc.DepthWriteMask, hash);
+                hash = hash::fnv1a_value(depthStencilDesc.DepthFunc, hash);
+                hash = hash::fnv1a_value(depthStencilDesc.StencilEnable, hash);
+                hash = hash::fnv1a_value(depthStencilDesc.StencilReadMask, hash);
+                hash = hash::fnv1a_value(depthStencilDesc.StencilWriteMask, hash);
+                hash = hash_depth_stencil_op(depthStencilDesc.FrontFace, hash);
+                hash = hash_depth_stencil_op(depthStencilDesc.BackFace, hash);
+                hash = hash::fnv1a_value(depthStencilDesc.DepthBoundsTestEnable, hash);
+
+                // DEPTH_STENCIL and DEPTH_STENCIL1 describe the same state.
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL, hash);
+            }
+            void DSVFormatCb(DXGI_FORMAT format) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT, hash::fnv1a_value(format));
+            }
+            void RasterizerStateCb(const D3D12_RASTERIZER_DESC& rasterizerDesc) override
+            {
+                // D3D12_RASTERIZER_DESC only contains 32-bit members, there is no padding.
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER, hash::fnv1a_value(rasterizerDesc));
+            }
+            void RTVFormatsCb(const D3D12_RT_FORMAT_ARRAY& formats) override
+            {
+                u64 hash = hash::fnv1a_value(formats.NumRenderTargets);
+                hash = hash::fnv1a(formats.RTFormats, formats.NumRenderTargets * sizeof(DXGI_FORMAT), hash);
+
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS, hash);
+            }
+            void SampleDescCb(const DXGI_SAMPLE_DESC& sampleDesc) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC, hash::fnv1a_value(sampleDesc));
+            }
+            void SampleMaskCb(UINT sampleMask) override
+            {
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK, hash::fnv1a_value(sampleMask));
+            }
+            void ViewInstancingCb(const D3D12_VIEW_INSTANCING_DESC& viewInstancingDesc) override
+            {
+                u64 hash = hash::fnv1a_value(viewInstancingDesc.ViewInstanceCount);
+                if (viewInstancingDesc.ViewInstanceCount > 0)
+                {
+                    hash = hash::fnv1a(viewInstancingDesc.pViewInstanceLocations, viewInstancingDesc.ViewInstanceCount * sizeof(D3D12_VIEW_INSTANCE_LOCATION), hash);
+                }
+                hash = hash::fnv1a_value(viewInstancingDesc.Flags, hash);
+
+                store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VIEW_INSTANCING, hash);
+            }
+            void CachedPSOCb(const D3D12_CACHED_PIPELINE_STATE&) override
+            {
+                // A cached blob is an input to compilation, it does not change the identity of the pipeline state.
+            }
+
+            void ErrorBadInputParameter(UINT) override { m_valid = false; }
+            void ErrorDuplicateSubobject(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE) override { m_valid = false; }
+            void ErrorUnknownSubobject(UINT) override { m_valid = false; }
+
+        private:
+            void store(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type, u64 hash)
+            {
+                m_subobject_hashes[type] = hash;
+                m_subobject_seen[type] = true;
+            }
+
+            u64  m_subobject_hashes[D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MAX_VALID];
+            bool m_subobject_seen[D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MAX_VALID];
+            bool m_persistent;
+            bool m_valid;
+        };
+
+        u64 compute_device_id(device& device)
+        {
+            u64 device_id = hash::fnv1a_offset_basis;
+
+            DXGI_ADAPTER_DESC1 adapter_desc = {};
+            if (SUCCEEDED(device.get_dxgi_adapter()->GetDesc1(&adapter_desc)))
+            {
+                device_id = hash::fnv1a_value(adapter_desc.VendorId, device_id);
+                device_id = hash::fnv1a_value(adapter_desc.DeviceId, device_id);
+                device_id = hash::fnv1a_value(adapter_desc.SubSysId, device_id);
+                device_id = hash::fnv1a_value(adapter_desc.Revision, device_id);
+            }
+
+            LARGE_INTEGER driver_version = {};
+            if (SUCCEEDED(device.get_dxgi_adapter()->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driver_version)))
+            {
+                device_id = hash::fnv1a_value(driver_version.QuadPart, device_id);
+            }
+
+            return device_id;
+        }
+    }
+
+    pipeline_state_hash hash_pipeline_state_stream(const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+    {
+        // The normalized stream is hashed, absent subobjects hash as their defaults. A stream and
+        // its pipeline_state_stream_copy, which is what gets compiled and stored, have the same key.
+        CD3DX12_PIPELINE_STATE_STREAM_PARSE_HELPER parsed_stream;
+        internal::pipeline_state_stream_hasher hasher;
+
+        D3D12_PIPELINE_STATE_STREAM_DESC normalized_desc = { sizeof(parsed_stream.PipelineStream), &parsed_stream.PipelineStream };
+        if (FAILED(D3DX12ParsePipelineStream(desc, &parsed_stream)) || FAILED(D3DX12ParsePipelineStream(normalized_desc, &hasher)))
+        {
+            // An invalid stream can still be deduplicated on its raw bytes, it will fail to compile later.
+            pipeline_state_hash hash;
+            hash.value = hash::fnv1a(desc.pPipelineStateSubobjectStream, desc.SizeInBytes);
+            hash.persistent = false;
+            return hash;
+        }
+
+        return hasher.result();
+    }
+
+    pipeline_state_stream_copy::pipeline_state_stream_copy(const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+        : m_root_signature(nullptr)
+        , m_valid(false)
+    {
+        // The parse helper normalizes any stream layout into a CD3DX12_PIPELINE_STATE_STREAM1,
+        // only the memory referenced by that stream has to be copied.
+        if (FAILED(D3DX12ParsePipelineStream(desc, &m_parsed_stream)))
+        {
+            return;
+        }
+
+        CD3DX12_PIPELINE_STATE_STREAM1& stream = m_parsed_stream.PipelineStream;
+
+        m_root_signature = static_cast<ID3D12RootSignature*>(stream.pRootSignature);
+
+        copy_shader_bytecode(stream.VS);
+        copy_shader_bytecode(stream.PS);
+        copy_shader_bytecode(stream.DS);
+        copy_shader_bytecode(stream.HS);
+        copy_shader_bytecode(stream.GS);
+        copy_shader_bytecode(stream.CS);
+
+        D3D12_INPUT_LAYOUT_DESC& input_layout = stream.InputLayout;
+        if (input_layout.NumElements > 0)
+        {
+            m_input_elements.assign(input_layout.pInputElementDescs, input_layout.pInputElementDescs + input_layout.NumElements);
+            for (D3D12_INPUT_ELEMENT_DESC& element : m_input_elements)
+            {
+                element.SemanticName = copy_semantic_name(element.SemanticName);
+            }
+            input_layout.pInputElementDescs = m_input_elements.data();
+        }
+
+        D3D12_STREAM_OUTPUT_DESC& stream_output = stream.StreamOutput;
+        if (stream_output.NumEntries > 0)
+        {
+            m_stream_output_entries.assign(stream_output.pSODeclaration, stream_output.pSODeclaration + stream_output.NumEntries);
+            for (D3D12_SO_DECLARATION_ENTRY& entry : m_stream_output_entries)
+            {
+                entry.SemanticName = copy_semantic_name(entry.SemanticName);
+            }
+            stream_output.pSODeclaration = m_stream_output_entries.data();
+        }
+        if (stream_output.NumStrides > 0)
+        {
+            m_stream_output_strides.assign(stream_output.pBufferStrides, stream_output.pBufferStrides + stream_output.NumStrides);
+            stream_output.pBufferStrides = m_stream_output_strides.data();
+        }
+
+        D3D12_VIEW_INSTANCING_DESC& view_instancing = stream.ViewInstancingDesc;
+        if (view_instancing.ViewInstanceCount > 0)
+        {
+            m_view_instance_locations.assign(view_instancing.pViewInstanceLocations, view_instancing.pViewInstanceLocations + view_instancing.ViewInstanceCount);
+            view_instancing.pViewInstanceLocations = m_view_instance_locations.data();
+        }
+
+        // Cached blobs are only valid during the call that created the pipeline state, the library is used instead.
+        stream.CachedPSO = D3D12_CACHED_PIPELINE_STATE{ nullptr, 0 };
+
+        m_valid = true;
+    }
+
+    D3D12_PIPELINE_STATE_STREAM_DESC pipeline_state_stream_copy::get_desc()
+    {
+        return { sizeof(m_parsed_stream.PipelineStream), &m_parsed_stream.PipelineStream };
+    }
+
+    bool pipeline_state_stream_copy::is_valid() const
+    {
+        return m_valid;
+    }
+
+    void pipeline_state_stream_copy::copy_shader_bytecode(D3D12_SHADER_BYTECODE& bytecode)
+    {
+        if (bytecode.pShaderBytecode == nullptr || bytecode.BytecodeLength == 0)
+        {
+            return;
+        }
+
+        const std::byte* src = static_cast<const std::byte*>(bytecode.pShaderBytecode);
+        blob& copy = m_shader_bytecode.emplace_back(src, src + bytecode.BytecodeLength);
+
+        bytecode.pShaderBytecode = copy.data();
+    }
+
+    const char* pipeline_state_stream_copy::copy_semantic_name(const char* semanticName)
+    {
+        if (semanticName == nullptr)
+        {
+            return nullptr;
+        }
+
+        // A deque never moves its elements when growing, the returned pointer stays valid.
+        return m_semantic_names.emplace_back(semanticName).c_str();
+    }
+
+    pipeline_state_cache::pipeline_state_cache(device& device)
+        : m_device(device)
+        , m_device_id(internal::compute_device_id(device))
+        , m_pipeline_library_dirty(false)
+        , m_num_library_hits(0)
+        , m_num_compilations(0)
+    {
+        create_pipeline_library({});
+    }
+
+    pipeline_state_cache::~pipeline_state_cache() = default;
+
+    std::shared_ptr<pipeline_state_object> pipeline_state_cache::find(u64 hash) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_pipeline_states.find(hash);
+        return it != m_pipeline_states.end() ? it->second : nullptr;
+    }
+
+    std::shared_ptr<pipeline_state_object> pipeline_state_cache::insert(u64 hash, const std::shared_ptr<pipeline_state_object>& pipelineState)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto result = m_pipeline_states.emplace(hash, pipelineState);
+        return result.first->second;
+    }
+
+    void pipeline_state_cache::remove(u64 hash, const std::shared_ptr<pipeline_state_object>& pipelineState)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_pipeline_states.find(hash);
+        if (it != m_pipeline_states.end() && it->second == pipelineState)
+        {
+            m_pipeline_states.erase(it);
+        }
+    }
+
+    wrl::ComPtr<ID3D12PipelineState> pipeline_state_cache::load_or_create(const pipeline_state_hash& hash, pipeline_state_stream_copy& stream)
+    {
+        wrl::ComPtr<ID3D12PipelineState> d3d_pipeline_state;
+
+        // LoadPipeline only succeeds with the description the pipeline state was stored with,
+        // the normalized stream is used for compiling, storing and loading.
+        D3D12_PIPELINE_STATE_STREAM_DESC desc = stream.get_desc();
+
+        std::wstring name = get_pipeline_name(hash.value);
+
+        if (hash.persistent)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_pipeline_library && m_pipeline_library_entries.count(hash.value) > 0)
+            {
+                if (SUCCEEDED(m_pipeline_library->LoadPipeline(name.c_str(), &desc, IID_PPV_ARGS(&d3d_pipeline_state))))
+                {
+                    ++m_num_library_hits;
+                    return d3d_pipeline_state;
+                }
+
+                // The stored pipeline no longer matches the description, it will be recompiled.
+                log::warn("Failed to load pipeline state {0:016x} from the pipeline library", hash.value);
+            }
+        }
+
+        // Compilation is done without holding the lock, other threads can keep using the cache.
+        auto d3d_device = m_device.get_d3d_device();
+        if (DX_FAILED(d3d_device->CreatePipelineState(&desc, IID_PPV_ARGS(&d3d_pipeline_state))))
+        {
+            log::error("Failed to CreatePipelineState");
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        ++m_num_compilations;
+
+        if (hash.persistent && m_pipeline_library && m_pipeline_library_entries.count(hash.value) == 0)
+        {
+            if (SUCCEEDED(m_pipeline_library->StorePipeline(name.c_str(), d3d_pipeline_state.Get())))
+            {
+                m_pipeline_library_entries.insert(hash.value);
+                m_pipeline_library_dirty = true;
+            }
+        }
+
+        return d3d_pipeline_state;
+    }
+
+    bool pipeline_state_cache::load_from_disk(const std::wstring& path)
+    {
+        pipeline_state_cache_file file;
+        if (!pipeline_state_cache_io::load(path, file))
+        {
+            log::info("No valid pipeline state cache found on disk, starting with an empty cache");
+            return false;
+        }
+
+        if (file.device_id != m_device_id)
+        {
+            log::info("Pipeline state cache was created with a different adapter or driver, starting with an empty cache");
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!create_pipeline_library(file.library))
+        {
+            // Fall back to an empty library, the data on disk will be replaced on the next save.
+            create_pipeline_library({});
+            return false;
+        }
+
+        m_pipeline_library_entries.clear();
+        m_pipeline_library_entries.insert(file.entries.begin(), file.entries.end());
+        m_pipeline_library_dirty = false;
+
+        log::info("Loaded {0} pipeline states from the pipeline state cache", file.entries.size());
+
+        return true;
+    }
+
+    bool pipeline_state_cache::save_to_disk(const std::wstring& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_pipeline_library || !m_pipeline_library_dirty)
+        {
+            return true;
+        }
+
+        pipeline_state_cache_file file;
+        file.device_id = m_device_id;
+        file.entries.assign(m_pipeline_library_entries.begin(), m_pipeline_library_entries.end());
+        file.library.resize(m_pipeline_library->GetSerializedSize());
+
+        if (DX_FAILED(m_pipeline_library->Serialize(file.library.data(), file.library.size())))
+        {
+            log::error("Failed to serialize the pipeline library");
+            return false;
+        }
+
+        if (!pipeline_state_cache_io::save(path, file))
+        {
+            log::error("Failed to write the pipeline state cache to disk");
+            return false;
+        }
+
+        m_pipeline_library_dirty = false;
+
+        return true;
+    }
+
+    u64 pipeline_state_cache::get_num_library_hits() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_num_library_hits;
+    }
+
+    u64 pipeline_state_cache::get_num_compilations() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_num_compilations;
+    }
+
+    bool pipeline_state_cache::create_pipeline_library(const blob& data)
+    {
+        wrl::ComPtr<ID3D12Device1> d3d_device1;
+        if (FAILED(m_device.get_d3d_device()->QueryInterface(IID_PPV_ARGS(&d3d_device1))))
+        {
+            return false;
+        }
+
+        // Keep the data alive for as long as the library exists.
+        blob library_data = data;
+
+        wrl::ComPtr<ID3D12PipelineLibrary1> pipeline_library;
+        HRESULT hr = d3d_device1->CreatePipelineLibrary(library_data.empty() ? nullptr : library_data.data(), library_data.size(), IID_PPV_ARGS(&pipeline_library));
+
+        if (FAILED(hr))
+        {
+            switch (hr)
+            {
+            case DXGI_ERROR_UNSUPPORTED:
+                log::warn("Pipeline libraries are not supported, pipeline states will not be persisted");
+                break;
+            case D3D12_ERROR_ADAPTER_NOT_FOUND:
+            case D3D12_ERROR_DRIVER_VERSION_MISMATCH:
+                log::info("Pipeline library was created with a different adapter or driver");
+                break;
+            default:
+                log::error("Failed to CreatePipelineLibrary");
+                break;
+            }
+
+            return false;
+        }
+
+        m_pipeline_library = pipeline_library;
+        m_pipeline_library_data = std::move(library_data);
+        m_pipeline_library_entries.clear();
+
+        return true;
+    }
+
+    std::wstring pipeline_state_cache::get_pipeline_name(u64 hash)
+    {
+        wchar_t name[32];
+        swprintf(name, sizeof(name) / sizeof(name[0]), L"pso_%016llx", static_cast<unsigned long long>(hash));
+
+        return name;
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "device/windows_types.h"
+
+#include "render/d3dx12_declarations.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace cera
+{
+    class device;
+    class pipeline_state_object;
+
+    /**
+     * Result of hashing a pipeline state stream.
+     */
+    struct pipeline_state_hash
+    {
+        u64 value = 0;
+
+        // A hash is persistent when it only depends on the content of the stream.
+        // Streams that reference a root signature that was not created through a
+        // cera::root_signature fall back to hashing the root signature pointer, these
+        // hashes are only valid for the lifetime of the process and are never written to disk.
+        bool persistent = true;
+    };
+
+    /**
+     * Compute a stable hash of a pipeline state stream.
+     * Pointers in the stream are followed, shader bytecode, input layouts and stream output
+     * declarations are hashed by content. The order of the subobjects in the stream does not
+     * influence the result, and absent subobjects hash the same as their default values.
+     */
+    pipeline_state_hash hash_pipeline_state_stream(const D3D12_PIPELINE_STATE_STREAM_DESC& desc);
+
+    /**
+     * Owning copy of a pipeline state stream.
+     * Pipeline state streams reference memory owned by the caller (shader bytecode, input layouts, ...).
+     * Background compilation outlives the caller so all referenced memory is copied.
+     */
+    class pipeline_state_stream_copy
+    {
+    public:
+        explicit pipeline_state_stream_copy(const D3D12_PIPELINE_STATE_STREAM_DESC& desc);
+
+        pipeline_state_stream_copy(const pipeline_state_stream_copy&) = delete;
+        pipeline_state_stream_copy& operator=(const pipeline_state_stream_copy&) = delete;
+
+        /**
+         * Get a description of the copied stream.
+         * The description stays valid for the lifetime of this object.
+         */
+        D3D12_PIPELINE_STATE_STREAM_DESC get_desc();
+
+        /**
+         * False when the source stream could not be parsed.
+         */
+        bool is_valid() const;
+
+    private:
+        void copy_shader_bytecode(D3D12_SHADER_BYTECODE& bytecode);
+        const char* copy_semantic_name(const char* semanticName);
+
+    private:
+        CD3DX12_PIPELINE_STATE_STREAM_PARSE_HELPER m_parsed_stream;
+
+        // Keeps the root signature alive until compilation has finished.
+        wrl::ComPtr<ID3D12RootSignature> m_root_signature;
+
+        std::vector<blob> m_shader_bytecode;
+        std::deque<std::string> m_semantic_names;
+        std::vector<D3D12_INPUT_ELEMENT_DESC> m_input_elements;
+        std::vector<D3D12_SO_DECLARATION_ENTRY> m_stream_output_entries;
+        std::vector<UINT> m_stream_output_strides;
+        std::vector<D3D12_VIEW_INSTANCE_LOCATION> m_view_instance_locations;
+
+        bool m_valid;
+    };
+
+    /**
+     * Device level cache of pipeline state objects.
+     *
+     * Identical pipeline state streams result in the same pipeline_state_object instance.
+     * Compiled pipeline states are stored in an ID3D12PipelineLibrary which can be
+     * serialized to disk and loaded again at startup to skip driver compilation.
+     */
+    class pipeline_state_cache
+    {
+    public:
+        explicit pipeline_state_cache(device& device);
+        ~pipeline_state_cache();
+
+        /**
+         * Find a previously created pipeline state object.
+         * @returns nullptr when the pipeline state was never created.
+         */
+        std::shared_ptr<pipeline_state_object> find(u64 hash) const;
+
+        /**
+         * Register a created pipeline state object.
+         * When another thread registered a pipeline state with the same hash first,
+         * that instance is returned instead.
+         */
+        std::shared_ptr<pipeline_state_object> insert(u64 hash, const std::shared_ptr<pipeline_state_object>& pipelineState);
+
+        /**
+         * Unregister a pipeline state object, used to evict pipeline states that failed to compile
+         * so the next request compiles them again. Nothing happens when another instance is registered with the hash.
+         */
+        void remove(u64 hash, const std::shared_ptr<pipeline_state_object>& pipelineState);
+
+        /**
+         * Load the pipeline state from the pipeline library or compile it when
+         * the library does not contain it yet. Newly compiled persistent pipeline states
+         * are added to the library.
+         * The library is always accessed with the normalized stream of the copy.
+         */
+        wrl::ComPtr<ID3D12PipelineState> load_or_create(const pipeline_state_hash& hash, pipeline_state_stream_copy& stream);
+
+        /**
+         * Load a previously saved pipeline library.
+         * Libraries saved with a different adapter or driver are discarded.
+         */
+        bool load_from_disk(const std::wstring& path);
+
+        /**
+         * Save the pipeline library to disk.
+         * Nothing is written when no pipeline states were added since the last load or save.
+         */
+        bool save_to_disk(const std::wstring& path);
+
+        /**
+         * Number of pipeline states that were loaded from the pipeline library instead of compiled.
+         */
+        u64 get_num_library_hits() const;
+
+        /**
+         * Number of pipeline states that had to be compiled.
+         */
+        u64 get_num_compilations() const;
+
+    private:
+        // Create an empty library or a library from previously serialized data.
+        bool create_pipeline_library(const blob& data);
+
+        static std::wstring get_pipeline_name(u64 hash);
+
+    private:
+        device& m_device;
+
+        // Identifies the adapter and driver, used to validate the pipeline library on disk.
+        u64 m_device_id;
+
+        mutable std::mutex m_mutex;
+
+        std::unordered_map<u64, std::shared_ptr<pipeline_state_object>> m_pipeline_states;
+
+        // The pipeline library references the memory it was created from.
+        // This data must outlive the library.
+        blob m_pipeline_library_data;
+        wrl::ComPtr<ID3D12PipelineLibrary1> m_pipeline_library;
+        std::unordered_set<u64> m_pipeline_library_entries;
+        bool m_pipeline_library_dirty;
+
+        u64 m_num_library_hits;
+        u64 m_num_compilations;
+    };
+}
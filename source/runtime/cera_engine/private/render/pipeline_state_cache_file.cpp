@@ -0,0 +1,137 @@
+#include "render/pipeline_state_cache_file.h"
+
+#include "util/hash.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace cera
+{
+    namespace pipeline_state_cache_io
+    {
+        namespace internal
+        {
+            u64 compute_checksum(const pipeline_state_cache_file& file)
+            {
+                u64 checksum = hash::fnv1a_value(file.device_id);
+                checksum = hash::fnv1a(file.entries.data(), file.entries.size() * sizeof(u64), checksum);
+                checksum = hash::fnv1a(file.library.data(), file.library.size(), checksum);
+
+                return checksum;
+            }
+        }
+
+        blob serialize(const pipeline_state_cache_file& file)
+        {
+            pipeline_state_cache_file::header header = {};
+            header.magic = pipeline_state_cache_file::magic;
+            header.version = pipeline_state_cache_file::version;
+            header.device_id = file.device_id;
+            header.entry_count = file.entries.size();
+            header.library_size = file.library.size();
+            header.checksum = internal::compute_checksum(file);
+
+            size_t entries_size = file.entries.size() * sizeof(u64);
+
+            blob data(sizeof(header) + entries_size + file.library.size());
+
+            std::byte* dst = data.data();
+            memcpy(dst, &header, sizeof(header));
+            dst += sizeof(header);
+            memcpy(dst, file.entries.data(), entries_size);
+            dst += entries_size;
+            memcpy(dst, file.library.data(), file.library.size());
+
+            return data;
+        }
+
+        bool deserialize(const blob& data, pipeline_state_cache_file& file)
+        {
+            pipeline_state_cache_file::header header;
+            if (data.size() < sizeof(header))
+            {
+                return false;
+            }
+
+            memcpy(&header, data.data(), sizeof(header));
+
+            if (header.magic != pipeline_state_cache_file::magic || header.version != pipeline_state_cache_file::version)
+            {
+                return false;
+            }
+
+            // Guard against overflow before validating the total size.
+            u64 remaining = data.size() - sizeof(header);
+            if (header.entry_count > remaining / sizeof(u64))
+            {
+                return false;
+            }
+
+            u64 entries_size = header.entry_count * sizeof(u64);
+            if (remaining - entries_size != header.library_size)
+            {
+                return false;
+            }
+
+            pipeline_state_cache_file result;
+            result.device_id = header.device_id;
+            result.entries.resize(header.entry_count);
+            result.library.resize(header.library_size);
+
+            const std::byte* src = data.data() + sizeof(header);
+            memcpy(result.entries.data(), src, entries_size);
+            src += entries_size;
+            memcpy(result.library.data(), src, header.library_size);
+
+            if (internal::compute_checksum(result) != header.checksum)
+            {
+                return false;
+            }
+
+            file = std::move(result);
+
+            return true;
+        }
+
+        bool save(const std::wstring& path, const pipeline_state_cache_file& file)
+        {
+            blob data = serialize(file);
+
+            std::ofstream stream(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+            if (!stream)
+            {
+                return false;
+            }
+
+            stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+            return stream.good();
+        }
+
+        bool load(const std::wstring& path, pipeline_state_cache_file& file)
+        {
+            std::ifstream stream(std::filesystem::path(path), std::ios::binary | std::ios::ate);
+            if (!stream)
+            {
+                return false;
+            }
+
+            std::streamsize size = stream.tellg();
+            if (size <= 0)
+            {
+                return false;
+            }
+
+            blob data(static_cast<size_t>(size));
+
+            stream.seekg(0, std::ios::beg);
+            if (!stream.read(reinterpret_cast<char*>(data.data()), size))
+            {
+                return false;
+            }
+
+            return deserialize(data, file);
+        }
+    }
+}
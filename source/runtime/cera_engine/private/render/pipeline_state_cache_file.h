@@ -0,0 +1,71 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <string>
+#include <vector>
+
+namespace cera
+{
+    /**
+     * On-disk representation of the pipeline state cache.
+     *
+     * This structure does not depend on any D3D12 type so it can be written, read and validated
+     * on any platform. The library blob is whatever ID3D12PipelineLibrary::Serialize produced and
+     * is treated as opaque data.
+     *
+     * Layout (little endian):
+     *   header                      (see pipeline_state_cache_file::header)
+     *   u64   entries[entry_count]  (pipeline state hashes stored in the library)
+     *   u8    library[library_size] (serialized pipeline library)
+     */
+    struct pipeline_state_cache_file
+    {
+        static constexpr u32 magic = 0x4f535043; // 'CPSO'
+        // Bump the version when the pipeline state keys change, caches of older versions are rejected.
+        static constexpr u32 version = 2;
+
+        struct header
+        {
+            u32 magic;
+            u32 version;
+            u64 device_id;
+            u64 entry_count;
+            u64 library_size;
+            u64 checksum;
+        };
+
+        // Identifies the adapter and driver that produced the library.
+        // A pipeline library can only be used with the exact same adapter and driver.
+        u64 device_id = 0;
+        // Hashes of the pipeline states that are stored in the library.
+        std::vector<u64> entries;
+        // The serialized pipeline library.
+        blob library;
+    };
+
+    namespace pipeline_state_cache_io
+    {
+        /**
+         * Convert the cache to a contiguous block of memory.
+         */
+        blob serialize(const pipeline_state_cache_file& file);
+
+        /**
+         * Read the cache from a contiguous block of memory.
+         * @returns false when the data is truncated, corrupt or was written by a different version.
+         */
+        bool deserialize(const blob& data, pipeline_state_cache_file& file);
+
+        /**
+         * Write the cache to disk.
+         */
+        bool save(const std::wstring& path, const pipeline_state_cache_file& file);
+
+        /**
+         * Load the cache from disk.
+         * @returns false when the file does not exist or could not be deserialized.
+         */
+        bool load(const std::wstring& path, pipeline_state_cache_file& file);
+    }
+}
@@ -3,20 +3,81 @@
 
 namespace cera
 {
-    pipeline_state_object::pipeline_state_object(device& device, const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+    pipeline_state_object::pipeline_state_object(device& device, Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState, u64 hash)
         : m_device(device)
+        , m_d3d_pipeline_state_object(pipelineState)
+        , m_hash(hash)
+        , m_fallback(nullptr)
+        , m_compile_state(compile_state::ready)
     {
-        auto d3d_device = device.get_d3d_device();
-
-        auto hr = d3d_device->CreatePipelineState(&desc, IID_PPV_ARGS(&m_d3d_pipeline_state_object));
-
-        assert(SUCCEEDED(hr));
+        assert(m_d3d_pipeline_state_object);
     }
 
+    pipeline_state_object::pipeline_state_object(device& device, u64 hash, const std::shared_ptr<pipeline_state_object>& fallback)
+        : m_device(device)
+        , m_d3d_pipeline_state_object(nullptr)
+        , m_hash(hash)
+        , m_fallback(fallback)
+        , m_compile_state(compile_state::pending)
+    {}
+
     pipeline_state_object::~pipeline_state_object() = default;
 
     Microsoft::WRL::ComPtr<ID3D12PipelineState> pipeline_state_object::get_d3d_pipeline_state_object() const
     {
-        return m_d3d_pipeline_state_object;
+        return is_ready() ? m_d3d_pipeline_state_object : nullptr;
+    }
+
+    u64 pipeline_state_object::get_hash() const
+    {
+        return m_hash;
+    }
+
+    bool pipeline_state_object::is_ready() const
+    {
+        return m_compile_state.load(std::memory_order_acquire) == compile_state::ready;
+    }
+
+    bool pipeline_state_object::has_failed() const
+    {
+        return m_compile_state.load(std::memory_order_acquire) == compile_state::failed;
+    }
+
+    void pipeline_state_object::wait() const
+    {
+        if (m_compile_state.load(std::memory_order_acquire) != compile_state::pending)
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_compile_mutex);
+        m_compile_cv.wait(lock, [this]() { return m_compile_state.load(std::memory_order_acquire) != compile_state::pending; });
+    }
+
+    const std::shared_ptr<pipeline_state_object>& pipeline_state_object::get_fallback() const
+    {
+        return m_fallback;
+    }
+
+    const pipeline_state_object* pipeline_state_object::get_bindable_pipeline_state() const
+    {
+        if (is_ready())
+        {
+            return this;
+        }
+
+        return m_fallback ? m_fallback->get_bindable_pipeline_state() : nullptr;
+    }
+
+    void pipeline_state_object::complete(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_compile_mutex);
+
+            m_d3d_pipeline_state_object = pipelineState;
+            m_compile_state.store(pipelineState ? compile_state::ready : compile_state::failed, std::memory_order_release);
+        }
+
+        m_compile_cv.notify_all();
     }
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "render/procedural_mesh_cache.h"
+
+#include "mesh.h"
+
+namespace cera
+{
+    std::shared_ptr<mesh> procedural_mesh_cache::get_mesh(const std::shared_ptr<command_list>& commandList, const procedural_mesh_desc& desc)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_meshes.find(desc);
+            if (it != m_meshes.end())
+            {
+                ++m_num_hits;
+                return it->second;
+            }
+
+            ++m_num_misses;
+        }
+
+        // Meshes are created without holding the lock, other threads keep hitting the cache meanwhile.
+        std::shared_ptr<mesh> new_mesh = mesh_factory::create_mesh(commandList, desc);
+        if (!new_mesh)
+        {
+            return nullptr;
+        }
+
+        // When another thread created the same shape first, that mesh is returned instead.
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto result = m_meshes.emplace(desc, new_mesh);
+        return result.first->second;
+    }
+
+    void procedural_mesh_cache::get_meshes(const std::shared_ptr<command_list>& commandList, const std::vector<procedural_mesh_desc>& descs, std::vector<std::shared_ptr<mesh>>& meshes)
+    {
+        meshes.assign(descs.size(), nullptr);
+
+        std::vector<size_t> missing;
+        std::vector<procedural_mesh_desc> missing_descs;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            for (size_t i = 0; i < descs.size(); ++i)
+            {
+                auto it = m_meshes.find(descs[i]);
+                if (it != m_meshes.end())
+                {
+                    ++m_num_hits;
+                    meshes[i] = it->second;
+                    continue;
+                }
+
+                ++m_num_misses;
+                missing.push_back(i);
+                missing_descs.push_back(descs[i]);
+            }
+        }
+
+        if (missing.empty())
+        {
+            return;
+        }
+
+        // Equal missing descriptions are deduplicated by the factory, they receive the same mesh.
+        std::vector<std::shared_ptr<mesh>> new_meshes;
+        mesh_factory::create_meshes(commandList, missing_descs, new_meshes);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (size_t i = 0; i < missing.size(); ++i)
+        {
+            if (!new_meshes[i])
+            {
+                continue;
+            }
+
+            auto result = m_meshes.emplace(missing_descs[i], new_meshes[i]);
+            meshes[missing[i]] = result.first->second;
+        }
+    }
+
+    void procedural_mesh_cache::clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_meshes.clear();
+    }
+
+    size_t procedural_mesh_cache::size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_meshes.size();
+    }
+
+    u64 procedural_mesh_cache::get_num_hits() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_num_hits;
+    }
+
+    u64 procedural_mesh_cache::get_num_misses() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_num_misses;
+    }
+}
\ No newline at end of file
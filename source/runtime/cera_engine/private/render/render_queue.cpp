@@ -0,0 +1,272 @@
+#include "render/render_queue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace cera
+{
+    namespace sort_key
+    {
+        namespace internal
+        {
+            constexpr u64 field_mask(u32 bits)
+            {
+                return (1ull << bits) - 1;
+            }
+        }
+
+        u32 quantize_depth(float viewDepth)
+        {
+            // Also catches NaN.
+            if (!(viewDepth > 0.0f))
+            {
+                return 0;
+            }
+
+            u32 bits;
+            memcpy(&bits, &viewDepth, sizeof(bits));
+
+            // The sign bit is always 0, keep the exponent and the most significant mantissa bits.
+            return bits >> (31 - depth_bits);
+        }
+
+        u64 make(u32 pass, u32 rootSignature, u32 pipelineState, u32 material, float viewDepth)
+        {
+            u64 key = 0;
+            key |= (pass & internal::field_mask(pass_bits)) << pass_shift;
+            key |= (rootSignature & internal::field_mask(root_signature_bits)) << root_signature_shift;
+            key |= (pipelineState & internal::field_mask(pipeline_state_bits)) << pipeline_state_shift;
+            key |= (material & internal::field_mask(material_bits)) << material_shift;
+            key |= static_cast<u64>(quantize_depth(viewDepth)) << depth_shift;
+
+            return key;
+        }
+
+        u32 get_pass(u64 key)
+        {
+            return static_cast<u32>((key >> pass_shift) & internal::field_mask(pass_bits));
+        }
+
+        u32 get_root_signature(u64 key)
+        {
+            return static_cast<u32>((key >> root_signature_shift) & internal::field_mask(root_signature_bits));
+        }
+
+        u32 get_pipeline_state(u64 key)
+        {
+            return static_cast<u32>((key >> pipeline_state_shift) & internal::field_mask(pipeline_state_bits));
+        }
+
+        u32 get_material(u64 key)
+        {
+            return static_cast<u32>((key >> material_shift) & internal::field_mask(material_bits));
+        }
+
+        u64 set_material(u64 key, u32 material)
+        {
+            key &= ~(internal::field_mask(material_bits) << material_shift);
+            key |= (material & internal::field_mask(material_bits)) << material_shift;
+
+            return key;
+        }
+
+        u32 get_lod(u64 key)
+        {
+            return static_cast<u32>((key >> lod_shift) & internal::field_mask(lod_bits));
+        }
+
+        u64 set_lod(u64 key, u32 lod)
+        {
+            u64 clamped = std::min(static_cast<u64>(lod), internal::field_mask(lod_bits));
+
+            key &= ~(internal::field_mask(lod_bits) << lod_shift);
+            key |= clamped << lod_shift;
+
+            return key;
+        }
+    }
+
+    void render_queue::clear()
+    {
+        m_packets.clear();
+        m_sort_entries.clear();
+    }
+
+    void render_queue::submit(u64 sortKey, const draw_packet& packet)
+    {
+        m_sort_entries.push_back({ sortKey, static_cast<u32>(m_packets.size()) });
+        m_packets.push_back(packet);
+    }
+
+    void render_queue::sort()
+    {
+        m_stats.num_packets = static_cast<u32>(m_sort_entries.size());
+        m_stats.num_state_changes_unsorted = count_state_changes(m_sort_entries);
+
+        radix_sort(m_sort_entries, m_sort_scratch);
+
+        m_stats.num_state_changes_sorted = count_state_changes(m_sort_entries);
+    }
+
+    void render_queue::cull(const std::vector<u8>& visibility)
+    {
+        assert(visibility.size() == m_packets.size());
+
+        // Packets stay in place, only their sort entries are removed.
+        auto new_end = std::remove_if(m_sort_entries.begin(), m_sort_entries.end(), [&visibility](const sort_entry& entry)
+        {
+            return visibility[entry.packet_index] == 0;
+        });
+
+        m_sort_entries.erase(new_end, m_sort_entries.end());
+    }
+
+    size_t render_queue::size() const
+    {
+        return m_sort_entries.size();
+    }
+
+    bool render_queue::empty() const
+    {
+        return m_sort_entries.empty();
+    }
+
+    u64 render_queue::get_sort_key(size_t index) const
+    {
+        assert(index < m_sort_entries.size());
+        return m_sort_entries[index].key;
+    }
+
+    const draw_packet& render_queue::get_packet(size_t index) const
+    {
+        assert(index < m_sort_entries.size());
+        return m_packets[m_sort_entries[index].packet_index];
+    }
+
+    draw_packet& render_queue::get_packet(size_t index)
+    {
+        assert(index < m_sort_entries.size());
+        return m_packets[m_sort_entries[index].packet_index];
+    }
+
+    void render_queue::set_sort_key(size_t index, u64 sortKey)
+    {
+        assert(index < m_sort_entries.size());
+        m_sort_entries[index].key = sortKey;
+    }
+
+    void render_queue::build_instance_batches(std::vector<instance_batch>& batches) const
+    {
+        batches.clear();
+
+        size_t num_packets = m_sort_entries.size();
+        for (size_t begin = 0; begin < num_packets;)
+        {
+            const draw_packet& first = get_packet(begin);
+            u64 batch_state = m_sort_entries[begin].key & sort_key::state_mask;
+
+            size_t end = begin + 1;
+            while (end < num_packets
+                && get_packet(end).mesh == first.mesh
+                && get_packet(end).lod == first.lod
+                && (m_sort_entries[end].key & sort_key::state_mask) == batch_state)
+            {
+                ++end;
+            }
+
+            instance_batch batch;
+            batch.mesh = first.mesh;
+            batch.lod = first.lod;
+            batch.start_instance = static_cast<u32>(begin);
+            batch.instance_count = static_cast<u32>(end - begin);
+            batches.push_back(batch);
+
+            begin = end;
+        }
+    }
+
+    const render_queue_stats& render_queue::get_stats() const
+    {
+        return m_stats;
+    }
+
+    void render_queue::radix_sort(std::vector<sort_entry>& entries, std::vector<sort_entry>& scratch)
+    {
+        constexpr u32 digit_bits = 8;
+        constexpr u32 num_digits = 64 / digit_bits;
+        constexpr u32 num_buckets = 1 << digit_bits;
+
+        size_t count = entries.size();
+        if (count < 2)
+        {
+            return;
+        }
+
+        // Build the histograms of all digits in a single pass over the keys.
+        std::vector<u32> histograms(num_digits * num_buckets, 0);
+        for (const sort_entry& entry : entries)
+        {
+            for (u32 digit = 0; digit < num_digits; ++digit)
+            {
+                u32 bucket = static_cast<u32>((entry.key >> (digit * digit_bits)) & (num_buckets - 1));
+                ++histograms[digit * num_buckets + bucket];
+            }
+        }
+
+        scratch.resize(count);
+
+        sort_entry* src = entries.data();
+        sort_entry* dst = scratch.data();
+
+        for (u32 digit = 0; digit < num_digits; ++digit)
+        {
+            u32* histogram = histograms.data() + digit * num_buckets;
+
+            // All keys share this digit, the pass would not change the order.
+            u32 first_bucket = static_cast<u32>(src[0].key >> (digit * digit_bits)) & (num_buckets - 1);
+            if (histogram[first_bucket] == count)
+            {
+                continue;
+            }
+
+            // Convert the counts to offsets.
+            u32 offset = 0;
+            for (u32 bucket = 0; bucket < num_buckets; ++bucket)
+            {
+                u32 bucket_count = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucket_count;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                u32 bucket = static_cast<u32>((src[i].key >> (digit * digit_bits)) & (num_buckets - 1));
+                dst[histogram[bucket]++] = src[i];
+            }
+
+            std::swap(src, dst);
+        }
+
+        // An odd number of passes leaves the result in the scratch buffer.
+        if (src != entries.data())
+        {
+            entries.swap(scratch);
+        }
+    }
+
+    u32 render_queue::count_state_changes(const std::vector<sort_entry>& entries)
+    {
+        u32 num_state_changes = 0;
+
+        for (size_t i = 1; i < entries.size(); ++i)
+        {
+            if ((entries[i].key & sort_key::state_mask) != (entries[i - 1].key & sort_key::state_mask))
+            {
+                ++num_state_changes;
+            }
+        }
+
+        return num_state_changes;
+    }
+}
\ No newline at end of file
@@ -2,16 +2,137 @@
 #include "render/device.h"
 #include "render/d3dx12_call.h"
 
+#include "util/hash.h"
 #include "util/log.h"
 
+#include <cassert>
+
 namespace cera
 {
+    namespace internal
+    {
+        // Identifies the hash that is attached to an ID3D12RootSignature as private data.
+        // {5B8D6A3E-2F4C-4E91-9B7A-1C3D5E7F9A21}
+        static const GUID root_signature_hash_guid = { 0x5b8d6a3e, 0x2f4c, 0x4e91, { 0x9b, 0x7a, 0x1c, 0x3d, 0x5e, 0x7f, 0x9a, 0x21 } };
+
+        u64 hash_descriptor_ranges(const D3D12_ROOT_DESCRIPTOR_TABLE1& descriptorTable, u64 seed)
+        {
+            u64 hash = hash::fnv1a_value(descriptorTable.NumDescriptorRanges, seed);
+
+            // Appended ranges are hashed with their resolved offset, both ways of describing
+            // the same table result in the same layout.
+            u32 offset = 0;
+            for (u32 i = 0; i < descriptorTable.NumDescriptorRanges; ++i)
+            {
+                const D3D12_DESCRIPTOR_RANGE1& range = descriptorTable.pDescriptorRanges[i];
+
+                if (range.OffsetInDescriptorsFromTableStart != D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND)
+                {
+                    offset = range.OffsetInDescriptorsFromTableStart;
+                }
+
+                hash = hash::fnv1a_value(range.RangeType, hash);
+                hash = hash::fnv1a_value(range.NumDescriptors, hash);
+                hash = hash::fnv1a_value(range.BaseShaderRegister, hash);
+                hash = hash::fnv1a_value(range.RegisterSpace, hash);
+                hash = hash::fnv1a_value(range.Flags, hash);
+                hash = hash::fnv1a_value(offset, hash);
+
+                // Unbounded ranges can only be the last range of a table.
+                offset = range.NumDescriptors != UINT_MAX
+                    ? offset + range.NumDescriptors
+                    : offset;
+            }
+
+            return hash;
+        }
+
+        u64 hash_root_signature_desc(const D3D12_ROOT_SIGNATURE_DESC1& desc)
+        {
+            u64 hash = hash::fnv1a_value(desc.NumParameters);
+
+            for (u32 i = 0; i < desc.NumParameters; ++i)
+            {
+                const D3D12_ROOT_PARAMETER1& root_parameter = desc.pParameters[i];
+
+                hash = hash::fnv1a_value(root_parameter.ParameterType, hash);
+                hash = hash::fnv1a_value(root_parameter.ShaderVisibility, hash);
+
+                switch (root_parameter.ParameterType)
+                {
+                case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+                    hash = hash_descriptor_ranges(root_parameter.DescriptorTable, hash);
+                    break;
+                case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+                    hash = hash::fnv1a_value(root_parameter.Constants, hash);
+                    break;
+                default:
+                    hash = hash::fnv1a_value(root_parameter.Descriptor, hash);
+                    break;
+                }
+            }
+
+            hash = hash::fnv1a_value(desc.NumStaticSamplers, hash);
+            hash = hash::fnv1a(desc.pStaticSamplers, sizeof(D3D12_STATIC_SAMPLER_DESC) * desc.NumStaticSamplers, hash);
+            hash = hash::fnv1a_value(desc.Flags, hash);
+
+            return hash;
+        }
+
+        root_signature_layout compute_root_signature_layout(const D3D12_ROOT_SIGNATURE_DESC1& desc)
+        {
+            root_signature_layout layout = {};
+
+            for (u32 i = 0; i < desc.NumParameters; ++i)
+            {
+                const D3D12_ROOT_PARAMETER1& root_parameter = desc.pParameters[i];
+                if (root_parameter.ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE || root_parameter.DescriptorTable.NumDescriptorRanges == 0)
+                {
+                    continue;
+                }
+
+                // Root constants and root descriptors may follow, only tables need a bit in the 32-bit masks.
+                if (i >= root_signature_layout::max_descriptor_tables)
+                {
+                    assert(false && "Only the first 32 root parameters can be descriptor tables.");
+                    log::error("Root parameter {0} is a descriptor table, only the first {1} root parameters can be descriptor tables", i, root_signature_layout::max_descriptor_tables);
+                    continue;
+                }
+
+                const D3D12_ROOT_DESCRIPTOR_TABLE1& descriptor_table = root_parameter.DescriptorTable;
+
+                // The type of descriptor table is determined by the first range.
+                D3D12_DESCRIPTOR_HEAP_TYPE heap_type = descriptor_table.pDescriptorRanges[0].RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER
+                    ? D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER
+                    : D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+
+                // Count the number of descriptors in the descriptor table.
+                u32 num_descriptors = 0;
+                for (u32 j = 0; j < descriptor_table.NumDescriptorRanges; ++j)
+                {
+                    num_descriptors += descriptor_table.pDescriptorRanges[j].NumDescriptors;
+                }
+
+                layout.descriptor_table_bit_mask[heap_type] |= (1u << i);
+                layout.num_descriptors_per_table[i] = num_descriptors;
+                layout.descriptor_table_offset[i] = layout.num_descriptors[heap_type];
+                layout.num_descriptors[heap_type] += num_descriptors;
+            }
+
+            return layout;
+        }
+    }
+
+    u64 root_signature::compute_hash(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc)
+    {
+        return internal::hash_root_signature_desc(rootSignatureDesc);
+    }
+
     root_signature::root_signature(device& device, const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc)
         :m_device(device)
         ,m_root_signature_description{}
-        ,m_num_descriptors_per_table{ 0 }
-        ,m_sampler_table_bit_mask(0)
-        ,m_descriptor_table_bit_mask(0)
+        ,m_hash(0)
+        ,m_layout{}
     {
         set_root_signature_desc(rootSignatureDesc);
     }
@@ -27,64 +148,35 @@ namespace cera
         // up first.
         destroy();
 
-        u32                    num_parameters = rootSignatureDesc.NumParameters;
-        D3D12_ROOT_PARAMETER1* parameters = num_parameters > 0 
-            ? new D3D12_ROOT_PARAMETER1[num_parameters]
-            : nullptr;
+        u32 num_parameters = rootSignatureDesc.NumParameters;
+
+        // The description points into storage owned by this root signature, it stays valid
+        // after the caller's description goes away.
+        m_root_parameters.assign(rootSignatureDesc.pParameters, rootSignatureDesc.pParameters + num_parameters);
+        m_descriptor_ranges.resize(num_parameters);
 
         for (u32 i = 0; i < num_parameters; ++i)
         {
-            const D3D12_ROOT_PARAMETER1& root_parameter = rootSignatureDesc.pParameters[i];
-            parameters[i] = root_parameter;
+            D3D12_ROOT_PARAMETER1& root_parameter = m_root_parameters[i];
 
             if (root_parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
             {
-                u32                      num_descriptor_ranges = root_parameter.DescriptorTable.NumDescriptorRanges;
-                D3D12_DESCRIPTOR_RANGE1* descriptor_ranges = num_descriptor_ranges > 0 
-                    ? new D3D12_DESCRIPTOR_RANGE1[num_descriptor_ranges] 
-                    : nullptr;
-
-                memcpy(descriptor_ranges, root_parameter.DescriptorTable.pDescriptorRanges, sizeof(D3D12_DESCRIPTOR_RANGE1) * num_descriptor_ranges);
+                const D3D12_ROOT_DESCRIPTOR_TABLE1& descriptor_table = rootSignatureDesc.pParameters[i].DescriptorTable;
+                m_descriptor_ranges[i].assign(descriptor_table.pDescriptorRanges, descriptor_table.pDescriptorRanges + descriptor_table.NumDescriptorRanges);
 
-                parameters[i].DescriptorTable.NumDescriptorRanges = num_descriptor_ranges;
-                parameters[i].DescriptorTable.pDescriptorRanges = descriptor_ranges;
-
-                // Set the bit mask depending on the type of descriptor table.
-                if (num_descriptor_ranges > 0)
-                {
-                    switch (descriptor_ranges[0].RangeType)
-                    {
-                    case D3D12_DESCRIPTOR_RANGE_TYPE_CBV:
-                    case D3D12_DESCRIPTOR_RANGE_TYPE_SRV:
-                    case D3D12_DESCRIPTOR_RANGE_TYPE_UAV:
-                        m_descriptor_table_bit_mask |= (1 << i);
-                        break;
-                    case D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER:
-                        m_sampler_table_bit_mask |= (1 << i);
-                        break;
-                    }
-                }
-
-                // Count the number of descriptors in the descriptor table.
-                for (u32 j = 0; j < num_descriptor_ranges; ++j)
-                {
-                    m_num_descriptors_per_table[i] += descriptor_ranges[j].NumDescriptors;
-                }
+                root_parameter.DescriptorTable.pDescriptorRanges = m_descriptor_ranges[i].empty() ? nullptr : m_descriptor_ranges[i].data();
             }
         }
 
+        D3D12_ROOT_PARAMETER1* parameters = m_root_parameters.empty() ? nullptr : m_root_parameters.data();
+
         m_root_signature_description.NumParameters = num_parameters;
         m_root_signature_description.pParameters = parameters;
 
-        u32                        num_static_samplers = rootSignatureDesc.NumStaticSamplers;
-        D3D12_STATIC_SAMPLER_DESC* static_samplers = num_static_samplers > 0 
-            ? new D3D12_STATIC_SAMPLER_DESC[num_static_samplers]
-            : nullptr;
+        u32 num_static_samplers = rootSignatureDesc.NumStaticSamplers;
+        m_static_samplers.assign(rootSignatureDesc.pStaticSamplers, rootSignatureDesc.pStaticSamplers + num_static_samplers);
 
-        if (static_samplers)
-        {
-            memcpy(static_samplers, rootSignatureDesc.pStaticSamplers, sizeof(D3D12_STATIC_SAMPLER_DESC) * num_static_samplers);
-        }
+        D3D12_STATIC_SAMPLER_DESC* static_samplers = m_static_samplers.empty() ? nullptr : m_static_samplers.data();
 
         m_root_signature_description.NumStaticSamplers = num_static_samplers;
         m_root_signature_description.pStaticSamplers = static_samplers;
@@ -92,6 +184,8 @@ namespace cera
         D3D12_ROOT_SIGNATURE_FLAGS flags = rootSignatureDesc.Flags;
         m_root_signature_description.Flags = flags;
 
+        m_layout = internal::compute_root_signature_layout(m_root_signature_description);
+
         CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC version_root_signature_desc;
         version_root_signature_desc.Init_1_1(num_parameters, parameters, num_static_samplers, static_samplers, flags);
 
@@ -116,6 +210,11 @@ namespace cera
             return false;
         }
 
+        // Attach the hash to the D3D object so pipeline state streams, which only reference
+        // the ID3D12RootSignature, can be hashed by content.
+        m_hash = internal::hash_root_signature_desc(m_root_signature_description);
+        m_root_signature->SetPrivateData(internal::root_signature_hash_guid, sizeof(m_hash), &m_hash);
+
         return true;
     }
 
@@ -131,49 +230,55 @@ namespace cera
 
     u32 root_signature::get_descriptor_table_bit_mask(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) const
     {
-        u32 descriptor_table_bit_mask = 0;
-        switch (descriptorHeapType)
-        {
-        case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
-            descriptor_table_bit_mask = m_descriptor_table_bit_mask;
-            break;
-        case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
-            descriptor_table_bit_mask = m_sampler_table_bit_mask;
-            break;
-        }
+        return descriptorHeapType < root_signature_layout::num_descriptor_heap_types
+            ? m_layout.descriptor_table_bit_mask[descriptorHeapType]
+            : 0;
+    }
 
-        return descriptor_table_bit_mask;
+    const root_signature_layout& root_signature::get_layout() const
+    {
+        return m_layout;
     }
 
-    u32 root_signature::get_num_descriptors(u32 rootIndex) const
+    u64 root_signature::get_hash() const
     {
-        assert(rootIndex < 32);
-        return m_num_descriptors_per_table[rootIndex];
+        return m_hash;
     }
 
-    void root_signature::destroy()
+    u64 root_signature::get_hash(ID3D12RootSignature* rootSignature)
     {
-        for (u32 i = 0; i < m_root_signature_description.NumParameters; ++i)
-        {
-            const D3D12_ROOT_PARAMETER1& root_parameter = m_root_signature_description.pParameters[i];
+        u64 hash = 0;
 
-            if (root_parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+        if (rootSignature)
+        {
+            UINT data_size = sizeof(hash);
+            if (FAILED(rootSignature->GetPrivateData(internal::root_signature_hash_guid, &data_size, &hash)) || data_size != sizeof(hash))
             {
-                delete[] root_parameter.DescriptorTable.pDescriptorRanges;
+                hash = 0;
             }
         }
 
-        delete[] m_root_signature_description.pParameters;
+        return hash;
+    }
+
+    u32 root_signature::get_num_descriptors(u32 rootIndex) const
+    {
+        assert(rootIndex < root_signature_layout::max_descriptor_tables);
+        return m_layout.num_descriptors_per_table[rootIndex];
+    }
+
+    void root_signature::destroy()
+    {
+        m_root_parameters.clear();
+        m_descriptor_ranges.clear();
+        m_static_samplers.clear();
+
         m_root_signature_description.pParameters = nullptr;
         m_root_signature_description.NumParameters = 0;
-
-        delete[] m_root_signature_description.pStaticSamplers;
         m_root_signature_description.pStaticSamplers = nullptr;
         m_root_signature_description.NumStaticSamplers = 0;
 
-        m_descriptor_table_bit_mask = 0;
-        m_sampler_table_bit_mask = 0;
-
-        memset(m_num_descriptors_per_table, 0, sizeof(m_num_descriptors_per_table));
+        m_hash = 0;
+        m_layout = {};
     }
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "render/root_signature_cache.h"
+
+namespace cera
+{
+    std::shared_ptr<root_signature> root_signature_cache::find(u64 hash) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_root_signatures.find(hash);
+        return it != m_root_signatures.end() ? it->second : nullptr;
+    }
+
+    std::shared_ptr<root_signature> root_signature_cache::insert(u64 hash, const std::shared_ptr<root_signature>& rootSignature)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto result = m_root_signatures.emplace(hash, rootSignature);
+        return result.first->second;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace cera
+{
+    class root_signature;
+
+    /**
+     * Device level cache of root signatures.
+     * Root signatures are keyed by the hash of their description, creating a root signature
+     * with an identical description returns the same instance. Binding code can therefore
+     * compare root signatures by pointer.
+     */
+    class root_signature_cache
+    {
+    public:
+        /**
+         * Find a previously created root signature.
+         * @returns nullptr when no root signature with the given hash was created.
+         */
+        std::shared_ptr<root_signature> find(u64 hash) const;
+
+        /**
+         * Register a created root signature.
+         * When another thread registered a root signature with the same hash first,
+         * that instance is returned instead.
+         */
+        std::shared_ptr<root_signature> insert(u64 hash, const std::shared_ptr<root_signature>& rootSignature);
+
+    private:
+        mutable std::mutex m_mutex;
+
+        std::unordered_map<u64, std::shared_ptr<root_signature>> m_root_signatures;
+    };
+}
\ No newline at end of file
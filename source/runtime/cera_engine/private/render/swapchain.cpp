@@ -227,6 +227,7 @@ namespace cera
         m_command_queue.wait_for_fence_value(fence_value);
 
         m_device.release_stale_descriptors();
+        m_device.release_stale_geometry();
 
         return m_current_back_buffer_index;
     }
@@ -123,6 +123,8 @@ namespace cera
         upload_buffer::allocation allocation;
         allocation.CPU = static_cast<uint8_t*>(m_CPU_ptr) + m_offset;
         allocation.GPU = m_GPU_ptr + m_offset;
+        allocation.resource = m_d3d12_resource.Get();
+        allocation.offset = m_offset;
 
         m_offset += aligned_size;
 
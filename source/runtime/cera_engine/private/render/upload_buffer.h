@@ -22,6 +22,10 @@ namespace cera
         {
             void* CPU;
             D3D12_GPU_VIRTUAL_ADDRESS GPU;
+
+            // Page and offset of the allocation, for commands that read from a resource instead of a GPU address.
+            ID3D12Resource* resource;
+            size_t offset;
         };
 
         /**
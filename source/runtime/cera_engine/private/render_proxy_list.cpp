@@ -0,0 +1,290 @@
+#include "render_proxy_list.h"
+#include "scene_node.h"
+#include "mesh.h"
+
+#include <cassert>
+
+namespace cera
+{
+    render_proxy_list::render_proxy_list()
+        :m_num_updated_proxies(0)
+        ,m_spatial_index(nullptr)
+    {}
+
+    render_proxy_list::~render_proxy_list() = default;
+
+    void render_proxy_list::attach(scene_node& root)
+    {
+        collect_subtree(root);
+
+        for (scene_node* node : m_subtree)
+        {
+            if (node->m_proxy_list == this)
+            {
+                continue;
+            }
+
+            if (node->m_proxy_list)
+            {
+                node->m_proxy_list->remove_proxies(*node);
+            }
+
+            node->m_proxy_list = this;
+            add_proxies(*node);
+        }
+    }
+
+    void render_proxy_list::detach(scene_node& root)
+    {
+        collect_subtree(root);
+
+        for (scene_node* node : m_subtree)
+        {
+            if (node->m_proxy_list == this)
+            {
+                remove_proxies(*node);
+                node->m_proxy_list = nullptr;
+            }
+        }
+    }
+
+    void render_proxy_list::on_meshes_changed(scene_node& node)
+    {
+        assert(node.m_proxy_list == this);
+
+        remove_proxies(node);
+        add_proxies(node);
+    }
+
+    void render_proxy_list::on_moved(scene_node& node)
+    {
+        assert(node.m_proxy_list == this);
+
+        // World transforms of all descendants change with the node.
+        collect_subtree(node);
+
+        for (scene_node* n : m_subtree)
+        {
+            for (u32 index : n->m_proxy_indices)
+            {
+                mark_dirty(index);
+            }
+        }
+    }
+
+    void render_proxy_list::update()
+    {
+        m_num_updated_proxies = 0;
+
+        bool needs_refit = false;
+        for (u32 index : m_journal)
+        {
+            // Removed proxies leave stale entries behind, proxies can also be recorded more than once.
+            if (index < m_proxies.size() && m_proxies[index].dirty)
+            {
+                needs_refit |= update_proxy(m_proxies[index], index);
+                ++m_num_updated_proxies;
+            }
+        }
+
+        m_journal.clear();
+
+        if (needs_refit)
+        {
+            m_spatial_index->refit();
+        }
+    }
+
+    void render_proxy_list::set_spatial_index(aabb_tree* spatialIndex)
+    {
+        for (render_proxy& proxy : m_proxies)
+        {
+            if (proxy.spatial_proxy != aabb_tree::invalid_proxy)
+            {
+                m_spatial_index->remove(proxy.spatial_proxy);
+                proxy.spatial_proxy = aabb_tree::invalid_proxy;
+            }
+        }
+
+        m_spatial_owners.clear();
+        m_spatial_index = spatialIndex;
+
+        if (!m_spatial_index)
+        {
+            return;
+        }
+
+        // Dirty proxies are inserted by the next update, their bounds are not known yet.
+        for (u32 i = 0; i < m_proxies.size(); ++i)
+        {
+            render_proxy& proxy = m_proxies[i];
+            if (!proxy.dirty && proxy.mesh->has_bounds())
+            {
+                insert_spatial_proxy(proxy, i);
+            }
+        }
+    }
+
+    u32 render_proxy_list::get_proxy_of_spatial_proxy(aabb_tree::proxy spatialProxy) const
+    {
+        assert(spatialProxy < m_spatial_owners.size());
+        return m_spatial_owners[spatialProxy];
+    }
+
+    std::vector<render_proxy>& render_proxy_list::get_proxies()
+    {
+        return m_proxies;
+    }
+
+    const std::vector<render_proxy>& render_proxy_list::get_proxies() const
+    {
+        return m_proxies;
+    }
+
+    size_t render_proxy_list::size() const
+    {
+        return m_proxies.size();
+    }
+
+    u32 render_proxy_list::get_num_updated_proxies() const
+    {
+        return m_num_updated_proxies;
+    }
+
+    void render_proxy_list::collect_subtree(scene_node& root)
+    {
+        m_subtree.clear();
+        m_subtree.push_back(&root);
+
+        // Parents are visited before their children.
+        for (size_t i = 0; i < m_subtree.size(); ++i)
+        {
+            for (const auto& child : m_subtree[i]->m_children)
+            {
+                m_subtree.push_back(child.get());
+            }
+        }
+    }
+
+    void render_proxy_list::add_proxies(scene_node& node)
+    {
+        node.m_proxy_indices.clear();
+
+        for (u32 i = 0; i < node.m_meshes.size(); ++i)
+        {
+            u32 index = static_cast<u32>(m_proxies.size());
+
+            render_proxy& proxy = m_proxies.emplace_back();
+            proxy.world_transform = float4x4::identity();
+            proxy.world_box = bounding_box::empty();
+            proxy.mesh = node.m_meshes[i].get();
+            proxy.node = &node;
+            proxy.mesh_index = i;
+            proxy.spatial_proxy = aabb_tree::invalid_proxy;
+            proxy.lod = 0;
+            proxy.dirty = 0;
+
+            node.m_proxy_indices.push_back(index);
+
+            mark_dirty(index);
+        }
+    }
+
+    void render_proxy_list::remove_proxies(scene_node& node)
+    {
+        // Removing from the back keeps the indices of the remaining proxies of the node valid,
+        // remove_proxy() updates them when a proxy of this node is moved.
+        while (!node.m_proxy_indices.empty())
+        {
+            u32 index = node.m_proxy_indices.back();
+            node.m_proxy_indices.pop_back();
+
+            remove_proxy(index);
+        }
+    }
+
+    void render_proxy_list::remove_proxy(u32 index)
+    {
+        render_proxy& proxy = m_proxies[index];
+
+        if (proxy.spatial_proxy != aabb_tree::invalid_proxy)
+        {
+            m_spatial_index->remove(proxy.spatial_proxy);
+        }
+
+        u32 last = static_cast<u32>(m_proxies.size() - 1);
+        if (index != last)
+        {
+            proxy = m_proxies[last];
+
+            proxy.node->m_proxy_indices[proxy.mesh_index] = index;
+
+            if (proxy.spatial_proxy != aabb_tree::invalid_proxy)
+            {
+                m_spatial_owners[proxy.spatial_proxy] = index;
+            }
+
+            // The journal refers to the old index.
+            if (proxy.dirty)
+            {
+                m_journal.push_back(index);
+            }
+        }
+
+        m_proxies.pop_back();
+    }
+
+    void render_proxy_list::mark_dirty(u32 index)
+    {
+        render_proxy& proxy = m_proxies[index];
+        if (!proxy.dirty)
+        {
+            proxy.dirty = 1;
+            m_journal.push_back(index);
+        }
+    }
+
+    bool render_proxy_list::update_proxy(render_proxy& proxy, u32 index)
+    {
+        proxy.world_transform = proxy.node->get_transform_hierarchy().get_world_transform(proxy.node->m_transform);
+        proxy.world_box = proxy.mesh->has_bounds() ? transform(proxy.mesh->get_bounding_box(), proxy.world_transform) : bounding_box::empty();
+        proxy.dirty = 0;
+
+        if (!m_spatial_index || !proxy.mesh->has_bounds())
+        {
+            return false;
+        }
+
+        if (proxy.spatial_proxy == aabb_tree::invalid_proxy)
+        {
+            insert_spatial_proxy(proxy, index);
+            return false;
+        }
+
+        // Small movements only grow the ancestors, teleported meshes are reinserted to keep the tree tight.
+        const bounding_box& previous_box = m_spatial_index->get_fat_bounds(proxy.spatial_proxy);
+        bool teleported = proxy.world_box.min.x > previous_box.max.x || proxy.world_box.max.x < previous_box.min.x
+            || proxy.world_box.min.y > previous_box.max.y || proxy.world_box.max.y < previous_box.min.y
+            || proxy.world_box.min.z > previous_box.max.z || proxy.world_box.max.z < previous_box.min.z;
+
+        if (teleported)
+        {
+            m_spatial_index->move(proxy.spatial_proxy, proxy.world_box);
+            return false;
+        }
+
+        return m_spatial_index->move_deferred(proxy.spatial_proxy, proxy.world_box);
+    }
+
+    void render_proxy_list::insert_spatial_proxy(render_proxy& proxy, u32 index)
+    {
+        proxy.spatial_proxy = m_spatial_index->insert(proxy.world_box);
+
+        if (proxy.spatial_proxy >= m_spatial_owners.size())
+        {
+            m_spatial_owners.resize(proxy.spatial_proxy + 1);
+        }
+
+        m_spatial_owners[proxy.spatial_proxy] = index;
+    }
+}
\ No newline at end of file
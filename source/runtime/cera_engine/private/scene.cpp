@@ -1,17 +1,109 @@
 #include "scene.h"
 #include "scene_node.h"
+#include "mesh.h"
+
+#include "ecs/components.h"
+#include "ecs/registry.h"
+
+#include "render/command_list.h"
+
+#include "util/threading/thread_pool.h"
+
+#include "util/memory_definitions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 namespace cera
 {
+    namespace internal
+    {
+        u64 get_triangle_count(const mesh& mesh, u32 lod)
+        {
+            if (mesh.get_primitive_topology() != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+            {
+                return 0;
+            }
+
+            size_t index_count = mesh.get_index_count(lod);
+            return (index_count > 0 ? index_count : mesh.get_vertex_count()) / 3;
+        }
+
+        /**
+         * Meshes do not have a material, pipeline state or root signature yet. All draws of a scene are recorded in
+         * one pass with the root signature and pipeline state the caller bound, so these fields are 0 for every draw.
+         * The mesh is the state that changes between draws and takes the material field, render_queue_stats counts
+         * its changes. Fill the fields here once meshes carry a material.
+         */
+        u64 make_sort_key(const mesh& mesh, float viewDepth)
+        {
+            constexpr u32 pass = 0;
+            constexpr u32 root_signature = 0;
+            constexpr u32 pipeline_state = 0;
+
+            return sort_key::make(pass, root_signature, pipeline_state, mesh.get_id(), viewDepth);
+        }
+
+        // Same draw as mesh::draw_bound, written as the arguments of an indirect draw.
+        draw_indexed_arguments get_draw_arguments(const draw_packet& packet)
+        {
+            draw_indexed_arguments arguments;
+            arguments.index_count_per_instance = static_cast<u32>(packet.mesh->get_index_count(packet.lod));
+            arguments.instance_count = packet.instance_count;
+            arguments.start_index_location = packet.mesh->get_first_index(packet.lod);
+            arguments.base_vertex_location = static_cast<s32>(packet.mesh->get_base_vertex());
+            arguments.start_instance_location = packet.start_instance;
+
+            return arguments;
+        }
+    }
+
     scene::scene()
         :m_root_node(nullptr)
+        ,m_lod_selection_enabled(false)
+        ,m_lod_viewport_height(0.0f)
+        ,m_lod_max_pixel_error(1.0f)
+        ,m_lod_hysteresis(0.25f)
+        ,m_instancing_enabled(false)
+        ,m_instance_buffer_slot(instance_transform::input_slot)
+        ,m_indirect_draws_enabled(false)
+        ,m_indirect_root_parameter_index(0)
+        ,m_indirect_transforms_root_parameter_index(1)
+        ,m_indirect_arguments(1)
+        ,m_meshlet_culling_enabled(false)
+        ,m_has_view_projection(false)
+        ,m_view_projection(float4x4::identity())
+        ,m_camera_position({ 0.0f, 0.0f, 0.0f })
     {}
 
-    scene::~scene() = default;
+    scene::~scene()
+    {
+        // Nodes must not report changes to the proxy list once it is gone.
+        if (m_root_node)
+        {
+            m_render_proxies.detach(*m_root_node);
+        }
+    }
 
     void scene::set_root_node(const std::shared_ptr<scene_node>& root)
     {
+        if (m_root_node)
+        {
+            m_render_proxies.detach(*m_root_node);
+        }
+
         m_root_node = root;
+
+        if (m_root_node)
+        {
+            m_render_proxies.attach(*m_root_node);
+        }
+
+        if (m_spatial_index)
+        {
+            update_spatial_index();
+        }
     }
 
     const std::shared_ptr<scene_node>& scene::get_root_node() const
@@ -19,8 +111,783 @@ namespace cera
         return m_root_node;
     }
 
-    void scene::draw(const std::shared_ptr<command_list>& commandList)
+    const render_proxy_list& scene::get_render_proxies() const
+    {
+        return m_render_proxies;
+    }
+
+    void scene::set_entities(const std::shared_ptr<ecs::registry>& entityRegistry)
+    {
+        m_entities = entityRegistry;
+    }
+
+    const std::shared_ptr<ecs::registry>& scene::get_entities() const
+    {
+        return m_entities;
+    }
+
+    void scene::update()
+    {
+        if (m_root_node)
+        {
+            m_root_node->update_world_transforms(m_transform_update_pool.get());
+        }
+    }
+
+    void scene::draw(const std::shared_ptr<command_list>& commandList, const DirectX::XMMATRIX& viewMatrix)
+    {
+        draw_scene(*commandList, viewMatrix, nullptr);
+    }
+
+    void scene::draw(const std::shared_ptr<command_list>& commandList, const DirectX::XMMATRIX& viewMatrix, const DirectX::XMMATRIX& projectionMatrix)
+    {
+        draw_scene(*commandList, viewMatrix, &projectionMatrix);
+    }
+
+    void scene::draw_scene(command_list& commandList, const DirectX::XMMATRIX& viewMatrix, const DirectX::XMMATRIX* projectionMatrix)
+    {
+        auto start_time = std::chrono::steady_clock::now();
+
+        m_render_queue.clear();
+        m_world_transforms.clear();
+
+        // World transforms are updated once per frame by update(), not by every draw.
+        m_render_proxies.update();
+
+        m_draw_stats.num_updated_proxies = m_render_proxies.get_num_updated_proxies();
+
+        submit_proxies(viewMatrix);
+
+        if (m_entities)
+        {
+            submit_entities(viewMatrix);
+        }
+
+        m_draw_stats.num_culled_packets = 0;
+        m_draw_stats.culling_time_us = 0;
+        m_draw_stats.num_occluded_packets = 0;
+        m_draw_stats.num_occluders = 0;
+        m_draw_stats.occlusion_time_us = 0;
+        m_draw_stats.num_reduced_lod_packets = 0;
+        m_draw_stats.lod_selection_time_us = 0;
+        m_draw_stats.num_meshlets = 0;
+        m_draw_stats.num_backfacing_meshlets = 0;
+        m_draw_stats.num_culled_meshlets = 0;
+        m_draw_stats.meshlet_culling_time_us = 0;
+
+        m_has_view_projection = projectionMatrix != nullptr;
+
+        if (projectionMatrix)
+        {
+            DirectX::XMStoreFloat4x4A(reinterpret_cast<DirectX::XMFLOAT4X4A*>(&m_view_projection), viewMatrix * (*projectionMatrix));
+
+            DirectX::XMVECTOR camera_position = DirectX::XMMatrixInverse(nullptr, viewMatrix).r[3];
+            m_camera_position = { DirectX::XMVectorGetX(camera_position), DirectX::XMVectorGetY(camera_position), DirectX::XMVectorGetZ(camera_position) };
+
+            cull(m_view_projection);
+
+            if (m_lod_selection_enabled)
+            {
+                select_lods(viewMatrix, *projectionMatrix);
+            }
+        }
+
+        m_render_queue.sort();
+
+        m_draw_stats.num_draw_packets = static_cast<u32>(m_render_queue.size());
+        m_draw_stats.num_draw_calls = 0;
+        m_draw_stats.num_indirect_commands = 0;
+        m_draw_stats.num_buffer_binds = 0;
+        m_draw_stats.num_triangles = 0;
+
+        if (m_indirect_draws_enabled)
+        {
+            record_indirect_draws(commandList);
+        }
+        else if (m_instancing_enabled)
+        {
+            record_instanced_draws(commandList);
+        }
+        else
+        {
+            record_draws(commandList);
+        }
+
+        m_draw_stats.cpu_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+    }
+
+    void scene::submit_proxies(const DirectX::XMMATRIX& viewMatrix)
+    {
+        std::vector<render_proxy>& proxies = m_render_proxies.get_proxies();
+
+        m_world_transforms.reserve(m_world_transforms.size() + proxies.size());
+
+        for (render_proxy& proxy : proxies)
+        {
+            u32 transform_index = static_cast<u32>(m_world_transforms.size());
+            memcpy(&m_world_transforms.emplace_back(), &proxy.world_transform, sizeof(proxy.world_transform));
+
+            // Depth of the node origin, the translation is the last row of the matrix.
+            DirectX::XMVECTOR origin = DirectX::XMLoadFloat4A(reinterpret_cast<const DirectX::XMFLOAT4A*>(proxy.world_transform.m[3]));
+            float view_depth = DirectX::XMVectorGetZ(DirectX::XMVector3TransformCoord(origin, viewMatrix));
+
+            u64 key = internal::make_sort_key(*proxy.mesh, view_depth);
+
+            draw_packet packet;
+            packet.mesh = proxy.mesh;
+            packet.transform_index = transform_index;
+            packet.previous_lod = &proxy.lod;
+            packet.world_box = &proxy.world_box;
+
+            m_render_queue.submit(key, packet);
+        }
+    }
+
+    void scene::submit_entities(const DirectX::XMMATRIX& viewMatrix)
+    {
+        auto submit_chunk = [this, &viewMatrix](u32 count, const ecs::world_transform* worldTransforms, ecs::mesh_instance* meshInstances, const ecs::world_bounds* worldBounds)
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                ecs::mesh_instance& instance = meshInstances[i];
+                if (!instance.mesh)
+                {
+                    continue;
+                }
+
+                const float4x4& world_transform = worldTransforms[i].matrix;
+
+                u32 transform_index = static_cast<u32>(m_world_transforms.size());
+                memcpy(&m_world_transforms.emplace_back(), &world_transform, sizeof(world_transform));
+
+                // Depth of the entity origin, the translation is the last row of the matrix.
+                DirectX::XMVECTOR origin = DirectX::XMLoadFloat4A(reinterpret_cast<const DirectX::XMFLOAT4A*>(world_transform.m[3]));
+                float view_depth = DirectX::XMVectorGetZ(DirectX::XMVector3TransformCoord(origin, viewMatrix));
+
+                u64 key = internal::make_sort_key(*instance.mesh, view_depth);
+
+                draw_packet packet;
+                packet.mesh = instance.mesh.get();
+                packet.transform_index = transform_index;
+                packet.previous_lod = &instance.lod;
+                packet.world_box = worldBounds ? &worldBounds[i].box : nullptr;
+
+                m_render_queue.submit(key, packet);
+            }
+        };
+
+        // Entities with world bounds first, the bounds of all others are computed during culling.
+        m_entities->for_each_chunk<ecs::world_transform, ecs::mesh_instance, ecs::world_bounds>([&submit_chunk](u32 count, const ecs::entity*, ecs::world_transform* worldTransforms, ecs::mesh_instance* meshInstances, ecs::world_bounds* worldBounds)
+        {
+            submit_chunk(count, worldTransforms, meshInstances, worldBounds);
+        });
+
+        m_entities->for_each_chunk<ecs::world_transform, ecs::mesh_instance>([&submit_chunk](u32 count, const ecs::entity*, ecs::world_transform* worldTransforms, ecs::mesh_instance* meshInstances)
+        {
+            submit_chunk(count, worldTransforms, meshInstances, nullptr);
+        }, ecs::get_component_mask<ecs::world_bounds>());
+    }
+
+    void scene::enable_instancing(u32 instanceBufferSlot)
+    {
+        m_instancing_enabled = true;
+        m_instance_buffer_slot = instanceBufferSlot;
+    }
+
+    void scene::disable_instancing()
+    {
+        m_instancing_enabled = false;
+    }
+
+    bool scene::is_instancing_enabled() const
+    {
+        return m_instancing_enabled;
+    }
+
+    void scene::enable_indirect_draws(u32 rootParameterIndex, u32 transformsRootParameterIndex)
+    {
+        m_indirect_draws_enabled = true;
+        m_indirect_root_parameter_index = rootParameterIndex;
+        m_indirect_transforms_root_parameter_index = transformsRootParameterIndex;
+    }
+
+    void scene::disable_indirect_draws()
+    {
+        m_indirect_draws_enabled = false;
+    }
+
+    bool scene::is_indirect_draws_enabled() const
+    {
+        return m_indirect_draws_enabled;
+    }
+
+    void scene::enable_parallel_transform_update(u32 numThreads)
+    {
+        m_transform_update_pool = std::make_unique<threading::thread_pool>(numThreads, "cera transform update");
+    }
+
+    void scene::disable_parallel_transform_update()
+    {
+        m_transform_update_pool.reset();
+    }
+
+    bool scene::is_parallel_transform_update_enabled() const
+    {
+        return m_transform_update_pool != nullptr;
+    }
+
+    void scene::enable_spatial_index(float margin)
+    {
+        m_render_proxies.set_spatial_index(nullptr);
+        m_spatial_index = std::make_unique<aabb_tree>(margin);
+        m_render_proxies.set_spatial_index(m_spatial_index.get());
+
+        update_spatial_index();
+    }
+
+    void scene::disable_spatial_index()
+    {
+        m_render_proxies.set_spatial_index(nullptr);
+        m_spatial_index.reset();
+    }
+
+    bool scene::is_spatial_index_enabled() const
+    {
+        return m_spatial_index != nullptr;
+    }
+
+    void scene::update_spatial_index()
+    {
+        if (!m_spatial_index)
+        {
+            return;
+        }
+
+        // Proxies keep the index up to date, only the changes since the last update are applied.
+        if (m_root_node)
+        {
+            m_root_node->update_world_transforms(m_transform_update_pool.get());
+        }
+        m_render_proxies.update();
+    }
+
+    void scene::query(const bounding_box& box, std::vector<scene_query_result>& results) const
+    {
+        if (m_spatial_index)
+        {
+            m_query_proxies.clear();
+            m_spatial_index->query(box, m_query_proxies);
+
+            append_query_results(m_query_proxies, results);
+        }
+    }
+
+    void scene::query(const bounding_sphere& sphere, std::vector<scene_query_result>& results) const
+    {
+        if (m_spatial_index)
+        {
+            m_query_proxies.clear();
+            m_spatial_index->query(sphere, m_query_proxies);
+
+            append_query_results(m_query_proxies, results);
+        }
+    }
+
+    void scene::query(const frustum& viewFrustum, std::vector<scene_query_result>& results) const
+    {
+        if (m_spatial_index)
+        {
+            m_query_proxies.clear();
+            m_spatial_index->query(viewFrustum, m_query_proxies);
+
+            append_query_results(m_query_proxies, results);
+        }
+    }
+
+    bool scene::raycast(const float3& origin, const float3& direction, float maxDistance, scene_query_result& result, float& distance) const
+    {
+        if (!m_spatial_index)
+        {
+            return false;
+        }
+
+        bool hit = false;
+
+        // Fat boxes only select candidates, the distance is measured to the tight world box.
+        m_spatial_index->raycast(origin, direction, maxDistance, [&](aabb_tree::proxy proxy, float currentMaxDistance)
+        {
+            const render_proxy& item = m_render_proxies.get_proxies()[m_render_proxies.get_proxy_of_spatial_proxy(proxy)];
+
+            float hit_distance;
+            if (intersect_ray(item.world_box, origin, direction, currentMaxDistance, hit_distance))
+            {
+                result = { item.node, item.mesh };
+                distance = hit_distance;
+                hit = true;
+
+                return hit_distance;
+            }
+
+            return currentMaxDistance;
+        });
+
+        return hit;
+    }
+
+    const aabb_tree* scene::get_spatial_index() const
+    {
+        return m_spatial_index.get();
+    }
+
+    void scene::append_query_results(const std::vector<aabb_tree::proxy>& proxies, std::vector<scene_query_result>& results) const
+    {
+        results.reserve(results.size() + proxies.size());
+
+        for (aabb_tree::proxy proxy : proxies)
+        {
+            const render_proxy& item = m_render_proxies.get_proxies()[m_render_proxies.get_proxy_of_spatial_proxy(proxy)];
+            results.push_back({ item.node, item.mesh });
+        }
+    }
+
+    void scene::enable_occlusion_culling(u32 width, u32 height, u32 numThreads)
+    {
+        m_occlusion_culler = std::make_unique<occlusion_culler>(width, height);
+        m_occlusion_pool = std::make_unique<threading::thread_pool>(numThreads, "cera occlusion");
+    }
+
+    void scene::disable_occlusion_culling()
+    {
+        m_occlusion_culler.reset();
+        m_occlusion_pool.reset();
+    }
+
+    bool scene::is_occlusion_culling_enabled() const
+    {
+        return m_occlusion_culler != nullptr;
+    }
+
+    const occlusion_culler* scene::get_occlusion_culler() const
+    {
+        return m_occlusion_culler.get();
+    }
+
+    void scene::enable_lod_selection(float viewportHeight, float maxPixelError, float hysteresis)
+    {
+        m_lod_selection_enabled = true;
+        m_lod_viewport_height = viewportHeight;
+        m_lod_max_pixel_error = maxPixelError;
+        m_lod_hysteresis = hysteresis;
+    }
+
+    void scene::disable_lod_selection()
+    {
+        m_lod_selection_enabled = false;
+    }
+
+    bool scene::is_lod_selection_enabled() const
+    {
+        return m_lod_selection_enabled;
+    }
+
+    void scene::enable_meshlet_culling()
+    {
+        m_meshlet_culling_enabled = true;
+    }
+
+    void scene::disable_meshlet_culling()
+    {
+        m_meshlet_culling_enabled = false;
+    }
+
+    bool scene::is_meshlet_culling_enabled() const
+    {
+        return m_meshlet_culling_enabled;
+    }
+
+    const render_queue_stats& scene::get_render_queue_stats() const
+    {
+        return m_render_queue.get_stats();
+    }
+
+    const scene_draw_stats& scene::get_draw_stats() const
+    {
+        return m_draw_stats;
+    }
+
+    void scene::cull(const float4x4& viewProjection)
+    {
+        auto start_time = std::chrono::steady_clock::now();
+
+        // Packets are still in submission order, box i belongs to packet i.
+        m_frustum_culler.clear();
+        m_frustum_culler.reserve(m_render_queue.size());
+        m_world_boxes.resize(m_render_queue.size());
+
+        for (size_t i = 0; i < m_render_queue.size(); ++i)
+        {
+            const draw_packet& packet = m_render_queue.get_packet(i);
+
+            if (packet.world_box)
+            {
+                m_world_boxes[i] = *packet.world_box;
+            }
+            else if (!packet.mesh->has_bounds())
+            {
+                m_world_boxes[i] = bounding_box::empty();
+            }
+            else
+            {
+                // DirectX::XMFLOAT4X4 is not aligned, copy it to an aligned matrix.
+                float4x4 world_transform;
+                memcpy(&world_transform, &m_world_transforms[packet.transform_index], sizeof(world_transform));
+
+                m_world_boxes[i] = transform(packet.mesh->get_bounding_box(), world_transform);
+            }
+
+            m_frustum_culler.add(m_world_boxes[i]);
+        }
+
+        u32 num_visible = m_frustum_culler.cull(frustum::from_view_projection(viewProjection), m_visibility);
+
+        m_draw_stats.num_culled_packets = static_cast<u32>(m_render_queue.size()) - num_visible;
+
+        if (m_occlusion_culler)
+        {
+            cull_occluded(viewProjection);
+        }
+
+        m_render_queue.cull(m_visibility);
+
+        m_draw_stats.culling_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+    }
+
+    void scene::cull_occluded(const float4x4& viewProjection)
+    {
+        auto start_time = std::chrono::steady_clock::now();
+
+        m_occlusion_culler->begin_frame(viewProjection);
+
+        // Only occluders inside the frustum can hide anything.
+        u32 num_occluders = 0;
+        for (size_t i = 0; i < m_render_queue.size(); ++i)
+        {
+            const draw_packet& packet = m_render_queue.get_packet(i);
+            if (!m_visibility[i] || !packet.mesh->get_occluder())
+            {
+                continue;
+            }
+
+            float4x4 world_transform;
+            memcpy(&world_transform, &m_world_transforms[packet.transform_index], sizeof(world_transform));
+
+            m_occlusion_culler->add_occluder(*packet.mesh->get_occluder(), world_transform);
+            ++num_occluders;
+        }
+
+        if (num_occluders > 0)
+        {
+            m_occlusion_culler->rasterize(m_occlusion_pool.get());
+
+            // Occluders are never hidden by themselves, their bounds enclose their surface.
+            for (size_t i = 0; i < m_render_queue.size(); ++i)
+            {
+                if (m_visibility[i] && !m_occlusion_culler->is_visible(m_world_boxes[i]))
+                {
+                    m_visibility[i] = 0;
+                    ++m_draw_stats.num_occluded_packets;
+                }
+            }
+        }
+
+        m_draw_stats.num_occluders = num_occluders;
+        m_draw_stats.occlusion_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+    }
+
+    void scene::select_lods(const DirectX::XMMATRIX& viewMatrix, const DirectX::XMMATRIX& projectionMatrix)
+    {
+        auto start_time = std::chrono::steady_clock::now();
+
+        // Packets are still in submission order, only visible packets are left.
+        m_lod_selector.clear();
+        m_lod_selector.reserve(m_render_queue.size());
+        m_lod_packets.clear();
+
+        for (size_t i = 0; i < m_render_queue.size(); ++i)
+        {
+            const draw_packet& packet = m_render_queue.get_packet(i);
+
+            const mesh* m = packet.mesh;
+            if (m->get_num_lods() < 2 || !m->has_bounds())
+            {
+                continue;
+            }
+
+            float4x4 world_transform;
+            memcpy(&world_transform, &m_world_transforms[packet.transform_index], sizeof(world_transform));
+
+            const bounding_sphere& object_sphere = m->get_bounding_sphere();
+            bounding_sphere world_sphere = transform(object_sphere, world_transform);
+
+            // The radius of the world sphere is scaled by the largest scale of the transform.
+            float error_scale = object_sphere.radius > 0.0f ? world_sphere.radius / object_sphere.radius : 1.0f;
+
+            m_lod_selector.add(world_sphere, error_scale, m->get_lod_errors(), m->get_num_lods(), *packet.previous_lod);
+            m_lod_packets.push_back(static_cast<u32>(i));
+        }
+
+        DirectX::XMVECTOR camera_position = DirectX::XMMatrixInverse(nullptr, viewMatrix).r[3];
+
+        float4x4 projection;
+        DirectX::XMStoreFloat4x4A(reinterpret_cast<DirectX::XMFLOAT4X4A*>(&projection), projectionMatrix);
+
+        m_lod_selector.select(
+            { DirectX::XMVectorGetX(camera_position), DirectX::XMVectorGetY(camera_position), DirectX::XMVectorGetZ(camera_position) },
+            lod_selector::get_projection_scale(projection, m_lod_viewport_height),
+            m_lod_max_pixel_error,
+            m_lod_hysteresis,
+            m_selected_lods);
+
+        for (size_t i = 0; i < m_lod_packets.size(); ++i)
+        {
+            size_t index = m_lod_packets[i];
+            u32 lod = m_selected_lods[i];
+
+            draw_packet& packet = m_render_queue.get_packet(index);
+            packet.lod = lod;
+            *packet.previous_lod = static_cast<u8>(lod);
+
+            // Packets of the same mesh and level are adjacent after sorting.
+            m_render_queue.set_sort_key(index, sort_key::set_lod(m_render_queue.get_sort_key(index), lod));
+
+            m_draw_stats.num_reduced_lod_packets += lod > 0 ? 1 : 0;
+        }
+
+        m_draw_stats.lod_selection_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+    }
+
+    void scene::record_draws(command_list& commandList)
+    {
+        const mesh* bound_mesh = nullptr;
+        u32 bound_lod = 0;
+        for (size_t i = 0; i < m_render_queue.size(); ++i)
+        {
+            const draw_packet& packet = m_render_queue.get_packet(i);
+
+            // Sorted packets of the same mesh are adjacent, meshes that share their buffers are bound once.
+            if (bound_mesh == nullptr || !packet.mesh->has_same_bindings(packet.lod, *bound_mesh, bound_lod))
+            {
+                packet.mesh->bind(commandList, packet.lod);
+
+                ++m_draw_stats.num_buffer_binds;
+            }
+
+            bound_mesh = packet.mesh;
+            bound_lod = packet.lod;
+
+            if (record_meshlet_draws(commandList, packet))
+            {
+                continue;
+            }
+
+            packet.mesh->draw_bound(commandList, packet.instance_count, packet.start_instance, packet.lod);
+
+            ++m_draw_stats.num_draw_calls;
+            m_draw_stats.num_triangles += internal::get_triangle_count(*packet.mesh, packet.lod) * packet.instance_count;
+        }
+    }
+
+    bool scene::record_meshlet_draws(command_list& commandList, const draw_packet& packet)
+    {
+        const std::vector<meshlet>& meshlets = packet.mesh->get_meshlets();
+        if (!m_meshlet_culling_enabled || !m_has_view_projection || meshlets.empty() || packet.lod != 0)
+        {
+            return false;
+        }
+
+        auto start_time = std::chrono::steady_clock::now();
+
+        float4x4 world_transform;
+        memcpy(&world_transform, &m_world_transforms[packet.transform_index], sizeof(world_transform));
+
+        float4x4 inverse_world_transform;
+        if (!inverse(world_transform, inverse_world_transform))
+        {
+            return false;
+        }
+
+        // Meshlet bounds are in object space, move the camera and the frustum there instead.
+        const float (&m)[4][4] = inverse_world_transform.m;
+        const float3& p = m_camera_position;
+        float3 object_camera_position = {
+            p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+            p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+            p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2]
+        };
+
+        frustum object_frustum = frustum::from_view_projection(multiply(world_transform, m_view_projection));
+
+        u32 num_backfacing = 0;
+        u32 num_visible = cull_meshlets(meshlets, object_camera_position, object_frustum, m_meshlet_ranges, num_backfacing);
+
+        m_draw_stats.num_meshlets += static_cast<u32>(meshlets.size());
+        m_draw_stats.num_backfacing_meshlets += num_backfacing;
+        m_draw_stats.num_culled_meshlets += static_cast<u32>(meshlets.size()) - num_visible - num_backfacing;
+        m_draw_stats.meshlet_culling_time_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+        for (const meshlet_index_range& range : m_meshlet_ranges)
+        {
+            packet.mesh->draw_bound_range(commandList, range.first_index, range.index_count, packet.instance_count, packet.start_instance);
+
+            ++m_draw_stats.num_draw_calls;
+            m_draw_stats.num_triangles += (range.index_count / 3) * packet.instance_count;
+        }
+
+        return true;
+    }
+
+    void scene::record_instanced_draws(command_list& commandList)
+    {
+        m_render_queue.build_instance_batches(m_instance_batches);
+
+        // Gather the transforms in sorted order, every batch becomes a contiguous range of instances.
+        m_instance_transforms.clear();
+        m_instance_transforms.reserve(m_render_queue.size());
+        for (size_t i = 0; i < m_render_queue.size(); ++i)
+        {
+            m_instance_transforms.push_back(m_world_transforms[m_render_queue.get_packet(i).transform_index]);
+        }
+
+        // The upload buffer allocates from fixed size pages, upload at most one page of instances at a time.
+        constexpr u32 max_instances_per_upload = _2MB / sizeof(DirectX::XMFLOAT4X4);
+
+        u32 num_instances = static_cast<u32>(m_instance_transforms.size());
+        u32 upload_start = 0;
+        u32 upload_count = 0;
+
+        const mesh* bound_mesh = nullptr;
+        u32 bound_lod = 0;
+        for (const instance_batch& batch : m_instance_batches)
+        {
+            if (bound_mesh == nullptr || !batch.mesh->has_same_bindings(batch.lod, *bound_mesh, bound_lod))
+            {
+                batch.mesh->bind(commandList, batch.lod);
+
+                ++m_draw_stats.num_buffer_binds;
+            }
+
+            bound_mesh = batch.mesh;
+            bound_lod = batch.lod;
+
+            m_draw_stats.num_triangles += internal::get_triangle_count(*batch.mesh, batch.lod) * batch.instance_count;
+
+            u32 first_instance = batch.start_instance;
+            u32 remaining_instances = batch.instance_count;
+            while (remaining_instances > 0)
+            {
+                if (first_instance >= upload_start + upload_count)
+                {
+                    upload_start = first_instance;
+                    upload_count = std::min(max_instances_per_upload, num_instances - first_instance);
+
+                    commandList.set_dynamic_vertex_buffer(m_instance_buffer_slot, upload_count, sizeof(DirectX::XMFLOAT4X4), &m_instance_transforms[upload_start]);
+                }
+
+                u32 instance_count = std::min(remaining_instances, upload_start + upload_count - first_instance);
+
+                batch.mesh->draw_bound(commandList, instance_count, first_instance - upload_start, batch.lod);
+
+                ++m_draw_stats.num_draw_calls;
+
+                first_instance += instance_count;
+                remaining_instances -= instance_count;
+            }
+        }
+    }
+
+    void scene::record_indirect_draws(command_list& commandList)
     {
-        m_root_node->draw(commandList);
+        // Draws in a batch share the pass, root signature and pipeline state, the material field may differ.
+        constexpr u64 pipeline_state_mask = ~((1ull << sort_key::pipeline_state_shift) - 1);
+
+        // The transforms of a batch are uploaded at once and have to fit a page of the upload buffer.
+        constexpr u32 max_transforms_per_batch = _2MB / sizeof(DirectX::XMFLOAT4X4);
+
+        m_indirect_arguments.clear();
+        m_indirect_transforms.clear();
+
+        const mesh* bound_mesh = nullptr;
+        u32 bound_lod = 0;
+        u64 batch_state = 0;
+        for (size_t i = 0; i < m_render_queue.size(); ++i)
+        {
+            const draw_packet& packet = m_render_queue.get_packet(i);
+            u64 state = m_render_queue.get_sort_key(i) & pipeline_state_mask;
+
+            // Commands draw from the bound buffers, the batch ends before other buffers or state are bound.
+            bool same_bindings = bound_mesh != nullptr && packet.mesh->has_same_bindings(packet.lod, *bound_mesh, bound_lod);
+            if (!same_bindings || state != batch_state)
+            {
+                flush_indirect_draws(commandList);
+
+                batch_state = state;
+            }
+
+            if (!same_bindings)
+            {
+                packet.mesh->bind(commandList, packet.lod);
+
+                ++m_draw_stats.num_buffer_binds;
+            }
+
+            bound_mesh = packet.mesh;
+            bound_lod = packet.lod;
+
+            m_draw_stats.num_triangles += internal::get_triangle_count(*packet.mesh, packet.lod) * packet.instance_count;
+
+            // Commands are indexed draws, meshes without indices are drawn directly.
+            if (packet.mesh->get_index_count(packet.lod) == 0)
+            {
+                flush_indirect_draws(commandList);
+
+                // Bound like a batch of one command, the shader reads the transform the same way.
+                const u32 transform_index = 0;
+                commandList.set_graphics_dynamic_structured_buffer(m_indirect_transforms_root_parameter_index, 1, sizeof(DirectX::XMFLOAT4X4), &m_world_transforms[packet.transform_index]);
+                commandList.set_graphics_32_bit_constants(m_indirect_root_parameter_index, transform_index);
+
+                packet.mesh->draw_bound(commandList, packet.instance_count, packet.start_instance, packet.lod);
+
+                ++m_draw_stats.num_draw_calls;
+                continue;
+            }
+
+            if (m_indirect_transforms.size() == max_transforms_per_batch)
+            {
+                flush_indirect_draws(commandList);
+            }
+
+            // The root constant indexes the transforms uploaded with the batch.
+            m_indirect_arguments.add_draw(internal::get_draw_arguments(packet), static_cast<u32>(m_indirect_transforms.size()));
+            m_indirect_transforms.push_back(m_world_transforms[packet.transform_index]);
+        }
+
+        flush_indirect_draws(commandList);
+    }
+
+    void scene::flush_indirect_draws(command_list& commandList)
+    {
+        if (m_indirect_arguments.empty())
+        {
+            return;
+        }
+
+        commandList.set_graphics_dynamic_structured_buffer(m_indirect_transforms_root_parameter_index, m_indirect_transforms);
+        commandList.execute_indirect(m_indirect_arguments, m_indirect_root_parameter_index);
+
+        ++m_draw_stats.num_draw_calls;
+        m_draw_stats.num_indirect_commands += m_indirect_arguments.get_num_commands();
+
+        m_indirect_arguments.clear();
+        m_indirect_transforms.clear();
     }
 }
\ No newline at end of file
@@ -1,32 +1,73 @@
 #include "scene_node.h"
 #include "mesh.h"
+#include "render_proxy_list.h"
+
+#include "util/log.h"
 
 namespace cera
 {
+    namespace internal
+    {
+        DirectX::XMMATRIX to_xmmatrix(const float4x4& matrix)
+        {
+            return DirectX::XMLoadFloat4x4A(reinterpret_cast<const DirectX::XMFLOAT4X4A*>(&matrix));
+        }
+
+        float4x4 to_float4x4(const DirectX::XMMATRIX& matrix)
+        {
+            float4x4 result;
+            DirectX::XMStoreFloat4x4A(reinterpret_cast<DirectX::XMFLOAT4X4A*>(&result), matrix);
+
+            return result;
+        }
+
+        // Hierarchy of the scene nodes that are created without one, every such node holds a reference.
+        std::weak_ptr<transform_hierarchy> s_transform_hierarchy;
+
+        std::shared_ptr<transform_hierarchy> acquire_transform_hierarchy()
+        {
+            std::shared_ptr<transform_hierarchy> hierarchy = s_transform_hierarchy.lock();
+            if (!hierarchy)
+            {
+                hierarchy = std::make_shared<transform_hierarchy>();
+                s_transform_hierarchy = hierarchy;
+            }
+
+            return hierarchy;
+        }
+    }
+
     scene_node::scene_node(const DirectX::XMMATRIX& localTransform)
+        : scene_node(localTransform, nullptr)
+    {}
+
+    scene_node::scene_node(const DirectX::XMMATRIX& localTransform, const std::shared_ptr<transform_hierarchy>& transformHierarchy)
         : m_name("scene_node")
+        , m_transform_hierarchy(transformHierarchy ? transformHierarchy : internal::acquire_transform_hierarchy())
+        , m_proxy_list(nullptr)
     {
-        m_aligned_data = (aligned_data*)_aligned_malloc(sizeof(aligned_data), 16);
-        m_aligned_data->m_local_transform = localTransform;
-        m_aligned_data->m_inverse_transform = XMMatrixInverse(nullptr, localTransform);
+        m_transform = m_transform_hierarchy->create(internal::to_float4x4(localTransform));
     }
 
     scene_node::~scene_node()
     {
-        _aligned_free(m_aligned_data);
+        if (m_proxy_list)
+        {
+            m_proxy_list->detach(*this);
+        }
+
+        // Children that are still referenced elsewhere become root nodes.
+        get_transform_hierarchy().destroy(m_transform);
     }
 
-    void scene_node::draw(const std::shared_ptr<command_list>& commandList)
+    transform_hierarchy& scene_node::get_transform_hierarchy() const
     {
-        for (auto& m : m_meshes)
-        {
-            m->draw(*commandList);
-        }
+        return *m_transform_hierarchy;
+    }
 
-        for (auto& child : m_children)
-        {
-            child->draw(commandList);
-        }
+    transform_hierarchy::handle scene_node::get_transform_handle() const
+    {
+        return m_transform;
     }
 
     const std::string& scene_node::get_name() const
@@ -41,50 +82,62 @@ namespace cera
 
     DirectX::XMMATRIX scene_node::get_local_transform() const
     {
-        return m_aligned_data->m_local_transform;
+        return internal::to_xmmatrix(get_transform_hierarchy().get_local_transform(m_transform));
     }
 
     void scene_node::set_local_transform(const DirectX::XMMATRIX& localTransform)
     {
-        m_aligned_data->m_local_transform = localTransform;
-        m_aligned_data->m_inverse_transform = XMMatrixInverse(nullptr, localTransform);
+        get_transform_hierarchy().set_local_transform(m_transform, internal::to_float4x4(localTransform));
+
+        if (m_proxy_list)
+        {
+            m_proxy_list->on_moved(*this);
+        }
     }
 
     DirectX::XMMATRIX scene_node::get_inverse_local_transform() const
     {
-        return m_aligned_data->m_inverse_transform;
+        return XMMatrixInverse(nullptr, get_local_transform());
     }
 
     DirectX::XMMATRIX scene_node::get_world_transform() const
     {
-        return m_aligned_data->m_local_transform * get_parent_world_transform();
+        return internal::to_xmmatrix(get_transform_hierarchy().get_world_transform(m_transform));
     }
 
     DirectX::XMMATRIX scene_node::get_inverse_world_transform() const
     {
-        return XMMatrixInverse(nullptr, get_world_transform());
+        return internal::to_xmmatrix(get_transform_hierarchy().get_inverse_world_transform(m_transform));
     }
 
-    DirectX::XMMATRIX scene_node::get_parent_world_transform() const
+    void scene_node::update_world_transforms(threading::thread_pool* threadPool) const
     {
-        DirectX::XMMATRIX parent_transform = DirectX::XMMatrixIdentity();
-        if (auto parent_node = m_parent_node.lock())
+        if (threadPool)
         {
-            parent_transform = parent_node->get_world_transform();
+            get_transform_hierarchy().update(*threadPool);
+        }
+        else
+        {
+            get_transform_hierarchy().update();
         }
-
-        return parent_transform;
     }
 
     void scene_node::add_child(const std::shared_ptr<scene_node>& childNode)
     {
         if (childNode)
         {
+            if (childNode->m_transform_hierarchy != m_transform_hierarchy)
+            {
+                log::error("Scene node {} is in another transform hierarchy than {}", childNode->get_name(), get_name());
+                return;
+            }
+
             node_list::iterator iter = std::find(m_children.begin(), m_children.end(), childNode);
             if (iter == m_children.end())
             {
                 DirectX::XMMATRIX world_transform = childNode->get_world_transform();
                 childNode->m_parent_node = shared_from_this();
+                get_transform_hierarchy().set_parent(childNode->m_transform, m_transform);
                 DirectX::XMMATRIX local_transform = world_transform * get_inverse_world_transform();
                 childNode->set_local_transform(local_transform);
                 m_children.push_back(childNode);
@@ -92,6 +145,15 @@ namespace cera
                 {
                     m_children_by_name.emplace(childNode->get_name(), childNode);
                 }
+
+                if (m_proxy_list)
+                {
+                    m_proxy_list->attach(*childNode);
+                }
+                else if (childNode->m_proxy_list)
+                {
+                    childNode->m_proxy_list->detach(*childNode);
+                }
             }
         }
     }
@@ -103,20 +165,37 @@ namespace cera
             node_list::const_iterator iter = std::find(m_children.begin(), m_children.end(), childNode);
             if (iter != m_children.cend())
             {
-                childNode->set_parent(nullptr);
+                // Keep the child alive in case this node held the last reference.
+                std::shared_ptr<scene_node> child = childNode;
+
+                if (child->m_proxy_list)
+                {
+                    child->m_proxy_list->detach(*child);
+                }
+
                 m_children.erase(iter);
 
-                // Also remove it from the name map.
-                node_name_map::iterator iter2 = m_children_by_name.find(childNode->get_name());
-                if (iter2 != m_children_by_name.end())
+                // Also remove it from the name map, siblings can share the name.
+                auto range = m_children_by_name.equal_range(child->get_name());
+                for (node_name_map::iterator iter2 = range.first; iter2 != range.second; ++iter2)
                 {
-                    m_children_by_name.erase(iter2);
+                    if (iter2->second == child)
+                    {
+                        m_children_by_name.erase(iter2);
+                        break;
+                    }
                 }
+
+                // The child becomes a root node, its world transform is kept.
+                auto world_transform = child->get_world_transform();
+                child->m_parent_node.reset();
+                get_transform_hierarchy().set_parent(child->m_transform, transform_hierarchy::invalid_handle);
+                child->set_local_transform(world_transform);
             }
             else
             {
                 // Maybe the child appears deeper in the scene graph.
-                for (auto child : m_children)
+                for (auto& child : m_children)
                 {
                     child->remove_child(childNode);
                 }
@@ -139,11 +218,8 @@ namespace cera
         }
         else if (auto parent = m_parent_node.lock())
         {
-            // Setting parent to NULL.. remove from current parent and reset parent node.
-            auto world_transform = get_world_transform();
+            // Setting parent to NULL.. remove from current parent, which resets the parent node.
             parent->remove_child(me);
-            m_parent_node.reset();
-            set_local_transform(world_transform);
         }
     }
 
@@ -157,6 +233,11 @@ namespace cera
             {
                 index = m_meshes.size();
                 m_meshes.push_back(mesh);
+
+                if (m_proxy_list)
+                {
+                    m_proxy_list->on_meshes_changed(*this);
+                }
             }
             else
             {
@@ -175,6 +256,11 @@ namespace cera
             if (iter != m_meshes.end())
             {
                 m_meshes.erase(iter);
+
+                if (m_proxy_list)
+                {
+                    m_proxy_list->on_meshes_changed(*this);
+                }
             }
         }
     }
@@ -190,4 +276,19 @@ namespace cera
 
         return mesh;
     }
+
+    size_t scene_node::get_num_meshes() const
+    {
+        return m_meshes.size();
+    }
+
+    void scene_node::for_each_node(const std::function<void(scene_node&)>& function)
+    {
+        function(*this);
+
+        for (auto& child : m_children)
+        {
+            child->for_each_node(function);
+        }
+    }
 }
\ No newline at end of file
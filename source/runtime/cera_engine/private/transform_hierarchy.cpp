@@ -0,0 +1,546 @@
+#include "transform_hierarchy.h"
+
+#include "util/threading/thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CERA_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#else
+#define CERA_TRANSFORM_SSE 0
+#endif
+
+namespace cera
+{
+    float4x4 float4x4::identity()
+    {
+        float4x4 result = {};
+        result.m[0][0] = 1.0f;
+        result.m[1][1] = 1.0f;
+        result.m[2][2] = 1.0f;
+        result.m[3][3] = 1.0f;
+
+        return result;
+    }
+
+    float4x4 multiply(const float4x4& a, const float4x4& b)
+    {
+        float4x4 result;
+
+#if CERA_TRANSFORM_SSE
+        // Every row of the result is a linear combination of the rows of b.
+        __m128 b0 = _mm_load_ps(b.m[0]);
+        __m128 b1 = _mm_load_ps(b.m[1]);
+        __m128 b2 = _mm_load_ps(b.m[2]);
+        __m128 b3 = _mm_load_ps(b.m[3]);
+
+        for (u32 row = 0; row < 4; ++row)
+        {
+            __m128 r = _mm_mul_ps(_mm_set1_ps(a.m[row][0]), b0);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[row][1]), b1));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[row][2]), b2));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.m[row][3]), b3));
+
+            _mm_store_ps(result.m[row], r);
+        }
+#else
+        for (u32 row = 0; row < 4; ++row)
+        {
+            for (u32 column = 0; column < 4; ++column)
+            {
+                result.m[row][column] =
+                    a.m[row][0] * b.m[0][column] +
+                    a.m[row][1] * b.m[1][column] +
+                    a.m[row][2] * b.m[2][column] +
+                    a.m[row][3] * b.m[3][column];
+            }
+        }
+#endif
+
+        return result;
+    }
+
+    bool inverse(const float4x4& matrix, float4x4& result)
+    {
+        const float* m = &matrix.m[0][0];
+
+        float inv[16];
+
+        inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+        inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+        inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+        inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+        inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+        inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+        inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+        inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+        inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+        inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+        inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+        inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+        inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+        inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+        inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+        inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+        float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+        if (determinant == 0.0f || !std::isfinite(determinant))
+        {
+            return false;
+        }
+
+        float inverse_determinant = 1.0f / determinant;
+
+        float* r = &result.m[0][0];
+        for (u32 i = 0; i < 16; ++i)
+        {
+            r[i] = inv[i] * inverse_determinant;
+        }
+
+        return true;
+    }
+
+    transform_hierarchy::transform_hierarchy()
+        : m_num_dirty(0)
+        , m_order_dirty(false)
+    {}
+
+    transform_hierarchy::handle transform_hierarchy::create(const float4x4& localTransform, handle parent)
+    {
+        handle node;
+        if (!m_free_handles.empty())
+        {
+            node = m_free_handles.back();
+            m_free_handles.pop_back();
+        }
+        else
+        {
+            node = static_cast<handle>(m_slot_of_handle.size());
+            m_slot_of_handle.push_back(invalid_slot);
+            m_first_child.push_back(invalid_handle);
+            m_next_sibling.push_back(invalid_handle);
+            m_previous_sibling.push_back(invalid_handle);
+        }
+
+        u32 slot = static_cast<u32>(m_handles.size());
+        m_slot_of_handle[node] = slot;
+
+        m_local_transforms.push_back(localTransform);
+        m_world_transforms.push_back(localTransform);
+        m_parent_slots.push_back(parent != invalid_handle ? get_slot(parent) : invalid_slot);
+        m_dirty.push_back(1);
+        m_handles.push_back(node);
+        m_inverse_world_transforms.emplace_back();
+        m_inverse_world_valid.push_back(0);
+
+        if (parent != invalid_handle)
+        {
+            link_child(node, parent);
+        }
+
+        ++m_num_dirty;
+
+        // Appending keeps parents before children but breaks the ordering by depth.
+        m_order_dirty = true;
+
+        return node;
+    }
+
+    void transform_hierarchy::destroy(handle node)
+    {
+        u32 slot = get_slot(node);
+
+        // Children become root nodes.
+        handle child = m_first_child[node];
+        while (child != invalid_handle)
+        {
+            handle next_sibling = m_next_sibling[child];
+
+            u32 child_slot = get_slot(child);
+            m_parent_slots[child_slot] = invalid_slot;
+            m_dirty[child_slot] = 1;
+            ++m_num_dirty;
+
+            m_next_sibling[child] = invalid_handle;
+            m_previous_sibling[child] = invalid_handle;
+
+            child = next_sibling;
+        }
+        m_first_child[node] = invalid_handle;
+
+        if (m_parent_slots[slot] != invalid_slot)
+        {
+            unlink_child(node);
+        }
+
+        // The slot is removed by the next sort.
+        m_handles[slot] = invalid_handle;
+        m_parent_slots[slot] = invalid_slot;
+
+        m_slot_of_handle[node] = invalid_slot;
+        m_free_handles.push_back(node);
+
+        m_order_dirty = true;
+    }
+
+    void transform_hierarchy::set_parent(handle node, handle parent)
+    {
+        u32 slot = get_slot(node);
+
+        if (m_parent_slots[slot] != invalid_slot)
+        {
+            unlink_child(node);
+        }
+
+        m_parent_slots[slot] = parent != invalid_handle ? get_slot(parent) : invalid_slot;
+        m_dirty[slot] = 1;
+
+        if (parent != invalid_handle)
+        {
+            link_child(node, parent);
+        }
+
+        ++m_num_dirty;
+        m_order_dirty = true;
+    }
+
+    transform_hierarchy::handle transform_hierarchy::get_parent(handle node) const
+    {
+        u32 parent_slot = m_parent_slots[get_slot(node)];
+
+        return parent_slot != invalid_slot ? m_handles[parent_slot] : invalid_handle;
+    }
+
+    void transform_hierarchy::set_local_transform(handle node, const float4x4& localTransform)
+    {
+        u32 slot = get_slot(node);
+
+        m_local_transforms[slot] = localTransform;
+        m_dirty[slot] = 1;
+
+        ++m_num_dirty;
+    }
+
+    const float4x4& transform_hierarchy::get_local_transform(handle node) const
+    {
+        return m_local_transforms[get_slot(node)];
+    }
+
+    float4x4 transform_hierarchy::get_world_transform(handle node) const
+    {
+        u32 slot = get_slot(node);
+
+        if (!needs_update())
+        {
+            return m_world_transforms[slot];
+        }
+
+        // Dirty flags are only propagated to children by update(), walk up the hierarchy instead.
+        float4x4 world_transform = m_local_transforms[slot];
+        for (u32 parent_slot = m_parent_slots[slot]; parent_slot != invalid_slot; parent_slot = m_parent_slots[parent_slot])
+        {
+            world_transform = multiply(world_transform, m_local_transforms[parent_slot]);
+        }
+
+        return world_transform;
+    }
+
+    float4x4 transform_hierarchy::get_inverse_world_transform(handle node)
+    {
+        if (needs_update())
+        {
+            float4x4 inverse_world_transform = float4x4::identity();
+            inverse(get_world_transform(node), inverse_world_transform);
+
+            return inverse_world_transform;
+        }
+
+        u32 slot = get_slot(node);
+        if (!m_inverse_world_valid[slot])
+        {
+            if (!inverse(m_world_transforms[slot], m_inverse_world_transforms[slot]))
+            {
+                m_inverse_world_transforms[slot] = float4x4::identity();
+            }
+
+            m_inverse_world_valid[slot] = 1;
+        }
+
+        return m_inverse_world_transforms[slot];
+    }
+
+    void transform_hierarchy::update()
+    {
+        if (begin_update())
+        {
+            update_world_transforms(0, size());
+
+            end_update();
+        }
+    }
+
+    void transform_hierarchy::update(threading::thread_pool& threadPool)
+    {
+        if (!begin_update())
+        {
+            return;
+        }
+
+        u32 num_workers = threadPool.get_num_threads() + 1;
+
+        // Only the ranges of the current level are waited for, other work in the pool does not hold up the update.
+        threading::task_group level_tasks(threadPool);
+
+        for (u32 level = 0; level + 1 < m_level_offsets.size(); ++level)
+        {
+            u32 level_begin = m_level_offsets[level];
+            u32 level_end = m_level_offsets[level + 1];
+            u32 num_slots = level_end - level_begin;
+
+            if (num_slots < 2 * min_slots_per_task || num_workers == 1)
+            {
+                update_world_transforms(level_begin, level_end);
+                continue;
+            }
+
+            // Nodes within a level only read from the previous level, every range can be updated independently.
+            // Every slot is written by exactly one worker so the result does not depend on scheduling.
+            u32 num_ranges = std::min(num_workers, num_slots / min_slots_per_task);
+            u32 slots_per_range = (num_slots + num_ranges - 1) / num_ranges;
+
+            u32 range_begin = level_begin;
+            for (u32 range = 0; range < num_ranges && range_begin < level_end; ++range)
+            {
+                u32 range_end = range_begin + slots_per_range;
+                range_end = ((range_end + slots_per_range_alignment - 1) / slots_per_range_alignment) * slots_per_range_alignment;
+                range_end = std::min(range_end, level_end);
+
+                if (range_end == level_end)
+                {
+                    // The calling thread takes the last range.
+                    update_world_transforms(range_begin, range_end);
+                }
+                else
+                {
+                    level_tasks.submit([this, range_begin, range_end]() { update_world_transforms(range_begin, range_end); });
+                }
+
+                range_begin = range_end;
+            }
+
+            // The next level reads the world transforms of this level.
+            level_tasks.wait();
+        }
+
+        end_update();
+    }
+
+    bool transform_hierarchy::begin_update()
+    {
+        if (m_order_dirty)
+        {
+            sort_by_depth();
+        }
+
+        return m_num_dirty > 0;
+    }
+
+    void transform_hierarchy::end_update()
+    {
+        std::fill(m_dirty.begin(), m_dirty.end(), u8(0));
+        m_num_dirty = 0;
+    }
+
+    bool transform_hierarchy::needs_update() const
+    {
+        return m_order_dirty || m_num_dirty > 0;
+    }
+
+    u32 transform_hierarchy::size() const
+    {
+        return static_cast<u32>(m_handles.size());
+    }
+
+    void transform_hierarchy::sort_by_depth()
+    {
+        u32 num_slots = size();
+
+        // Compute the depth of every live slot. Parents can be stored after their children
+        // at this point, depths are resolved by walking up until a known depth is found.
+        constexpr u32 unknown_depth = ~0u;
+
+        std::vector<u32> depths(num_slots, unknown_depth);
+        std::vector<u32> chain;
+
+        u32 max_depth = 0;
+        for (u32 slot = 0; slot < num_slots; ++slot)
+        {
+            if (m_handles[slot] == invalid_handle || depths[slot] != unknown_depth)
+            {
+                continue;
+            }
+
+            chain.clear();
+
+            u32 current = slot;
+            while (current != invalid_slot && depths[current] == unknown_depth)
+            {
+                chain.push_back(current);
+                current = m_parent_slots[current];
+            }
+
+            u32 depth = current != invalid_slot ? depths[current] + 1 : 0;
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                depths[*it] = depth++;
+            }
+
+            max_depth = std::max(max_depth, depth - 1);
+        }
+
+        // Counting sort by depth, stable so siblings keep their relative order.
+        m_level_offsets.assign(max_depth + 2, 0);
+        for (u32 slot = 0; slot < num_slots; ++slot)
+        {
+            if (m_handles[slot] != invalid_handle)
+            {
+                ++m_level_offsets[depths[slot] + 1];
+            }
+        }
+
+        for (u32 level = 1; level < m_level_offsets.size(); ++level)
+        {
+            m_level_offsets[level] += m_level_offsets[level - 1];
+        }
+
+        u32 num_live_slots = m_level_offsets.back();
+
+        std::vector<u32> new_slots(num_slots, invalid_slot);
+        {
+            std::vector<u32> next_slot(m_level_offsets.begin(), m_level_offsets.end() - 1);
+            for (u32 slot = 0; slot < num_slots; ++slot)
+            {
+                if (m_handles[slot] != invalid_handle)
+                {
+                    new_slots[slot] = next_slot[depths[slot]]++;
+                }
+            }
+        }
+
+        std::vector<float4x4> local_transforms(num_live_slots);
+        cache_aligned_vector<float4x4> world_transforms(num_live_slots);
+        std::vector<u32> parent_slots(num_live_slots);
+        cache_aligned_vector<u8> dirty(num_live_slots);
+        std::vector<handle> handles(num_live_slots);
+        std::vector<float4x4> inverse_world_transforms(num_live_slots);
+        cache_aligned_vector<u8> inverse_world_valid(num_live_slots);
+
+        for (u32 slot = 0; slot < num_slots; ++slot)
+        {
+            u32 new_slot = new_slots[slot];
+            if (new_slot == invalid_slot)
+            {
+                continue;
+            }
+
+            u32 parent_slot = m_parent_slots[slot];
+
+            local_transforms[new_slot] = m_local_transforms[slot];
+            world_transforms[new_slot] = m_world_transforms[slot];
+            parent_slots[new_slot] = parent_slot != invalid_slot ? new_slots[parent_slot] : invalid_slot;
+            dirty[new_slot] = m_dirty[slot];
+            handles[new_slot] = m_handles[slot];
+            inverse_world_transforms[new_slot] = m_inverse_world_transforms[slot];
+            inverse_world_valid[new_slot] = m_inverse_world_valid[slot];
+
+            m_slot_of_handle[m_handles[slot]] = new_slot;
+        }
+
+        m_local_transforms.swap(local_transforms);
+        m_world_transforms.swap(world_transforms);
+        m_parent_slots.swap(parent_slots);
+        m_dirty.swap(dirty);
+        m_handles.swap(handles);
+        m_inverse_world_transforms.swap(inverse_world_transforms);
+        m_inverse_world_valid.swap(inverse_world_valid);
+
+        m_order_dirty = false;
+    }
+
+    void transform_hierarchy::update_world_transforms(u32 begin, u32 end)
+    {
+        const float4x4* local_transforms = m_local_transforms.data();
+        const u32* parent_slots = m_parent_slots.data();
+        float4x4* world_transforms = m_world_transforms.data();
+        u8* dirty = m_dirty.data();
+        u8* inverse_world_valid = m_inverse_world_valid.data();
+
+        for (u32 slot = begin; slot < end; ++slot)
+        {
+            u32 parent_slot = parent_slots[slot];
+
+            // Parents are stored first, their dirty flag is final when their children are visited.
+            if (parent_slot != invalid_slot)
+            {
+                dirty[slot] |= dirty[parent_slot];
+            }
+
+            if (dirty[slot])
+            {
+                world_transforms[slot] = parent_slot != invalid_slot
+                    ? multiply(local_transforms[slot], world_transforms[parent_slot])
+                    : local_transforms[slot];
+
+                inverse_world_valid[slot] = 0;
+            }
+        }
+    }
+
+    void transform_hierarchy::link_child(handle node, handle parent)
+    {
+        handle first_child = m_first_child[parent];
+
+        m_next_sibling[node] = first_child;
+        m_previous_sibling[node] = invalid_handle;
+
+        if (first_child != invalid_handle)
+        {
+            m_previous_sibling[first_child] = node;
+        }
+
+        m_first_child[parent] = node;
+    }
+
+    void transform_hierarchy::unlink_child(handle node)
+    {
+        handle next_sibling = m_next_sibling[node];
+        handle previous_sibling = m_previous_sibling[node];
+
+        if (previous_sibling != invalid_handle)
+        {
+            m_next_sibling[previous_sibling] = next_sibling;
+        }
+        else
+        {
+            m_first_child[get_parent(node)] = next_sibling;
+        }
+
+        if (next_sibling != invalid_handle)
+        {
+            m_previous_sibling[next_sibling] = previous_sibling;
+        }
+
+        m_next_sibling[node] = invalid_handle;
+        m_previous_sibling[node] = invalid_handle;
+    }
+
+    u32 transform_hierarchy::get_slot(handle node) const
+    {
+        assert(node < m_slot_of_handle.size() && m_slot_of_handle[node] != invalid_slot && "Invalid transform hierarchy handle.");
+
+        return m_slot_of_handle[node];
+    }
+}
\ No newline at end of file
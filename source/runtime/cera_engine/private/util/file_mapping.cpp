@@ -0,0 +1,186 @@
+#include "util/file_mapping.h"
+
+#include "util/log.h"
+
+#if defined(CERA_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+namespace cera
+{
+    file_mapping::file_mapping()
+        :m_data(nullptr)
+        ,m_size(0)
+        ,m_open(false)
+#if defined(CERA_WINDOWS)
+        ,m_file(INVALID_HANDLE_VALUE)
+        ,m_mapping(nullptr)
+#endif
+    {}
+
+    file_mapping::~file_mapping()
+    {
+        close();
+    }
+
+    file_mapping::file_mapping(file_mapping&& other) noexcept
+        :file_mapping()
+    {
+        *this = std::move(other);
+    }
+
+    file_mapping& file_mapping::operator=(file_mapping&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            std::swap(m_open, other.m_open);
+#if defined(CERA_WINDOWS)
+            std::swap(m_file, other.m_file);
+            std::swap(m_mapping, other.m_mapping);
+#endif
+        }
+
+        return *this;
+    }
+
+    bool file_mapping::open(const std::filesystem::path& path)
+    {
+        close();
+
+#if defined(CERA_WINDOWS)
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            log::error("Failed to open file: {}", path.string());
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            log::error("Failed to query the size of file: {}", path.string());
+            CloseHandle(file);
+            return false;
+        }
+
+        m_file = file;
+        m_size = static_cast<size_t>(size.QuadPart);
+        m_open = true;
+
+        // Empty files cannot be mapped.
+        if (m_size == 0)
+        {
+            return true;
+        }
+
+        m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping)
+        {
+            m_data = static_cast<const u8*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            log::error("Failed to open file: {}", path.string());
+            return false;
+        }
+
+        struct stat status;
+        if (fstat(file, &status) != 0)
+        {
+            log::error("Failed to query the size of file: {}", path.string());
+            ::close(file);
+            return false;
+        }
+
+        m_size = static_cast<size_t>(status.st_size);
+        m_open = true;
+
+        if (m_size == 0)
+        {
+            ::close(file);
+            return true;
+        }
+
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        // The mapping keeps its own reference to the file.
+        ::close(file);
+
+        if (data != MAP_FAILED)
+        {
+            // Files are mostly parsed front to back, let the OS read ahead.
+            madvise(data, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const u8*>(data);
+        }
+#endif
+
+        if (!m_data)
+        {
+            log::error("Failed to map file: {}", path.string());
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void file_mapping::close()
+    {
+#if defined(CERA_WINDOWS)
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (m_data)
+        {
+            munmap(const_cast<u8*>(m_data), m_size);
+        }
+#endif
+
+        m_data = nullptr;
+        m_size = 0;
+        m_open = false;
+    }
+
+    bool file_mapping::is_open() const
+    {
+        return m_open;
+    }
+
+    const u8* file_mapping::get_data() const
+    {
+        return m_data;
+    }
+
+    size_t file_mapping::get_size() const
+    {
+        return m_size;
+    }
+}
\ No newline at end of file
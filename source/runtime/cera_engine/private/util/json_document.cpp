@@ -0,0 +1,273 @@
+#include "util/json_document.h"
+
+#include <charconv>
+
+namespace cera
+{
+    namespace internal
+    {
+        // Deeper documents are rejected instead of overflowing the stack.
+        constexpr u32 max_json_depth = 128;
+    }
+
+    bool json_document::parse(std::string_view text)
+    {
+        m_values.clear();
+        m_children.clear();
+        m_names.clear();
+        m_child_stack.clear();
+        m_name_stack.clear();
+
+        m_cursor = text.data();
+        m_end = text.data() + text.size();
+
+        m_values.emplace_back();
+
+        skip_whitespace();
+        bool valid = parse_value(0, 0);
+        skip_whitespace();
+
+        if (!valid || m_cursor != m_end)
+        {
+            m_values.assign(1, json_value());
+            m_children.clear();
+            m_names.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    const json_value& json_document::get_root() const
+    {
+        return m_values.front();
+    }
+
+    const json_value* json_document::get_element(const json_value& array, size_t index) const
+    {
+        if (array.type != json_type::array || index >= array.num_children)
+        {
+            return nullptr;
+        }
+
+        return &m_values[m_children[array.first_child + index]];
+    }
+
+    const json_value* json_document::find_member(const json_value& object, std::string_view name) const
+    {
+        if (object.type != json_type::object)
+        {
+            return nullptr;
+        }
+
+        for (u32 i = object.first_child; i < object.first_child + object.num_children; ++i)
+        {
+            if (m_names[i] == name)
+            {
+                return &m_values[m_children[i]];
+            }
+        }
+
+        return nullptr;
+    }
+
+    double json_document::get_number(const json_value& object, std::string_view name, double fallback) const
+    {
+        const json_value* member = find_member(object, name);
+        return member && member->type == json_type::number ? member->number : fallback;
+    }
+
+    std::string_view json_document::get_string(const json_value& object, std::string_view name) const
+    {
+        const json_value* member = find_member(object, name);
+        return member && member->type == json_type::string ? member->string : std::string_view();
+    }
+
+    bool json_document::parse_value(u32 value, u32 depth)
+    {
+        if (m_cursor == m_end || depth > internal::max_json_depth)
+        {
+            return false;
+        }
+
+        switch (*m_cursor)
+        {
+        case '{':
+        case '[':
+        {
+            bool is_object = *m_cursor == '{';
+            char closing = is_object ? '}' : ']';
+            ++m_cursor;
+
+            // Children are collected on a stack while nested values are parsed, then moved next to each other.
+            size_t stack_begin = m_child_stack.size();
+
+            skip_whitespace();
+            if (m_cursor < m_end && *m_cursor == closing)
+            {
+                ++m_cursor;
+            }
+            else
+            {
+                while (true)
+                {
+                    std::string_view name;
+                    if (is_object)
+                    {
+                        if (!parse_string(name))
+                        {
+                            return false;
+                        }
+
+                        skip_whitespace();
+                        if (m_cursor == m_end || *m_cursor != ':')
+                        {
+                            return false;
+                        }
+                        ++m_cursor;
+                        skip_whitespace();
+                    }
+
+                    u32 child = static_cast<u32>(m_values.size());
+                    m_values.emplace_back();
+                    m_child_stack.push_back(child);
+                    m_name_stack.push_back(name);
+
+                    if (!parse_value(child, depth + 1))
+                    {
+                        return false;
+                    }
+
+                    skip_whitespace();
+                    if (m_cursor == m_end)
+                    {
+                        return false;
+                    }
+
+                    if (*m_cursor == ',')
+                    {
+                        ++m_cursor;
+                        skip_whitespace();
+                        continue;
+                    }
+
+                    if (*m_cursor != closing)
+                    {
+                        return false;
+                    }
+
+                    ++m_cursor;
+                    break;
+                }
+            }
+
+            json_value& result = m_values[value];
+            result.type = is_object ? json_type::object : json_type::array;
+            result.first_child = static_cast<u32>(m_children.size());
+            result.num_children = static_cast<u32>(m_child_stack.size() - stack_begin);
+
+            m_children.insert(m_children.end(), m_child_stack.begin() + stack_begin, m_child_stack.end());
+            m_names.insert(m_names.end(), m_name_stack.begin() + stack_begin, m_name_stack.end());
+            m_child_stack.resize(stack_begin);
+            m_name_stack.resize(stack_begin);
+
+            return true;
+        }
+        case '"':
+        {
+            std::string_view string;
+            if (!parse_string(string))
+            {
+                return false;
+            }
+
+            m_values[value].type = json_type::string;
+            m_values[value].string = string;
+            return true;
+        }
+        case 't':
+            m_values[value].type = json_type::boolean;
+            m_values[value].boolean = true;
+            return parse_literal("true");
+        case 'f':
+            m_values[value].type = json_type::boolean;
+            return parse_literal("false");
+        case 'n':
+            return parse_literal("null");
+        default:
+        {
+            double number;
+            if (!parse_number(number))
+            {
+                return false;
+            }
+
+            m_values[value].type = json_type::number;
+            m_values[value].number = number;
+            return true;
+        }
+        }
+    }
+
+    bool json_document::parse_string(std::string_view& string)
+    {
+        if (m_cursor == m_end || *m_cursor != '"')
+        {
+            return false;
+        }
+
+        const char* begin = ++m_cursor;
+        while (m_cursor < m_end && *m_cursor != '"')
+        {
+            // Skip the escaped character, it may be a quote.
+            m_cursor += *m_cursor == '\\' ? 2 : 1;
+        }
+
+        if (m_cursor >= m_end)
+        {
+            return false;
+        }
+
+        string = std::string_view(begin, m_cursor - begin);
+        ++m_cursor;
+
+        return true;
+    }
+
+    bool json_document::parse_number(double& number)
+    {
+        if (*m_cursor != '-' && (*m_cursor < '0' || *m_cursor > '9'))
+        {
+            return false;
+        }
+
+        // from_chars does not depend on the locale, unlike strtod.
+        std::from_chars_result result = std::from_chars(m_cursor, m_end, number);
+        if (result.ec != std::errc())
+        {
+            return false;
+        }
+
+        m_cursor = result.ptr;
+        return true;
+    }
+
+    bool json_document::parse_literal(std::string_view literal)
+    {
+        if (static_cast<size_t>(m_end - m_cursor) < literal.size() || std::string_view(m_cursor, literal.size()) != literal)
+        {
+            return false;
+        }
+
+        m_cursor += literal.size();
+        return true;
+    }
+
+    void json_document::skip_whitespace()
+    {
+        while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\t' || *m_cursor == '\n' || *m_cursor == '\r'))
+        {
+            ++m_cursor;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace cera
+{
+    enum class json_type : u8
+    {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object
+    };
+
+    /**
+     * A value of a json document. Strings point into the parsed text, escape sequences are left as they are.
+     */
+    struct json_value
+    {
+        json_type type = json_type::null;
+
+        bool boolean = false;
+        double number = 0.0;
+        std::string_view string;
+
+        // Range of the elements or members in the child list of the document.
+        u32 first_child = 0;
+        u32 num_children = 0;
+    };
+
+    /**
+     * Read only json document that is parsed in place.
+     * The text must outlive the document, values reference it instead of copying strings.
+     */
+    class json_document
+    {
+    public:
+        /**
+         * @returns false when the text is not valid json, the document is empty.
+         */
+        bool parse(std::string_view text);
+
+        const json_value& get_root() const;
+
+        /**
+         * Retrieve an element of an array.
+         * @returns nullptr when the value is not an array or the index is out of range.
+         */
+        const json_value* get_element(const json_value& array, size_t index) const;
+
+        /**
+         * Retrieve a member of an object by name.
+         * @returns nullptr when the value is not an object or has no member with that name.
+         */
+        const json_value* find_member(const json_value& object, std::string_view name) const;
+
+        /**
+         * Retrieve a numeric member, the fallback is returned when it is missing or not a number.
+         */
+        double get_number(const json_value& object, std::string_view name, double fallback) const;
+
+        /**
+         * Retrieve a string member, an empty string is returned when it is missing or not a string.
+         */
+        std::string_view get_string(const json_value& object, std::string_view name) const;
+
+    private:
+        bool parse_value(u32 value, u32 depth);
+        bool parse_string(std::string_view& string);
+        bool parse_number(double& number);
+        bool parse_literal(std::string_view literal);
+
+        void skip_whitespace();
+
+    private:
+        std::vector<json_value> m_values;
+
+        // Children of all arrays and objects, the children of one value are stored consecutively.
+        std::vector<u32> m_children;
+        // Member names, parallel to m_children. Array elements have no name.
+        std::vector<std::string_view> m_names;
+
+        // Children of the values that are being parsed.
+        std::vector<u32> m_child_stack;
+        std::vector<std::string_view> m_name_stack;
+
+        const char* m_cursor = nullptr;
+        const char* m_end = nullptr;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "util/threading/thread_pool.h"
+
+#if defined(CERA_WINDOWS)
+#include "util/threading/thread_helpers.h"
+#endif
+
+#include <algorithm>
+
+namespace cera
+{
+    namespace threading
+    {
+        thread_pool::thread_pool(u32 numThreads, const char* name)
+            : m_num_active_tasks(0)
+            , m_stop(false)
+        {
+            if (numThreads == 0)
+            {
+                // Leave one hardware thread for the thread that submits the work.
+                u32 hardware_threads = std::thread::hardware_concurrency();
+                numThreads = std::max(hardware_threads, 2u) - 1;
+            }
+
+            m_threads.reserve(numThreads);
+            for (u32 i = 0; i < numThreads; ++i)
+            {
+                m_threads.emplace_back(&thread_pool::worker_main, this);
+
+#if defined(CERA_WINDOWS)
+                set_thread_name(m_threads.back(), name);
+#else
+                (void)name;
+#endif
+            }
+        }
+
+        thread_pool::~thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+
+            m_task_available_cv.notify_all();
+
+            for (std::thread& thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        void thread_pool::submit(task task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.push(std::move(task));
+            }
+
+            m_task_available_cv.notify_one();
+        }
+
+        void thread_pool::wait_idle()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_idle_cv.wait(lock, [this]() { return m_tasks.empty() && m_num_active_tasks == 0; });
+        }
+
+        u32 thread_pool::get_num_threads() const
+        {
+            return static_cast<u32>(m_threads.size());
+        }
+
+        void thread_pool::worker_main()
+        {
+            while (true)
+            {
+                task task;
+
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_task_available_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+
+                    // Remaining tasks are still executed when the pool is destroyed.
+                    if (m_tasks.empty())
+                    {
+                        return;
+                    }
+
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop();
+                    ++m_num_active_tasks;
+                }
+
+                task();
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    --m_num_active_tasks;
+
+                    if (m_tasks.empty() && m_num_active_tasks == 0)
+                    {
+                        m_idle_cv.notify_all();
+                    }
+                }
+            }
+        }
+
+        task_group::task_group(thread_pool& threadPool)
+            : m_thread_pool(threadPool)
+            , m_num_pending_tasks(0)
+        {}
+
+        task_group::~task_group()
+        {
+            wait();
+        }
+
+        void task_group::submit(thread_pool::task task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_num_pending_tasks;
+            }
+
+            m_thread_pool.submit([this, task = std::move(task)]()
+            {
+                task();
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_num_pending_tasks == 0)
+                {
+                    m_done_cv.notify_all();
+                }
+            });
+        }
+
+        void task_group::wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done_cv.wait(lock, [this]() { return m_num_pending_tasks == 0; });
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "vertex_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CERA_ENCODER_SSE 1
+#include <emmintrin.h>
+#else
+#define CERA_ENCODER_SSE 0
+#endif
+
+namespace cera
+{
+    namespace internal
+    {
+        constexpr float unorm16_max = 65535.0f;
+        constexpr float snorm16_max = 32767.0f;
+
+        inline void read_floats(const void* data, size_t vertex, size_t stride, u32 count, float* values)
+        {
+            memcpy(values, static_cast<const u8*>(data) + vertex * stride, count * sizeof(float));
+        }
+
+        inline u8* get_output(void* output, size_t vertex, size_t stride)
+        {
+            return static_cast<u8*>(output) + vertex * stride;
+        }
+
+        inline u16 encode_unorm16(float value, float offset, float inverseScale)
+        {
+            float normalized = std::min(std::max((value - offset) * inverseScale, 0.0f), 1.0f);
+            return static_cast<u16>(std::lrint(normalized * unorm16_max));
+        }
+
+        inline void encode_octahedral(const float* direction, s16* encoded)
+        {
+            float length = std::fabs(direction[0]) + std::fabs(direction[1]) + std::fabs(direction[2]);
+            float inverse_length = length > 0.0f ? 1.0f / length : 0.0f;
+
+            float x = direction[0] * inverse_length;
+            float y = direction[1] * inverse_length;
+
+            // The lower hemisphere is folded over the diagonals of the octahedron.
+            if (direction[2] < 0.0f)
+            {
+                float folded_x = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                float folded_y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = folded_x;
+                y = folded_y;
+            }
+
+            encoded[0] = static_cast<s16>(std::lrint(std::min(std::max(x, -1.0f), 1.0f) * snorm16_max));
+            encoded[1] = static_cast<s16>(std::lrint(std::min(std::max(y, -1.0f), 1.0f) * snorm16_max));
+        }
+
+        inline void encode_rgba8(const float* color, u8* encoded)
+        {
+            for (u32 channel = 0; channel < 4; ++channel)
+            {
+                encoded[channel] = static_cast<u8>(conversions::f32_to_uint8(color[channel]));
+            }
+        }
+    }
+
+    namespace vertex_encoder
+    {
+        position_quantization compute_position_quantization(const void* positions, size_t numVertices, size_t inputStride)
+        {
+            position_quantization quantization;
+
+            if (numVertices == 0)
+            {
+                return quantization;
+            }
+
+            float min_position[3];
+            float max_position[3];
+            internal::read_floats(positions, 0, inputStride, 3, min_position);
+            memcpy(max_position, min_position, sizeof(max_position));
+
+            for (size_t vertex = 1; vertex < numVertices; ++vertex)
+            {
+                float position[3];
+                internal::read_floats(positions, vertex, inputStride, 3, position);
+
+                for (u32 axis = 0; axis < 3; ++axis)
+                {
+                    min_position[axis] = std::min(min_position[axis], position[axis]);
+                    max_position[axis] = std::max(max_position[axis], position[axis]);
+                }
+            }
+
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                // Flat axes keep a scale of 1, all their positions encode to 0.
+                float extent = max_position[axis] - min_position[axis];
+                quantization.scale[axis] = extent > 0.0f ? extent : 1.0f;
+                quantization.offset[axis] = min_position[axis];
+            }
+
+            return quantization;
+        }
+
+        void encode_positions_unorm16(const void* positions, size_t numVertices, size_t inputStride, const position_quantization& quantization, void* output, size_t outputStride)
+        {
+            float inverse_scale[3];
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                inverse_scale[axis] = 1.0f / quantization.scale[axis];
+            }
+
+            size_t vertex = 0;
+
+#if CERA_ENCODER_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 unorm_max = _mm_set1_ps(internal::unorm16_max);
+
+            for (; vertex + 4 <= numVertices; vertex += 4)
+            {
+                // Transpose 4 positions to one register per axis.
+                alignas(16) float soa[3][4];
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    float position[3];
+                    internal::read_floats(positions, vertex + i, inputStride, 3, position);
+
+                    soa[0][i] = position[0];
+                    soa[1][i] = position[1];
+                    soa[2][i] = position[2];
+                }
+
+                alignas(16) s32 encoded[3][4];
+                for (u32 axis = 0; axis < 3; ++axis)
+                {
+                    __m128 normalized = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(soa[axis]), _mm_set1_ps(quantization.offset[axis])), _mm_set1_ps(inverse_scale[axis]));
+                    normalized = _mm_min_ps(_mm_max_ps(normalized, zero), one);
+
+                    // Rounds to nearest like lrint in the scalar loop.
+                    _mm_store_si128(reinterpret_cast<__m128i*>(encoded[axis]), _mm_cvtps_epi32(_mm_mul_ps(normalized, unorm_max)));
+                }
+
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    u16 packed[4] = { static_cast<u16>(encoded[0][i]), static_cast<u16>(encoded[1][i]), static_cast<u16>(encoded[2][i]), 0 };
+                    memcpy(internal::get_output(output, vertex + i, outputStride), packed, sizeof(packed));
+                }
+            }
+#endif
+
+            for (; vertex < numVertices; ++vertex)
+            {
+                float position[3];
+                internal::read_floats(positions, vertex, inputStride, 3, position);
+
+                u16 packed[4];
+                for (u32 axis = 0; axis < 3; ++axis)
+                {
+                    packed[axis] = internal::encode_unorm16(position[axis], quantization.offset[axis], inverse_scale[axis]);
+                }
+                packed[3] = 0;
+
+                memcpy(internal::get_output(output, vertex, outputStride), packed, sizeof(packed));
+            }
+        }
+
+        void encode_directions_octahedral(const void* directions, size_t numVertices, size_t inputStride, void* output, size_t outputStride)
+        {
+            size_t vertex = 0;
+
+#if CERA_ENCODER_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 minus_one = _mm_set1_ps(-1.0f);
+            const __m128 sign_mask = _mm_set1_ps(-0.0f);
+            const __m128 snorm_max = _mm_set1_ps(internal::snorm16_max);
+
+            for (; vertex + 4 <= numVertices; vertex += 4)
+            {
+                alignas(16) float soa[3][4];
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    float direction[3];
+                    internal::read_floats(directions, vertex + i, inputStride, 3, direction);
+
+                    soa[0][i] = direction[0];
+                    soa[1][i] = direction[1];
+                    soa[2][i] = direction[2];
+                }
+
+                __m128 x = _mm_load_ps(soa[0]);
+                __m128 y = _mm_load_ps(soa[1]);
+                __m128 z = _mm_load_ps(soa[2]);
+
+                __m128 length = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign_mask, x), _mm_andnot_ps(sign_mask, y)), _mm_andnot_ps(sign_mask, z));
+                __m128 inverse_length = _mm_and_ps(_mm_cmpgt_ps(length, zero), _mm_div_ps(one, length));
+
+                x = _mm_mul_ps(x, inverse_length);
+                y = _mm_mul_ps(y, inverse_length);
+
+                // Fold the lower hemisphere, the sign of zero counts as positive.
+                __m128 sign_x = _mm_or_ps(one, _mm_and_ps(_mm_cmplt_ps(x, zero), sign_mask));
+                __m128 sign_y = _mm_or_ps(one, _mm_and_ps(_mm_cmplt_ps(y, zero), sign_mask));
+                __m128 folded_x = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, y)), sign_x);
+                __m128 folded_y = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, x)), sign_y);
+
+                __m128 lower = _mm_cmplt_ps(z, zero);
+                x = _mm_or_ps(_mm_and_ps(lower, folded_x), _mm_andnot_ps(lower, x));
+                y = _mm_or_ps(_mm_and_ps(lower, folded_y), _mm_andnot_ps(lower, y));
+
+                alignas(16) s32 encoded[2][4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(encoded[0]), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(x, minus_one), one), snorm_max)));
+                _mm_store_si128(reinterpret_cast<__m128i*>(encoded[1]), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(y, minus_one), one), snorm_max)));
+
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    s16 packed[2] = { static_cast<s16>(encoded[0][i]), static_cast<s16>(encoded[1][i]) };
+                    memcpy(internal::get_output(output, vertex + i, outputStride), packed, sizeof(packed));
+                }
+            }
+#endif
+
+            for (; vertex < numVertices; ++vertex)
+            {
+                float direction[3];
+                internal::read_floats(directions, vertex, inputStride, 3, direction);
+
+                s16 packed[2];
+                internal::encode_octahedral(direction, packed);
+
+                memcpy(internal::get_output(output, vertex, outputStride), packed, sizeof(packed));
+            }
+        }
+
+        void encode_colors_rgba8(const void* colors, size_t numVertices, size_t inputStride, u32 numChannels, void* output, size_t outputStride)
+        {
+            numChannels = std::min(std::max(numChannels, 3u), 4u);
+
+            size_t vertex = 0;
+
+#if CERA_ENCODER_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 max_value = _mm_set1_ps(255.0f);
+            const __m128 half = _mm_set1_ps(0.5f);
+
+            for (; vertex + 4 <= numVertices; vertex += 4)
+            {
+                __m128i encoded[4];
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    float color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                    internal::read_floats(colors, vertex + i, inputStride, numChannels, color);
+
+                    // Truncates after adding a half like conversions::f32_to_uint8.
+                    __m128 saturated = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(color), zero), one);
+                    encoded[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(saturated, max_value), half));
+                }
+
+                __m128i packed = _mm_packus_epi16(_mm_packs_epi32(encoded[0], encoded[1]), _mm_packs_epi32(encoded[2], encoded[3]));
+
+                alignas(16) u32 packed_colors[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(packed_colors), packed);
+
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    memcpy(internal::get_output(output, vertex + i, outputStride), &packed_colors[i], sizeof(u32));
+                }
+            }
+#endif
+
+            for (; vertex < numVertices; ++vertex)
+            {
+                float color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                internal::read_floats(colors, vertex, inputStride, numChannels, color);
+
+                u8 packed[4];
+                internal::encode_rgba8(color, packed);
+
+                memcpy(internal::get_output(output, vertex, outputStride), packed, sizeof(packed));
+            }
+        }
+
+        void decode_position_unorm16(const u16* encoded, const position_quantization& quantization, float* position)
+        {
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                position[axis] = static_cast<float>(encoded[axis]) / internal::unorm16_max * quantization.scale[axis] + quantization.offset[axis];
+            }
+        }
+
+        void decode_direction_octahedral(const s16* encoded, float* direction)
+        {
+            // SNORM expands -32768 and -32767 to -1.
+            float x = std::max(static_cast<float>(encoded[0]) / internal::snorm16_max, -1.0f);
+            float y = std::max(static_cast<float>(encoded[1]) / internal::snorm16_max, -1.0f);
+            float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+            // Unfold the lower hemisphere.
+            float t = std::max(-z, 0.0f);
+            x += x >= 0.0f ? -t : t;
+            y += y >= 0.0f ? -t : t;
+
+            float length = std::sqrt(x * x + y * y + z * z);
+            direction[0] = x / length;
+            direction[1] = y / length;
+            direction[2] = z / length;
+        }
+    }
+}
\ No newline at end of file
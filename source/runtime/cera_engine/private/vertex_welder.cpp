@@ -0,0 +1,410 @@
+#include "vertex_welder.h"
+
+#include "util/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CERA_WELDER_SSE 1
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#else
+#define CERA_WELDER_SSE 0
+#endif
+
+namespace cera
+{
+    namespace internal
+    {
+        constexpr u32 empty_weld_slot = ~0u;
+        constexpr u64 empty_weld_entry = ~0ull;
+
+        // Table slots of vertices this far ahead are prefetched, the table is too large for the caches.
+        constexpr u32 weld_prefetch_distance = 16;
+
+        // Cells are at least this many epsilons wide, a vertex is near at most one neighbour cell per axis and
+        // most vertices are near none.
+        constexpr float weld_cell_epsilons = 4.0f;
+        // Largest number of cells along an axis, cell coordinates of larger grids lose precision in float.
+        constexpr float max_weld_cells = 32768.0f;
+        // Margin for the rounding of cell coordinates, in cells.
+        constexpr float weld_border_margin = 1.0f / 64.0f;
+
+        // Spatial hash of Teschner et al. 2003, finished with a Fibonacci hash so the table uses the high bits.
+        constexpr u32 weld_hash_primes[3] = { 73856093u, 19349663u, 83492791u };
+        constexpr u32 weld_hash_multiplier = 0x9E3779B1u;
+
+        inline u32 hash_weld_cell(const s32* cell)
+        {
+            u32 hash = (static_cast<u32>(cell[0]) * weld_hash_primes[0]) ^ (static_cast<u32>(cell[1]) * weld_hash_primes[1]) ^ (static_cast<u32>(cell[2]) * weld_hash_primes[2]);
+            return hash * weld_hash_multiplier;
+        }
+
+        inline const float* get_weld_components(const welder_attribute& attribute, size_t vertex)
+        {
+            return reinterpret_cast<const float*>(static_cast<const u8*>(attribute.data) + vertex * attribute.stride);
+        }
+
+        inline s32 get_exact_weld_cell(float value)
+        {
+            // -0 and +0 are equal and share a cell.
+            value = value == 0.0f ? 0.0f : value;
+
+            s32 bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+#if CERA_WELDER_SSE
+        // 32 bit multiply of every lane, SSE2 only multiplies the even lanes.
+        inline __m128i multiply_epi32(__m128i a, __m128i b)
+        {
+            __m128i even = _mm_mul_epu32(a, b);
+            __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        }
+#endif
+    }
+
+    bool vertex_welder::weld(const welder_input& input, welder_result& result)
+    {
+        if (!validate(input))
+        {
+            return false;
+        }
+
+        u32 num_vertices = static_cast<u32>(input.num_vertices);
+
+        compute_cells(input.attributes.front(), num_vertices);
+
+        size_t table_size = 16;
+        m_table_shift = 28;
+        while (table_size < 2 * static_cast<size_t>(num_vertices))
+        {
+            table_size *= 2;
+            --m_table_shift;
+        }
+
+        m_table.assign(table_size, internal::empty_weld_entry);
+        m_remap.resize(num_vertices);
+
+        u32 num_kept = 0;
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+#if CERA_WELDER_SSE
+            if (vertex + internal::weld_prefetch_distance < num_vertices)
+            {
+                _mm_prefetch(reinterpret_cast<const char*>(&m_table[m_hashes[vertex + internal::weld_prefetch_distance] >> m_table_shift]), _MM_HINT_T0);
+            }
+#endif
+
+            const s32* cell = &m_cells[vertex * 3];
+
+            u32 insert_slot = internal::empty_weld_slot;
+            u32 match = find(input, vertex, m_hashes[vertex], &insert_slot);
+
+            // Visit the neighbour cells the vertex is near to, every combination of axes is one cell.
+            u8 neighbours = m_neighbours[vertex];
+            for (u32 axes = 1; axes < 8 && match == internal::empty_weld_slot && neighbours != 0; ++axes)
+            {
+                s32 neighbour[3] = { cell[0], cell[1], cell[2] };
+
+                bool valid = true;
+                for (u32 axis = 0; axis < 3 && valid; ++axis)
+                {
+                    if (axes & (1u << axis))
+                    {
+                        u32 direction = (neighbours >> (axis * 2)) & 3u;
+                        valid = direction != 0;
+                        neighbour[axis] += direction == 1 ? -1 : 1;
+                    }
+                }
+
+                if (valid)
+                {
+                    match = find(input, vertex, internal::hash_weld_cell(neighbour), nullptr);
+                }
+            }
+
+            if (match != internal::empty_weld_slot)
+            {
+                m_remap[vertex] = m_remap[match];
+                continue;
+            }
+
+            m_table[insert_slot] = (static_cast<u64>(m_hashes[vertex]) << 32) | vertex;
+            m_remap[vertex] = num_kept++;
+        }
+
+        // Kept vertices only move towards the front, they are compacted in place.
+        u32 next_vertex = 0;
+        for (u32 vertex = 0; vertex < num_vertices; ++vertex)
+        {
+            if (m_remap[vertex] != next_vertex)
+            {
+                continue;
+            }
+
+            if (vertex != next_vertex)
+            {
+                for (const welder_attribute& attribute : input.attributes)
+                {
+                    u8* data = static_cast<u8*>(attribute.data);
+                    memmove(data + next_vertex * attribute.stride, data + vertex * attribute.stride, attribute.num_components * sizeof(float));
+                }
+            }
+
+            ++next_vertex;
+        }
+
+        size_t num_indices = 0;
+        for (size_t i = 0; i < input.num_indices; i += 3)
+        {
+            u32 a = m_remap[input.indices[i + 0]];
+            u32 b = m_remap[input.indices[i + 1]];
+            u32 c = m_remap[input.indices[i + 2]];
+
+            if (a == b || b == c || c == a)
+            {
+                continue;
+            }
+
+            input.indices[num_indices++] = a;
+            input.indices[num_indices++] = b;
+            input.indices[num_indices++] = c;
+        }
+
+        result.num_vertices = num_kept;
+        result.num_indices = num_indices;
+
+        return true;
+    }
+
+    bool vertex_welder::validate(const welder_input& input) const
+    {
+        if (input.num_vertices >= internal::empty_weld_slot || input.attributes.empty() || input.attributes.front().num_components != 3
+            || (!input.indices && input.num_indices > 0) || input.num_indices % 3 != 0)
+        {
+            log::error("Invalid vertex welder input");
+            return false;
+        }
+
+        for (const welder_attribute& attribute : input.attributes)
+        {
+            if (!attribute.data || attribute.num_components == 0 || attribute.stride < attribute.num_components * sizeof(float) || !(attribute.epsilon >= 0.0f) || std::isinf(attribute.epsilon))
+            {
+                log::error("Invalid vertex welder attribute");
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < input.num_indices; ++i)
+        {
+            if (input.indices[i] >= input.num_vertices)
+            {
+                log::error("Vertex welder input indexes a vertex out of range");
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void vertex_welder::compute_cells(const welder_attribute& position, size_t numVertices)
+    {
+        m_cells.resize(numVertices * 3);
+        m_hashes.resize(numVertices);
+        m_neighbours.assign(numVertices, 0);
+
+        // Without an epsilon positions are hashed by their bits, only equal positions share a cell.
+        bool exact = position.epsilon == 0.0f;
+
+        if (!exact)
+        {
+            float min_position[3] = { 0.0f, 0.0f, 0.0f };
+            float max_position[3] = { 0.0f, 0.0f, 0.0f };
+            for (size_t vertex = 0; vertex < numVertices; ++vertex)
+            {
+                const float* components = internal::get_weld_components(position, vertex);
+                for (u32 axis = 0; axis < 3; ++axis)
+                {
+                    min_position[axis] = vertex == 0 ? components[axis] : std::min(min_position[axis], components[axis]);
+                    max_position[axis] = vertex == 0 ? components[axis] : std::max(max_position[axis], components[axis]);
+                }
+            }
+
+            float max_extent = std::max({ max_position[0] - min_position[0], max_position[1] - min_position[1], max_position[2] - min_position[2] });
+
+            m_cell_size = std::max(position.epsilon * internal::weld_cell_epsilons, max_extent / internal::max_weld_cells);
+            m_inverse_cell_size = 1.0f / m_cell_size;
+            m_border = position.epsilon * m_inverse_cell_size + internal::weld_border_margin;
+            memcpy(m_origin, min_position, sizeof(m_origin));
+        }
+
+        size_t vertex = 0;
+
+#if CERA_WELDER_SSE
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 inverse_cell_size = _mm_set1_ps(m_inverse_cell_size);
+        const __m128 lower_border = _mm_set1_ps(m_border);
+        const __m128 upper_border = _mm_set1_ps(1.0f - m_border);
+
+        for (; vertex + 4 <= numVertices; vertex += 4)
+        {
+            // Transpose 4 positions to one register per axis.
+            alignas(16) float soa[3][4];
+            for (u32 i = 0; i < 4; ++i)
+            {
+                const float* components = internal::get_weld_components(position, vertex + i);
+
+                soa[0][i] = components[0];
+                soa[1][i] = components[1];
+                soa[2][i] = components[2];
+            }
+
+            __m128i cells[3];
+            u32 neighbour_masks[3][2] = {};
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                __m128 values = _mm_load_ps(soa[axis]);
+
+                if (exact)
+                {
+                    cells[axis] = _mm_castps_si128(_mm_and_ps(values, _mm_cmpneq_ps(values, zero)));
+                    continue;
+                }
+
+                // Positions are relative to the bounds, truncation rounds down.
+                __m128 local = _mm_mul_ps(_mm_sub_ps(values, _mm_set1_ps(m_origin[axis])), inverse_cell_size);
+                cells[axis] = _mm_cvttps_epi32(local);
+
+                __m128 fraction = _mm_sub_ps(local, _mm_cvtepi32_ps(cells[axis]));
+                neighbour_masks[axis][0] = _mm_movemask_ps(_mm_cmplt_ps(fraction, lower_border));
+                neighbour_masks[axis][1] = _mm_movemask_ps(_mm_cmpgt_ps(fraction, upper_border));
+            }
+
+            __m128i hashes = _mm_xor_si128(_mm_xor_si128(
+                internal::multiply_epi32(cells[0], _mm_set1_epi32(static_cast<s32>(internal::weld_hash_primes[0]))),
+                internal::multiply_epi32(cells[1], _mm_set1_epi32(static_cast<s32>(internal::weld_hash_primes[1])))),
+                internal::multiply_epi32(cells[2], _mm_set1_epi32(static_cast<s32>(internal::weld_hash_primes[2]))));
+            hashes = internal::multiply_epi32(hashes, _mm_set1_epi32(static_cast<s32>(internal::weld_hash_multiplier)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&m_hashes[vertex]), hashes);
+
+            alignas(16) s32 soa_cells[3][4];
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                _mm_store_si128(reinterpret_cast<__m128i*>(soa_cells[axis]), cells[axis]);
+            }
+
+            for (u32 i = 0; i < 4; ++i)
+            {
+                u8 neighbours = 0;
+                for (u32 axis = 0; axis < 3; ++axis)
+                {
+                    m_cells[(vertex + i) * 3 + axis] = soa_cells[axis][i];
+
+                    u32 direction = ((neighbour_masks[axis][0] >> i) & 1u) | (((neighbour_masks[axis][1] >> i) & 1u) << 1);
+                    neighbours |= static_cast<u8>(direction << (axis * 2));
+                }
+
+                m_neighbours[vertex + i] = neighbours;
+            }
+        }
+#endif
+
+        for (; vertex < numVertices; ++vertex)
+        {
+            const float* components = internal::get_weld_components(position, vertex);
+            s32* cell = &m_cells[vertex * 3];
+
+            u8 neighbours = 0;
+            for (u32 axis = 0; axis < 3; ++axis)
+            {
+                if (exact)
+                {
+                    cell[axis] = internal::get_exact_weld_cell(components[axis]);
+                    continue;
+                }
+
+                float local = (components[axis] - m_origin[axis]) * m_inverse_cell_size;
+                cell[axis] = static_cast<s32>(local);
+
+                float fraction = local - static_cast<float>(cell[axis]);
+                u32 direction = fraction < m_border ? 1u : (fraction > 1.0f - m_border ? 2u : 0u);
+                neighbours |= static_cast<u8>(direction << (axis * 2));
+            }
+
+            m_hashes[vertex] = internal::hash_weld_cell(cell);
+            m_neighbours[vertex] = neighbours;
+        }
+    }
+
+    bool vertex_welder::match(const welder_input& input, u32 vertex, u32 other) const
+    {
+        for (const welder_attribute& attribute : input.attributes)
+        {
+            const float* a = internal::get_weld_components(attribute, vertex);
+            const float* b = internal::get_weld_components(attribute, other);
+
+            u32 component = 0;
+
+#if CERA_WELDER_SSE
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            const __m128 epsilon = _mm_set1_ps(attribute.epsilon);
+
+            // Attributes of 3 components are compared in one iteration, the fourth lane compares zeros.
+            for (; component < attribute.num_components; component += 4)
+            {
+                u32 count = std::min(attribute.num_components - component, 4u);
+
+                alignas(16) float lanes[2][4] = {};
+                memcpy(lanes[0], a + component, count * sizeof(float));
+                memcpy(lanes[1], b + component, count * sizeof(float));
+
+                __m128 difference = _mm_andnot_ps(sign, _mm_sub_ps(_mm_load_ps(lanes[0]), _mm_load_ps(lanes[1])));
+                if (_mm_movemask_ps(_mm_cmple_ps(difference, epsilon)) != 0xF)
+                {
+                    return false;
+                }
+            }
+#endif
+
+            for (; component < attribute.num_components; ++component)
+            {
+                if (!(std::fabs(a[component] - b[component]) <= attribute.epsilon))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    u32 vertex_welder::find(const welder_input& input, u32 vertex, u32 hash, u32* insertSlot) const
+    {
+        u32 mask = static_cast<u32>(m_table.size() - 1);
+
+        // Entries store the hash next to the vertex, the attributes of other cells in the chain are not read.
+        u32 slot = hash >> m_table_shift;
+        for (u64 entry = m_table[slot]; entry != internal::empty_weld_entry; entry = m_table[slot])
+        {
+            u32 other = static_cast<u32>(entry);
+            if (static_cast<u32>(entry >> 32) == hash && match(input, vertex, other))
+            {
+                return other;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+
+        if (insertSlot)
+        {
+            *insertSlot = slot;
+        }
+
+        return internal::empty_weld_slot;
+    }
+}
\ No newline at end of file
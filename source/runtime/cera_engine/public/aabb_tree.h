@@ -0,0 +1,159 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "bounding_volume.h"
+
+#include <functional>
+#include <vector>
+
+namespace cera
+{
+    struct frustum;
+
+    /**
+     * Dynamic bounding volume hierarchy of axis aligned boxes.
+     *
+     * Leaves store a box that is fattened by a margin so small movements do not change the tree.
+     * Insertion picks the sibling with the lowest surface area cost and tree rotations keep the
+     * tree balanced. Proxies stay valid until they are removed, their indices are reused afterwards.
+     */
+    class aabb_tree
+    {
+    public:
+        using proxy = u32;
+
+        static constexpr proxy invalid_proxy = ~0u;
+
+        /**
+         * Called for every proxy whose box is hit by a ray.
+         * Return the distance of the actual hit to shorten the ray, or the current maximum distance to ignore the proxy.
+         */
+        using raycast_callback = std::function<float(proxy hitProxy, float maxDistance)>;
+
+        /**
+         * @param margin Distance added on every side of the leaf boxes.
+         */
+        explicit aabb_tree(float margin = 0.1f);
+
+        proxy insert(const bounding_box& box, u32 userData = 0);
+        void remove(proxy leaf);
+
+        /**
+         * Move a proxy to a new box.
+         * Nothing changes while the box stays inside the fattened box of the proxy, otherwise the proxy is reinserted.
+         * @returns true when the proxy was reinserted.
+         */
+        bool move(proxy leaf, const bounding_box& box);
+
+        /**
+         * Move a proxy without changing the structure of the tree.
+         * Ancestors that do not contain the new box are grown right away, so queries stay correct,
+         * but they are not shrunk. The next refit() recomputes them tightly and visits every ancestor once
+         * no matter how many of its descendants moved. Cheaper than move() when many proxies move a
+         * little every frame, proxies that move far should be moved with move() to keep the tree tight.
+         * @returns true when the fattened box changed and a refit is required.
+         */
+        bool move_deferred(proxy leaf, const bounding_box& box);
+
+        /**
+         * Recompute the boxes of the ancestors of all proxies moved with move_deferred().
+         */
+        void refit();
+
+        /**
+         * Remove all proxies.
+         */
+        void clear();
+
+        u32 get_user_data(proxy leaf) const;
+        const bounding_box& get_fat_bounds(proxy leaf) const;
+
+        /**
+         * Append all proxies whose fattened box intersects the query volume to results.
+         * Subtrees that are completely inside a frustum are added without testing their children.
+         */
+        void query(const bounding_box& box, std::vector<proxy>& results) const;
+        void query(const bounding_sphere& sphere, std::vector<proxy>& results) const;
+        void query(const frustum& frustum, std::vector<proxy>& results) const;
+
+        /**
+         * Cast a ray through the tree, closer children are visited first.
+         *
+         * @param direction Direction of the ray, does not have to be normalized. Distances are in multiples of its length.
+         */
+        void raycast(const float3& origin, const float3& direction, float maxDistance, const raycast_callback& callback) const;
+
+        /**
+         * Number of proxies in the tree.
+         */
+        u32 size() const;
+
+        /**
+         * Height of the tree, 0 for a single leaf.
+         */
+        s32 get_height() const;
+
+        /**
+         * Sum of the surface areas of all internal nodes relative to the root, lower is better.
+         */
+        float get_area_ratio() const;
+
+    private:
+        static constexpr u32 invalid_node = ~0u;
+
+        struct node
+        {
+            bounding_box box;
+
+            // Next free node when the node is not used.
+            u32 parent;
+            u32 child1;
+            u32 child2;
+
+            // 0 for leaves, -1 for free nodes.
+            s32 height;
+
+            u32 user_data;
+
+            // Set by move_deferred(), cleared by refit().
+            bool moved;
+
+            bool is_leaf() const { return child1 == invalid_node; }
+        };
+
+        u32 allocate_node();
+        void free_node(u32 index);
+
+        void insert_leaf(u32 leaf);
+        void remove_leaf(u32 leaf);
+
+        /**
+         * Rotate the tree at a node when its children differ in height by more than one.
+         * @returns The node that takes the place of the given node.
+         */
+        u32 balance(u32 index);
+
+        /**
+         * Walk up from a node, recomputing heights and boxes and balancing the tree.
+         */
+        void fix_upwards(u32 index);
+
+        bounding_box fatten(const bounding_box& box) const;
+
+    private:
+        std::vector<node> m_nodes;
+
+        u32 m_root;
+        u32 m_free_list;
+        u32 m_num_leaves;
+
+        float m_margin;
+
+        // Leaves moved by move_deferred() since the last refit().
+        std::vector<u32> m_moved_leaves;
+
+        // Scratch memory of refit().
+        std::vector<u32> m_refit_nodes;
+    };
+}
\ No newline at end of file
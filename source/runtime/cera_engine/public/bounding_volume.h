@@ -0,0 +1,78 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "transform_hierarchy.h"
+
+#include <cstddef>
+
+namespace cera
+{
+    struct float3
+    {
+        float x;
+        float y;
+        float z;
+    };
+
+    /**
+     * Axis aligned bounding box.
+     */
+    struct bounding_box
+    {
+        float3 min;
+        float3 max;
+
+        /**
+         * A box that contains nothing, expanding it by a point results in a box around that point.
+         */
+        static bounding_box empty();
+
+        bool is_empty() const;
+
+        void expand(const float3& point);
+
+        float3 get_center() const;
+        float3 get_extents() const;
+    };
+
+    struct bounding_sphere
+    {
+        float3 center;
+        float radius;
+    };
+
+    /**
+     * Compute the bounding box of a set of positions.
+     *
+     * @param positions Pointer to the first position, every position is 3 floats.
+     * @param count The number of positions.
+     * @param stride The distance in bytes between two positions, usually the size of a vertex.
+     */
+    bounding_box compute_bounding_box(const void* positions, size_t count, size_t stride);
+
+    /**
+     * Compute a bounding sphere of a set of positions.
+     * The sphere is centered on the bounding box, the radius is the distance to the furthest position.
+     */
+    bounding_sphere compute_bounding_sphere(const bounding_box& box, const void* positions, size_t count, size_t stride);
+
+    /**
+     * Intersect a ray with a bounding box.
+     *
+     * @param direction Direction of the ray, distances are in multiples of its length.
+     * @param distance Receives the distance at which the ray enters the box, 0 when the origin is inside the box.
+     * @returns false when the ray misses the box or enters it beyond maxDistance.
+     */
+    bool intersect_ray(const bounding_box& box, const float3& origin, const float3& direction, float maxDistance, float& distance);
+
+    /**
+     * Transform a bounding box, the result is the box around the transformed corners.
+     */
+    bounding_box transform(const bounding_box& box, const float4x4& matrix);
+
+    /**
+     * Transform a bounding sphere, the radius is scaled by the largest scale of the matrix.
+     */
+    bounding_sphere transform(const bounding_sphere& sphere, const float4x4& matrix);
+}
\ No newline at end of file
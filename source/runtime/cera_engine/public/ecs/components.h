@@ -0,0 +1,66 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "bounding_volume.h"
+#include "transform_hierarchy.h"
+
+#include <memory>
+
+namespace cera
+{
+    class mesh;
+
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    namespace ecs
+    {
+        class registry;
+
+        /**
+         * World transform of an entity, written by game code or a simulation system.
+         */
+        struct world_transform
+        {
+            float4x4 matrix = float4x4::identity();
+        };
+
+        /**
+         * A mesh drawn by scene with the world transform of the entity.
+         */
+        struct mesh_instance
+        {
+            std::shared_ptr<cera::mesh> mesh;
+            // Level of detail drawn last frame, updated by the scene when levels of detail are selected.
+            u8 lod = 0;
+        };
+
+        /**
+         * Object space bounds of the mesh of an entity, mesh::get_bounding_box() of meshes with bounds.
+         * Entities keep their own copy so the world bounds are updated without reading the meshes.
+         */
+        struct local_bounds
+        {
+            bounding_box box = bounding_box::empty();
+        };
+
+        /**
+         * World space bounds of the mesh of an entity, see update_world_bounds().
+         * Used by the scene for culling instead of transforming the mesh bounds every draw.
+         */
+        struct world_bounds
+        {
+            bounding_box box = bounding_box::empty();
+        };
+
+        /**
+         * Recompute the world bounds of all entities with a world transform, local bounds and world bounds.
+         * Empty local bounds result in empty world bounds.
+         * Chunks are processed on the worker threads of a thread pool when one is given.
+         */
+        void update_world_bounds(registry& registry, threading::thread_pool* threadPool = nullptr);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,410 @@
+#pragma once
+
+#include "util/types.h"
+#include "util/aligned_allocator.h"
+#include "util/threading/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cera
+{
+    namespace ecs
+    {
+        /**
+         * Handle of an entity. The generation changes when the index of a destroyed entity is reused,
+         * handles of destroyed entities never refer to a new entity.
+         */
+        struct entity
+        {
+            u32 index = ~0u;
+            u32 generation = 0;
+
+            bool operator==(const entity& other) const { return index == other.index && generation == other.generation; }
+            bool operator!=(const entity& other) const { return !(*this == other); }
+        };
+
+        constexpr u32 max_component_types = 64;
+
+        /**
+         * One bit per component type.
+         */
+        using component_mask = u64;
+
+        namespace internal
+        {
+            /**
+             * Type erased operations on a component type.
+             */
+            struct component_type
+            {
+                u32 size;
+                u32 alignment;
+                void (*move_construct)(void* destination, void* source);
+                void (*destroy)(void* component);
+            };
+
+            u32 register_component_type(const component_type& type);
+            const component_type& get_component_type(u32 id);
+
+            template <typename T>
+            void move_construct(void* destination, void* source)
+            {
+                new (destination) T(std::move(*static_cast<T*>(source)));
+            }
+
+            template <typename T>
+            void destroy(void* component)
+            {
+                static_cast<T*>(component)->~T();
+            }
+        }
+
+        /**
+         * Identifier of a component type, assigned the first time it is requested.
+         */
+        template <typename T>
+        u32 get_component_id()
+        {
+            static const u32 id = internal::register_component_type({ sizeof(T), alignof(T), &internal::move_construct<T>, &internal::destroy<T> });
+            return id;
+        }
+
+        template <typename... Components>
+        component_mask get_component_mask()
+        {
+            return (component_mask(0) | ... | (component_mask(1) << get_component_id<Components>()));
+        }
+
+        /**
+         * Storage of all entities with the same set of components.
+         *
+         * Entities are stored in fixed size chunks. Within a chunk every component type is stored in its
+         * own array (structure of arrays), iterating a component touches only the memory of that component.
+         * Rows are kept dense, removing an entity moves the last entity of the archetype into its place.
+         */
+        class archetype
+        {
+        public:
+            static constexpr size_t chunk_size = 16 * 1024;
+
+            struct chunk
+            {
+                std::vector<u8, memory::aligned_allocator<u8>> data;
+                u32 count = 0;
+            };
+
+            explicit archetype(component_mask mask);
+            ~archetype();
+
+            archetype(const archetype&) = delete;
+            archetype& operator=(const archetype&) = delete;
+
+            component_mask get_mask() const { return m_mask; }
+            bool has_component(u32 componentId) const { return (m_mask >> componentId) & 1; }
+
+            u32 get_chunk_capacity() const { return m_chunk_capacity; }
+            size_t get_num_chunks() const { return m_chunks.size(); }
+            chunk& get_chunk(size_t index) { return *m_chunks[index]; }
+
+            /**
+             * Number of entities stored in this archetype.
+             */
+            size_t size() const;
+
+            entity* get_entities(chunk& chunk) const
+            {
+                return reinterpret_cast<entity*>(chunk.data.data());
+            }
+
+            void* get_components(chunk& chunk, u32 componentId) const
+            {
+                assert(has_component(componentId));
+                return chunk.data.data() + m_offsets[componentId];
+            }
+
+            template <typename T>
+            T* get_components(chunk& chunk) const
+            {
+                return static_cast<T*>(get_components(chunk, get_component_id<T>()));
+            }
+
+            void* get_component(u32 chunkIndex, u32 row, u32 componentId) const
+            {
+                return static_cast<u8*>(get_components(*m_chunks[chunkIndex], componentId)) + row * internal::get_component_type(componentId).size;
+            }
+
+            /**
+             * Append a row for an entity, the components of the row are not constructed.
+             */
+            void allocate_row(entity entity, u32& chunkIndex, u32& row);
+
+            /**
+             * Remove a row whose components were already destroyed or moved from.
+             * The last row is moved into its place.
+             * @returns The entity that was moved, an invalid entity when the removed row was the last.
+             */
+            entity remove_row(u32 chunkIndex, u32 row);
+
+            /**
+             * Destroy all components of a row.
+             */
+            void destroy_row(u32 chunkIndex, u32 row);
+
+            const std::vector<u32>& get_component_ids() const { return m_component_ids; }
+
+        private:
+            friend class registry;
+
+            component_mask m_mask;
+            std::vector<u32> m_component_ids;
+            // Byte offset of every component array in a chunk, indexed by component id.
+            u32 m_offsets[max_component_types];
+            u32 m_chunk_capacity;
+            size_t m_chunk_bytes;
+
+            std::vector<std::unique_ptr<chunk>> m_chunks;
+
+            // Archetypes reached by adding or removing a component, filled on first use.
+            std::unordered_map<u32, archetype*> m_add_edges;
+            std::unordered_map<u32, archetype*> m_remove_edges;
+        };
+
+        /**
+         * Archetype based entity component store.
+         *
+         * Entities with the same component types share an archetype, queries visit only the archetypes that
+         * contain all requested components and iterate their chunks linearly. Components are plain structs,
+         * they must be move constructible.
+         *
+         * Adding or removing components and creating or destroying entities must not happen while entities
+         * are iterated. The registry is not thread safe, parallel_for_each only reads the structure.
+         */
+        class registry
+        {
+        public:
+            registry();
+            ~registry();
+
+            registry(const registry&) = delete;
+            registry& operator=(const registry&) = delete;
+
+            template <typename... Components>
+            entity create(Components&&... components)
+            {
+                archetype& target = get_archetype(get_component_mask<std::decay_t<Components>...>());
+
+                entity new_entity = allocate_entity();
+                entity_record& record = m_records[new_entity.index];
+                record.archetype = &target;
+                target.allocate_row(new_entity, record.chunk, record.row);
+
+                (new (target.get_component(record.chunk, record.row, get_component_id<std::decay_t<Components>>())) std::decay_t<Components>(std::forward<Components>(components)), ...);
+
+                return new_entity;
+            }
+
+            void destroy(entity entity);
+            bool is_alive(entity entity) const;
+
+            /**
+             * Add a component to an entity, an existing component of the same type is replaced.
+             * The entity moves to another archetype, pointers to its components become invalid.
+             */
+            template <typename T>
+            T& add_component(entity entity, T&& component)
+            {
+                using component_t = std::decay_t<T>;
+
+                u32 id = get_component_id<component_t>();
+                if (component_t* existing = get_component<component_t>(entity))
+                {
+                    *existing = std::forward<T>(component);
+                    return *existing;
+                }
+
+                const entity_record& record = move_entity(entity, id, true);
+                return *new (record.archetype->get_component(record.chunk, record.row, id)) component_t(std::forward<T>(component));
+            }
+
+            template <typename T>
+            void remove_component(entity entity)
+            {
+                if (has_component<T>(entity))
+                {
+                    move_entity(entity, get_component_id<T>(), false);
+                }
+            }
+
+            /**
+             * @returns nullptr when the entity does not exist or does not have the component.
+             */
+            template <typename T>
+            T* get_component(entity entity)
+            {
+                if (!is_alive(entity))
+                {
+                    return nullptr;
+                }
+
+                const entity_record& record = m_records[entity.index];
+                u32 id = get_component_id<T>();
+                if (!record.archetype->has_component(id))
+                {
+                    return nullptr;
+                }
+
+                return static_cast<T*>(record.archetype->get_component(record.chunk, record.row, id));
+            }
+
+            template <typename T>
+            bool has_component(entity entity) const
+            {
+                return is_alive(entity) && m_records[entity.index].archetype->has_component(get_component_id<T>());
+            }
+
+            /**
+             * Call a function for every chunk of entities that have all requested components.
+             * The function receives the number of entities, their handles and one array per component:
+             * function(u32 count, const entity* entities, Components*... components).
+             *
+             * @param excludedComponents Entities with any of these components are skipped, see get_component_mask().
+             */
+            template <typename... Components, typename Function>
+            void for_each_chunk(Function&& function, component_mask excludedComponents = 0)
+            {
+                component_mask mask = get_component_mask<Components...>();
+
+                for (archetype* a : m_archetype_list)
+                {
+                    if ((a->get_mask() & mask) != mask || (a->get_mask() & excludedComponents) != 0)
+                    {
+                        continue;
+                    }
+
+                    for (size_t i = 0; i < a->get_num_chunks(); ++i)
+                    {
+                        archetype::chunk& c = a->get_chunk(i);
+                        function(c.count, static_cast<const entity*>(a->get_entities(c)), a->get_components<Components>(c)...);
+                    }
+                }
+            }
+
+            /**
+             * Call a function for every entity that has all requested components: function(Components&... components).
+             */
+            template <typename... Components, typename Function>
+            void for_each(Function&& function)
+            {
+                for_each_chunk<Components...>([&function](u32 count, const entity*, Components*... components)
+                {
+                    for (u32 i = 0; i < count; ++i)
+                    {
+                        function(components[i]...);
+                    }
+                });
+            }
+
+            /**
+             * Same as for_each(), chunks are split across the worker threads of a thread pool and the calling thread.
+             * The function is called concurrently for different entities.
+             * The thread pool must not execute other work while this function runs.
+             */
+            template <typename... Components, typename Function>
+            void parallel_for_each(threading::thread_pool& threadPool, Function&& function)
+            {
+                component_mask mask = get_component_mask<Components...>();
+
+                m_parallel_chunks.clear();
+                for (archetype* a : m_archetype_list)
+                {
+                    if ((a->get_mask() & mask) == mask)
+                    {
+                        for (size_t i = 0; i < a->get_num_chunks(); ++i)
+                        {
+                            m_parallel_chunks.push_back({ a, &a->get_chunk(i) });
+                        }
+                    }
+                }
+
+                // Workers take chunks one at a time so archetypes of different sizes balance out.
+                std::atomic<size_t> next_chunk(0);
+                auto process_chunks = [this, &next_chunk, &function]()
+                {
+                    for (size_t i = next_chunk++; i < m_parallel_chunks.size(); i = next_chunk++)
+                    {
+                        archetype* a = m_parallel_chunks[i].first;
+                        archetype::chunk& c = *m_parallel_chunks[i].second;
+
+                        process_chunk<Components...>(c.count, function, a->get_components<Components>(c)...);
+                    }
+                };
+
+                size_t num_tasks = std::min<size_t>(threadPool.get_num_threads(), m_parallel_chunks.size() > 0 ? m_parallel_chunks.size() - 1 : 0);
+                for (size_t i = 0; i < num_tasks; ++i)
+                {
+                    threadPool.submit(process_chunks);
+                }
+
+                process_chunks();
+
+                threadPool.wait_idle();
+            }
+
+            /**
+             * Number of living entities.
+             */
+            size_t size() const;
+
+            /**
+             * Number of archetypes, every distinct set of components creates one.
+             */
+            size_t get_num_archetypes() const;
+
+        private:
+            struct entity_record
+            {
+                ecs::archetype* archetype = nullptr;
+                u32 chunk = 0;
+                u32 row = 0;
+                u32 generation = 0;
+            };
+
+            template <typename... Components, typename Function>
+            static void process_chunk(u32 count, Function& function, Components*... components)
+            {
+                for (u32 i = 0; i < count; ++i)
+                {
+                    function(components[i]...);
+                }
+            }
+
+            entity allocate_entity();
+            archetype& get_archetype(component_mask mask);
+
+            /**
+             * Move an entity to the archetype with one component added or removed.
+             * Shared components are moved, a removed component is destroyed and an added component is left unconstructed.
+             */
+            const entity_record& move_entity(entity entity, u32 componentId, bool add);
+
+        private:
+            std::unordered_map<component_mask, std::unique_ptr<archetype>> m_archetypes;
+            // Archetypes in creation order, iterated by queries.
+            std::vector<archetype*> m_archetype_list;
+
+            std::vector<entity_record> m_records;
+            std::vector<u32> m_free_indices;
+            size_t m_num_entities;
+
+            std::vector<std::pair<archetype*, archetype::chunk*>> m_parallel_chunks;
+        };
+    }
+}
\ No newline at end of file
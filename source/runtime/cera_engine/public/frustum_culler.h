@@ -0,0 +1,89 @@
+#pragma once
+
+#include "util/types.h"
+#include "util/aligned_allocator.h"
+
+#include "bounding_volume.h"
+
+#include <vector>
+
+namespace cera
+{
+    /**
+     * Plane equation, points p with dot(normal, p) + distance >= 0 are on the inside.
+     */
+    struct plane
+    {
+        float3 normal;
+        float distance;
+    };
+
+    /**
+     * The six planes of a view frustum, the normals point inwards.
+     */
+    struct frustum
+    {
+        static constexpr u32 num_planes = 6;
+
+        plane planes[num_planes];
+
+        /**
+         * Extract the frustum planes from a view projection matrix (row vectors, depth in [0, 1]).
+         * Using a world view projection matrix results in a frustum in object space.
+         */
+        static frustum from_view_projection(const float4x4& viewProjection);
+    };
+
+    /**
+     * Tests many bounding boxes against a frustum at once.
+     *
+     * Boxes are stored as centers and extents in separate arrays (structure of arrays) so
+     * every SIMD register holds the same component of consecutive boxes. AVX tests 8 boxes
+     * per iteration, SSE 4, platforms without either fall back to a scalar loop.
+     */
+    class frustum_culler
+    {
+    public:
+        /**
+         * Remove all boxes, allocated memory is kept.
+         */
+        void clear();
+        void reserve(size_t count);
+
+        /**
+         * Add a bounding box, boxes are numbered in the order they are added.
+         * Empty boxes (objects without bounds) are never culled.
+         */
+        u32 add(const bounding_box& box);
+
+        size_t size() const;
+
+        /**
+         * Test all boxes against a frustum.
+         * Boxes that intersect or are inside the frustum are conservatively reported as visible.
+         *
+         * @param visibility Receives one entry per box, 1 when the box is visible and 0 when it is culled.
+         * @returns The number of visible boxes.
+         */
+        u32 cull(const frustum& frustum, std::vector<u8>& visibility) const;
+
+    private:
+        // Number of boxes tested per iteration of the widest SIMD path, arrays are padded to this size.
+        static constexpr u32 batch_size = 8;
+
+        void cull_scalar(const frustum& frustum, u32 begin, u32 end, u8* visibility) const;
+        void cull_simd(const frustum& frustum, u32 begin, u32 end, u8* visibility) const;
+
+        template <typename T>
+        using cache_aligned_vector = std::vector<T, memory::aligned_allocator<T>>;
+
+        cache_aligned_vector<float> m_center_x;
+        cache_aligned_vector<float> m_center_y;
+        cache_aligned_vector<float> m_center_z;
+        cache_aligned_vector<float> m_extents_x;
+        cache_aligned_vector<float> m_extents_y;
+        cache_aligned_vector<float> m_extents_z;
+
+        u32 m_num_boxes = 0;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "util/types.h"
+#include "util/aligned_allocator.h"
+
+#include "bounding_volume.h"
+
+#include <vector>
+
+namespace cera
+{
+    /**
+     * Selects a level of detail for many objects at once.
+     *
+     * An object is drawn with the coarsest level whose error, projected to the screen at the distance
+     * of the object, stays below a number of pixels. Switching to a coarser level requires the error to
+     * be below that limit by a margin (hysteresis) so objects near the limit do not switch back and forth.
+     *
+     * Bounding spheres are stored in separate arrays (structure of arrays). The allowed world space error
+     * of 4 objects is computed per SSE iteration, the levels are then picked by comparing against it.
+     */
+    class lod_selector
+    {
+    public:
+        /**
+         * Factor that converts a world space size at distance 1 to pixels.
+         *
+         * @param projection Perspective projection matrix (row vectors).
+         * @param viewportHeight Height of the viewport in pixels.
+         */
+        static float get_projection_scale(const float4x4& projection, float viewportHeight);
+
+        /**
+         * Remove all objects, allocated memory is kept.
+         */
+        void clear();
+        void reserve(size_t count);
+
+        /**
+         * Add an object, objects are numbered in the order they are added.
+         *
+         * @param worldSphere World space bounding sphere of the object.
+         * @param errorScale Converts object space errors to world space, the largest scale of the world transform.
+         * @param lodErrors Object space error of every level, increasing. Must stay valid until select() returns.
+         * @param numLods Number of levels, 0 is treated as 1.
+         * @param previousLod Level selected for the object last frame.
+         */
+        u32 add(const bounding_sphere& worldSphere, float errorScale, const float* lodErrors, u32 numLods, u32 previousLod);
+
+        size_t size() const;
+
+        /**
+         * Select the level of detail of all objects.
+         *
+         * @param cameraPosition World space position of the camera.
+         * @param projectionScale See get_projection_scale().
+         * @param maxPixelError Largest error on screen, in pixels.
+         * @param hysteresis Fraction of maxPixelError a coarser level must stay below before it is selected.
+         * @param lods Receives one entry per object.
+         */
+        void select(const float3& cameraPosition, float projectionScale, float maxPixelError, float hysteresis, std::vector<u8>& lods) const;
+
+    private:
+        // Number of objects processed per SIMD iteration.
+        static constexpr u32 batch_size = 4;
+
+        // Compute the largest world space error allowed for every object.
+        void compute_allowed_errors(const float3& cameraPosition, float errorPerDistance) const;
+
+        template <typename T>
+        using cache_aligned_vector = std::vector<T, memory::aligned_allocator<T>>;
+
+        cache_aligned_vector<float> m_center_x;
+        cache_aligned_vector<float> m_center_y;
+        cache_aligned_vector<float> m_center_z;
+        cache_aligned_vector<float> m_radius;
+        // Inverse of the error scale, divides the allowed world space error into object space.
+        cache_aligned_vector<float> m_inverse_error_scale;
+
+        std::vector<const float*> m_lod_errors;
+        std::vector<u8> m_num_lods;
+        std::vector<u8> m_previous_lods;
+
+        // Allowed object space error, written by select().
+        mutable cache_aligned_vector<float> m_allowed_errors;
+
+        u32 m_num_objects = 0;
+    };
+}
\ No newline at end of file
@@ -4,13 +4,20 @@
 
 #include "render/d3dx12_declarations.h"
 
+#include "bounding_volume.h"
+#include "meshlet_builder.h"
+#include "occlusion_culler.h"
+#include "vertex_encoder.h"
+
 #include <map>
 #include <memory>
+#include <vector>
 
 namespace cera
 {
     class vertex_buffer;
     class index_buffer;
+    class geometry_allocation;
 
     class command_list;
 
@@ -34,10 +41,10 @@ namespace cera
         std::shared_ptr<index_buffer>           get_index_buffer() const;
 
         /**
-         * Get the number if indices in the index buffer.
+         * Get the number if indices in the index buffer of a level of detail.
          * If no index buffer is bound to the mesh, this function returns 0.
          */
-        size_t                                  get_index_count() const;
+        size_t                                  get_index_count(u32 lod = 0) const;
 
         /**
          * Get the number of vertices in the mesh.
@@ -45,19 +52,156 @@ namespace cera
          */
         size_t                                  get_vertex_count() const;
 
+        /**
+         * Meshes packed into shared buffers draw a range of them, see mesh_factory::create_meshes.
+         * Indices of all levels of detail are relative to the base vertex.
+         */
+        void                                    set_vertex_range(u32 baseVertex, u32 numVertices);
+        u32                                     get_base_vertex() const;
+
+        /**
+         * Draw a range of the index buffer of a level of detail, add the level first.
+         * Levels without a range draw their whole index buffer.
+         */
+        void                                    set_index_range(u32 lod, u32 firstIndex, u32 numIndices);
+        u32                                     get_first_index(u32 lod = 0) const;
+
+        /**
+         * Draw from ranges of the geometry pool. The buffers of the allocation become vertex buffer 0 and the
+         * index buffer, the mesh keeps the allocation alive. Meshes packed into one allocation share it.
+         */
+        void                                    set_geometry(const std::shared_ptr<const geometry_allocation>& geometry);
+        const std::shared_ptr<const geometry_allocation>& get_geometry() const;
+
+        /**
+         * Whether binding this mesh binds the same topology and buffers as binding the other mesh.
+         * Meshes in the same page of the geometry pool do, their binds can be skipped.
+         */
+        bool                                    has_same_bindings(u32 lod, const mesh& other, u32 otherLod) const;
+
+        /**
+         * Unique identifier of this mesh, used to group draws of the same mesh.
+         */
+        u32                                     get_id() const;
+
+        /**
+         * Object space bounds of the mesh, used to cull the mesh before it is drawn.
+         * Meshes without bounds are never culled.
+         */
+        void                                    set_bounds(const bounding_box& box, const bounding_sphere& sphere);
+        const bounding_box&                     get_bounding_box() const;
+        const bounding_sphere&                  get_bounding_sphere() const;
+        bool                                    has_bounds() const;
+
+        /**
+         * Maps packed positions of the vertex buffers back to object space, the vertex shader applies it
+         * before the world transform. Meshes with float positions keep the identity quantization.
+         */
+        void                                    set_position_quantization(const position_quantization& quantization);
+        const position_quantization&            get_position_quantization() const;
+
+        /**
+         * Levels of detail share the vertex buffers of the mesh and replace its index buffer.
+         * Level 0 is the index buffer of the mesh, coarser levels are added in order.
+         *
+         * @param error Object space distance between the surface of this level and the full detail surface.
+         * Errors must increase with every level.
+         * @returns false when the level was not added.
+         */
+        bool                                    add_lod(const std::shared_ptr<index_buffer>& indexBuffer, float error);
+        void                                    clear_lods();
+
+        /**
+         * Number of levels of detail, including level 0.
+         */
+        u32                                     get_num_lods() const;
+        std::shared_ptr<index_buffer>           get_lod_index_buffer(u32 lod) const;
+        float                                   get_lod_error(u32 lod) const;
+
+        /**
+         * Errors of all levels of detail, get_num_lods() entries.
+         */
+        const float*                            get_lod_errors() const;
+
+        /**
+         * Geometry rasterized when the mesh is used as an occluder, see scene::enable_occlusion_culling.
+         * Meshes without occluder geometry never hide other meshes.
+         */
+        void                                    set_occluder(const std::shared_ptr<const occluder_geometry>& occluder);
+        const std::shared_ptr<const occluder_geometry>& get_occluder() const;
+
+        /**
+         * Meshlets of level 0, ranges of its index buffer that can be culled separately (see meshlet_builder).
+         * Meshes without meshlets are always drawn as a whole.
+         */
+        void                                    set_meshlets(std::vector<meshlet> meshlets);
+        const std::vector<meshlet>&             get_meshlets() const;
+
         /**
          * Draw the mesh to a CommandList.
          *
          * @param commandList The command list to draw to.
          * @param instanceCount The number of instances to draw.
          * @param startInstance The offset added to the instance ID when reading from the instance buffers.
+         * @param lod The level of detail to draw.
+         */
+        void                                    draw(command_list& commandList, u32 instanceCount = 1, u32 startInstance = 0, u32 lod = 0) const;
+
+        /**
+         * Bind the primitive topology, vertex buffers and the index buffer of a level of detail.
+         */
+        void                                    bind(command_list& commandList, u32 lod = 0) const;
+
+        /**
+         * Draw the mesh assuming its buffers are already bound to the command list.
+         * Consecutive draws of the same mesh and level of detail only have to bind it once.
+         */
+        void                                    draw_bound(command_list& commandList, u32 instanceCount = 1, u32 startInstance = 0, u32 lod = 0) const;
+
+        /**
+         * Draw a range of the indices of level 0, see draw_bound.
+         * The first index is relative to the index range of the mesh.
          */
-        void                                    draw(command_list& commandList, u32 instanceCount = 1, u32 startInstance = 0);
+        void                                    draw_bound_range(command_list& commandList, u32 firstIndex, u32 indexCount, u32 instanceCount = 1, u32 startInstance = 0) const;
+
+    private:
+        struct index_range
+        {
+            u32 first_index;
+            u32 num_indices;
+        };
+
+        // Range of the level, nullptr when the level draws its whole index buffer.
+        const index_range*              find_index_range(u32 lod) const;
 
     private:
         buffer_map                      m_vertex_buffers;
         std::shared_ptr<index_buffer>   m_index_buffer;
 
+        // Index buffers of level 1 and up, level 0 is m_index_buffer.
+        std::vector<std::shared_ptr<index_buffer>> m_lod_index_buffers;
+        // Error of every level, starting with 0 for level 0.
+        std::vector<float>              m_lod_errors;
+
+        // Ranges of shared buffers, the vertex count is 0 when the mesh owns its buffers.
+        u32                             m_base_vertex;
+        u32                             m_num_vertices;
+        // One range per level, empty when the mesh owns its index buffers.
+        std::vector<index_range>        m_index_ranges;
+        // Allocation of the shared buffers, nullptr when the mesh owns its buffers.
+        std::shared_ptr<const geometry_allocation> m_geometry;
+
         D3D12_PRIMITIVE_TOPOLOGY        m_primitive_topology;
+
+        u32                             m_id;
+
+        bounding_box                    m_bounding_box;
+        bounding_sphere                 m_bounding_sphere;
+
+        position_quantization           m_position_quantization;
+
+        std::shared_ptr<const occluder_geometry> m_occluder;
+
+        std::vector<meshlet>            m_meshlets;
     };
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "mesh_cooker.h"
+
+#include <filesystem>
+
+namespace cera
+{
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    /**
+     * On-disk representation of a cooked model.
+     *
+     * Vertex and index buffers are stored exactly as they are uploaded, a loader maps the file and copies
+     * the buffers straight from the mapping into upload memory. Buffers are aligned to data_alignment
+     * relative to the start of the file so they are copied with aligned loads.
+     *
+     * Layout (little endian):
+     *   header
+     *   node_record  nodes[node_count]
+     *   mesh_record  meshes[mesh_count]
+     *   lod_record   lods[lod_count]
+     *   u32          links[link_count]   (root nodes, then the meshes and children of every node)
+     *   char         names[names_size]
+     *   u8           data[data_size]     (vertex, index and meshlet buffers, starts at data_offset)
+     */
+    struct mesh_cache_file
+    {
+        static constexpr u32 magic = 0x4853454d; // 'MESH'
+        // Bump the version when the cooker output changes, caches of older versions are rejected.
+        static constexpr u32 version = 2;
+
+        static constexpr u64 data_alignment = 64;
+
+        struct header
+        {
+            u32 magic;
+            u32 version;
+            u32 node_count;
+            u32 mesh_count;
+            u32 lod_count;
+            u32 link_count;
+            u32 root_count;
+            u32 reserved;
+            u64 names_size;
+            u64 data_offset;
+            u64 data_size;
+            // Checksum of the records, links and names. Buffers are only range checked, hashing them would cost as much as loading them.
+            u64 checksum;
+        };
+
+        struct node_record
+        {
+            float local_transform[16];
+            u32 name_offset;
+            u32 name_size;
+            // Ranges of the link array.
+            u32 first_mesh;
+            u32 mesh_count;
+            u32 first_child;
+            u32 child_count;
+        };
+
+        struct mesh_record
+        {
+            u32 format;
+            u32 vertex_stride;
+            u32 vertex_count;
+            u32 index_size;
+            u32 index_count;
+            u32 first_lod;
+            u32 lod_count;
+            u32 meshlet_count;
+            float box[6];
+            float sphere[4];
+            float quantization_scale[3];
+            float quantization_offset[3];
+            // Offsets relative to the data section.
+            u64 vertex_offset;
+            u64 index_offset;
+            u64 meshlet_offset;
+        };
+
+        struct lod_record
+        {
+            u32 index_count;
+            float error;
+            u64 index_offset;
+        };
+    };
+
+    namespace mesh_cache_io
+    {
+        /**
+         * Convert a cooked model to a contiguous block of memory.
+         */
+        blob serialize(const cooked_model& model);
+
+        /**
+         * Read a cooked model in place, the views point into the data which must outlive them.
+         * Index values are not validated, out of range indices read zeros on the GPU.
+         *
+         * @returns false when the data is truncated, corrupt or was written by a different version.
+         */
+        bool read(const u8* data, size_t size, cooked_model_view& model);
+
+        /**
+         * Write a cooked model to disk.
+         */
+        bool save(const std::filesystem::path& path, const cooked_model& model);
+
+        /**
+         * Offline cook step: import a model file, cook it and write the cache to disk.
+         *
+         * @param threadPool When set, the model is imported and cooked in parallel.
+         */
+        bool cook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, vertex_format format, threading::thread_pool* threadPool = nullptr);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "bounding_volume.h"
+#include "meshlet_builder.h"
+#include "model_importer.h"
+#include "vertex_encoder.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cera
+{
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    /**
+     * Vertex layout of cooked meshes.
+     * Packed meshes use vertex_packed_pos_color and need a vertex shader that applies the position quantization of the mesh.
+     */
+    enum class vertex_format : u32
+    {
+        pos_color,
+        packed_pos_color
+    };
+
+    /**
+     * Vertices and triangles to cook, every vertex holds a position and a color of 3 floats each.
+     * Vertices are read with a stride so interleaved vertex data can be passed as is.
+     */
+    struct cooker_input
+    {
+        // Vertices and indices are welded and reordered in place.
+        void* vertices = nullptr;
+        size_t num_vertices = 0;
+        size_t vertex_stride = 0;
+
+        size_t position_offset = 0;
+        size_t color_offset = 0;
+
+        u32* indices = nullptr;
+        size_t num_indices = 0;
+    };
+
+    struct cooked_lod
+    {
+        blob indices;
+        float error = 0.0f;
+    };
+
+    /**
+     * GPU ready data of a mesh, buffers are stored exactly as they are uploaded.
+     */
+    struct cooked_mesh
+    {
+        vertex_format format = vertex_format::pos_color;
+
+        u32 vertex_stride = 0;
+        u32 num_vertices = 0;
+        blob vertices;
+
+        // 2 or 4 bytes, levels of detail use the index size of the mesh.
+        u32 index_size = 0;
+        blob indices;
+
+        std::vector<cooked_lod> lods;
+        std::vector<meshlet> meshlets;
+
+        bounding_box box;
+        bounding_sphere sphere;
+        position_quantization quantization;
+    };
+
+    /**
+     * Cooked meshes and the node hierarchy of a model.
+     */
+    struct cooked_model
+    {
+        std::vector<cooked_mesh> meshes;
+        std::vector<imported_node> nodes;
+        std::vector<u32> root_nodes;
+    };
+
+    struct cooked_lod_view
+    {
+        const void* indices = nullptr;
+        u32 num_indices = 0;
+        float error = 0.0f;
+    };
+
+    /**
+     * Cooked mesh data that is referenced instead of owned, either by a cooked_mesh or by a mapped mesh cache file.
+     */
+    struct cooked_mesh_view
+    {
+        vertex_format format = vertex_format::pos_color;
+
+        u32 vertex_stride = 0;
+        u32 num_vertices = 0;
+        const void* vertices = nullptr;
+
+        u32 index_size = 0;
+        u32 num_indices = 0;
+        const void* indices = nullptr;
+
+        std::vector<cooked_lod_view> lods;
+
+        const meshlet* meshlets = nullptr;
+        u32 num_meshlets = 0;
+
+        bounding_box box;
+        bounding_sphere sphere;
+        position_quantization quantization;
+    };
+
+    struct cooked_model_view
+    {
+        std::vector<cooked_mesh_view> meshes;
+        std::vector<imported_node> nodes;
+        std::vector<u32> root_nodes;
+    };
+
+    /**
+     * Prepares geometry for the GPU: duplicate vertices are merged, triangles are ordered for the vertex caches,
+     * split into meshlets and simplified to a chain of levels of detail, vertices are encoded in the requested
+     * format and indices are narrowed to 16 bit when the vertex count allows it.
+     *
+     * Cooking is free of graphics API calls, it runs at load time in mesh_factory or offline to write mesh caches.
+     */
+    namespace mesh_cooker
+    {
+        /**
+         * Cook a mesh.
+         *
+         * @param optimized Whether the triangles are ordered for the vertex caches already.
+         * @returns false when the input is empty or invalid.
+         */
+        bool cook_mesh(const cooker_input& input, vertex_format format, bool optimized, cooked_mesh& mesh);
+
+        /**
+         * Cook all meshes of an imported model, vertices are colored with the base color of their mesh.
+         *
+         * @param threadPool When set, meshes are cooked in parallel.
+         */
+        void cook_model(const imported_model& model, vertex_format format, threading::thread_pool* threadPool, cooked_model& cooked);
+
+        cooked_mesh_view get_view(const cooked_mesh& mesh);
+        cooked_model_view get_view(const cooked_model& model);
+    }
+}
\ No newline at end of file
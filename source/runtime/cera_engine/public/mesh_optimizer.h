@@ -0,0 +1,133 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cera
+{
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    /**
+     * Vertex and index data of a triangle list that is optimized in place.
+     * Vertices are read with a stride so interleaved vertex data can be passed as is.
+     */
+    struct optimizer_input
+    {
+        void* vertices = nullptr;
+        size_t num_vertices = 0;
+        size_t vertex_stride = 0;
+
+        // Byte offset of the position (3 floats) in a vertex.
+        size_t position_offset = 0;
+
+        u32* indices = nullptr;
+        size_t num_indices = 0;
+    };
+
+    struct mesh_optimizer_settings
+    {
+        // Number of vertices in the simulated post transform cache. Small values suit all hardware, large values only help on hardware with a large cache.
+        u32 cache_size = 16;
+        // Largest allowed growth of the cache miss ratio when triangles are reordered to reduce overdraw, 0 keeps the cache order.
+        float overdraw_threshold = 1.05f;
+    };
+
+    /**
+     * Cost of drawing a mesh, measured with a simulated post transform cache and vertex fetch cache.
+     */
+    struct mesh_optimizer_statistics
+    {
+        // Average cache miss ratio, vertex shader invocations per triangle. 3 is the worst case, around 0.6 is good.
+        float acmr = 0.0f;
+        // Average transform to vertex ratio, vertex shader invocations per referenced vertex. 1 is optimal.
+        float atvr = 0.0f;
+        // Bytes of vertex data read through the fetch cache per byte of referenced vertex data. 1 is optimal.
+        float overfetch = 0.0f;
+    };
+
+    /**
+     * Reorders meshes so the GPU transforms and fetches every vertex as few times as possible.
+     *
+     * Optimizing a mesh runs three passes:
+     * - Triangles are reordered for the post transform cache with Tipsify (Sander et al. 2007): the mesh is walked
+     *   fan by fan around vertices that are still in the cache.
+     * - Runs of triangles that start with a cold cache are sorted so triangles facing away from the center are drawn
+     *   first, they tend to occlude the rest of the mesh from any direction. Runs are only cut where the cache miss
+     *   ratio stays below the threshold.
+     * - Vertices are moved into the order in which the triangles first reference them, vertex fetches read memory linearly.
+     *
+     * An optimizer keeps its memory between meshes, reuse it to optimize many meshes on one thread.
+     */
+    class mesh_optimizer
+    {
+    public:
+        explicit mesh_optimizer(const mesh_optimizer_settings& settings = mesh_optimizer_settings());
+
+        /**
+         * Reorder the triangles and vertices of a mesh.
+         * Vertices that are not referenced by a triangle are moved to the end.
+         *
+         * @param before When set, receives the statistics of the mesh as it was passed in.
+         * @param after When set, receives the statistics of the optimized mesh.
+         * @returns false when the input is invalid, the mesh is not changed.
+         */
+        bool optimize(const optimizer_input& input, mesh_optimizer_statistics* before = nullptr, mesh_optimizer_statistics* after = nullptr);
+
+        /**
+         * Reorder the triangles of a mesh without moving its vertices.
+         * Use this for index buffers that share their vertices with an optimized mesh, like levels of detail.
+         */
+        bool optimize_triangles(const optimizer_input& input);
+
+        /**
+         * Optimize many meshes, meshes are optimized in parallel on the worker threads of a thread pool and the calling thread.
+         */
+        static void optimize(const std::vector<optimizer_input>& inputs, const mesh_optimizer_settings& settings, threading::thread_pool* threadPool);
+
+        /**
+         * Measure the cost of drawing a mesh with a post transform cache of cacheSize vertices.
+         */
+        static mesh_optimizer_statistics analyze(const optimizer_input& input, u32 cacheSize);
+
+    private:
+        bool validate(const optimizer_input& input) const;
+
+        void optimize_vertex_cache(const optimizer_input& input);
+        void optimize_overdraw(const optimizer_input& input);
+        void optimize_vertex_fetch(const optimizer_input& input);
+
+        // Pick the next fanning vertex, the candidates are the vertices of the last emitted fan.
+        u32 get_next_vertex(u32 time, u32& cursor);
+
+    private:
+        mesh_optimizer_settings m_settings;
+
+        std::vector<u32> m_indices;
+
+        // Triangles around every vertex.
+        std::vector<u32> m_adjacency_offsets;
+        std::vector<u32> m_adjacency;
+
+        std::vector<u32> m_live_triangles;
+        std::vector<u32> m_cache_times;
+        std::vector<u8> m_emitted;
+        std::vector<u32> m_dead_ends;
+        std::vector<u32> m_candidates;
+
+        // Scratch memory of the overdraw pass.
+        std::vector<u32> m_cluster_offsets;
+        // Area weighted centroid and normal of every cluster.
+        std::vector<float> m_cluster_data;
+        std::vector<float> m_cluster_keys;
+        std::vector<u32> m_cluster_order;
+
+        // Scratch memory of the vertex fetch pass.
+        std::vector<u32> m_remap;
+        std::vector<u8> m_vertex_data;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cera
+{
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    /**
+     * Vertex and index data of a triangle list to simplify.
+     * Vertices are read with a stride so interleaved vertex data can be passed as is.
+     */
+    struct simplifier_input
+    {
+        const void* vertices = nullptr;
+        size_t num_vertices = 0;
+        size_t vertex_stride = 0;
+
+        // Byte offset of the position (3 floats) in a vertex.
+        size_t position_offset = 0;
+
+        // Byte offset and number of float attributes (colors, normals, texture coordinates) that are preserved.
+        size_t attribute_offset = 0;
+        u32 num_attributes = 0;
+
+        const u32* indices = nullptr;
+        size_t num_indices = 0;
+    };
+
+    struct mesh_simplifier_settings
+    {
+        // Weight of attribute differences compared to geometric error. Geometric error is measured relative to the size of the mesh.
+        float attribute_weight = 1.0f;
+        // Vertices on open borders are never moved, meshes that share a border stay connected.
+        bool lock_border = true;
+        // Largest geometric error relative to the size of the mesh, simplification stops before it is exceeded.
+        float max_error = 1.0f;
+    };
+
+    /**
+     * A level of detail created by the mesh simplifier.
+     */
+    struct simplified_lod
+    {
+        // Triangle list that indexes the vertices of the input.
+        std::vector<u32> indices;
+        // Object space geometric error of this level, see mesh::add_lod.
+        float error = 0.0f;
+    };
+
+    /**
+     * Reduces the triangle count of meshes by collapsing edges, ordered by quadric error.
+     *
+     * Every vertex accumulates the planes of its triangles in a quadric, collapsing a vertex onto a neighbour
+     * costs the squared distance of the neighbour to these planes. Vertices are only moved onto existing
+     * vertices so attributes never have to be interpolated, differences in attributes add to the cost.
+     *
+     * Vertices with equal position and attributes are welded. Vertices that share a position but not their
+     * attributes (seams), non-manifold vertices and optionally border vertices are locked in place.
+     * Collapses that flip a triangle are rejected.
+     *
+     * A simplifier keeps its memory between meshes, reuse it to simplify many meshes on one thread.
+     */
+    class mesh_simplifier
+    {
+    public:
+        explicit mesh_simplifier(const mesh_simplifier_settings& settings = mesh_simplifier_settings());
+
+        /**
+         * Create a chain of levels with decreasing triangle counts.
+         * Every level continues the simplification of the previous level. The chain ends early when a target
+         * triangle count can not be reached without exceeding the maximum error.
+         *
+         * @param ratios Target triangle count of every level relative to the input, decreasing.
+         * @returns false when the input is invalid.
+         */
+        bool generate_lods(const simplifier_input& input, const std::vector<float>& ratios, std::vector<simplified_lod>& lods);
+
+        /**
+         * Create the levels of many meshes, meshes are simplified in parallel on the worker threads of a thread pool
+         * and the calling thread.
+         *
+         * @param lods Receives the levels of every input.
+         */
+        static void generate_lods(const std::vector<simplifier_input>& inputs, const std::vector<float>& ratios, const mesh_simplifier_settings& settings, std::vector<std::vector<simplified_lod>>& lods, threading::thread_pool* threadPool);
+
+    private:
+        struct quadric
+        {
+            float a00, a11, a22, a01, a02, a12;
+            float b0, b1, b2;
+            float c;
+            float weight;
+        };
+
+        struct collapse
+        {
+            u32 vertex;
+            u32 target;
+            float cost;
+            float error;
+        };
+
+        enum vertex_kind : u8
+        {
+            vertex_kind_manifold,
+            vertex_kind_border,
+            vertex_kind_locked
+        };
+
+        // Read the input, weld duplicate vertices, classify vertices and compute the quadrics.
+        bool prepare(const simplifier_input& input);
+        void build_adjacency();
+        void classify_vertices();
+        void compute_quadrics();
+
+        /**
+         * Collapse edges until the index count drops to targetIndexCount.
+         * The largest squared geometric error of a performed collapse is accumulated in error.
+         */
+        void simplify(size_t targetIndexCount, float maxError, float& error);
+
+        // Gather the possible collapses of every edge and order them by cost.
+        void collect_collapses();
+        void sort_collapses();
+        size_t perform_collapses(size_t numTrianglesToRemove, float maxError, float& error);
+        bool can_collapse(u32 vertex, u32 target, u32& numSharedTriangles);
+        // Apply the collapses of a pass to the index buffer and remove degenerate triangles.
+        void compact_indices();
+
+        float get_collapse_error(u32 vertex, u32 target) const;
+        float get_attribute_distance(u32 vertex, u32 target) const;
+
+    private:
+        mesh_simplifier_settings m_settings;
+
+        // Positions are scaled so the largest extent of the mesh is 1.
+        std::vector<float> m_positions;
+        float m_scale;
+
+        std::vector<float> m_attributes;
+        u32 m_num_attributes;
+
+        std::vector<u32> m_indices;
+        std::vector<vertex_kind> m_vertex_kinds;
+        std::vector<quadric> m_quadrics;
+
+        // Triangles around every vertex.
+        std::vector<u32> m_adjacency_offsets;
+        std::vector<u32> m_adjacency;
+
+        std::vector<collapse> m_collapses;
+        std::vector<u32> m_collapse_order;
+        std::vector<u32> m_collapse_buckets;
+
+        std::vector<u32> m_remap;
+        std::vector<u8> m_touched;
+        std::vector<u32> m_vertex_marks;
+        u32 m_mark;
+
+        // Scratch memory of the vertex welding.
+        std::vector<u32> m_hash_table;
+        std::vector<u32> m_position_remap;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "bounding_volume.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cera
+{
+    struct frustum;
+
+    /**
+     * A small cluster of connected triangles, stored as a range of the index buffer of its mesh.
+     */
+    struct meshlet
+    {
+        u32 first_index;
+        u32 index_count;
+        u32 vertex_count;
+
+        bounding_sphere sphere;
+
+        // All triangles face away from a viewer at position p when dot(c - p, axis) > cutoff * length(c - p) + radius,
+        // with c and radius the bounding sphere. The cutoff is the sine of the spread of the normals, 1 when the
+        // normals spread too wide for the cluster to ever face away as a whole.
+        float3 cone_axis;
+        float cone_cutoff;
+    };
+
+    /**
+     * A run of consecutive index buffer entries to draw.
+     */
+    struct meshlet_index_range
+    {
+        u32 first_index;
+        u32 index_count;
+    };
+
+    /**
+     * Vertex and index data of a triangle list to split into meshlets.
+     * Vertices are read with a stride so interleaved vertex data can be passed as is.
+     */
+    struct meshlet_builder_input
+    {
+        const void* vertices = nullptr;
+        size_t num_vertices = 0;
+        size_t vertex_stride = 0;
+
+        // Byte offset of the position (3 floats) in a vertex.
+        size_t position_offset = 0;
+
+        // The triangles are reordered in place so every meshlet is a contiguous range.
+        u32* indices = nullptr;
+        size_t num_indices = 0;
+    };
+
+    struct meshlet_builder_settings
+    {
+        // Limits that match the preferred sizes of mesh shader thread groups.
+        u32 max_vertices = 64;
+        u32 max_triangles = 124;
+    };
+
+    /**
+     * Splits meshes into meshlets that can be rejected as a whole before they are drawn.
+     *
+     * Meshlets grow greedily from a seed triangle, the next triangle is the neighbour that adds the fewest
+     * new vertices. Seeds are taken in index buffer order, meshes optimized for the vertex cache keep their
+     * locality. A meshlet ends when no neighbour fits in the limits.
+     *
+     * A builder keeps its memory between meshes, reuse it to build meshlets of many meshes on one thread.
+     */
+    class meshlet_builder
+    {
+    public:
+        explicit meshlet_builder(const meshlet_builder_settings& settings = meshlet_builder_settings());
+
+        /**
+         * Split a mesh into meshlets and compute their bounding spheres and normal cones.
+         *
+         * @returns false when the input is invalid, the mesh is not changed.
+         */
+        bool build(const meshlet_builder_input& input, std::vector<meshlet>& meshlets);
+
+    private:
+        void build_adjacency(const meshlet_builder_input& input);
+
+        // Add the unused neighbours of a triangle to the candidates of the current meshlet.
+        void add_candidates(u32 triangle);
+
+        void compute_bounds(const meshlet_builder_input& input, meshlet& meshlet) const;
+
+    private:
+        meshlet_builder_settings m_settings;
+
+        std::vector<u32> m_indices;
+
+        // Triangles around every vertex.
+        std::vector<u32> m_adjacency_offsets;
+        std::vector<u32> m_adjacency;
+
+        std::vector<u8> m_used;
+        std::vector<u32> m_candidates;
+
+        // Meshlet a vertex was last added to, plus one.
+        std::vector<u32> m_vertex_meshlets;
+    };
+
+    /**
+     * Reject the meshlets of a mesh that face away from the camera or are outside of the view frustum.
+     * Consecutive visible meshlets are merged into one index range.
+     *
+     * @param cameraPosition Position of the camera in object space of the mesh.
+     * @param objectFrustum View frustum in object space, see frustum::from_view_projection.
+     * @param numBackfacing Receives the number of meshlets rejected by their normal cone.
+     * @returns The number of visible meshlets.
+     */
+    u32 cull_meshlets(const std::vector<meshlet>& meshlets, const float3& cameraPosition, const frustum& objectFrustum, std::vector<meshlet_index_range>& ranges, u32& numBackfacing);
+}
\ No newline at end of file
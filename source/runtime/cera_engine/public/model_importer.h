@@ -0,0 +1,129 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "bounding_volume.h"
+#include "transform_hierarchy.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace cera
+{
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    /**
+     * Triangle list of an imported model, indices are 32 bit and index positions and normals alike.
+     */
+    struct imported_mesh
+    {
+        std::string name;
+
+        std::vector<float3> positions;
+        // Empty when the source has no normals.
+        std::vector<float3> normals;
+        std::vector<u32> indices;
+
+        // Base color of the material, white when the source has none.
+        float3 color = { 1.0f, 1.0f, 1.0f };
+    };
+
+    struct imported_node
+    {
+        std::string name;
+
+        float4x4 local_transform = float4x4::identity();
+
+        // Indices into imported_model::meshes and imported_model::nodes.
+        std::vector<u32> meshes;
+        std::vector<u32> children;
+    };
+
+    /**
+     * CPU side geometry and node hierarchy of a model file, see mesh_factory::create_model to upload it.
+     * Coordinates and winding are kept as they are stored in the file.
+     */
+    struct imported_model
+    {
+        std::vector<imported_mesh> meshes;
+        std::vector<imported_node> nodes;
+
+        // Nodes without a parent.
+        std::vector<u32> root_nodes;
+
+        void clear();
+
+        size_t get_num_vertices() const;
+        size_t get_num_triangles() const;
+    };
+
+    /**
+     * Statistics of the last import.
+     */
+    struct model_import_statistics
+    {
+        // Bytes of all source files, external glTF buffers included.
+        u64 num_bytes = 0;
+        u64 num_vertices = 0;
+        u64 num_triangles = 0;
+        // Time spent to map and parse the files.
+        u64 import_time_us = 0;
+    };
+
+    /**
+     * Imports Wavefront OBJ and glTF 2.0 (.gltf and .glb) models.
+     *
+     * Source files are memory mapped and parsed in place. OBJ files are split into chunks at line boundaries
+     * that are tokenized in parallel, the chunks are stitched together afterwards so relative indices and groups
+     * that span chunks resolve as if the file had been read front to back. Every OBJ object and group becomes a mesh.
+     * glTF accessors are read straight from the mapped binary chunk or buffer files, every primitive becomes a
+     * mesh and is decoded in parallel.
+     *
+     * Only triangle geometry with positions and normals is imported. Texture coordinates, OBJ material libraries,
+     * glTF textures, skins and animations are ignored, glTF materials only provide the base color.
+     */
+    class model_importer
+    {
+    public:
+        /**
+         * @param threadPool When set, parsing is split across the worker threads and the calling thread.
+         */
+        explicit model_importer(threading::thread_pool* threadPool = nullptr);
+
+        /**
+         * Import a model file, the format is chosen by the file extension.
+         *
+         * @returns false when the file cannot be read or is malformed, the model is left empty.
+         */
+        bool load(const std::filesystem::path& path, imported_model& model);
+
+        /**
+         * Import the text of an OBJ file.
+         */
+        bool parse_obj(const char* text, size_t size, imported_model& model);
+
+        /**
+         * Import a glTF JSON document or a GLB container.
+         *
+         * @param directory Directory that relative buffer URIs are resolved against.
+         */
+        bool parse_gltf(const u8* data, size_t size, const std::filesystem::path& directory, imported_model& model);
+
+        const model_import_statistics& get_statistics() const;
+
+    private:
+        // Run a function for every index in [0, count) on the thread pool and the calling thread.
+        void parallel_for(size_t count, const std::function<void(size_t)>& function);
+
+    private:
+        threading::thread_pool* m_thread_pool;
+
+        model_import_statistics m_statistics;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "util/types.h"
+#include "util/aligned_allocator.h"
+
+#include "bounding_volume.h"
+
+#include <vector>
+
+namespace cera
+{
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    /**
+     * Low polygon geometry that is rasterized to hide other meshes.
+     * Occluders must not be larger than the mesh they represent or visible meshes are culled.
+     */
+    struct occluder_geometry
+    {
+        std::vector<float3> positions;
+        std::vector<u32> indices;
+    };
+
+    /**
+     * Software occlusion culling.
+     *
+     * Occluders are rasterized into a low resolution depth buffer on the CPU, bounding boxes of
+     * occludees are then tested against it. Triangles are binned into screen tiles, tiles are
+     * rasterized in parallel. A second level stores the farthest depth of every 8x8 block of pixels
+     * so most occludees are rejected with a few reads.
+     *
+     * Depth follows the D3D convention, 0 at the near plane and 1 at the far plane.
+     */
+    class occlusion_culler
+    {
+    public:
+        static constexpr u32 tile_width = 32;
+        static constexpr u32 tile_height = 32;
+        static constexpr u32 block_size = 8;
+
+        /**
+         * The resolution is rounded up to a multiple of the tile size.
+         */
+        explicit occlusion_culler(u32 width = 256, u32 height = 128);
+
+        /**
+         * Clear the depth buffer and remove all occluders.
+         *
+         * @param viewProjection Transforms world space positions to clip space (row vectors).
+         */
+        void begin_frame(const float4x4& viewProjection);
+
+        /**
+         * Transform, clip and bin the triangles of an occluder.
+         */
+        void add_occluder(const occluder_geometry& geometry, const float4x4& worldTransform);
+
+        /**
+         * Rasterize all occluders added since begin_frame().
+         *
+         * @param threadPool When set, tiles are rasterized on the worker threads. The thread pool must not execute other work while this function runs.
+         */
+        void rasterize(threading::thread_pool* threadPool = nullptr);
+
+        /**
+         * Test a world space bounding box against the rasterized occluders.
+         * @returns false when the box is completely hidden, boxes crossing the near plane are always visible.
+         */
+        bool is_visible(const bounding_box& worldBox) const;
+
+        u32 get_width() const;
+        u32 get_height() const;
+
+        /**
+         * Depth buffer, get_width() * get_height() values in rows from top to bottom.
+         */
+        const float* get_depth_buffer() const;
+
+        /**
+         * Number of triangles rasterized this frame, after clipping.
+         */
+        u32 get_num_triangles() const;
+
+    private:
+        struct screen_triangle
+        {
+            // Pixel coordinates and depth of the vertices.
+            float x[3];
+            float y[3];
+            float z[3];
+        };
+
+        struct clip_vertex
+        {
+            float x;
+            float y;
+            float z;
+            float w;
+        };
+
+        // Clip a triangle against the near plane, then project and bin the resulting triangles.
+        void add_triangle(const clip_vertex& v0, const clip_vertex& v1, const clip_vertex& v2);
+        void add_screen_triangle(const clip_vertex& v0, const clip_vertex& v1, const clip_vertex& v2);
+
+        void rasterize_tile(u32 tile);
+        void rasterize_triangle(const screen_triangle& triangle, u32 tileX, u32 tileY);
+
+        // Compute the farthest depth of every block of pixels.
+        void build_block_depth();
+
+        template <typename T>
+        using cache_aligned_vector = std::vector<T, memory::aligned_allocator<T>>;
+
+    private:
+        u32 m_width;
+        u32 m_height;
+        u32 m_num_tiles_x;
+        u32 m_num_tiles_y;
+
+        float4x4 m_view_projection;
+
+        // Rows are a multiple of the tile width, tiles never share a cache line.
+        cache_aligned_vector<float> m_depth;
+        std::vector<float> m_block_depth;
+
+        std::vector<screen_triangle> m_triangles;
+        std::vector<std::vector<u32>> m_tile_triangles;
+
+        std::vector<clip_vertex> m_clip_vertices;
+    };
+}
\ No newline at end of file
@@ -30,6 +30,7 @@ namespace cera
     class shader_resource_view;
     class unordered_access_view;
     class pipeline_state_object;
+    class indirect_draw_arguments;
 
     class command_list : public std::enable_shared_from_this<command_list>
     {
@@ -119,6 +120,13 @@ namespace cera
             return copy_byte_address_buffer(sizeof(T), &data);
         }
 
+        /**
+         * Copy the contents to a range of a buffer in GPU memory, the rest of the buffer is kept.
+         * Used to fill buffers that are shared by many meshes, like the pages of the geometry pool.
+         * The data is staged in the upload buffer of the command list, copies do not create resources.
+         */
+        bool copy_buffer_region(const std::shared_ptr<buffer>& dstBuffer, size_t dstOffset, size_t bufferSize, const void* bufferData);
+
         /**
          * Set the current primitive topology for the rendering pipeline.
          */
@@ -151,6 +159,17 @@ namespace cera
             set_graphics_dynamic_constant_buffer(rootParameterIndex, sizeof(T), &data);
         }
 
+        /**
+         * Set a dynamic structured buffer data to an inline shader resource view in the root
+         * signature. The data must fit a single page of the upload buffer.
+         */
+        void set_graphics_dynamic_structured_buffer(u32 rootParameterIndex, size_t numElements, size_t elementSize, const void* bufferData);
+        template<typename T>
+        void set_graphics_dynamic_structured_buffer(u32 rootParameterIndex, const std::vector<T>& bufferData)
+        {
+            set_graphics_dynamic_structured_buffer(rootParameterIndex, bufferData.size(), sizeof(T), bufferData.data());
+        }
+
         /**
          * Set a set of 32-bit constants on the graphics pipeline.
          */
@@ -210,6 +229,8 @@ namespace cera
 
         /**
          * Set the pipeline state object on the command list.
+         * When the pipeline state is still being compiled its fallback is bound instead.
+         * Without a ready fallback, draws are skipped until a ready pipeline state is set.
          */
         void set_pipeline_state(const std::shared_ptr<pipeline_state_object>& pipelineState);
 
@@ -274,6 +295,19 @@ namespace cera
         void draw(u32 vertexCount, u32 instanceCount = 1, u32 startVertex = 0, u32 startInstance = 0);
         void draw_indexed(u32 indexCount, u32 instanceCount = 1, u32 startIndex = 0, int32_t baseVertex = 0, u32 startInstance = 0);
 
+        /**
+         * Draw all commands of an argument buffer built on the CPU with ExecuteIndirect.
+         * The commands use the bound pipeline state, root signature, vertex and index buffers, their root constants
+         * are written to rootParameterIndex. The command signature is created once per layout by the device.
+         * Root constants written by the commands are undefined afterwards, set them again before direct draws read them.
+         */
+        void execute_indirect(const indirect_draw_arguments& arguments, u32 rootParameterIndex = 0);
+
+        /**
+         * Number of draws that were skipped since the last reset because the bound pipeline state was not ready.
+         */
+        u32 get_num_skipped_draws() const;
+
 
     protected:
         friend class command_queue;
@@ -341,6 +375,9 @@ namespace cera
         ID3D12RootSignature* m_root_signature;
         // Keep track of the currently bond pipeline state object to minimize PSO changes.
         ID3D12PipelineState* m_pipeline_state;
+        // Set when the requested pipeline state is still compiling and has no ready fallback.
+        bool m_skip_draws;
+        u32 m_num_skipped_draws;
 
         // resource created in an upload heap. Useful for drawing of dynamic geometry
         // or for uploading constant buffer data that changes every draw call.
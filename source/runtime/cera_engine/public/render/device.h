@@ -7,13 +7,19 @@
 
 #include "render/d3dx12_declarations.h"
 #include "render/descriptor_allocation.h"
+#include "render/geometry_allocation.h"
+
+#include "util/timing_histogram.h"
 
 #include <memory>
+#include <string>
 
 namespace cera
 {
     class command_queue;
     class descriptor_allocator;
+    class geometry_pool;
+    struct geometry_pool_stats;
     class vertex_buffer;
     class index_buffer;
     class constant_buffer;
@@ -26,6 +32,14 @@ namespace cera
     class root_signature;
     class resource;
     class swapchain;
+    class pipeline_state_cache;
+    class root_signature_cache;
+    class command_signature_cache;
+
+    namespace threading
+    {
+        class thread_pool;
+    }
 
     class device
     {
@@ -100,10 +114,55 @@ namespace cera
         std::shared_ptr<vertex_buffer> create_vertex_buffer(size_t numVertices, size_t vertexStride);
         std::shared_ptr<vertex_buffer> create_vertex_buffer(Microsoft::WRL::ComPtr<ID3D12Resource> resource, size_t numVertices, size_t vertexStride);
 
+        /**
+         * Create a root signature.
+         * Root signatures are cached by a hash of the description, requesting
+         * the same description twice returns the same instance.
+         */
         std::shared_ptr<root_signature> create_root_signature(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc);
 
+        /**
+         * Create a command signature for indirect indexed draws, see indirect_draw_arguments.
+         * Every command sets numRootConstants 32-bit constants at rootParameterIndex before its draw, the root
+         * signature is only used when it does. Command signatures are cached by their layout and root signature,
+         * root signatures that were not created by the device are kept alive by the cache.
+         *
+         * @returns nullptr when the command signature could not be created.
+         */
+        wrl::ComPtr<ID3D12CommandSignature> create_draw_indexed_command_signature(ID3D12RootSignature* rootSignature, u32 rootParameterIndex, u32 numRootConstants);
+
+        /**
+         * Create a pipeline state object.
+         * Pipeline state objects are cached by a hash of the pipeline state stream, requesting
+         * the same stream twice returns the same instance.
+         */
         template<class pipeline_state_stream>
         std::shared_ptr<pipeline_state_object> create_pipeline_state_object(pipeline_state_stream& pipelineStateStream);
+        /**
+         * Create a pipeline state object that is compiled on a background thread.
+         * The returned pipeline state object is not ready until compilation has finished,
+         * until then the fallback is bound instead or draws that use it are skipped.
+         * The pipeline state stream is copied, it does not have to outlive this call.
+         * A pipeline state that fails to compile is evicted from the cache, requesting it again compiles it again.
+         */
+        template<class pipeline_state_stream>
+        std::shared_ptr<pipeline_state_object> create_pipeline_state_object_async(pipeline_state_stream& pipelineStateStream, const std::shared_ptr<pipeline_state_object>& fallback = nullptr);
+
+        /**
+         * Time spent on the calling thread to create pipeline state objects.
+         * Any sample above a frame budget is a visible hitch.
+         */
+        const timing_histogram& get_pipeline_state_creation_histogram() const;
+
+        /**
+         * Load the compiled pipeline states that were stored by a previous run.
+         * Call this at startup, before any pipeline state objects are created, to skip driver compilation.
+         */
+        bool load_pipeline_state_cache(const std::wstring& path);
+        /**
+         * Store all compiled pipeline states to disk.
+         */
+        bool save_pipeline_state_cache(const std::wstring& path);
 
         std::shared_ptr<constant_buffer_view> create_constant_buffer_view(const std::shared_ptr<constant_buffer>& constantBuffer, size_t offset = 0);
         std::shared_ptr<shader_resource_view> create_shader_resource_view(const std::shared_ptr<resource>& resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* srv = nullptr);
@@ -119,6 +178,18 @@ namespace cera
          */
         void release_stale_descriptors();
 
+        /**
+         * Allocate ranges of the shared vertex and index buffers for static geometry, see geometry_pool.
+         */
+        geometry_allocation allocate_geometry(u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices);
+
+        /**
+         * Return freed geometry ranges to the pool. This should only be called with a completed frame counter.
+         */
+        void release_stale_geometry();
+
+        geometry_pool_stats get_geometry_pool_stats() const;
+
         /**
         * Get the highest root signature version
         */
@@ -147,6 +218,7 @@ namespace cera
          * Execute logic to create the pipeline state object
         */
         std::shared_ptr<pipeline_state_object> do_create_pipeline_state_object( const D3D12_PIPELINE_STATE_STREAM_DESC& pipelineStateStreamDesc );
+        std::shared_ptr<pipeline_state_object> do_create_pipeline_state_object_async(const D3D12_PIPELINE_STATE_STREAM_DESC& pipelineStateStreamDesc, const std::shared_ptr<pipeline_state_object>& fallback);
 
     private:
         /**
@@ -169,6 +241,15 @@ namespace cera
         bool m_tearing_supported;
 
         std::unique_ptr<descriptor_allocator> m_descriptor_allocators[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+
+        std::unique_ptr<geometry_pool> m_geometry_pool;
+
+        std::unique_ptr<root_signature_cache> m_root_signature_cache;
+        std::unique_ptr<command_signature_cache> m_command_signature_cache;
+        std::unique_ptr<pipeline_state_cache> m_pipeline_state_cache;
+        // Declared after the cache so pending compilations finish before the cache is destroyed.
+        std::unique_ptr<threading::thread_pool> m_pipeline_state_compile_pool;
+        timing_histogram m_pipeline_state_creation_histogram;
     };
 
     template<class pipeline_state_stream>
@@ -178,4 +259,12 @@ namespace cera
 
         return do_create_pipeline_state_object(pipeline_state_stream_desc);
     }
+
+    template<class pipeline_state_stream>
+    std::shared_ptr<pipeline_state_object> device::create_pipeline_state_object_async(pipeline_state_stream& pipelineStateStream, const std::shared_ptr<pipeline_state_object>& fallback)
+    {
+        D3D12_PIPELINE_STATE_STREAM_DESC pipeline_state_stream_desc = { sizeof(pipeline_state_stream), &pipelineStateStream };
+
+        return do_create_pipeline_state_object_async(pipeline_state_stream_desc, fallback);
+    }
 }
\ No newline at end of file
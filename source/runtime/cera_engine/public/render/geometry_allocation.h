@@ -0,0 +1,73 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "render/d3dx12_declarations.h"
+
+#include <memory>
+
+namespace cera
+{
+    class geometry_pool_page;
+    class vertex_buffer;
+    class index_buffer;
+
+    /**
+     * A range of vertices and a range of indices in the shared buffers of the geometry_pool.
+     * Draw it with the base vertex and first index of the allocation.
+     */
+    class geometry_allocation
+    {
+    public:
+        // Creates a NULL allocation
+        geometry_allocation();
+        geometry_allocation(u32 baseVertex, u32 numVertices, u32 firstIndex, u32 numIndices, std::shared_ptr<geometry_pool_page> page);
+
+        // The destructor will automatically free the allocation.
+        ~geometry_allocation();
+
+        // Copies are not allowed.
+        geometry_allocation(const geometry_allocation&) = delete;
+        geometry_allocation& operator=(const geometry_allocation&) = delete;
+
+        // Move is allowed.
+        geometry_allocation(geometry_allocation&& allocation);
+        geometry_allocation& operator=(geometry_allocation&& other);
+
+        bool is_null() const;
+        bool is_valid() const;
+
+        /**
+         * Buffers of the page the ranges were allocated from, shared with other allocations.
+         */
+        std::shared_ptr<vertex_buffer> get_vertex_buffer() const;
+        std::shared_ptr<index_buffer> get_index_buffer() const;
+
+        u32 get_vertex_stride() const;
+        DXGI_FORMAT get_index_format() const;
+
+        u32 get_base_vertex() const;
+        u32 get_num_vertices() const;
+        u32 get_first_index() const;
+        u32 get_num_indices() const;
+
+        /**
+         * Byte offsets of the ranges in their buffers, used to copy the geometry.
+         */
+        size_t get_vertex_offset() const;
+        size_t get_index_offset() const;
+
+    private:
+        // Free the ranges back to the page they came from.
+        void free();
+
+    private:
+        u32 m_base_vertex;
+        u32 m_num_vertices;
+        u32 m_first_index;
+        u32 m_num_indices;
+
+        // A pointer back to the original page where this allocation came from.
+        std::shared_ptr<geometry_pool_page> m_page;
+    };
+}
\ No newline at end of file
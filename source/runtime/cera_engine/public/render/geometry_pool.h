@@ -0,0 +1,81 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "render/d3dx12_declarations.h"
+#include "render/geometry_allocation.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cera
+{
+    class device;
+    class geometry_pool_page;
+
+    /**
+     * Size and use of the geometry pool.
+     */
+    struct geometry_pool_stats
+    {
+        // Vertex and index buffers created by the pool, two per page.
+        u32 num_resources = 0;
+        u32 num_pages = 0;
+        // Live allocations, every one of them would own a vertex and an index buffer without the pool.
+        u32 num_allocations = 0;
+
+        u64 num_vertices = 0;
+        u64 num_allocated_vertices = 0;
+        u64 num_indices = 0;
+        u64 num_allocated_indices = 0;
+    };
+
+    /*
+    * The geometry_pool keeps static geometry in a few large vertex and index buffers instead of one
+    * committed resource per buffer of every mesh. Meshes allocate ranges of the buffers and draw them with
+    * a base vertex and a first index, meshes that share a page are drawn without binding other buffers.
+    *
+    * Pages are created per vertex stride and index format when the existing pages are full. Freed ranges
+    * return to their page once the frame has completed, see release_stale_ranges.
+    */
+    class geometry_pool
+    {
+    public:
+        /**
+         * Allocate a range of vertices and a range of indices that are stored in the same page.
+         * Requests larger than a page get a page of their own.
+         *
+         * @returns A NULL allocation when numVertices is 0.
+         */
+        geometry_allocation allocate(u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices);
+
+        /**
+         * When the frame has completed, the freed ranges can be reused.
+         */
+        void release_stale_ranges();
+
+        geometry_pool_stats get_stats() const;
+
+    protected:
+        friend class std::default_delete<geometry_pool>;
+
+        // Can only be created by the Device.
+        geometry_pool(device& device, u32 numVerticesPerPage = 1 << 18, u32 numIndicesPerPage = 1 << 21);
+        virtual ~geometry_pool();
+
+    private:
+        std::shared_ptr<geometry_pool_page> create_page(u32 vertexStride, DXGI_FORMAT indexFormat, u32 numVertices, u32 numIndices);
+
+    private:
+        using page_pool = std::vector<std::shared_ptr<geometry_pool_page>>;
+
+        device& m_device;
+        u32 m_num_vertices_per_page;
+        u32 m_num_indices_per_page;
+
+        page_pool m_page_pool;
+
+        mutable std::mutex m_allocation_mutex;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cera
+{
+    /**
+     * Arguments of a single indexed draw, laid out like D3D12_DRAW_INDEXED_ARGUMENTS.
+     */
+    struct draw_indexed_arguments
+    {
+        u32 index_count_per_instance = 0;
+        u32 instance_count = 1;
+        u32 start_index_location = 0;
+        s32 base_vertex_location = 0;
+        u32 start_instance_location = 0;
+    };
+
+    static_assert(sizeof(draw_indexed_arguments) == 5 * sizeof(u32), "Draw arguments must match D3D12_DRAW_INDEXED_ARGUMENTS.");
+
+    /**
+     * Argument buffer of indirect draws built on the CPU, see command_list::execute_indirect.
+     * Every command is a fixed number of 32-bit root constants followed by the arguments of an indexed draw,
+     * the order a command signature requires since the draw must be its last argument.
+     * Commands are packed without padding, get_data() can be copied to an upload buffer as is.
+     */
+    class indirect_draw_arguments
+    {
+    public:
+        explicit indirect_draw_arguments(u32 numRootConstants = 0);
+
+        /**
+         * Remove all commands, allocated memory is kept for the next frame.
+         */
+        void clear();
+        void reserve(u32 numCommands);
+
+        /**
+         * Append a command.
+         *
+         * @param rootConstants get_num_root_constants() values, may be nullptr when there are none.
+         */
+        void add_draw(const draw_indexed_arguments& arguments, const u32* rootConstants = nullptr);
+        void add_draw(const draw_indexed_arguments& arguments, u32 rootConstant);
+
+        u32 get_num_root_constants() const;
+        /**
+         * Size of a single command in bytes.
+         */
+        u32 get_stride() const;
+        /**
+         * Offset of the draw arguments in a command in bytes.
+         */
+        u32 get_arguments_offset() const;
+
+        u32 get_num_commands() const;
+        bool empty() const;
+
+        const void* get_data() const;
+        size_t get_size() const;
+
+        /**
+         * Read back a packed command.
+         */
+        draw_indexed_arguments get_arguments(u32 command) const;
+        const u32* get_root_constants(u32 command) const;
+
+    private:
+        u32 m_num_root_constants;
+        // Number of 32-bit values per command.
+        u32 m_command_size;
+
+        std::vector<u32> m_data;
+    };
+}
\ No newline at end of file
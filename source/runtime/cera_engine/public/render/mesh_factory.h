@@ -2,41 +2,94 @@
 
 #include "render/d3dx12_declarations.h"
 
+#include "mesh_cooker.h"
+
+#include <filesystem>
 #include <memory>
+#include <vector>
 
 namespace cera
 {
     class scene;
+    class mesh;
     class command_list;
 
+    enum class procedural_shape : u32
+    {
+        cube,
+        sphere,
+        cylinder,
+        plane
+    };
+
+    /**
+     * Shape, parameters and vertex layout of a generated mesh, the key of the procedural_mesh_cache.
+     * Create descriptions with the shape functions, they leave the parameters a shape does not use at 0 so
+     * equal shapes compare equal.
+     */
+    struct procedural_mesh_desc
+    {
+        procedural_shape shape = procedural_shape::cube;
+        DirectX::XMFLOAT3 color = { 1.0f, 1.0f, 1.0f };
+        // Size of the cube, radius of the sphere and the cylinder, width of the plane.
+        float size = 0.0f;
+        // Height of the cylinder and the plane.
+        float height = 0.0f;
+        u32 tessellation = 0;
+        vertex_format format = vertex_format::pos_color;
+
+        static procedural_mesh_desc cube(DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float size = 1.0f, vertex_format format = vertex_format::pos_color);
+        static procedural_mesh_desc sphere(DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float radius = 0.5f, u32 tessellation = 16, vertex_format format = vertex_format::pos_color);
+        static procedural_mesh_desc cylinder(DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float radius = 0.5f, float height = 1.0f, u32 tessellation = 32, vertex_format format = vertex_format::pos_color);
+        static procedural_mesh_desc plane(DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float width = 1.0f, float height = 1.0f, vertex_format format = vertex_format::pos_color);
+
+        // Descriptions are compared and hashed bitwise.
+        bool operator==(const procedural_mesh_desc& other) const;
+        u64 get_hash() const;
+    };
+
+    struct procedural_mesh_desc_hasher
+    {
+        size_t operator()(const procedural_mesh_desc& desc) const
+        {
+            return static_cast<size_t>(desc.get_hash());
+        }
+    };
+
     namespace mesh_factory
     {
+        // Vertex layout of the created meshes, see vertex_format.
+        using cera::vertex_format;
+
         /**
          * Create a cube.
          *
          * @param size The size of one side of the cube.
          * @param reverseWinding Whether to reverse the winding order of the triangles (useful for skyboxes).
+         * @param format Vertex layout of the mesh.
          */
-        std::shared_ptr<scene> create_cube(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float size = 1.0);
+        std::shared_ptr<scene> create_cube(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float size = 1.0, vertex_format format = vertex_format::pos_color);
 
         /**
          * Create a sphere.
          *
          * @param radius Radius of the sphere.
-         * @param tessellation Determines how smooth the sphere is.
+         * @param tessellation Determines how smooth the sphere is. Above 180 the sphere has too many vertices for 16 bit indices and uses 32 bit indices.
          * @param reverseWinding Whether to reverse the winding order of the triangles (useful for sydomes).
+         * @param format Vertex layout of the mesh.
          */
-        std::shared_ptr<scene> create_sphere(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float radius = 0.5f, uint32_t tessellation = 16);
+        std::shared_ptr<scene> create_sphere(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float radius = 0.5f, uint32_t tessellation = 16, vertex_format format = vertex_format::pos_color);
 
         /**
          * Create a Cylinder
          *
          * @param radius The radius of the primary axis of the cylinder.
          * @param hight The height of the cylinder.
-         * @param tessellation How smooth the cylinder will be.
+         * @param tessellation How smooth the cylinder will be. Above 16383 the cylinder uses 32 bit indices.
          * @param reverseWinding Whether to reverse the winding order of the triangles.
+         * @param format Vertex layout of the mesh.
          */
-        std::shared_ptr<scene> create_cylinder(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float radius = 0.5f, float height = 1.0f, uint32_t tessellation = 32);
+        std::shared_ptr<scene> create_cylinder(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float radius = 0.5f, float height = 1.0f, uint32_t tessellation = 32, vertex_format format = vertex_format::pos_color);
 
         /**
          * Create a plane.
@@ -44,7 +97,49 @@ namespace cera
          * @param width The width of the plane.
          * @param height The height of the plane.
          * @reverseWinding Whether to reverse the winding order of the plane.
+         * @param format Vertex layout of the mesh.
+         */
+        std::shared_ptr<scene> create_plane(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float width = 1.0f, float height = 1.0f, vertex_format format = vertex_format::pos_color);
+
+        /**
+         * Create the mesh of a shape, its vertices and indices are allocated from the geometry pool of the device.
+         *
+         * @returns nullptr when the description is invalid.
+         */
+        std::shared_ptr<mesh> create_mesh(const std::shared_ptr<command_list>& commandList, const procedural_mesh_desc& desc);
+
+        /**
+         * Create the meshes of many shapes at once. Meshes of the same vertex layout and index size are packed into
+         * one allocation of the geometry pool, every mesh draws its range of it. Equal descriptions share a mesh.
+         * Every allocation is recorded on the command list with one copy per buffer.
+         *
+         * @param meshes Receives one mesh per description, nullptr for invalid descriptions.
+         */
+        void create_meshes(const std::shared_ptr<command_list>& commandList, const std::vector<procedural_mesh_desc>& descs, std::vector<std::shared_ptr<mesh>>& meshes);
+
+        /**
+         * Create a scene from a model loaded by the model_importer.
+         * Every imported node becomes a scene node below the root node, vertices are colored with the base color of their mesh.
+         * All buffers are recorded on the command list, execute it once to upload the whole model.
+         *
+         * @param format Vertex layout of the meshes.
+         * @param threadPool When set, the meshes are cooked in parallel.
+         */
+        std::shared_ptr<scene> create_model(const std::shared_ptr<command_list>& commandList, const imported_model& model, vertex_format format = vertex_format::pos_color, threading::thread_pool* threadPool = nullptr);
+
+        /**
+         * Create a scene from a cooked model, see mesh_cooker::get_view.
+         * All buffers are recorded on the command list, execute it once to upload the whole model.
+         */
+        std::shared_ptr<scene> create_model(const std::shared_ptr<command_list>& commandList, const cooked_model_view& model);
+
+        /**
+         * Create a scene from a mesh cache file written by mesh_cache_io::cook.
+         * The file is memory mapped and its buffers are copied straight from the mapping into upload memory,
+         * nothing is imported or cooked at load time.
+         *
+         * @returns nullptr when the file cannot be read or is not a valid mesh cache of the current version.
          */
-        std::shared_ptr<scene> create_plane(const std::shared_ptr<command_list>& commandList, DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f), float width = 1.0f, float height = 1.0f);
+        std::shared_ptr<scene> load_model(const std::shared_ptr<command_list>& commandList, const std::filesystem::path& path);
     }
 }
\ No newline at end of file
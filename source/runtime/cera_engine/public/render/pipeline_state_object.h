@@ -4,6 +4,11 @@
 
 #include "render/d3dx12_declarations.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
 namespace cera
 {
     class device;
@@ -11,14 +16,72 @@ namespace cera
     class pipeline_state_object
     {
     public:
+        /**
+         * Get the d3d pipeline state.
+         * Returns nullptr while the pipeline state is still being compiled or when compilation failed.
+         */
         Microsoft::WRL::ComPtr<ID3D12PipelineState> get_d3d_pipeline_state_object() const;
 
+        /**
+         * Get the hash of the pipeline state stream this pipeline state object was created from.
+         * Pipeline state objects with the same hash are shared by the device.
+         */
+        u64 get_hash() const;
+
+        /**
+         * Pipeline state objects created with device::create_pipeline_state_object_async are
+         * compiled on a background thread, they can only be bound once they are ready.
+         */
+        bool is_ready() const;
+        bool has_failed() const;
+
+        /**
+         * Block the calling thread until compilation has finished.
+         */
+        void wait() const;
+
+        /**
+         * Get the pipeline state that is used while this pipeline state is not ready.
+         */
+        const std::shared_ptr<pipeline_state_object>& get_fallback() const;
+
+        /**
+         * Get the pipeline state that should be bound in place of this one.
+         * This is the pipeline state itself when it is ready, otherwise its (ready) fallback.
+         * @returns nullptr when neither is ready.
+         */
+        const pipeline_state_object* get_bindable_pipeline_state() const;
+
     protected:
-        pipeline_state_object(device& device, const D3D12_PIPELINE_STATE_STREAM_DESC& desc);
+        friend class device;
+
+        pipeline_state_object(device& device, Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState, u64 hash);
+        pipeline_state_object(device& device, u64 hash, const std::shared_ptr<pipeline_state_object>& fallback);
         virtual ~pipeline_state_object();
 
+        /**
+         * Called when background compilation has finished.
+         * A null pipeline state marks the pipeline state object as failed.
+         */
+        void complete(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState);
+
     private:
+        enum class compile_state : u8
+        {
+            pending,
+            ready,
+            failed
+        };
+
         device& m_device;
         Microsoft::WRL::ComPtr<ID3D12PipelineState> m_d3d_pipeline_state_object;
+        u64 m_hash;
+
+        std::shared_ptr<pipeline_state_object> m_fallback;
+
+        // The d3d pipeline state may only be read once the state is no longer pending.
+        std::atomic<compile_state> m_compile_state;
+        mutable std::mutex m_compile_mutex;
+        mutable std::condition_variable m_compile_cv;
     };
 }
\ No newline at end of file
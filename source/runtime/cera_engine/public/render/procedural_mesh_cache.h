@@ -0,0 +1,61 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "render/mesh_factory.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace cera
+{
+    class mesh;
+    class command_list;
+
+    /**
+     * Cache of generated meshes keyed by their shape, parameters and vertex layout.
+     * Requesting a shape that was created before returns the same mesh, any number of equal primitives share
+     * one set of GPU buffers that is uploaded once. Draws of a shared mesh are grouped by the scene and
+     * instanced. Cached meshes stay alive until the cache is cleared.
+     */
+    class procedural_mesh_cache
+    {
+    public:
+        /**
+         * Get the mesh of a shape, it is created and recorded on the command list when it is requested the first time.
+         * Execute the command list before the mesh is drawn.
+         *
+         * @returns nullptr when the description is invalid.
+         */
+        std::shared_ptr<mesh> get_mesh(const std::shared_ptr<command_list>& commandList, const procedural_mesh_desc& desc);
+
+        /**
+         * Get the meshes of many shapes. Shapes that are not cached yet are created in one batch and share
+         * their buffers, see mesh_factory::create_meshes.
+         *
+         * @param meshes Receives one mesh per description, nullptr for invalid descriptions.
+         */
+        void get_meshes(const std::shared_ptr<command_list>& commandList, const std::vector<procedural_mesh_desc>& descs, std::vector<std::shared_ptr<mesh>>& meshes);
+
+        /**
+         * Release the cached meshes, meshes that are still referenced elsewhere stay valid.
+         */
+        void clear();
+
+        size_t size() const;
+
+        // Requests that were served from the cache and requests that created a mesh.
+        u64 get_num_hits() const;
+        u64 get_num_misses() const;
+
+    private:
+        mutable std::mutex m_mutex;
+
+        std::unordered_map<procedural_mesh_desc, std::shared_ptr<mesh>, procedural_mesh_desc_hasher> m_meshes;
+
+        u64 m_num_hits = 0;
+        u64 m_num_misses = 0;
+    };
+}
\ No newline at end of file
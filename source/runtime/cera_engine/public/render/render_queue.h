@@ -0,0 +1,195 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cera
+{
+    class mesh;
+    struct bounding_box;
+
+    /**
+     * 64-bit draw sort key.
+     * Fields are ordered from most to least expensive state change, sorting the keys
+     * groups draws that share state and orders draws front-to-back within a group.
+     *
+     * Layout (most significant bit first):
+     *   pass            4 bits
+     *   root signature  8 bits
+     *   pipeline state 12 bits
+     *   material       16 bits
+     *   level of detail 4 bits
+     *   depth          20 bits (front-to-back)
+     */
+    namespace sort_key
+    {
+        constexpr u32 pass_bits = 4;
+        constexpr u32 root_signature_bits = 8;
+        constexpr u32 pipeline_state_bits = 12;
+        constexpr u32 material_bits = 16;
+        constexpr u32 lod_bits = 4;
+        constexpr u32 depth_bits = 20;
+
+        constexpr u32 depth_shift = 0;
+        constexpr u32 lod_shift = depth_shift + depth_bits;
+        constexpr u32 material_shift = lod_shift + lod_bits;
+        constexpr u32 pipeline_state_shift = material_shift + material_bits;
+        constexpr u32 root_signature_shift = pipeline_state_shift + pipeline_state_bits;
+        constexpr u32 pass_shift = root_signature_shift + root_signature_bits;
+
+        static_assert(pass_shift + pass_bits == 64, "Sort key fields must fill 64 bits.");
+
+        /**
+         * All bits that identify GPU state, two keys with the same state bits can be drawn without state changes.
+         */
+        constexpr u64 state_mask = ~((1ull << material_shift) - 1);
+
+        /**
+         * Quantize a view space depth so it can be stored in the key.
+         * Positive IEEE floats compare like integers, the top bits of the float are used directly.
+         * Negative depths (behind the camera) are clamped to 0.
+         */
+        u32 quantize_depth(float viewDepth);
+
+        /**
+         * Build a key with level of detail 0. Identifiers are truncated to the width of their field.
+         */
+        u64 make(u32 pass, u32 rootSignature, u32 pipelineState, u32 material, float viewDepth);
+
+        u32 get_pass(u64 key);
+        u32 get_root_signature(u64 key);
+        u32 get_pipeline_state(u64 key);
+        u32 get_material(u64 key);
+        u32 get_lod(u64 key);
+
+        /**
+         * Replace the material field of a key, the other fields are kept.
+         */
+        u64 set_material(u64 key, u32 material);
+
+        /**
+         * Replace the level of detail field of a key, draws of the same material and level become adjacent.
+         * Levels beyond the width of the field are clamped to the largest value.
+         */
+        u64 set_lod(u64 key, u32 lod);
+    }
+
+    /**
+     * A single draw emitted during scene traversal.
+     */
+    struct draw_packet
+    {
+        const cera::mesh* mesh = nullptr;
+        u32 instance_count = 1;
+        u32 start_instance = 0;
+        // Index of the world transform of the draw in the transforms gathered during traversal.
+        u32 transform_index = 0;
+        // Level of detail of the mesh to draw.
+        u32 lod = 0;
+        // Level of detail drawn last frame, owned by the submitting node or entity. Read and updated when levels are selected.
+        u8* previous_lod = nullptr;
+        // World bounds computed before submission, nullptr when culling has to transform the bounds of the mesh.
+        const bounding_box* world_box = nullptr;
+    };
+
+    /**
+     * A run of sorted draw packets that share state, mesh and level of detail, drawn with one instanced draw.
+     * Every packet is one instance, the instances are the packets in sorted order starting at start_instance.
+     */
+    struct instance_batch
+    {
+        const cera::mesh* mesh;
+        u32 lod;
+        u32 start_instance;
+        u32 instance_count;
+    };
+
+    /**
+     * Number of state changes between consecutive draws of a render queue.
+     */
+    struct render_queue_stats
+    {
+        u32 num_packets = 0;
+        // State changes when drawing in submission order.
+        u32 num_state_changes_unsorted = 0;
+        // State changes when drawing in sorted order.
+        u32 num_state_changes_sorted = 0;
+    };
+
+    /**
+     * Collects draw packets during traversal and orders them by sort key before recording.
+     */
+    class render_queue
+    {
+    public:
+        /**
+         * Remove all packets, allocated memory is kept for the next frame.
+         */
+        void clear();
+
+        void submit(u64 sortKey, const draw_packet& packet);
+
+        /**
+         * Sort the submitted packets by key.
+         * The sort is stable, packets with equal keys keep their submission order.
+         */
+        void sort();
+
+        /**
+         * Remove packets that are not visible.
+         * Must be called before sort(), visibility holds one entry per packet in submission order.
+         */
+        void cull(const std::vector<u8>& visibility);
+
+        size_t size() const;
+        bool empty() const;
+
+        /**
+         * Get the sort key and packet at a position in sorted order.
+         * Before sort() was called, packets are in submission order.
+         */
+        u64 get_sort_key(size_t index) const;
+        const draw_packet& get_packet(size_t index) const;
+        draw_packet& get_packet(size_t index);
+
+        /**
+         * Change the sort key of a packet, must be called before sort().
+         */
+        void set_sort_key(size_t index, u64 sortKey);
+
+        /**
+         * Group the packets in sorted order into instance batches, the previous batches are replaced.
+         */
+        void build_instance_batches(std::vector<instance_batch>& batches) const;
+
+        /**
+         * Statistics of the last sort.
+         */
+        const render_queue_stats& get_stats() const;
+
+    private:
+        struct sort_entry
+        {
+            u64 key;
+            u32 packet_index;
+        };
+
+        /**
+         * Stable least significant digit radix sort on the 64-bit keys.
+         * Digits are 8 bits wide, passes where all keys share the same digit are skipped.
+         */
+        static void radix_sort(std::vector<sort_entry>& entries, std::vector<sort_entry>& scratch);
+
+        static u32 count_state_changes(const std::vector<sort_entry>& entries);
+
+    private:
+        std::vector<draw_packet> m_packets;
+
+        std::vector<sort_entry> m_sort_entries;
+        std::vector<sort_entry> m_sort_scratch;
+
+        render_queue_stats m_stats;
+    };
+}
\ No newline at end of file
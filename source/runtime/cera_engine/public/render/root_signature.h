@@ -6,12 +6,48 @@
 
 #include "render/d3dx12_declarations.h"
 
+#include <vector>
+
 namespace cera
 {
     class device;
 
+    /**
+     * Descriptor table layout of a root signature.
+     * Computed once when the root signature is created so binding a root signature
+     * does not have to walk the root parameters again.
+     */
+    struct root_signature_layout
+    {
+        // A maximum of 32 descriptor tables are supported (since a 32-bit
+        // mask is used to represent the descriptor tables in the root signature).
+        static constexpr u32 max_descriptor_tables = 32;
+
+        // Only CBV_SRV_UAV and SAMPLER descriptors can be placed in descriptor tables.
+        static constexpr u32 num_descriptor_heap_types = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER + 1;
+
+        // Per descriptor heap type, a bit mask that represents the root parameter
+        // indices that are descriptor tables of that type.
+        u32 descriptor_table_bit_mask[num_descriptor_heap_types];
+        // Total number of descriptors in all descriptor tables of a descriptor heap type.
+        u32 num_descriptors[num_descriptor_heap_types];
+
+        // Number of descriptors per descriptor table.
+        u32 num_descriptors_per_table[max_descriptor_tables];
+        // Offset of each descriptor table relative to the first table of the same descriptor heap type.
+        u32 descriptor_table_offset[max_descriptor_tables];
+    };
+
     class root_signature
     {
+    public:
+        /**
+         * Compute the hash of a root signature description.
+         * Equivalent descriptions, for example descriptor ranges using D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND
+         * and the same ranges with explicit offsets, result in the same hash.
+         */
+        static u64 compute_hash(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc);
+
     public:
         wrl::ComPtr<ID3D12RootSignature> get_d3d_root_signature() const;
         D3D12_ROOT_SIGNATURE_DESC1 get_d3d_root_signature_description() const;
@@ -19,6 +55,23 @@ namespace cera
         u32 get_descriptor_table_bit_mask(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) const;
         u32 get_num_descriptors(u32 rootIndex) const;
 
+        /**
+         * Get the precomputed descriptor table layout.
+         */
+        const root_signature_layout& get_layout() const;
+
+        /**
+         * Get a hash of the root signature description.
+         * The hash only depends on the content of the description and is stable between runs.
+         */
+        u64 get_hash() const;
+
+        /**
+         * Get the hash of a root signature that was created by a cera::root_signature.
+         * @returns 0 when the root signature was created by other means.
+         */
+        static u64 get_hash(ID3D12RootSignature* rootSignature);
+
     protected:
         root_signature(device& device, const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc);
 
@@ -33,18 +86,15 @@ namespace cera
 
         D3D12_ROOT_SIGNATURE_DESC1 m_root_signature_description;
 
+        // Storage the description points into, one range list per root parameter.
+        std::vector<D3D12_ROOT_PARAMETER1> m_root_parameters;
+        std::vector<std::vector<D3D12_DESCRIPTOR_RANGE1>> m_descriptor_ranges;
+        std::vector<D3D12_STATIC_SAMPLER_DESC> m_static_samplers;
+
         wrl::ComPtr<ID3D12RootSignature> m_root_signature;
 
-        // Need to know the number of descriptors per descriptor table.
-        // A maximum of 32 descriptor tables are supported (since a 32-bit
-        // mask is used to represent the descriptor tables in the root signature.
-        u32 m_num_descriptors_per_table[32];
-
-        // A bit mask that represents the root parameter indices that are 
-        // descriptor tables for Samplers.
-        u32 m_sampler_table_bit_mask;
-        // A bit mask that represents the root parameter indices that are 
-        // CBV, UAV, and SRV descriptor tables.
-        u32 m_descriptor_table_bit_mask;
+        u64 m_hash;
+
+        root_signature_layout m_layout;
     };
 }
\ No newline at end of file
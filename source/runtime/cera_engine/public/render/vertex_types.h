@@ -2,6 +2,8 @@
 
 #include "render/d3dx12_declarations.h"
 
+#include "util/types.h"
+
 namespace cera
 {
     struct vertex_pos_color
@@ -24,4 +26,51 @@ namespace cera
         static const int                        input_element_count = 2;
         static const D3D12_INPUT_ELEMENT_DESC   input_elements[input_element_count];
     };
+
+    /**
+     * Compact vertex with a quantized position and an RGBA8 color, half the size of vertex_pos_color.
+     * Positions are UNORM16 relative to the bounds of the mesh, see mesh::get_position_quantization.
+     * Encode vertices with the vertex_encoder.
+     */
+    struct vertex_packed_pos_color
+    {
+        u16 position[4];
+        u32 color;
+
+        static const D3D12_INPUT_LAYOUT_DESC    input_layout;
+        static const int                        input_element_count = 2;
+        static const D3D12_INPUT_ELEMENT_DESC   input_elements[input_element_count];
+    };
+
+    /**
+     * Compact vertex for lit meshes, 20 bytes instead of 52 bytes with float attributes.
+     * Normal and tangent are octahedral encoded unit vectors. The fourth position value holds the
+     * handedness of the tangent frame: 0 for a bitangent of cross(normal, tangent), 1 when it is flipped.
+     */
+    struct vertex_packed_pos_normal_tangent_color
+    {
+        u16 position[4];
+        s16 normal[2];
+        s16 tangent[2];
+        u32 color;
+
+        static const D3D12_INPUT_LAYOUT_DESC    input_layout;
+        static const int                        input_element_count = 4;
+        static const D3D12_INPUT_ELEMENT_DESC   input_elements[input_element_count];
+    };
+
+    /**
+     * Per instance world transform, read by instanced scene draws.
+     * The matrix is stored row-major as DirectXMath stores it and is read in the
+     * vertex shader as four float4 rows WORLD0 - WORLD3.
+     * Combine these elements with the vertex elements of the mesh in the input layout.
+     */
+    struct instance_transform
+    {
+        DirectX::XMFLOAT4X4 world;
+
+        static const UINT                       input_slot = 1;
+        static const int                        input_element_count = 4;
+        static const D3D12_INPUT_ELEMENT_DESC   input_elements[input_element_count];
+    };
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "aabb_tree.h"
+#include "bounding_volume.h"
+#include "transform_hierarchy.h"
+
+#include <vector>
+
+namespace cera
+{
+    class mesh;
+    class scene_node;
+
+    /**
+     * A mesh of a scene node as seen by the renderer.
+     */
+    struct render_proxy
+    {
+        float4x4 world_transform;
+        bounding_box world_box;
+
+        const cera::mesh* mesh;
+        scene_node* node;
+        // Index of the mesh in the mesh list of the node.
+        u32 mesh_index;
+
+        // Proxy in the spatial index, aabb_tree::invalid_proxy when the proxy is not indexed.
+        aabb_tree::proxy spatial_proxy;
+
+        // Level of detail drawn last frame, written by the scene when levels are selected.
+        u8 lod;
+        // Set while the world transform and bounds are outdated.
+        u8 dirty;
+    };
+
+    /**
+     * Flat array of the render proxies of a scene graph, kept up to date by the scene nodes themselves.
+     *
+     * Nodes that are attached to a proxy list report their changes: adding or removing nodes and meshes
+     * creates or removes proxies right away, moving a node marks the proxies of its subtree dirty and
+     * records them in a journal. update() only visits the journal, the cost of keeping the list current
+     * is proportional to the number of changes rather than the size of the scene.
+     *
+     * Proxies are stored densely, removing a proxy moves the last proxy into its place. A node belongs
+     * to at most one proxy list. Transforms of attached nodes must be changed through the scene node,
+     * changes made to the transform hierarchy directly are not reported.
+     */
+    class render_proxy_list
+    {
+    public:
+        render_proxy_list();
+        ~render_proxy_list();
+
+        render_proxy_list(const render_proxy_list&) = delete;
+        render_proxy_list& operator=(const render_proxy_list&) = delete;
+
+        /**
+         * Create the proxies of a node and its descendants, the nodes report their changes to this list from now on.
+         * Nodes attached to another list are detached from it first. Nodes must be detached before the list is destroyed.
+         */
+        void attach(scene_node& root);
+
+        /**
+         * Remove the proxies of a node and its descendants, the nodes stop reporting their changes.
+         */
+        void detach(scene_node& root);
+
+        /**
+         * Recreate the proxies of a node after its mesh list changed.
+         */
+        void on_meshes_changed(scene_node& node);
+
+        /**
+         * Mark the proxies of a node and its descendants dirty after its transform changed.
+         */
+        void on_moved(scene_node& node);
+
+        /**
+         * Refresh the world transforms and bounds of all dirty proxies and bring the spatial index up to date.
+         * The world transforms of the transform hierarchy must be up to date.
+         */
+        void update();
+
+        /**
+         * Keep the world bounds of all proxies in a spatial index, nullptr stops indexing.
+         * The user data of the index is not used, see get_proxy_of_spatial_proxy().
+         */
+        void set_spatial_index(aabb_tree* spatialIndex);
+
+        /**
+         * Index of the render proxy registered in the spatial index as spatialProxy.
+         */
+        u32 get_proxy_of_spatial_proxy(aabb_tree::proxy spatialProxy) const;
+
+        std::vector<render_proxy>& get_proxies();
+        const std::vector<render_proxy>& get_proxies() const;
+        size_t size() const;
+
+        /**
+         * Number of proxies refreshed by the last update().
+         */
+        u32 get_num_updated_proxies() const;
+
+    private:
+        // Gather a node and its descendants in m_subtree.
+        void collect_subtree(scene_node& root);
+
+        void add_proxies(scene_node& node);
+        void remove_proxies(scene_node& node);
+        void remove_proxy(u32 index);
+
+        void mark_dirty(u32 index);
+
+        // Refresh the world transform and bounds of a proxy, returns true when the spatial index has to be refit.
+        bool update_proxy(render_proxy& proxy, u32 index);
+        void insert_spatial_proxy(render_proxy& proxy, u32 index);
+
+    private:
+        std::vector<render_proxy> m_proxies;
+
+        // Proxies that became dirty since the last update. Entries of proxies that were removed or moved
+        // in the array are skipped by checking the dirty flag.
+        std::vector<u32> m_journal;
+        u32 m_num_updated_proxies;
+
+        aabb_tree* m_spatial_index;
+        // Render proxy of every spatial proxy.
+        std::vector<u32> m_spatial_owners;
+
+        std::vector<scene_node*> m_subtree;
+    };
+}
\ No newline at end of file
@@ -1,11 +1,90 @@
 #pragma once
 
+#include "util/types.h"
+
+#include "render/d3dx12_declarations.h"
+#include "render/indirect_draw_arguments.h"
+#include "render/render_queue.h"
+#include "render/vertex_types.h"
+
+#include "aabb_tree.h"
+#include "frustum_culler.h"
+#include "lod_selector.h"
+#include "meshlet_builder.h"
+#include "occlusion_culler.h"
+#include "render_proxy_list.h"
+
 #include <memory>
+#include <vector>
 
 namespace cera
 {
     class scene_node;
     class command_list;
+    class mesh;
+
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    namespace ecs
+    {
+        class registry;
+    }
+
+    /**
+     * Statistics of the last scene draw.
+     */
+    struct scene_draw_stats
+    {
+        // Number of visible meshes that were drawn, one per mesh per node.
+        u32 num_draw_packets = 0;
+        // Number of meshes that were outside of the view frustum.
+        u32 num_culled_packets = 0;
+        // Number of draw calls that were recorded to draw them, an indirect batch counts as one.
+        u32 num_draw_calls = 0;
+        // Number of draws recorded as commands of indirect batches.
+        u32 num_indirect_commands = 0;
+        // Number of times vertex and index buffers were bound, draws of meshes in the same page of the geometry pool share a bind.
+        u32 num_buffer_binds = 0;
+        // CPU time spent to traverse, sort and record the scene.
+        u64 cpu_time_us = 0;
+        // Part of the CPU time spent to compute world bounds and test them against the view frustum.
+        u64 culling_time_us = 0;
+        // Number of meshes inside the view frustum that were hidden by occluders.
+        u32 num_occluded_packets = 0;
+        // Number of occluders rasterized.
+        u32 num_occluders = 0;
+        // Part of the culling time spent to rasterize occluders and test occludees.
+        u64 occlusion_time_us = 0;
+        // Number of triangles drawn, instances included.
+        u64 num_triangles = 0;
+        // Number of draw packets drawn with a coarser level of detail than level 0.
+        u32 num_reduced_lod_packets = 0;
+        // Part of the CPU time spent to select levels of detail.
+        u64 lod_selection_time_us = 0;
+        // Number of render proxies whose world transform and bounds were refreshed because their node changed.
+        u32 num_updated_proxies = 0;
+        // Number of meshlets tested by meshlet culling.
+        u32 num_meshlets = 0;
+        // Number of meshlets that faced away from the camera.
+        u32 num_backfacing_meshlets = 0;
+        // Number of meshlets outside of the view frustum.
+        u32 num_culled_meshlets = 0;
+        // Part of the CPU time spent to cull meshlets.
+        u64 meshlet_culling_time_us = 0;
+    };
+
+    /**
+     * A mesh of a scene node found by a spatial query.
+     * Pointers are valid until the scene graph changes.
+     */
+    struct scene_query_result
+    {
+        scene_node* node = nullptr;
+        const cera::mesh* mesh = nullptr;
+    };
 
     class scene
     {
@@ -13,12 +92,241 @@ namespace cera
         scene();
         ~scene();
 
+        /**
+         * Set the root of the scene graph. The meshes of the graph are kept in a flat list of render proxies,
+         * nodes of the graph report their changes to it so draws do not traverse the graph.
+         * A node can be part of one scene only.
+         */
         void set_root_node(const std::shared_ptr<scene_node>& sceneNode);
         const std::shared_ptr<scene_node>& get_root_node() const;
 
-        void draw(const std::shared_ptr<command_list>& commandList);
+        /**
+         * Render proxies of the meshes in the scene graph.
+         */
+        const render_proxy_list& get_render_proxies() const;
+
+        /**
+         * Draw the entities of a registry together with the scene graph.
+         * Every entity with an ecs::world_transform and an ecs::mesh_instance is drawn, entities with
+         * ecs::world_bounds are culled with these bounds (see ecs::update_world_bounds and ecs::local_bounds),
+         * all others with the transformed bounds of their mesh. Entities are not part of the spatial index.
+         * The registry must not change structurally while the scene is drawn.
+         */
+        void set_entities(const std::shared_ptr<ecs::registry>& entityRegistry);
+        const std::shared_ptr<ecs::registry>& get_entities() const;
+
+        /**
+         * Recompute the outdated world transforms of the scene nodes, on the workers of the scene when the
+         * parallel transform update is enabled.
+         * Call this once per frame after nodes were moved and before the scene is drawn. Scenes that are drawn
+         * several times per frame are updated once. Scene nodes share one transform hierarchy unless they were created
+         * with their own, updating one scene updates the world transforms of the others in its hierarchy as well. Without an update draws are still correct,
+         * world transforms of moved nodes are computed by walking up the hierarchy.
+         */
+        void update();
+
+        /**
+         * Draw all meshes in the scene.
+         * Draws are collected in a render queue and sorted by state and front-to-back depth before they are recorded.
+         *
+         * @param viewMatrix Used to order draws front-to-back.
+         */
+        void draw(const std::shared_ptr<command_list>& commandList, const DirectX::XMMATRIX& viewMatrix = DirectX::XMMatrixIdentity());
+
+        /**
+         * Draw the meshes in the scene that intersect the view frustum.
+         * The object space bounds of the meshes are transformed by the world transform of their node
+         * and tested against the frustum before the draws are sorted and recorded.
+         */
+        void draw(const std::shared_ptr<command_list>& commandList, const DirectX::XMMATRIX& viewMatrix, const DirectX::XMMATRIX& projectionMatrix);
+
+        /**
+         * Draw nodes that share a mesh with a single instanced draw.
+         * The world transforms of the instances are uploaded every frame and bound as per instance
+         * vertex data (see instance_transform), the bound pipeline state must read them.
+         */
+        void enable_instancing(u32 instanceBufferSlot = instance_transform::input_slot);
+        void disable_instancing();
+        bool is_instancing_enabled() const;
+
+        /**
+         * Record the sorted draws with one ExecuteIndirect per batch of draws that share pipeline state and
+         * vertex and index buffers, meshes in the same page of the geometry pool end up in the same batch.
+         * The world transforms of a batch are uploaded as a structured buffer of row-major float4x4 and bound to the
+         * shader resource view at transformsRootParameterIndex. Every command sets a single root constant at
+         * rootParameterIndex to the index of its transform in that buffer, the bound root signature must have
+         * 32-bit constants there. Takes precedence over instancing, meshlet culling is not applied to indirect draws.
+         * Meshes without indices are drawn directly with the same bindings. Direct and instanced draws do not bind
+         * the transforms, bind a pipeline state that reads the transforms only while indirect draws are enabled.
+         */
+        void enable_indirect_draws(u32 rootParameterIndex = 0, u32 transformsRootParameterIndex = 1);
+        void disable_indirect_draws();
+        bool is_indirect_draws_enabled() const;
+
+        /**
+         * Update world transforms on worker threads owned by the scene, see update().
+         * Pays off for hierarchies with many thousands of moving nodes, small scenes are updated on the calling thread anyway.
+         *
+         * @param numThreads The number of worker threads, 0 uses the number of hardware threads minus one.
+         */
+        void enable_parallel_transform_update(u32 numThreads = 0);
+        void disable_parallel_transform_update();
+        bool is_parallel_transform_update_enabled() const;
+
+        /**
+         * Keep the world bounds of all meshes in a dynamic AABB tree, updated by draw() or update_spatial_index().
+         * The tree answers frustum, ray, sphere and box queries without visiting every node.
+         */
+        void enable_spatial_index(float margin = 0.1f);
+        void disable_spatial_index();
+        bool is_spatial_index_enabled() const;
+
+        /**
+         * Bring the spatial index up to date with the scene graph.
+         * Only the meshes that were added, moved or removed since the last update are visited.
+         */
+        void update_spatial_index();
+
+        /**
+         * Find the meshes whose world bounds intersect a volume. Requires the spatial index.
+         * Results are conservative, bounds are fattened by the margin of the index.
+         */
+        void query(const bounding_box& box, std::vector<scene_query_result>& results) const;
+        void query(const bounding_sphere& sphere, std::vector<scene_query_result>& results) const;
+        void query(const frustum& viewFrustum, std::vector<scene_query_result>& results) const;
+
+        /**
+         * Find the closest mesh whose world bounding box is hit by a ray. Requires the spatial index.
+         * @returns false when no mesh is hit.
+         */
+        bool raycast(const float3& origin, const float3& direction, float maxDistance, scene_query_result& result, float& distance) const;
+
+        const aabb_tree* get_spatial_index() const;
+
+        /**
+         * Cull meshes hidden behind other meshes, only used by draws with a projection matrix.
+         * Meshes with occluder geometry that pass frustum culling are rasterized into a low resolution
+         * depth buffer, the world bounds of all other meshes are tested against it before drawing.
+         *
+         * @param numThreads Number of worker threads that rasterize screen tiles, 0 uses the number of hardware threads minus one.
+         */
+        void enable_occlusion_culling(u32 width = 256, u32 height = 128, u32 numThreads = 0);
+        void disable_occlusion_culling();
+        bool is_occlusion_culling_enabled() const;
+
+        /**
+         * Depth buffer of the last draw, nullptr when occlusion culling is disabled.
+         */
+        const occlusion_culler* get_occlusion_culler() const;
+
+        /**
+         * Draw meshes with levels of detail (see mesh::add_lod) with the coarsest level whose error, projected
+         * to the screen, stays below maxPixelError. Only used by draws with a projection matrix.
+         * A coarser level is only selected once its error is a fraction hysteresis below the limit,
+         * meshes close to the limit do not switch levels every frame.
+         *
+         * @param viewportHeight Height of the render target in pixels.
+         */
+        void enable_lod_selection(float viewportHeight, float maxPixelError = 1.0f, float hysteresis = 0.25f);
+        void disable_lod_selection();
+        bool is_lod_selection_enabled() const;
+
+        /**
+         * Cull the meshlets of visible meshes (see mesh::set_meshlets) separately and only draw the index ranges of meshlets
+         * that face the camera and intersect the view frustum. Only used by draws with a projection matrix, for packets
+         * drawn at level of detail 0 and without instancing.
+         */
+        void enable_meshlet_culling();
+        void disable_meshlet_culling();
+        bool is_meshlet_culling_enabled() const;
+
+        /**
+         * Statistics of the render queue of the last draw.
+         */
+        const render_queue_stats& get_render_queue_stats() const;
+        /**
+         * Statistics of the last draw.
+         */
+        const scene_draw_stats& get_draw_stats() const;
+
+    private:
+        void draw_scene(command_list& commandList, const DirectX::XMMATRIX& viewMatrix, const DirectX::XMMATRIX* projectionMatrix);
+
+        // Submit a draw packet per render proxy of the scene graph.
+        void submit_proxies(const DirectX::XMMATRIX& viewMatrix);
+        // Submit a draw packet per mesh instance of the entity registry.
+        void submit_entities(const DirectX::XMMATRIX& viewMatrix);
+
+        // Remove the packets of the render queue that are outside of the frustum or hidden by occluders.
+        void cull(const float4x4& viewProjection);
+        void cull_occluded(const float4x4& viewProjection);
+
+        // Select the level of detail of the visible packets, must be called before the render queue is sorted.
+        void select_lods(const DirectX::XMMATRIX& viewMatrix, const DirectX::XMMATRIX& projectionMatrix);
+
+        void append_query_results(const std::vector<aabb_tree::proxy>& proxies, std::vector<scene_query_result>& results) const;
+
+        // Record the sorted render queue with one draw per packet.
+        void record_draws(command_list& commandList);
+        // Record a draw per range of visible meshlets of a packet, returns false when the packet has to be drawn as a whole.
+        bool record_meshlet_draws(command_list& commandList, const draw_packet& packet);
+        // Record the sorted render queue with one draw per instance batch.
+        void record_instanced_draws(command_list& commandList);
+        // Record the sorted render queue with one indirect draw per batch of packets that share state and buffers.
+        void record_indirect_draws(command_list& commandList);
+        void flush_indirect_draws(command_list& commandList);
 
     private:
         std::shared_ptr<scene_node> m_root_node;
+        std::shared_ptr<ecs::registry> m_entities;
+
+        // Meshes of the scene graph, updated by the nodes as they change.
+        render_proxy_list m_render_proxies;
+
+        // Kept between frames to reuse their memory.
+        render_queue m_render_queue;
+        std::vector<DirectX::XMFLOAT4X4> m_world_transforms;
+        std::vector<DirectX::XMFLOAT4X4> m_instance_transforms;
+        std::vector<instance_batch> m_instance_batches;
+        frustum_culler m_frustum_culler;
+        std::vector<u8> m_visibility;
+        // World bounds of the packets in submission order.
+        std::vector<bounding_box> m_world_boxes;
+
+        std::unique_ptr<occlusion_culler> m_occlusion_culler;
+        std::unique_ptr<threading::thread_pool> m_occlusion_pool;
+
+        lod_selector m_lod_selector;
+        // Render queue index of every object of the LOD selector.
+        std::vector<u32> m_lod_packets;
+        std::vector<u8> m_selected_lods;
+        bool m_lod_selection_enabled;
+        float m_lod_viewport_height;
+        float m_lod_max_pixel_error;
+        float m_lod_hysteresis;
+
+        bool m_instancing_enabled;
+        u32 m_instance_buffer_slot;
+
+        bool m_indirect_draws_enabled;
+        u32 m_indirect_root_parameter_index;
+        u32 m_indirect_transforms_root_parameter_index;
+        // Commands of the current indirect batch and the world transforms they index.
+        indirect_draw_arguments m_indirect_arguments;
+        std::vector<DirectX::XMFLOAT4X4> m_indirect_transforms;
+
+        bool m_meshlet_culling_enabled;
+        // View of the current draw, only valid while it has a projection matrix.
+        bool m_has_view_projection;
+        float4x4 m_view_projection;
+        float3 m_camera_position;
+        std::vector<meshlet_index_range> m_meshlet_ranges;
+
+        std::unique_ptr<threading::thread_pool> m_transform_update_pool;
+
+        std::unique_ptr<aabb_tree> m_spatial_index;
+        mutable std::vector<aabb_tree::proxy> m_query_proxies;
+
+        scene_draw_stats m_draw_stats;
     };
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 #include "render/d3dx12_declarations.h"
 
+#include "transform_hierarchy.h"
+
+#include <functional>
 #include <memory>
 #include <map>
 #include <vector>
@@ -10,15 +13,19 @@
 namespace cera
 {
     class mesh;
-    class command_list;
+    class render_proxy_list;
 
     class scene_node : public std::enable_shared_from_this<scene_node>
     {
     public:
         explicit scene_node(const DirectX::XMMATRIX& localTransform = DirectX::XMMatrixIdentity());
-        virtual ~scene_node();
 
-        void draw(const std::shared_ptr<command_list>& commandList);
+        /**
+         * Create a node in a given transform hierarchy instead of the shared one, nullptr uses the shared one.
+         * Scene graphs that are updated separately (for example of different worlds) do not have to share their storage.
+         */
+        scene_node(const DirectX::XMMATRIX& localTransform, const std::shared_ptr<transform_hierarchy>& transformHierarchy);
+        virtual ~scene_node();
 
         /**
          * Assign a name to the scene node so it can be searched for later.
@@ -26,6 +33,19 @@ namespace cera
         const std::string& get_name() const;
         void               set_name(const std::string& name);
 
+        /**
+         * Transforms of scene nodes are stored in a transform hierarchy, a scene node only holds a handle into it.
+         * Nodes created without a hierarchy share one, it is destroyed with the last scene node that uses it.
+         * Parents and children must use the same hierarchy.
+         * Scene nodes are not thread safe, create, modify and draw them on a single thread.
+         */
+        transform_hierarchy& get_transform_hierarchy() const;
+
+        /**
+         * Handle of this node in the transform hierarchy, unique while the node exists.
+         */
+        transform_hierarchy::handle get_transform_handle() const;
+
         /**
          * Get the scene nodes local (relative to its parent's transform).
          */
@@ -40,6 +60,8 @@ namespace cera
         /**
          * Get the scene node's world transform (concatenated with its parents
          * world transform).
+         * World transforms are cached in the transform hierarchy and recomputed by update_world_transforms.
+         * Until then, nodes that changed compute their world transform by walking up the hierarchy.
          */
         DirectX::XMMATRIX get_world_transform() const;
 
@@ -49,6 +71,16 @@ namespace cera
          */
         DirectX::XMMATRIX get_inverse_world_transform() const;
 
+        /**
+         * Recompute all outdated world transforms in one linear pass over the transform hierarchy of this node,
+         * this includes the nodes of other scene graphs in the same hierarchy.
+         * Queries after this call do not have to walk up the hierarchy.
+         * Call this once per frame before the scenes are traversed, see scene::update.
+         *
+         * @param threadPool When set, depth levels of the hierarchy are split across the worker threads.
+         */
+        void update_world_transforms(threading::thread_pool* threadPool = nullptr) const;
+
         /**
          * Add a child node to this scene node.
          * NOTE: Circular references are not checked.
@@ -71,11 +103,16 @@ namespace cera
          * Get a mesh in the list of meshes for this node.
          */
         std::shared_ptr<mesh> get_mesh(size_t index = 0);
+        size_t get_num_meshes() const;
 
-    private:
-        DirectX::XMMATRIX get_parent_world_transform() const;
+        /**
+         * Call a function for this node and all of its descendants, parents are visited before their children.
+         */
+        void for_each_node(const std::function<void(scene_node&)>& function);
 
     private:
+        friend class render_proxy_list;
+
         using node_ptr      = std::shared_ptr<scene_node>;
         using node_list     = std::vector<node_ptr>;
         using node_name_map = std::multimap<std::string, node_ptr>;
@@ -83,14 +120,8 @@ namespace cera
 
         std::string m_name;
 
-        // This data must be aligned to a 16-byte boundary.
-        // The only way to guarantee this, is to allocate this
-        // structure in aligned memory.
-        struct alignas(16) aligned_data
-        {
-            DirectX::XMMATRIX m_local_transform;
-            DirectX::XMMATRIX m_inverse_transform;
-        } * m_aligned_data;
+        std::shared_ptr<transform_hierarchy> m_transform_hierarchy;
+        transform_hierarchy::handle m_transform;
 
         std::weak_ptr<scene_node> m_parent_node;
 
@@ -98,5 +129,10 @@ namespace cera
         node_name_map             m_children_by_name;
 
         mesh_list                 m_meshes;
+
+        // Render proxy list of the scene this node is part of, changes of the node are reported to it.
+        render_proxy_list*        m_proxy_list;
+        // Index of the render proxy of every mesh.
+        std::vector<u32>          m_proxy_indices;
     };
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "util/types.h"
+#include "util/aligned_allocator.h"
+
+#include <vector>
+
+namespace cera
+{
+    namespace threading
+    {
+        class thread_pool;
+    }
+
+    /**
+     * Row-major 4x4 matrix with the same memory layout as DirectX::XMFLOAT4X4A.
+     * Points are transformed as row vectors: p' = p * M.
+     */
+    struct alignas(16) float4x4
+    {
+        float m[4][4];
+
+        static float4x4 identity();
+    };
+
+    /**
+     * Compute a * b.
+     */
+    float4x4 multiply(const float4x4& a, const float4x4& b);
+
+    /**
+     * Compute the inverse of a matrix.
+     * @returns false when the matrix is not invertible, the result is left untouched.
+     */
+    bool inverse(const float4x4& matrix, float4x4& result);
+
+    /**
+     * Data oriented storage of a transform hierarchy.
+     *
+     * Transforms are stored in contiguous arrays (local, world, parent, dirty) ordered by
+     * depth in the hierarchy so every parent is stored before its children. Updating the
+     * world transforms is a single linear pass over these arrays.
+     *
+     * Nodes are referenced by handles, handles stay valid when the arrays are reordered.
+     */
+    class transform_hierarchy
+    {
+    public:
+        using handle = u32;
+
+        static constexpr handle invalid_handle = ~0u;
+
+        transform_hierarchy();
+
+        /**
+         * Add a node to the hierarchy.
+         */
+        handle create(const float4x4& localTransform = float4x4::identity(), handle parent = invalid_handle);
+
+        /**
+         * Remove a node from the hierarchy, only the children of the node are visited.
+         * Children of the node become root nodes, their local transforms are kept.
+         */
+        void destroy(handle node);
+
+        /**
+         * Change the parent of a node. Cycles are not checked.
+         */
+        void set_parent(handle node, handle parent);
+        handle get_parent(handle node) const;
+
+        void set_local_transform(handle node, const float4x4& localTransform);
+        const float4x4& get_local_transform(handle node) const;
+
+        /**
+         * Get the world transform of a node.
+         * When transforms changed since the last update, the world transform is computed by
+         * walking up the hierarchy, call update() once per frame to avoid this.
+         */
+        float4x4 get_world_transform(handle node) const;
+
+        /**
+         * Get the inverse of the world transform, cached until the world transform changes.
+         * Filling the cache writes to the hierarchy, unlike the other getters this must not be called
+         * concurrently with any other access. Threads that only read use inverse(get_world_transform(node)).
+         */
+        float4x4 get_inverse_world_transform(handle node);
+
+        /**
+         * Reorder the storage when the structure of the hierarchy changed and recompute
+         * all outdated world transforms.
+         */
+        void update();
+
+        /**
+         * Same as update(), the world transforms are recomputed on the worker threads of a thread pool.
+         * Depth levels are processed one after the other, nodes within a level are split in
+         * cache line aligned ranges. The result is identical to the single threaded update.
+         * Other work in the thread pool may run concurrently, only the tasks of the update are waited for.
+         */
+        void update(threading::thread_pool& threadPool);
+
+        /**
+         * True when world transforms are outdated or the storage has to be reordered.
+         */
+        bool needs_update() const;
+
+        /**
+         * Number of nodes in the hierarchy.
+         */
+        u32 size() const;
+
+    protected:
+        /**
+         * Reorder the storage by depth, removes destroyed nodes.
+         */
+        void sort_by_depth();
+
+        /**
+         * Recompute the world transforms of the nodes in [begin, end) of the storage.
+         * The parents of these nodes must be up to date.
+         */
+        void update_world_transforms(u32 begin, u32 end);
+
+        /**
+         * Reorder the storage when needed, returns true when world transforms have to be recomputed.
+         */
+        bool begin_update();
+        void end_update();
+
+        u32 get_slot(handle node) const;
+
+        // Add a node to the front of the children of a parent, or remove it from the children of its parent.
+        void link_child(handle node, handle parent);
+        void unlink_child(handle node);
+
+        static constexpr u32 invalid_slot = ~0u;
+
+        // Ranges processed by a worker start and end on a multiple of this number of slots.
+        // Together with the cache line aligned storage below no cache line is written by two workers.
+        static constexpr u32 slots_per_range_alignment = memory::cache_line_size;
+        // Levels with fewer slots are updated on the calling thread.
+        static constexpr u32 min_slots_per_task = 1024;
+
+        // Storage written by the workers during the update.
+        template <typename T>
+        using cache_aligned_vector = std::vector<T, memory::aligned_allocator<T>>;
+
+        // Storage, indexed by slot and ordered by depth after update().
+        std::vector<float4x4> m_local_transforms;
+        cache_aligned_vector<float4x4> m_world_transforms;
+        std::vector<u32> m_parent_slots;
+        cache_aligned_vector<u8> m_dirty;
+        std::vector<handle> m_handles;
+
+        // First slot of every depth level, the last entry is the number of slots.
+        std::vector<u32> m_level_offsets;
+
+        // Inverse world transforms are only computed on request.
+        std::vector<float4x4> m_inverse_world_transforms;
+        cache_aligned_vector<u8> m_inverse_world_valid;
+
+        // Indirection from handles to slots.
+        std::vector<u32> m_slot_of_handle;
+        std::vector<handle> m_free_handles;
+
+        // Children of every node as a doubly linked list of siblings, indexed by handle so sorting leaves them intact.
+        std::vector<handle> m_first_child;
+        std::vector<handle> m_next_sibling;
+        std::vector<handle> m_previous_sibling;
+
+        u32 m_num_dirty;
+        bool m_order_dirty;
+    };
+}
\ No newline at end of file
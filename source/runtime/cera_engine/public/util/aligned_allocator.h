@@ -0,0 +1,63 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <new>
+
+namespace cera
+{
+    namespace memory
+    {
+        /**
+         * Size of a cache line on the platforms we target.
+         * Data written by different threads should not share a cache line.
+         */
+        constexpr size_t cache_line_size = 64;
+
+        /**
+         * Allocator for standard containers that aligns the start of every allocation.
+         * Used to line up container storage with cache lines.
+         */
+        template <typename T, size_t Alignment = cache_line_size>
+        class aligned_allocator
+        {
+        public:
+            using value_type = T;
+
+            template <typename U>
+            struct rebind
+            {
+                using other = aligned_allocator<U, Alignment>;
+            };
+
+            aligned_allocator() noexcept = default;
+
+            template <typename U>
+            aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept
+            {}
+
+            T* allocate(size_t count)
+            {
+                return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+            }
+
+            void deallocate(T* pointer, size_t /*count*/) noexcept
+            {
+                ::operator delete(pointer, std::align_val_t(Alignment));
+            }
+
+            template <typename U>
+            bool operator==(const aligned_allocator<U, Alignment>&) const noexcept
+            {
+                return true;
+            }
+
+            template <typename U>
+            bool operator!=(const aligned_allocator<U, Alignment>&) const noexcept
+            {
+                return false;
+            }
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <filesystem>
+
+namespace cera
+{
+    /**
+     * Read only view of a file mapped into the address space.
+     *
+     * Pages are loaded by the OS when they are first touched, nothing is copied into process memory.
+     * Parsers read the file in place and only pay for the pages they visit.
+     */
+    class file_mapping
+    {
+    public:
+        file_mapping();
+        ~file_mapping();
+
+        file_mapping(const file_mapping&) = delete;
+        file_mapping& operator=(const file_mapping&) = delete;
+
+        file_mapping(file_mapping&& other) noexcept;
+        file_mapping& operator=(file_mapping&& other) noexcept;
+
+        /**
+         * Map a whole file, a mapping that is already open is closed first.
+         * Empty files open successfully and have no data.
+         *
+         * @returns false when the file cannot be opened or mapped.
+         */
+        bool open(const std::filesystem::path& path);
+        void close();
+
+        bool is_open() const;
+
+        const u8* get_data() const;
+        size_t    get_size() const;
+
+    private:
+        const u8* m_data;
+        size_t m_size;
+        bool m_open;
+
+#if defined(CERA_WINDOWS)
+        void* m_file;
+        void* m_mapping;
+#endif
+    };
+}
\ No newline at end of file
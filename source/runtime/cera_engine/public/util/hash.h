@@ -0,0 +1,72 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+namespace cera
+{
+    namespace hash
+    {
+        /**
+         * 64-bit FNV-1a constants.
+         * FNV-1a is used because its output only depends on the bytes that are hashed,
+         * which makes it stable across runs, compilers and platforms. This is required
+         * for any hash that is persisted to disk.
+         */
+        constexpr u64 fnv1a_offset_basis = 0xcbf29ce484222325ull;
+        constexpr u64 fnv1a_prime = 0x100000001b3ull;
+
+        /**
+         * Hash a range of bytes.
+         *
+         * @param data Pointer to the bytes to hash.
+         * @param size The number of bytes to hash.
+         * @param seed The hash to continue from, this allows hashing of non-contiguous data.
+         */
+        inline u64 fnv1a(const void* data, size_t size, u64 seed = fnv1a_offset_basis)
+        {
+            const u8* bytes = static_cast<const u8*>(data);
+
+            u64 hash = seed;
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash ^= bytes[i];
+                hash *= fnv1a_prime;
+            }
+
+            return hash;
+        }
+
+        /**
+         * Hash a string, the terminating null character is not included.
+         */
+        inline u64 fnv1a(std::string_view str, u64 seed = fnv1a_offset_basis)
+        {
+            return fnv1a(str.data(), str.size(), seed);
+        }
+
+        /**
+         * Hash a trivially copyable value.
+         * NOTE: Padding bytes are hashed as well, only use this for types without padding
+         * or for values that were zero initialized.
+         */
+        template<typename T>
+        inline u64 fnv1a_value(const T& value, u64 seed = fnv1a_offset_basis)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be hashed by value");
+            return fnv1a(&value, sizeof(T), seed);
+        }
+
+        /**
+         * Combine two hashes into one.
+         * The order of the arguments matters, combine(a, b) != combine(b, a).
+         */
+        inline u64 combine(u64 seed, u64 value)
+        {
+            return fnv1a_value(value, seed);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace cera
+{
+    namespace threading
+    {
+        /**
+         * A fixed set of worker threads that execute submitted tasks in FIFO order.
+         */
+        class thread_pool
+        {
+        public:
+            using task = std::function<void()>;
+
+            /**
+             * @param numThreads The number of worker threads, 0 uses the number of hardware threads minus one (the calling thread).
+             * @param name Name given to the worker threads, visible in the debugger.
+             */
+            explicit thread_pool(u32 numThreads = 0, const char* name = "cera worker");
+            ~thread_pool();
+
+            thread_pool(const thread_pool&) = delete;
+            thread_pool& operator=(const thread_pool&) = delete;
+
+            /**
+             * Queue a task for execution on one of the worker threads.
+             */
+            void submit(task task);
+
+            /**
+             * Block until all submitted tasks have finished executing.
+             */
+            void wait_idle();
+
+            /**
+             * Retrieve the number of worker threads.
+             */
+            u32 get_num_threads() const;
+
+        private:
+            void worker_main();
+
+        private:
+            std::vector<std::thread> m_threads;
+
+            std::queue<task> m_tasks;
+            u32 m_num_active_tasks;
+            bool m_stop;
+
+            std::mutex m_mutex;
+            std::condition_variable m_task_available_cv;
+            std::condition_variable m_idle_cv;
+        };
+
+        /**
+         * Tasks submitted to a thread pool that can be waited for as a group.
+         * Unlike thread_pool::wait_idle, waiting does not depend on unrelated work in the pool.
+         */
+        class task_group
+        {
+        public:
+            explicit task_group(thread_pool& threadPool);
+            /**
+             * Waits for the tasks that are still running.
+             */
+            ~task_group();
+
+            task_group(const task_group&) = delete;
+            task_group& operator=(const task_group&) = delete;
+
+            void submit(thread_pool::task task);
+
+            /**
+             * Block until all tasks submitted to this group have finished executing.
+             */
+            void wait();
+
+        private:
+            thread_pool& m_thread_pool;
+            u32 m_num_pending_tasks;
+
+            std::mutex m_mutex;
+            std::condition_variable m_done_cv;
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+namespace cera
+{
+    /**
+     * Lock free histogram of durations.
+     * Used to measure hitches: every sample is sorted in a bucket by its duration
+     * so spikes are visible even when the average is low.
+     */
+    class timing_histogram
+    {
+    public:
+        static constexpr u32 num_buckets = 8;
+
+        /**
+         * Upper bound (exclusive) of each bucket in microseconds, the last bucket is unbounded.
+         */
+        static constexpr std::array<u64, num_buckets - 1> bucket_limits_us = { 100, 500, 1000, 2000, 4000, 8000, 16000 };
+
+        timing_histogram()
+        {
+            reset();
+        }
+
+        void add_sample(std::chrono::microseconds duration)
+        {
+            u64 us = static_cast<u64>(duration.count());
+
+            u32 bucket = 0;
+            while (bucket < bucket_limits_us.size() && us >= bucket_limits_us[bucket])
+            {
+                ++bucket;
+            }
+
+            m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            m_total_us.fetch_add(us, std::memory_order_relaxed);
+
+            u64 max_us = m_max_us.load(std::memory_order_relaxed);
+            while (us > max_us && !m_max_us.compare_exchange_weak(max_us, us, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        u64 get_bucket_count(u32 bucket) const
+        {
+            return m_buckets[bucket].load(std::memory_order_relaxed);
+        }
+
+        u64 get_num_samples() const
+        {
+            u64 num_samples = 0;
+            for (const auto& bucket : m_buckets)
+            {
+                num_samples += bucket.load(std::memory_order_relaxed);
+            }
+            return num_samples;
+        }
+
+        u64 get_total_us() const
+        {
+            return m_total_us.load(std::memory_order_relaxed);
+        }
+
+        u64 get_max_us() const
+        {
+            return m_max_us.load(std::memory_order_relaxed);
+        }
+
+        void reset()
+        {
+            for (auto& bucket : m_buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+
+            m_total_us.store(0, std::memory_order_relaxed);
+            m_max_us.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        std::array<std::atomic<u64>, num_buckets> m_buckets;
+        std::atomic<u64> m_total_us;
+        std::atomic<u64> m_max_us;
+    };
+
+    /**
+     * Adds the lifetime of the scope to a histogram.
+     */
+    class scoped_timing_sample
+    {
+    public:
+        explicit scoped_timing_sample(timing_histogram& histogram)
+            : m_histogram(histogram)
+            , m_start(std::chrono::steady_clock::now())
+        {}
+
+        ~scoped_timing_sample()
+        {
+            m_histogram.add_sample(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start));
+        }
+
+    private:
+        timing_histogram& m_histogram;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+
+namespace cera
+{
+    /**
+     * Maps 16 bit normalized positions back to object space: position = encoded * scale + offset.
+     * The identity quantization leaves float positions untouched.
+     */
+    struct position_quantization
+    {
+        float scale[3] = { 1.0f, 1.0f, 1.0f };
+        float offset[3] = { 0.0f, 0.0f, 0.0f };
+    };
+
+    /**
+     * Packs float vertex attributes into compact formats that the input assembler expands again.
+     *
+     * All functions read and write strided data, so interleaved vertices are encoded as is. Four vertices are
+     * encoded per SSE iteration. Platforms without SSE fall back to a scalar loop with identical results.
+     *
+     * Error bounds of the formats:
+     * - UNORM16 positions are within half a step, 1/131070 of the extent of the mesh on every axis, plus float rounding.
+     * - Octahedral SNORM16 directions are within 0.04 degrees of the input direction.
+     * - RGBA8 colors are within half a step, 1/510 per channel.
+     */
+    namespace vertex_encoder
+    {
+        /**
+         * Quantization that covers the bounds of all positions, every axis is scaled separately.
+         *
+         * @param positions The first position, 3 floats.
+         */
+        position_quantization compute_position_quantization(const void* positions, size_t numVertices, size_t inputStride);
+
+        /**
+         * Encode positions as 4 UNORM16 values (DXGI_FORMAT_R16G16B16A16_UNORM).
+         * The fourth value is 0, formats can store a sign in it.
+         */
+        void encode_positions_unorm16(const void* positions, size_t numVertices, size_t inputStride, const position_quantization& quantization, void* output, size_t outputStride);
+
+        /**
+         * Encode unit directions as 2 SNORM16 values (DXGI_FORMAT_R16G16_SNORM) of their octahedral projection.
+         * Directions are normalized while they are encoded, zero vectors encode as +Z.
+         */
+        void encode_directions_octahedral(const void* directions, size_t numVertices, size_t inputStride, void* output, size_t outputStride);
+
+        /**
+         * Encode colors with 3 or 4 float channels in [0, 1] as RGBA8 (DXGI_FORMAT_R8G8B8A8_UNORM).
+         * Colors with 3 channels are opaque.
+         */
+        void encode_colors_rgba8(const void* colors, size_t numVertices, size_t inputStride, u32 numChannels, void* output, size_t outputStride);
+
+        /**
+         * Decode a position as the vertex shader does.
+         */
+        void decode_position_unorm16(const u16* encoded, const position_quantization& quantization, float* position);
+
+        /**
+         * Decode an octahedral direction as the vertex shader does, the result has unit length.
+         */
+        void decode_direction_octahedral(const s16* encoded, float* direction);
+    }
+}
\ No newline at end of file
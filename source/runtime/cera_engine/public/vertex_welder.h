@@ -0,0 +1,103 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cera
+{
+    /**
+     * A float vertex attribute, read with a stride so interleaved and separate attribute arrays can be passed as is.
+     */
+    struct welder_attribute
+    {
+        // First component of the first vertex, the components are moved in place when vertices are compacted.
+        void* data = nullptr;
+        size_t stride = 0;
+        u32 num_components = 0;
+
+        // Largest difference per component of vertices that are merged, 0 only merges equal values.
+        float epsilon = 0.0f;
+    };
+
+    /**
+     * Vertex and index data of a triangle list to weld.
+     */
+    struct welder_input
+    {
+        size_t num_vertices = 0;
+
+        // The first attribute is the position (3 floats), vertices are hashed by it.
+        // Vertices are only merged when all attributes match, vertices that are split on hard edges or seams by
+        // their normals, colors or texture coordinates stay apart.
+        std::vector<welder_attribute> attributes;
+
+        u32* indices = nullptr;
+        size_t num_indices = 0;
+    };
+
+    struct welder_result
+    {
+        size_t num_vertices = 0;
+        size_t num_indices = 0;
+    };
+
+    /**
+     * Merges duplicate vertices and rebuilds the index buffer.
+     *
+     * Positions are snapped to a grid of cells at least 4 epsilons wide and hashed by their cell, the cells and
+     * hashes of four vertices are computed per SSE iteration. A vertex is compared to the vertices of its own
+     * cell and of the neighbour cells it is closer to than epsilon, and merged into the first one whose
+     * attributes are all within their epsilons. Merging is greedy in vertex order, a vertex is always merged
+     * into a vertex that was kept, so chains of close vertices do not collapse into one.
+     *
+     * A welder keeps its memory between meshes, reuse it to weld many meshes on one thread.
+     */
+    class vertex_welder
+    {
+    public:
+        /**
+         * Weld the vertices of a mesh in place.
+         * Kept vertices are moved to the front in their original order, indices are remapped and triangles
+         * that collapse to a line or a point are removed.
+         *
+         * @returns false when the input is invalid, the mesh is not changed.
+         */
+        bool weld(const welder_input& input, welder_result& result);
+
+        /**
+         * New vertex of every input vertex of the last weld.
+         */
+        const std::vector<u32>& get_remap() const { return m_remap; }
+
+    private:
+        bool validate(const welder_input& input) const;
+
+        // Grid cells and hashes of all positions.
+        void compute_cells(const welder_attribute& position, size_t numVertices);
+
+        bool match(const welder_input& input, u32 vertex, u32 other) const;
+
+        // Search the chain of a cell hash for a kept vertex that matches, insertSlot receives the end of the chain.
+        u32 find(const welder_input& input, u32 vertex, u32 hash, u32* insertSlot) const;
+
+    private:
+        float m_cell_size = 0.0f;
+        float m_inverse_cell_size = 0.0f;
+        float m_origin[3] = {};
+        // Fraction of a cell within epsilon of its border.
+        float m_border = 0.0f;
+        u32 m_table_shift = 0;
+
+        // 3 per vertex.
+        std::vector<s32> m_cells;
+        std::vector<u32> m_hashes;
+        // Per axis, 1 when the vertex is near the lower neighbour cell, 2 when near the upper one.
+        std::vector<u8> m_neighbours;
+
+        // Hash in the upper and kept vertex in the lower 32 bits.
+        std::vector<u64> m_table;
+        std::vector<u32> m_remap;
+    };
+}
\ No newline at end of file
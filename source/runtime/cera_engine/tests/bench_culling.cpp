@@ -0,0 +1,211 @@
+#include "benchmark.h"
+#include "test_geometry.h"
+
+#include "aabb_tree.h"
+#include "frustum_culler.h"
+#include "lod_selector.h"
+#include "occlusion_culler.h"
+#include "util/threading/thread_pool.h"
+
+#include <random>
+
+using namespace cera;
+
+namespace
+{
+    bounding_box make_box(const float3& center, float halfSize)
+    {
+        return { { center.x - halfSize, center.y - halfSize, center.z - halfSize }, { center.x + halfSize, center.y + halfSize, center.z + halfSize } };
+    }
+
+    void bench_frustum_culler(u32 count, int numRuns)
+    {
+        frustum frustum = frustum::from_view_projection(test::make_perspective(1.0f, 16.0f / 9.0f, 0.1f, 500.0f));
+
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+
+        frustum_culler culler;
+        culler.reserve(count);
+        for (u32 i = 0; i < count; ++i)
+        {
+            culler.add(make_box({ position(rng), position(rng), position(rng) }, 1.0f));
+        }
+
+        std::vector<u8> visibility;
+        u32 num_visible = 0;
+        double ms = benchmark::measure(numRuns, [&]() { num_visible = culler.cull(frustum, visibility); });
+
+        printf("frustum culler, %u boxes, %u visible\n", count, num_visible);
+        benchmark::report("  cull", ms, count, "boxes");
+    }
+
+    void bench_aabb_tree(u32 count, int numRuns)
+    {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> small_step(-0.05f, 0.05f);
+
+        std::vector<bounding_box> boxes;
+        for (u32 i = 0; i < count; ++i)
+        {
+            boxes.push_back(make_box({ position(rng), position(rng), position(rng) }, 1.0f));
+        }
+
+        aabb_tree tree(0.1f);
+        std::vector<aabb_tree::proxy> proxies;
+        double insert_ms = benchmark::measure(1, [&]()
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                proxies.push_back(tree.insert(boxes[i], i));
+            }
+        });
+
+        printf("aabb tree, %u proxies, height %d, area ratio %.1f\n", count, tree.get_height(), tree.get_area_ratio());
+        benchmark::report("  insert", insert_ms, count, "proxies");
+
+        double move_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                float step = small_step(rng);
+                boxes[i].min.x += step;
+                boxes[i].max.x += step;
+                tree.move_deferred(proxies[i], boxes[i]);
+            }
+            tree.refit();
+        });
+        benchmark::report("  move_deferred all + refit", move_ms, count, "proxies");
+
+        std::vector<aabb_tree::proxy> results;
+        double box_query_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (u32 q = 0; q < 1000; ++q)
+            {
+                results.clear();
+                tree.query(make_box({ position(rng), position(rng), position(rng) }, 20.0f), results);
+            }
+        });
+        benchmark::report("  1000 box queries", box_query_ms, 1000, "queries");
+
+        frustum frustum = frustum::from_view_projection(test::make_perspective(1.0f, 16.0f / 9.0f, 0.1f, 500.0f));
+        double frustum_query_ms = benchmark::measure(numRuns, [&]()
+        {
+            results.clear();
+            tree.query(frustum, results);
+        });
+        benchmark::report("  frustum query", frustum_query_ms);
+    }
+
+    void bench_occlusion_culler(u32 numOccludees, int numRuns)
+    {
+        occluder_geometry cube;
+        for (u32 i = 0; i < 8; ++i)
+        {
+            cube.positions.push_back({ (i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f });
+        }
+        const u32 faces[6][4] = { { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 } };
+        for (const auto& face : faces)
+        {
+            for (u32 index : { face[0], face[1], face[2], face[0], face[2], face[3] })
+            {
+                cube.indices.push_back(index);
+            }
+        }
+
+        float4x4 view_projection = test::make_perspective(1.2f, 2.0f, 0.1f, 500.0f);
+
+        std::mt19937 rng(5);
+        std::uniform_real_distribution<float> x(-40.0f, 40.0f);
+        std::uniform_real_distribution<float> y(-15.0f, 15.0f);
+        std::uniform_real_distribution<float> z(5.0f, 120.0f);
+        std::uniform_real_distribution<float> size(0.3f, 3.0f);
+
+        std::vector<float4x4> occluders;
+        for (u32 i = 0; i < 256; ++i)
+        {
+            occluders.push_back(test::make_scale_translation({ size(rng) * 4.0f, size(rng) * 4.0f, 0.5f }, { x(rng), y(rng), z(rng) * 0.5f }));
+        }
+
+        occlusion_culler culler(256, 128);
+        threading::thread_pool pool(3);
+
+        printf("occlusion culler, %zu occluders\n", occluders.size());
+        for (threading::thread_pool* thread_pool : { static_cast<threading::thread_pool*>(nullptr), &pool })
+        {
+            double ms = benchmark::measure(numRuns, [&]()
+            {
+                culler.begin_frame(view_projection);
+                for (const float4x4& world : occluders)
+                {
+                    culler.add_occluder(cube, world);
+                }
+                culler.rasterize(thread_pool);
+            });
+            benchmark::report(thread_pool ? "  rasterize, 4 threads" : "  rasterize, 1 thread", ms, culler.get_num_triangles(), "triangles");
+        }
+
+        std::vector<bounding_box> occludees;
+        for (u32 i = 0; i < numOccludees; ++i)
+        {
+            occludees.push_back(make_box({ x(rng), y(rng), z(rng) }, size(rng) * 0.3f));
+        }
+
+        u32 num_visible = 0;
+        double test_ms = benchmark::measure(numRuns, [&]()
+        {
+            num_visible = 0;
+            for (const bounding_box& box : occludees)
+            {
+                num_visible += culler.is_visible(box) ? 1 : 0;
+            }
+        });
+        printf("  %u of %u occludees visible\n", num_visible, numOccludees);
+        benchmark::report("  test occludees", test_ms, numOccludees, "boxes");
+    }
+
+    void bench_lod_selector(u32 count, int numRuns)
+    {
+        const float lod_errors[4] = { 0.0f, 0.01f, 0.04f, 0.16f };
+
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+
+        std::vector<bounding_sphere> spheres;
+        for (u32 i = 0; i < count; ++i)
+        {
+            spheres.push_back({ { position(rng), 0.0f, position(rng) }, 1.0f });
+        }
+
+        float projection_scale = lod_selector::get_projection_scale(test::make_perspective(1.0472f, 16.0f / 9.0f, 0.1f, 1000.0f), 1080.0f);
+
+        lod_selector selector;
+        std::vector<u8> lods(count, 0);
+        double ms = benchmark::measure(numRuns, [&]()
+        {
+            selector.clear();
+            for (u32 i = 0; i < count; ++i)
+            {
+                selector.add(spheres[i], 1.0f, lod_errors, 4, lods[i]);
+            }
+            selector.select({ 0.0f, 2.0f, 0.0f }, projection_scale, 1.0f, 0.25f, lods);
+        });
+
+        printf("lod selector, %u objects\n", count);
+        benchmark::report("  add + select", ms, count, "objects");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const bool quick = benchmark::is_quick(argc, argv);
+    const int num_runs = quick ? 1 : 10;
+
+    bench_frustum_culler(quick ? 10000 : 1000000, num_runs);
+    bench_aabb_tree(quick ? 5000 : 200000, num_runs);
+    bench_occlusion_culler(quick ? 1000 : 100000, num_runs);
+    bench_lod_selector(quick ? 10000 : 100000, num_runs);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "benchmark.h"
+
+#include "ecs/components.h"
+#include "ecs/registry.h"
+#include "transform_hierarchy.h"
+#include "util/threading/thread_pool.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace cera;
+
+namespace
+{
+    // Same layout as scene_node: a heap object per node that owns its children and holds a handle into a shared
+    // transform hierarchy. scene_node needs the graphics API, the benchmark uses this copy.
+    class tree_node
+    {
+    public:
+        tree_node(const std::shared_ptr<transform_hierarchy>& transformHierarchy, const float4x4& localTransform)
+            : m_name("scene_node")
+            , m_transform_hierarchy(transformHierarchy)
+            , m_transform(transformHierarchy->create(localTransform))
+        {}
+
+        ~tree_node()
+        {
+            m_transform_hierarchy->destroy(m_transform);
+        }
+
+        void add_child(const std::shared_ptr<tree_node>& child)
+        {
+            m_transform_hierarchy->set_parent(child->m_transform, m_transform);
+            m_children.push_back(child);
+            m_children_by_name.emplace(child->m_name, child);
+        }
+
+        void set_local_transform(const float4x4& localTransform)
+        {
+            m_transform_hierarchy->set_local_transform(m_transform, localTransform);
+        }
+
+        // Depth first like the traversal of the scene graph before the render proxies.
+        template <typename Function>
+        void for_each_node(Function& function) const
+        {
+            function(m_transform_hierarchy->get_world_transform(m_transform));
+            for (auto& child : m_children)
+            {
+                child->for_each_node(function);
+            }
+        }
+
+    private:
+        std::string m_name;
+
+        std::shared_ptr<transform_hierarchy> m_transform_hierarchy;
+        transform_hierarchy::handle m_transform;
+
+        std::vector<std::shared_ptr<tree_node>> m_children;
+        std::multimap<std::string, std::shared_ptr<tree_node>> m_children_by_name;
+    };
+
+    float4x4 make_translation(float x, float y, float z)
+    {
+        float4x4 m = float4x4::identity();
+        m.m[3][0] = x;
+        m.m[3][1] = y;
+        m.m[3][2] = z;
+        return m;
+    }
+
+    void bench_tree(u32 count, int numRuns)
+    {
+        auto hierarchy = std::make_shared<transform_hierarchy>();
+
+        std::mt19937 rng(1);
+        std::vector<std::shared_ptr<tree_node>> nodes;
+        std::vector<std::shared_ptr<tree_node>> roots;
+        for (u32 i = 0; i < count; ++i)
+        {
+            nodes.push_back(std::make_shared<tree_node>(hierarchy, make_translation((i % 7) * 0.1f, 0.0f, 0.0f)));
+            if (i < 16)
+            {
+                roots.push_back(nodes.back());
+            }
+            else
+            {
+                nodes[rng() % i]->add_child(nodes.back());
+            }
+        }
+        hierarchy->update();
+
+        float sum = 0.0f;
+        auto read = [&sum](const float4x4& world) { sum += world.m[3][0]; };
+        double iterate_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (auto& root : roots)
+            {
+                root->for_each_node(read);
+            }
+        });
+
+        double update_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                nodes[i]->set_local_transform(make_translation((i % 7) * 0.1f, 1.0f, 0.0f));
+            }
+            hierarchy->update();
+        });
+
+        printf("%u scene nodes\n", count);
+        benchmark::report("  iterate world transforms", iterate_ms, count, "nodes");
+        benchmark::report("  set local transforms + update", update_ms, count, "nodes");
+
+        if (sum == 0.0f)
+        {
+            printf("  unexpected world transforms\n");
+        }
+    }
+
+    void bench_registry(u32 count, int numRuns)
+    {
+        ecs::registry registry;
+
+        bounding_box unit = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+        for (u32 i = 0; i < count; ++i)
+        {
+            registry.create(ecs::world_transform{ make_translation((i % 7) * 0.1f, 0.0f, 0.0f) }, ecs::local_bounds{ unit }, ecs::world_bounds());
+        }
+
+        float sum = 0.0f;
+        double iterate_ms = benchmark::measure(numRuns, [&]()
+        {
+            registry.for_each<ecs::world_transform>([&sum](const ecs::world_transform& world) { sum += world.matrix.m[3][0]; });
+        });
+
+        double update_ms = benchmark::measure(numRuns, [&]()
+        {
+            u32 i = 0;
+            registry.for_each<ecs::world_transform>([&i](ecs::world_transform& world)
+            {
+                world.matrix = make_translation((i++ % 7) * 0.1f, 1.0f, 0.0f);
+            });
+        });
+
+        double bounds_ms = benchmark::measure(numRuns, [&]() { ecs::update_world_bounds(registry); });
+
+        printf("%u entities\n", count);
+        benchmark::report("  iterate world transforms", iterate_ms, count, "entities");
+        benchmark::report("  set world transforms", update_ms, count, "entities");
+        benchmark::report("  update world bounds", bounds_ms, count, "entities");
+
+        if (sum == 0.0f)
+        {
+            printf("  unexpected world transforms\n");
+        }
+
+        u32 max_threads = std::max(2u, std::thread::hardware_concurrency());
+        for (u32 num_threads = 2; num_threads <= max_threads; num_threads *= 2)
+        {
+            threading::thread_pool pool(num_threads - 1);
+
+            double parallel_bounds_ms = benchmark::measure(numRuns, [&]() { ecs::update_world_bounds(registry, &pool); });
+
+            char name[64];
+            snprintf(name, sizeof(name), "  update world bounds, %u threads", num_threads);
+            benchmark::report(name, parallel_bounds_ms, count, "entities");
+        }
+    }
+}
+
+// Iteration and update throughput of the entity registry against a scene graph of the same size.
+int main(int argc, char** argv)
+{
+    const bool quick = benchmark::is_quick(argc, argv);
+    const int num_runs = quick ? 1 : 10;
+
+    for (u32 count : { 10000u, quick ? 20000u : 200000u })
+    {
+        bench_tree(count, num_runs);
+        bench_registry(count, num_runs);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "benchmark.h"
+
+#include "render/render_queue.h"
+#include "transform_hierarchy.h"
+
+#include <random>
+
+using namespace cera;
+
+// The CPU side of scene::enable_instancing: submit and sort the packets of a frame, group them into instance
+// batches and gather the world transforms of the instances in sorted order.
+int main(int argc, char** argv)
+{
+    const bool quick = benchmark::is_quick(argc, argv);
+    const int num_runs = quick ? 1 : 10;
+    const u32 num_proxies = quick ? 5000u : 50000u;
+
+    for (u32 num_meshes : { 1u, 10u, 100u, 1000u, 10000u })
+    {
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<u32> mesh(0, num_meshes - 1);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+
+        // Proxies share meshes, the scene puts the mesh into the material field of the key.
+        std::vector<u32> proxy_meshes;
+        std::vector<float> proxy_depths;
+        std::vector<float4x4> world_transforms;
+        for (u32 i = 0; i < num_proxies; ++i)
+        {
+            proxy_meshes.push_back(mesh(rng));
+            proxy_depths.push_back(position(rng));
+
+            float4x4& world = world_transforms.emplace_back(float4x4::identity());
+            world.m[3][0] = position(rng);
+            world.m[3][2] = proxy_depths.back();
+        }
+
+        render_queue queue;
+        std::vector<instance_batch> batches;
+        std::vector<float4x4> instance_transforms;
+        double frame_ms = benchmark::measure(num_runs, [&]()
+        {
+            queue.clear();
+            for (u32 i = 0; i < num_proxies; ++i)
+            {
+                draw_packet packet;
+                packet.transform_index = i;
+                queue.submit(sort_key::make(0, 0, 0, proxy_meshes[i], proxy_depths[i]), packet);
+            }
+            queue.sort();
+
+            queue.build_instance_batches(batches);
+
+            instance_transforms.clear();
+            for (size_t i = 0; i < queue.size(); ++i)
+            {
+                instance_transforms.push_back(world_transforms[queue.get_packet(i).transform_index]);
+            }
+        });
+
+        // Without instancing every proxy is a draw, with instancing every batch is one.
+        printf("%u proxies of %u meshes, draws %u -> %zu instance batches\n", num_proxies, num_meshes, num_proxies, batches.size());
+        benchmark::report("  submit, sort, batch and gather per frame", frame_ms, num_proxies, "proxies");
+    }
+
+    return 0;
+}
\ No newline at end of file
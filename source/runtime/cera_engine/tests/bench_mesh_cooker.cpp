@@ -0,0 +1,155 @@
+#include "benchmark.h"
+#include "test_geometry.h"
+
+#include "mesh_cooker.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet_builder.h"
+#include "vertex_encoder.h"
+#include "vertex_welder.h"
+
+#include <cstddef>
+
+using namespace cera;
+using test::test_vertex;
+
+namespace
+{
+    void unweld(std::vector<test_vertex>& vertices, std::vector<u32>& indices)
+    {
+        std::vector<test_vertex> split;
+        for (u32& index : indices)
+        {
+            split.push_back(vertices[index]);
+            index = static_cast<u32>(split.size() - 1);
+        }
+        vertices.swap(split);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const bool quick = benchmark::is_quick(argc, argv);
+    const u32 tessellation = quick ? 48 : 256;
+    const int num_runs = quick ? 1 : 5;
+
+    std::vector<test_vertex> source_vertices;
+    std::vector<u32> source_indices;
+    test::make_sphere(tessellation, source_vertices, source_indices);
+    unweld(source_vertices, source_indices);
+
+    size_t num_triangles = source_indices.size() / 3;
+    printf("sphere, %zu triangles, %zu unwelded vertices\n", num_triangles, source_vertices.size());
+
+    std::vector<test_vertex> vertices;
+    std::vector<u32> indices;
+    welder_result welded;
+
+    // Every stage works on the output of the previous one, the copy is part of the measurement.
+    double weld_ms = benchmark::measure(num_runs, [&]()
+    {
+        vertices = source_vertices;
+        indices = source_indices;
+
+        welder_input input;
+        input.num_vertices = vertices.size();
+        input.attributes.push_back({ &vertices[0].position, sizeof(test_vertex), 3, 1e-6f });
+        input.attributes.push_back({ &vertices[0].color, sizeof(test_vertex), 3, 0.0f });
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+
+        vertex_welder().weld(input, welded);
+    });
+    vertices.resize(welded.num_vertices);
+    indices.resize(welded.num_indices);
+    benchmark::report("  weld", weld_ms, double(source_vertices.size()), "vertices");
+
+    std::vector<test_vertex> welded_vertices = vertices;
+    std::vector<u32> welded_indices = indices;
+
+    mesh_optimizer_statistics before;
+    mesh_optimizer_statistics after;
+    double optimize_ms = benchmark::measure(num_runs, [&]()
+    {
+        vertices = welded_vertices;
+        indices = welded_indices;
+
+        optimizer_input input;
+        input.vertices = vertices.data();
+        input.num_vertices = vertices.size();
+        input.vertex_stride = sizeof(test_vertex);
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+
+        mesh_optimizer().optimize(input, &before, &after);
+    });
+    printf("  acmr %.3f -> %.3f, overfetch %.2f -> %.2f\n", before.acmr, after.acmr, before.overfetch, after.overfetch);
+    benchmark::report("  optimize", optimize_ms, double(num_triangles), "triangles");
+
+    std::vector<simplified_lod> lods;
+    double simplify_ms = benchmark::measure(num_runs, [&]()
+    {
+        simplifier_input input;
+        input.vertices = vertices.data();
+        input.num_vertices = vertices.size();
+        input.vertex_stride = sizeof(test_vertex);
+        input.position_offset = offsetof(test_vertex, position);
+        input.attribute_offset = offsetof(test_vertex, color);
+        input.num_attributes = 3;
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+
+        mesh_simplifier().generate_lods(input, { 0.5f, 0.25f, 0.125f }, lods);
+    });
+    benchmark::report("  simplify to 3 levels", simplify_ms, double(num_triangles), "triangles");
+
+    std::vector<meshlet> meshlets;
+    double meshlet_ms = benchmark::measure(num_runs, [&]()
+    {
+        meshlet_builder_input input;
+        input.vertices = vertices.data();
+        input.num_vertices = vertices.size();
+        input.vertex_stride = sizeof(test_vertex);
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+
+        meshlet_builder().build(input, meshlets);
+    });
+    printf("  %zu meshlets\n", meshlets.size());
+    benchmark::report("  build meshlets", meshlet_ms, double(num_triangles), "triangles");
+
+    struct packed_vertex
+    {
+        u16 position[4];
+        u32 color;
+    };
+    std::vector<packed_vertex> packed(vertices.size());
+    double encode_ms = benchmark::measure(num_runs, [&]()
+    {
+        position_quantization quantization = vertex_encoder::compute_position_quantization(vertices[0].position, vertices.size(), sizeof(test_vertex));
+        vertex_encoder::encode_positions_unorm16(vertices[0].position, vertices.size(), sizeof(test_vertex), quantization, packed[0].position, sizeof(packed_vertex));
+        vertex_encoder::encode_colors_rgba8(vertices[0].color, vertices.size(), sizeof(test_vertex), 3, &packed[0].color, sizeof(packed_vertex));
+    });
+    benchmark::report("  encode positions and colors", encode_ms, double(vertices.size()), "vertices");
+
+    cooked_mesh cooked;
+    double cook_ms = benchmark::measure(num_runs, [&]()
+    {
+        vertices = source_vertices;
+        indices = source_indices;
+
+        cooker_input input;
+        input.vertices = vertices.data();
+        input.num_vertices = vertices.size();
+        input.vertex_stride = sizeof(test_vertex);
+        input.position_offset = offsetof(test_vertex, position);
+        input.color_offset = offsetof(test_vertex, color);
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+
+        mesh_cooker::cook_mesh(input, vertex_format::packed_pos_color, false, cooked);
+    });
+    benchmark::report("  cook_mesh, all stages", cook_ms, double(num_triangles), "triangles");
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "benchmark.h"
+#include "test_geometry.h"
+
+#include "mesh_cache_file.h"
+#include "mesh_cooker.h"
+#include "model_importer.h"
+#include "util/file_mapping.h"
+#include "util/threading/thread_pool.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace cera;
+
+namespace
+{
+    // Height field split into groups, written the way exporters write OBJ files.
+    std::string make_obj(u32 size, u32 numGroups)
+    {
+        std::vector<test::test_vertex> vertices;
+        std::vector<u32> indices;
+        test::make_grid(size, vertices, indices);
+
+        std::string text;
+        text.reserve(vertices.size() * 40 + indices.size() * 8);
+
+        char line[128];
+        for (const test::test_vertex& v : vertices)
+        {
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvn 0 1 0\n", v.position[0], v.position[1], v.position[2]);
+            text += line;
+        }
+
+        size_t triangles_per_group = indices.size() / 3 / numGroups + 1;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            if ((i / 3) % triangles_per_group == 0)
+            {
+                snprintf(line, sizeof(line), "g part_%zu\n", (i / 3) / triangles_per_group);
+                text += line;
+            }
+            snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u\n", indices[i] + 1, indices[i] + 1, indices[i + 1] + 1, indices[i + 1] + 1, indices[i + 2] + 1, indices[i + 2] + 1);
+            text += line;
+        }
+        return text;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const bool quick = benchmark::is_quick(argc, argv);
+    const u32 size = quick ? 100 : 1000;
+    const int num_runs = quick ? 1 : 5;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "cera_bench_model_importer";
+    std::filesystem::create_directories(directory);
+
+    std::filesystem::path obj_path = directory / "grid.obj";
+    std::filesystem::path cache_path = directory / "grid.mcache";
+
+    std::string text = make_obj(size, 16);
+    {
+        std::ofstream file(obj_path, std::ios::binary);
+        file << text;
+    }
+    printf("obj, %.1f MB, %u triangles\n", text.size() / 1e6, size * size * 2);
+
+    threading::thread_pool pool(3);
+
+    for (threading::thread_pool* thread_pool : { static_cast<threading::thread_pool*>(nullptr), &pool })
+    {
+        imported_model model;
+        double ms = benchmark::measure(num_runs, [&]()
+        {
+            model_importer importer(thread_pool);
+            importer.load(obj_path, model);
+        });
+        benchmark::report(thread_pool ? "  import, 4 threads" : "  import, 1 thread", ms, double(text.size()), "B");
+    }
+
+    // Loading from source means importing and cooking, a cache only maps the file and copies the buffers.
+    std::vector<u8> upload;
+    auto copy_to_upload = [&upload](const cooked_model_view& model)
+    {
+        size_t offset = 0;
+        auto copy = [&](const void* data, size_t bytes)
+        {
+            if (upload.size() < offset + bytes)
+            {
+                upload.resize(offset + bytes);
+            }
+            memcpy(upload.data() + offset, data, bytes);
+            offset += bytes;
+        };
+
+        for (const cooked_mesh_view& mesh : model.meshes)
+        {
+            copy(mesh.vertices, size_t(mesh.num_vertices) * mesh.vertex_stride);
+            copy(mesh.indices, size_t(mesh.num_indices) * mesh.index_size);
+            for (const cooked_lod_view& lod : mesh.lods)
+            {
+                copy(lod.indices, size_t(lod.num_indices) * mesh.index_size);
+            }
+        }
+    };
+
+    double source_ms = benchmark::measure(num_runs, [&]()
+    {
+        model_importer importer(&pool);
+        imported_model model;
+        importer.load(obj_path, model);
+
+        cooked_model cooked;
+        mesh_cooker::cook_model(model, vertex_format::pos_color, &pool, cooked);
+        copy_to_upload(mesh_cooker::get_view(cooked));
+    });
+    benchmark::report("  load from source (import + cook + copy)", source_ms);
+
+    if (!mesh_cache_io::cook(obj_path, cache_path, vertex_format::pos_color, &pool))
+    {
+        printf("failed to write the mesh cache\n");
+        return 1;
+    }
+
+    bool read = true;
+    double cache_ms = benchmark::measure(num_runs, [&]()
+    {
+        file_mapping mapping;
+        mapping.open(cache_path);
+
+        cooked_model_view model;
+        read &= mesh_cache_io::read(mapping.get_data(), mapping.get_size(), model);
+        copy_to_upload(model);
+    });
+    benchmark::report("  load from cache (map + read + copy)", cache_ms);
+
+    return read ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "benchmark.h"
+
+#include "render/render_queue.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace cera;
+
+int main(int argc, char** argv)
+{
+    const bool quick = benchmark::is_quick(argc, argv);
+    const int num_runs = quick ? 1 : 10;
+
+    for (u32 count : { 1000u, 10000u, quick ? 20000u : 1000000u })
+    {
+        std::mt19937_64 rng(1);
+
+        std::vector<u64> keys;
+        for (u32 i = 0; i < count; ++i)
+        {
+            keys.push_back(sort_key::make(rng() % 2, rng() % 4, rng() % 64, rng() % 1024, (rng() % 100000) / 100.0f));
+        }
+
+        render_queue queue;
+        double radix_ms = benchmark::measure(num_runs, [&]()
+        {
+            queue.clear();
+            for (u32 i = 0; i < count; ++i)
+            {
+                draw_packet packet;
+                packet.transform_index = i;
+                queue.submit(keys[i], packet);
+            }
+            queue.sort();
+        });
+
+        std::vector<std::pair<u64, u32>> entries;
+        double stable_sort_ms = benchmark::measure(num_runs, [&]()
+        {
+            entries.clear();
+            for (u32 i = 0; i < count; ++i)
+            {
+                entries.push_back({ keys[i], i });
+            }
+            std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        });
+
+        printf("%u packets, state changes %u -> %u\n", count, queue.get_stats().num_state_changes_unsorted, queue.get_stats().num_state_changes_sorted);
+        benchmark::report("  render_queue submit + radix sort", radix_ms, count, "packets");
+        benchmark::report("  std::stable_sort of the keys", stable_sort_ms, count, "packets");
+    }
+
+    // Keys as the scene makes them, the mesh is the material and the pass, root signature and pipeline state are 0.
+    for (u32 num_meshes : { 16u, 256u, 4096u })
+    {
+        const u32 count = quick ? 20000u : 100000u;
+
+        std::mt19937_64 rng(2);
+
+        render_queue queue;
+        for (u32 i = 0; i < count; ++i)
+        {
+            queue.submit(sort_key::make(0, 0, 0, static_cast<u32>(rng() % num_meshes), (rng() % 100000) / 100.0f), draw_packet());
+        }
+        queue.sort();
+
+        printf("%u packets of %u meshes, state changes %u -> %u\n", count, num_meshes, queue.get_stats().num_state_changes_unsorted, queue.get_stats().num_state_changes_sorted);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "benchmark.h"
+
+#include "scene.h"
+#include "scene_node.h"
+
+#include "render/device.h"
+#include "render/command_queue.h"
+#include "render/command_list.h"
+#include "render/root_signature.h"
+#include "render/mesh_factory.h"
+
+#include <random>
+
+using namespace cera;
+
+namespace
+{
+    // Same root parameters as the demo, indirect commands set the transform index.
+    enum root_parameters
+    {
+        matrices_cb,
+        transform_index,
+        world_transforms,
+        num_root_parameters
+    };
+
+    std::shared_ptr<root_signature> create_root_signature(device& device)
+    {
+        CD3DX12_ROOT_PARAMETER1 root_parameters[root_parameters::num_root_parameters];
+        root_parameters[root_parameters::matrices_cb].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+        root_parameters[root_parameters::transform_index].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        root_parameters[root_parameters::world_transforms].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC root_signature_description;
+        root_signature_description.Init_1_1(root_parameters::num_root_parameters, root_parameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+        return device.create_root_signature(root_signature_description.Desc_1_1);
+    }
+
+    // Fastest recording of the draws of a scene into a new command list. The lists are never executed, the draws do
+    // not need a pipeline state and only the CPU side is measured.
+    double measure_recording(device& device, const std::shared_ptr<root_signature>& rootSignature, scene& scene, int numRuns)
+    {
+        command_queue& queue = device.get_command_queue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+        double best = 0.0;
+        for (int run = 0; run < numRuns; ++run)
+        {
+            std::shared_ptr<command_list> command_list = queue.get_command_list();
+            command_list->set_graphics_root_signature(rootSignature);
+
+            double ms = benchmark::measure(1, [&]() { scene.draw(command_list); });
+            best = run == 0 ? ms : std::min(best, ms);
+        }
+        return best;
+    }
+}
+
+// CPU time of scene::draw per 10000 draws, recorded with one draw call per mesh or with ExecuteIndirect.
+// Needs a graphics device, the benchmark is only built with the engine.
+int main(int argc, char** argv)
+{
+    const bool quick = benchmark::is_quick(argc, argv);
+    const int num_runs = quick ? 1 : 10;
+    const u32 num_draws = 10000;
+
+    std::shared_ptr<device> device = device::create();
+    if (!device)
+    {
+        printf("no graphics device, skipped\n");
+        return 0;
+    }
+
+    std::shared_ptr<root_signature> root_signature = create_root_signature(*device);
+
+    // The meshes share a page of the geometry pool, indirect draws put all of them in one batch.
+    std::vector<std::shared_ptr<mesh>> meshes;
+    {
+        command_queue& copy_queue = device->get_command_queue(D3D12_COMMAND_LIST_TYPE_COPY);
+        std::shared_ptr<command_list> command_list = copy_queue.get_command_list();
+
+        mesh_factory::create_meshes(command_list, { procedural_mesh_desc::cube(), procedural_mesh_desc::sphere(), procedural_mesh_desc::cylinder() }, meshes);
+
+        copy_queue.execute_command_list(command_list);
+        copy_queue.flush();
+    }
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+    auto root = std::make_shared<scene_node>();
+    for (u32 i = 0; i < num_draws; ++i)
+    {
+        auto node = std::make_shared<scene_node>(DirectX::XMMatrixTranslation(position(rng), position(rng), position(rng)));
+        node->add_mesh(meshes[i % meshes.size()]);
+        root->add_child(node);
+    }
+
+    scene draw_scene;
+    draw_scene.set_root_node(root);
+    draw_scene.update();
+
+    double direct_ms = measure_recording(*device, root_signature, draw_scene, num_runs);
+    u32 direct_draw_calls = draw_scene.get_draw_stats().num_draw_calls;
+
+    draw_scene.enable_indirect_draws(root_parameters::transform_index, root_parameters::world_transforms);
+    double indirect_ms = measure_recording(*device, root_signature, draw_scene, num_runs);
+    u32 indirect_draw_calls = draw_scene.get_draw_stats().num_draw_calls;
+
+    printf("%u draws of %zu meshes\n", num_draws, meshes.size());
+    benchmark::report("  record direct draws", direct_ms, num_draws, "draws");
+    benchmark::report("  record indirect draws", indirect_ms, num_draws, "draws");
+    printf("  draw calls %u -> %u\n", direct_draw_calls, indirect_draw_calls);
+
+    return 0;
+}
\ No newline at end of file
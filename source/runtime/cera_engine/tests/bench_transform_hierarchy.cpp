@@ -0,0 +1,329 @@
+#include "benchmark.h"
+
+#include "transform_hierarchy.h"
+#include "util/threading/thread_pool.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace cera;
+
+namespace
+{
+    float4x4 make_local_transform(u32 i)
+    {
+        float4x4 local = float4x4::identity();
+        local.m[3][0] = (i % 7) * 0.1f;
+        local.m[3][1] = 1.0f;
+
+        return local;
+    }
+
+    // Time world and inverse world queries of every node, before and after the hierarchy was updated.
+    void bench_queries(transform_hierarchy& hierarchy, const std::vector<transform_hierarchy::handle>& handles, int numRuns)
+    {
+        u32 count = static_cast<u32>(handles.size());
+
+        // Keep the results alive so the queries are not optimized away.
+        float sum = 0.0f;
+
+        // Changing a root outdates the cache, queries walk up to the root.
+        hierarchy.set_local_transform(handles[0], make_local_transform(1));
+        double walk_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (auto handle : handles)
+            {
+                sum += hierarchy.get_world_transform(handle).m[3][0];
+            }
+        });
+        benchmark::report("  world queries, outdated (walk up)", walk_ms, count, "queries");
+
+        double inverse_walk_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (auto handle : handles)
+            {
+                sum += hierarchy.get_inverse_world_transform(handle).m[3][0];
+            }
+        });
+        benchmark::report("  inverse world queries, outdated (walk up)", inverse_walk_ms, count, "queries");
+
+        double update_ms = benchmark::measure(1, [&]() { hierarchy.update(); });
+        benchmark::report("  update after changing one root", update_ms, count, "nodes");
+
+        double cached_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (auto handle : handles)
+            {
+                sum += hierarchy.get_world_transform(handle).m[3][0];
+            }
+        });
+        benchmark::report("  world queries, cached", cached_ms, count, "queries");
+
+        // The first query after an update computes the inverse, later ones read the cache.
+        double inverse_first_ms = benchmark::measure(1, [&]()
+        {
+            for (auto handle : handles)
+            {
+                sum += hierarchy.get_inverse_world_transform(handle).m[3][0];
+            }
+        });
+        benchmark::report("  inverse world queries, first", inverse_first_ms, count, "queries");
+
+        double inverse_cached_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (auto handle : handles)
+            {
+                sum += hierarchy.get_inverse_world_transform(handle).m[3][0];
+            }
+        });
+        benchmark::report("  inverse world queries, cached", inverse_cached_ms, count, "queries");
+
+        if (sum == 0.0f)
+        {
+            printf("  unexpected query results\n");
+        }
+    }
+
+    // Chains of nodes, every chain is depth nodes long.
+    void bench_deep_hierarchy(u32 count, u32 depth, int numRuns)
+    {
+        transform_hierarchy hierarchy;
+        std::vector<transform_hierarchy::handle> handles;
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            transform_hierarchy::handle parent = i % depth == 0 ? transform_hierarchy::invalid_handle : handles.back();
+            handles.push_back(hierarchy.create(make_local_transform(i), parent));
+        }
+        hierarchy.update();
+
+        printf("%u nodes in chains of depth %u\n", count, depth);
+        bench_queries(hierarchy, handles, numRuns);
+    }
+
+    // A single root with all other nodes as its children.
+    void bench_wide_hierarchy(u32 numChildren, int numRuns)
+    {
+        transform_hierarchy hierarchy;
+        std::vector<transform_hierarchy::handle> handles;
+
+        handles.push_back(hierarchy.create());
+        for (u32 i = 0; i < numChildren; ++i)
+        {
+            handles.push_back(hierarchy.create(make_local_transform(i), handles[0]));
+        }
+        hierarchy.update();
+
+        printf("1 root with %u children\n", numChildren);
+        bench_queries(hierarchy, handles, numRuns);
+    }
+
+    // The scene_node tree before the transform hierarchy: every node allocates its matrices separately, owns its
+    // children through shared pointers and computes its world transform by walking up its parents.
+    class pointer_node : public std::enable_shared_from_this<pointer_node>
+    {
+    public:
+        explicit pointer_node(const float4x4& localTransform)
+            : m_name("scene_node")
+            , m_transforms(std::make_unique<transforms>())
+        {
+            set_local_transform(localTransform);
+        }
+
+        void set_local_transform(const float4x4& localTransform)
+        {
+            m_transforms->local = localTransform;
+            inverse(localTransform, m_transforms->inverse_local);
+        }
+
+        const float4x4& get_local_transform() const
+        {
+            return m_transforms->local;
+        }
+
+        float4x4 get_world_transform() const
+        {
+            if (auto parent = m_parent.lock())
+            {
+                return multiply(m_transforms->local, parent->get_world_transform());
+            }
+            return m_transforms->local;
+        }
+
+        void add_child(const std::shared_ptr<pointer_node>& child)
+        {
+            child->m_parent = shared_from_this();
+            m_children.push_back(child);
+            m_children_by_name.emplace(child->m_name, child);
+        }
+
+    private:
+        struct alignas(16) transforms
+        {
+            float4x4 local;
+            float4x4 inverse_local;
+        };
+
+        std::string m_name;
+        std::unique_ptr<transforms> m_transforms;
+
+        std::weak_ptr<pointer_node> m_parent;
+        std::vector<std::shared_ptr<pointer_node>> m_children;
+        std::multimap<std::string, std::shared_ptr<pointer_node>> m_children_by_name;
+    };
+
+    // Build, move every node and query its world transform, then tear down the same random forest in both.
+    void bench_pointer_tree(u32 count, int numRuns)
+    {
+        std::vector<u32> parents;
+        std::mt19937 rng(1);
+        for (u32 i = 0; i < count; ++i)
+        {
+            parents.push_back(i < 16 ? ~0u : static_cast<u32>(rng() % i));
+        }
+
+        printf("%u nodes, transform_hierarchy against the pointer based scene_node tree\n", count);
+
+        // Keep the results alive so the queries are not optimized away.
+        float sum = 0.0f;
+
+        std::vector<std::shared_ptr<pointer_node>> nodes;
+        double tree_build_ms = benchmark::measure(1, [&]()
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                nodes.push_back(std::make_shared<pointer_node>(make_local_transform(i)));
+                if (parents[i] != ~0u)
+                {
+                    nodes[parents[i]]->add_child(nodes.back());
+                }
+            }
+        });
+
+        transform_hierarchy hierarchy;
+        std::vector<transform_hierarchy::handle> handles;
+        double hierarchy_build_ms = benchmark::measure(1, [&]()
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                handles.push_back(hierarchy.create(make_local_transform(i), parents[i] != ~0u ? handles[parents[i]] : transform_hierarchy::invalid_handle));
+            }
+            hierarchy.update();
+        });
+
+        benchmark::report("  build, pointer tree", tree_build_ms, count, "nodes");
+        benchmark::report("  build, hierarchy", hierarchy_build_ms, count, "nodes");
+
+        double tree_frame_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (auto& node : nodes)
+            {
+                node->set_local_transform(node->get_local_transform());
+            }
+            for (auto& node : nodes)
+            {
+                sum += node->get_world_transform().m[3][0];
+            }
+        });
+
+        double hierarchy_frame_ms = benchmark::measure(numRuns, [&]()
+        {
+            for (auto handle : handles)
+            {
+                hierarchy.set_local_transform(handle, hierarchy.get_local_transform(handle));
+            }
+            hierarchy.update();
+            for (auto handle : handles)
+            {
+                sum += hierarchy.get_world_transform(handle).m[3][0];
+            }
+        });
+
+        benchmark::report("  set all + query all, pointer tree", tree_frame_ms, count, "nodes");
+        benchmark::report("  set all + update + query all, hierarchy", hierarchy_frame_ms, count, "nodes");
+
+        // Nodes are released in creation order, parents before their children.
+        double tree_teardown_ms = benchmark::measure(1, [&]() { nodes.clear(); });
+
+        double hierarchy_teardown_ms = benchmark::measure(1, [&]()
+        {
+            for (auto handle : handles)
+            {
+                hierarchy.destroy(handle);
+            }
+            hierarchy.update();
+        });
+
+        benchmark::report("  teardown, pointer tree", tree_teardown_ms, count, "nodes");
+        benchmark::report("  teardown, hierarchy", hierarchy_teardown_ms, count, "nodes");
+
+        if (sum == 0.0f)
+        {
+            printf("  unexpected query results\n");
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const bool quick = benchmark::is_quick(argc, argv);
+    const u32 count = quick ? 20000 : 200000;
+    const int num_runs = quick ? 1 : 10;
+
+    transform_hierarchy hierarchy;
+    std::vector<transform_hierarchy::handle> handles;
+
+    std::mt19937 rng(1);
+    for (u32 i = 0; i < count; ++i)
+    {
+        float4x4 local = float4x4::identity();
+        local.m[3][0] = (i % 7) * 0.1f;
+
+        transform_hierarchy::handle parent = i < 16 ? transform_hierarchy::invalid_handle : handles[rng() % handles.size()];
+        handles.push_back(hierarchy.create(local, parent));
+    }
+
+    double sort_ms = benchmark::measure(1, [&]() { hierarchy.update(); });
+    printf("%u nodes\n", count);
+    benchmark::report("  first update (sort by depth)", sort_ms, count, "nodes");
+
+    auto touch_all = [&]()
+    {
+        for (auto handle : handles)
+        {
+            hierarchy.set_local_transform(handle, hierarchy.get_local_transform(handle));
+        }
+    };
+
+    double single_ms = benchmark::measure(num_runs, [&]()
+    {
+        touch_all();
+        hierarchy.update();
+    });
+    benchmark::report("  set all + update", single_ms, count, "nodes");
+
+    u32 max_threads = std::max(2u, std::thread::hardware_concurrency());
+    for (u32 num_threads = 2; num_threads <= max_threads; num_threads *= 2)
+    {
+        threading::thread_pool pool(num_threads - 1);
+
+        double threaded_ms = benchmark::measure(num_runs, [&]()
+        {
+            touch_all();
+            hierarchy.update(pool);
+        });
+
+        char name[64];
+        snprintf(name, sizeof(name), "  set all + update, %u threads", num_threads);
+        benchmark::report(name, threaded_ms, count, "nodes");
+    }
+
+    bench_deep_hierarchy(quick ? 3200 : 100000, 32, num_runs);
+    bench_wide_hierarchy(quick ? 10000 : 100000, num_runs);
+    bench_pointer_tree(count, num_runs);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace cera
+{
+    namespace benchmark
+    {
+        /**
+         * Benchmarks run a reduced problem size when started with --quick, ctest uses it to check they still work.
+         */
+        inline bool is_quick(int argc, char** argv)
+        {
+            for (int i = 1; i < argc; ++i)
+            {
+                if (strcmp(argv[i], "--quick") == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Fastest of a number of runs of a function, in milliseconds.
+         */
+        template <typename Function>
+        double measure(int numRuns, Function&& function)
+        {
+            double best = 0.0;
+            for (int run = 0; run < numRuns; ++run)
+            {
+                auto start = std::chrono::steady_clock::now();
+                function();
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                best = run == 0 ? ms : std::min(best, ms);
+            }
+            return best;
+        }
+
+        inline void report(const char* name, double ms, double numItems = 0.0, const char* itemName = "items")
+        {
+            if (numItems > 0.0)
+            {
+                printf("%-48s %10.3f ms %12.2f M%s/s\n", name, ms, numItems / ms / 1000.0, itemName);
+            }
+            else
+            {
+                printf("%-48s %10.3f ms\n", name, ms);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * Define a test, it is run by test_main.cpp.
+ */
+#define CERA_TEST(name)                                                                 \
+    static void name();                                                                 \
+    static const cera::test::test_registrar name##_registrar(#name, &name);             \
+    static void name()
+
+/**
+ * Check an expression, a failed check is reported and the test continues.
+ */
+#define CERA_CHECK(expression)                                                          \
+    do                                                                                  \
+    {                                                                                   \
+        if (!(expression))                                                              \
+        {                                                                               \
+            cera::test::report_failure(__FILE__, __LINE__, #expression);                \
+        }                                                                               \
+    } while (false)
+
+namespace cera
+{
+    namespace test
+    {
+        using test_function = void (*)();
+
+        struct test_case
+        {
+            const char* name;
+            test_function function;
+        };
+
+        /**
+         * All tests of the executable in the order they are defined.
+         */
+        std::vector<test_case>& get_test_cases();
+
+        /**
+         * Record a failed check, the test keeps running.
+         */
+        void report_failure(const char* file, int line, const char* expression);
+
+        struct test_registrar
+        {
+            test_registrar(const char* name, test_function function)
+            {
+                get_test_cases().push_back({ name, function });
+            }
+        };
+    }
+}
\ No newline at end of file
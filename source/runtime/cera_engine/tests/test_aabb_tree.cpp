@@ -0,0 +1,331 @@
+#include "test.h"
+#include "test_geometry.h"
+
+#include "aabb_tree.h"
+#include "frustum_culler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+using namespace cera;
+
+namespace
+{
+    bool overlaps(const bounding_box& a, const bounding_box& b)
+    {
+        return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z
+            && a.max.x >= b.min.x && a.max.y >= b.min.y && a.max.z >= b.min.z;
+    }
+
+    bool contains(const bounding_box& outer, const bounding_box& inner)
+    {
+        return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z
+            && outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+    }
+
+    bounding_box make_box(const float3& center, float halfSize)
+    {
+        return { { center.x - halfSize, center.y - halfSize, center.z - halfSize }, { center.x + halfSize, center.y + halfSize, center.z + halfSize } };
+    }
+
+    struct test_scene
+    {
+        aabb_tree tree;
+        std::vector<bounding_box> boxes;
+        std::vector<aabb_tree::proxy> proxies;
+
+        test_scene(u32 count, u32 seed)
+            : tree(0.1f)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+            for (u32 i = 0; i < count; ++i)
+            {
+                boxes.push_back(make_box({ position(rng), position(rng), position(rng) }, 1.0f));
+                proxies.push_back(tree.insert(boxes.back(), i));
+            }
+        }
+
+        // User data of the proxies found by a query, sorted.
+        std::vector<u32> to_user_data(const std::vector<aabb_tree::proxy>& results) const
+        {
+            std::vector<u32> user_data;
+            for (aabb_tree::proxy p : results)
+            {
+                user_data.push_back(tree.get_user_data(p));
+            }
+            std::sort(user_data.begin(), user_data.end());
+            return user_data;
+        }
+
+        // Proxies whose fattened box passes a test, the results a query must return.
+        template <typename Predicate>
+        std::vector<u32> brute_force(Predicate&& predicate) const
+        {
+            std::vector<u32> user_data;
+            for (u32 i = 0; i < proxies.size(); ++i)
+            {
+                if (proxies[i] != aabb_tree::invalid_proxy && predicate(tree.get_fat_bounds(proxies[i])))
+                {
+                    user_data.push_back(i);
+                }
+            }
+            return user_data;
+        }
+    };
+}
+
+CERA_TEST(insert_and_remove)
+{
+    aabb_tree tree(0.5f);
+    CERA_CHECK(tree.size() == 0);
+
+    aabb_tree::proxy a = tree.insert(make_box({ 0.0f, 0.0f, 0.0f }, 1.0f), 7);
+    CERA_CHECK(tree.size() == 1 && tree.get_height() == 0);
+    CERA_CHECK(tree.get_user_data(a) == 7);
+    CERA_CHECK(contains(tree.get_fat_bounds(a), make_box({ 0.0f, 0.0f, 0.0f }, 1.5f)));
+
+    aabb_tree::proxy b = tree.insert(make_box({ 10.0f, 0.0f, 0.0f }, 1.0f), 8);
+    CERA_CHECK(tree.size() == 2 && tree.get_height() == 1);
+
+    tree.remove(a);
+    CERA_CHECK(tree.size() == 1);
+
+    std::vector<aabb_tree::proxy> results;
+    tree.query(make_box({ 10.0f, 0.0f, 0.0f }, 0.1f), results);
+    CERA_CHECK(results.size() == 1 && results[0] == b);
+
+    tree.clear();
+    results.clear();
+    tree.query(make_box({ 10.0f, 0.0f, 0.0f }, 0.1f), results);
+    CERA_CHECK(tree.size() == 0 && results.empty());
+}
+
+CERA_TEST(tree_stays_balanced)
+{
+    test_scene scene(10000, 7);
+
+    // A balanced tree of 10000 leaves is about 14 levels high.
+    CERA_CHECK(scene.tree.get_height() < 32);
+    CERA_CHECK(scene.tree.size() == 10000);
+}
+
+CERA_TEST(queries_match_brute_force)
+{
+    test_scene scene(5000, 7);
+
+    for (u32 i = 0; i < scene.proxies.size(); i += 3)
+    {
+        scene.tree.remove(scene.proxies[i]);
+        scene.proxies[i] = aabb_tree::invalid_proxy;
+    }
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+    bool boxes_match = true;
+    bool spheres_match = true;
+    for (u32 q = 0; q < 100; ++q)
+    {
+        bounding_box box = make_box({ position(rng), position(rng), position(rng) }, 15.0f);
+
+        std::vector<aabb_tree::proxy> results;
+        scene.tree.query(box, results);
+        boxes_match &= scene.to_user_data(results) == scene.brute_force([&box](const bounding_box& b) { return overlaps(b, box); });
+
+        bounding_sphere sphere = { { position(rng), position(rng), position(rng) }, 20.0f };
+
+        results.clear();
+        scene.tree.query(sphere, results);
+        spheres_match &= scene.to_user_data(results) == scene.brute_force([&sphere](const bounding_box& b)
+        {
+            float dx = std::max(std::max(b.min.x - sphere.center.x, 0.0f), sphere.center.x - b.max.x);
+            float dy = std::max(std::max(b.min.y - sphere.center.y, 0.0f), sphere.center.y - b.max.y);
+            float dz = std::max(std::max(b.min.z - sphere.center.z, 0.0f), sphere.center.z - b.max.z);
+            return dx * dx + dy * dy + dz * dz <= sphere.radius * sphere.radius;
+        });
+    }
+    CERA_CHECK(boxes_match);
+    CERA_CHECK(spheres_match);
+
+    // The frustum query returns the same boxes as the flat culler.
+    float4x4 view_projection = multiply(test::make_look_at({ 0.0f, 0.0f, -150.0f }, { 20.0f, 0.0f, 0.0f }), test::make_perspective(0.8f, 16.0f / 9.0f, 0.1f, 200.0f));
+    frustum frustum = frustum::from_view_projection(view_projection);
+
+    frustum_culler culler;
+    for (aabb_tree::proxy p : scene.proxies)
+    {
+        culler.add(p != aabb_tree::invalid_proxy ? scene.tree.get_fat_bounds(p) : make_box({ 1e9f, 1e9f, 1e9f }, 1.0f));
+    }
+
+    std::vector<u8> visibility;
+    culler.cull(frustum, visibility);
+
+    std::vector<aabb_tree::proxy> results;
+    scene.tree.query(frustum, results);
+
+    std::vector<u32> expected;
+    for (u32 i = 0; i < visibility.size(); ++i)
+    {
+        if (visibility[i])
+        {
+            expected.push_back(i);
+        }
+    }
+    CERA_CHECK(!expected.empty());
+    CERA_CHECK(scene.to_user_data(results) == expected);
+}
+
+CERA_TEST(moves_keep_queries_correct)
+{
+    test_scene scene(3000, 5);
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> small_step(-0.05f, 0.05f);
+    std::uniform_real_distribution<float> large_step(-20.0f, 20.0f);
+
+    // Small moves stay inside the fattened boxes.
+    u32 num_changed = 0;
+    for (u32 i = 0; i < scene.proxies.size(); ++i)
+    {
+        float step = small_step(rng);
+        scene.boxes[i].min.x += step;
+        scene.boxes[i].max.x += step;
+        num_changed += scene.tree.move(scene.proxies[i], scene.boxes[i]) ? 1 : 0;
+    }
+    CERA_CHECK(num_changed == 0);
+
+    // Large moves reinsert the proxies.
+    for (u32 i = 0; i < scene.proxies.size(); ++i)
+    {
+        float step = large_step(rng);
+        scene.boxes[i].min.y += step;
+        scene.boxes[i].max.y += step;
+        scene.tree.move(scene.proxies[i], scene.boxes[i]);
+    }
+
+    // Deferred moves, the tree is refit once.
+    for (u32 i = 0; i < scene.proxies.size(); ++i)
+    {
+        float step = large_step(rng);
+        scene.boxes[i].min.z += step;
+        scene.boxes[i].max.z += step;
+        scene.tree.move_deferred(scene.proxies[i], scene.boxes[i]);
+    }
+    scene.tree.refit();
+
+    bool fat_boxes_contain_boxes = true;
+    for (u32 i = 0; i < scene.proxies.size(); ++i)
+    {
+        fat_boxes_contain_boxes &= contains(scene.tree.get_fat_bounds(scene.proxies[i]), scene.boxes[i]);
+    }
+    CERA_CHECK(fat_boxes_contain_boxes);
+
+    bool match = true;
+    for (u32 q = 0; q < 50; ++q)
+    {
+        bounding_box box = make_box({ large_step(rng) * 5.0f, large_step(rng) * 5.0f, large_step(rng) * 5.0f }, 15.0f);
+
+        std::vector<aabb_tree::proxy> results;
+        scene.tree.query(box, results);
+        match &= scene.to_user_data(results) == scene.brute_force([&box](const bounding_box& b) { return overlaps(b, box); });
+    }
+    CERA_CHECK(match);
+}
+
+CERA_TEST(deferred_moves_are_found_before_refit)
+{
+    test_scene scene(3000, 21);
+
+    std::mt19937 rng(23);
+    std::uniform_real_distribution<float> large_step(-50.0f, 50.0f);
+
+    for (u32 i = 0; i < scene.proxies.size(); i += 2)
+    {
+        float step = large_step(rng);
+        scene.boxes[i].min.x += step;
+        scene.boxes[i].max.x += step;
+        scene.tree.move_deferred(scene.proxies[i], scene.boxes[i]);
+    }
+
+    bool match = true;
+    for (u32 q = 0; q < 50; ++q)
+    {
+        bounding_box box = make_box({ large_step(rng) * 2.0f, large_step(rng) * 2.0f, large_step(rng) * 2.0f }, 15.0f);
+
+        std::vector<aabb_tree::proxy> results;
+        scene.tree.query(box, results);
+        match &= scene.to_user_data(results) == scene.brute_force([&box](const bounding_box& b) { return overlaps(b, box); });
+    }
+    CERA_CHECK(match);
+
+    // Every moved proxy is found by a query around its new box.
+    bool found = true;
+    for (u32 i = 0; i < scene.proxies.size(); i += 2)
+    {
+        std::vector<aabb_tree::proxy> results;
+        scene.tree.query(scene.boxes[i], results);
+        found &= std::find(results.begin(), results.end(), scene.proxies[i]) != results.end();
+    }
+    CERA_CHECK(found);
+}
+
+CERA_TEST(raycast_finds_closest_box)
+{
+    test_scene scene(5000, 9);
+
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+    u32 num_hits = 0;
+    bool closest = true;
+    for (u32 r = 0; r < 200; ++r)
+    {
+        float3 origin = { position(rng), position(rng), -200.0f };
+        float3 direction = { 0.0f, 0.0f, 1.0f };
+
+        auto is_hit = [&origin](const bounding_box& b)
+        {
+            return origin.x >= b.min.x && origin.x <= b.max.x && origin.y >= b.min.y && origin.y <= b.max.y;
+        };
+
+        float best = std::numeric_limits<float>::infinity();
+        scene.tree.raycast(origin, direction, 1000.0f, [&](aabb_tree::proxy hit, float maxDistance)
+        {
+            const bounding_box& b = scene.tree.get_fat_bounds(hit);
+            if (!is_hit(b))
+            {
+                return maxDistance;
+            }
+
+            float distance = b.min.z - origin.z;
+            best = std::min(best, distance);
+            return std::min(maxDistance, distance);
+        });
+
+        float expected = std::numeric_limits<float>::infinity();
+        for (aabb_tree::proxy p : scene.proxies)
+        {
+            const bounding_box& b = scene.tree.get_fat_bounds(p);
+            if (is_hit(b))
+            {
+                expected = std::min(expected, b.min.z - origin.z);
+            }
+        }
+
+        if (expected != std::numeric_limits<float>::infinity())
+        {
+            ++num_hits;
+            closest &= std::fabs(expected - best) < 1e-3f;
+        }
+        else
+        {
+            closest &= best == std::numeric_limits<float>::infinity();
+        }
+    }
+    CERA_CHECK(num_hits > 0);
+    CERA_CHECK(closest);
+}
\ No newline at end of file
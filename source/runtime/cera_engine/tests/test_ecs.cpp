@@ -0,0 +1,320 @@
+#include "test.h"
+
+#include "ecs/components.h"
+#include "ecs/registry.h"
+#include "util/threading/thread_pool.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace cera;
+
+namespace
+{
+    struct position
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+    };
+
+    struct velocity
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+    };
+
+    struct health
+    {
+        u32 value = 100;
+    };
+
+    // Counts its live copies through the use count of the shared pointer, destroyed components release it.
+    struct tracked
+    {
+        std::shared_ptr<int> counter;
+    };
+}
+
+CERA_TEST(entities_are_created_and_destroyed)
+{
+    ecs::registry registry;
+
+    ecs::entity a = registry.create(position{ 1.0f, 2.0f, 3.0f });
+    ecs::entity b = registry.create(position{ 4.0f, 5.0f, 6.0f }, velocity{ 1.0f, 0.0f, 0.0f });
+    CERA_CHECK(registry.size() == 2);
+    CERA_CHECK(registry.get_num_archetypes() == 2);
+    CERA_CHECK(registry.is_alive(a) && registry.is_alive(b));
+
+    CERA_CHECK(registry.get_component<position>(a)->z == 3.0f);
+    CERA_CHECK(registry.get_component<velocity>(a) == nullptr);
+    CERA_CHECK(registry.has_component<velocity>(b));
+
+    registry.destroy(a);
+    CERA_CHECK(!registry.is_alive(a));
+    CERA_CHECK(registry.get_component<position>(a) == nullptr);
+    CERA_CHECK(registry.size() == 1);
+
+    // The index is reused with a new generation, the old handle stays invalid.
+    ecs::entity c = registry.create(position{});
+    CERA_CHECK(c.index == a.index && c != a);
+    CERA_CHECK(registry.is_alive(c) && !registry.is_alive(a));
+
+    // Destroying twice does nothing.
+    registry.destroy(a);
+    CERA_CHECK(registry.size() == 2);
+}
+
+CERA_TEST(components_are_stored_in_chunks_of_arrays)
+{
+    ecs::registry registry;
+
+    const u32 count = 5000;
+    for (u32 i = 0; i < count; ++i)
+    {
+        registry.create(position{ static_cast<float>(i), 0.0f, 0.0f }, health{ i });
+    }
+
+    u32 capacity = 0;
+    u32 num_chunks = 0;
+    u32 num_entities = 0;
+    bool separate_arrays = true;
+    bool rows_match = true;
+    registry.for_each_chunk<position, health>([&](u32 chunkCount, const ecs::entity* entities, position* positions, health* healths)
+    {
+        ++num_chunks;
+        num_entities += chunkCount;
+        capacity = std::max(capacity, chunkCount);
+
+        // Every component type has its own cache line aligned array.
+        const u8* entity_bytes = reinterpret_cast<const u8*>(entities);
+        const u8* position_bytes = reinterpret_cast<const u8*>(positions);
+        const u8* health_bytes = reinterpret_cast<const u8*>(healths);
+        separate_arrays &= reinterpret_cast<uintptr_t>(position_bytes) % memory::cache_line_size == 0;
+        separate_arrays &= reinterpret_cast<uintptr_t>(health_bytes) % memory::cache_line_size == 0;
+        separate_arrays &= position_bytes >= entity_bytes + chunkCount * sizeof(ecs::entity);
+        separate_arrays &= health_bytes >= position_bytes + chunkCount * sizeof(position);
+
+        for (u32 i = 0; i < chunkCount; ++i)
+        {
+            rows_match &= healths[i].value == static_cast<u32>(positions[i].x);
+            rows_match &= registry.get_component<health>(entities[i]) == &healths[i];
+        }
+    });
+
+    CERA_CHECK(num_entities == count);
+    CERA_CHECK(separate_arrays);
+    CERA_CHECK(rows_match);
+
+    // Chunks are filled before a new one is started and stay within the chunk size.
+    CERA_CHECK(capacity * (sizeof(ecs::entity) + sizeof(position) + sizeof(health)) <= ecs::archetype::chunk_size);
+    CERA_CHECK(num_chunks == (count + capacity - 1) / capacity);
+}
+
+CERA_TEST(destroy_keeps_rows_dense)
+{
+    ecs::registry registry;
+    std::vector<ecs::entity> entities;
+
+    auto counter = std::make_shared<int>(0);
+    for (u32 i = 0; i < 3000; ++i)
+    {
+        entities.push_back(registry.create(health{ i }, tracked{ counter }));
+    }
+    CERA_CHECK(counter.use_count() == 3001);
+
+    // The last entity of the archetype moves into every destroyed row.
+    for (u32 i = 0; i < entities.size(); i += 2)
+    {
+        registry.destroy(entities[i]);
+    }
+    CERA_CHECK(registry.size() == 1500);
+    CERA_CHECK(counter.use_count() == 1501);
+
+    bool values_kept = true;
+    for (u32 i = 1; i < entities.size(); i += 2)
+    {
+        values_kept &= registry.get_component<health>(entities[i])->value == i;
+    }
+    CERA_CHECK(values_kept);
+
+    u32 num_visited = 0;
+    registry.for_each<health>([&num_visited](health&) { ++num_visited; });
+    CERA_CHECK(num_visited == 1500);
+
+    {
+        ecs::registry other;
+        other.create(tracked{ counter });
+        CERA_CHECK(counter.use_count() == 1502);
+    }
+
+    // Destroying the registry destroys the remaining components.
+    CERA_CHECK(counter.use_count() == 1501);
+}
+
+CERA_TEST(adding_and_removing_components_moves_entities)
+{
+    ecs::registry registry;
+
+    auto counter = std::make_shared<int>(0);
+    std::vector<ecs::entity> entities;
+    for (u32 i = 0; i < 100; ++i)
+    {
+        entities.push_back(registry.create(position{ static_cast<float>(i), 0.0f, 0.0f }, tracked{ counter }));
+    }
+    CERA_CHECK(registry.get_num_archetypes() == 1);
+
+    // Every other entity moves to the archetype with velocity, its components move along.
+    for (u32 i = 0; i < entities.size(); i += 2)
+    {
+        velocity& v = registry.add_component(entities[i], velocity{ 0.0f, static_cast<float>(i), 0.0f });
+        CERA_CHECK(v.y == static_cast<float>(i));
+    }
+    CERA_CHECK(registry.get_num_archetypes() == 2);
+    CERA_CHECK(counter.use_count() == 101);
+
+    bool moved = true;
+    for (u32 i = 0; i < entities.size(); ++i)
+    {
+        moved &= registry.get_component<position>(entities[i])->x == static_cast<float>(i);
+        moved &= registry.has_component<velocity>(entities[i]) == (i % 2 == 0);
+        moved &= registry.get_component<tracked>(entities[i])->counter == counter;
+    }
+    CERA_CHECK(moved);
+
+    // Adding a component the entity already has replaces it in place.
+    registry.add_component(entities[0], velocity{ 5.0f, 0.0f, 0.0f });
+    CERA_CHECK(registry.get_component<velocity>(entities[0])->x == 5.0f);
+    CERA_CHECK(registry.get_num_archetypes() == 2);
+
+    // Removing a component destroys it.
+    for (u32 i = 0; i < entities.size(); i += 4)
+    {
+        registry.remove_component<tracked>(entities[i]);
+    }
+    CERA_CHECK(counter.use_count() == 76);
+    CERA_CHECK(registry.get_num_archetypes() == 3);
+    CERA_CHECK(!registry.has_component<tracked>(entities[0]));
+    CERA_CHECK(registry.get_component<velocity>(entities[0])->x == 5.0f);
+
+    // Removing a missing component does nothing.
+    registry.remove_component<health>(entities[1]);
+    CERA_CHECK(registry.get_num_archetypes() == 3);
+    CERA_CHECK(registry.size() == 100);
+}
+
+CERA_TEST(queries_visit_matching_archetypes)
+{
+    ecs::registry registry;
+
+    for (u32 i = 0; i < 10; ++i)
+    {
+        registry.create(position{});
+        registry.create(position{}, velocity{ 1.0f, 0.0f, 0.0f });
+        registry.create(position{}, velocity{ 1.0f, 0.0f, 0.0f }, health{});
+        registry.create(health{});
+    }
+
+    u32 num_positions = 0;
+    registry.for_each<position>([&num_positions](position&) { ++num_positions; });
+    CERA_CHECK(num_positions == 30);
+
+    // Systems write the components of all matching entities.
+    registry.for_each<position, velocity>([](position& p, const velocity& v) { p.x += v.x; });
+
+    float sum = 0.0f;
+    u32 num_moving = 0;
+    registry.for_each<position, velocity>([&](position& p, velocity&)
+    {
+        sum += p.x;
+        ++num_moving;
+    });
+    CERA_CHECK(num_moving == 20 && sum == 20.0f);
+
+    u32 num_healthy = 0;
+    registry.for_each<health>([&num_healthy](health&) { ++num_healthy; });
+    CERA_CHECK(num_healthy == 20);
+
+    // Excluded components skip whole archetypes.
+    u32 num_without_health = 0;
+    registry.for_each_chunk<position>([&num_without_health](u32 count, const ecs::entity*, position*)
+    {
+        num_without_health += count;
+    }, ecs::get_component_mask<health>());
+    CERA_CHECK(num_without_health == 20);
+}
+
+CERA_TEST(parallel_for_each_visits_every_entity_once)
+{
+    ecs::registry registry;
+
+    // Several archetypes of different sizes, many chunks each.
+    for (u32 i = 0; i < 20000; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            registry.create(health{ 0 }, position{});
+        }
+        else
+        {
+            registry.create(health{ 0 });
+        }
+    }
+
+    threading::thread_pool pool(3);
+    for (u32 pass = 0; pass < 4; ++pass)
+    {
+        registry.parallel_for_each<health>(pool, [](health& h) { ++h.value; });
+    }
+
+    bool once = true;
+    u32 num_visited = 0;
+    registry.for_each<health>([&](health& h)
+    {
+        once &= h.value == 4;
+        ++num_visited;
+    });
+    CERA_CHECK(once);
+    CERA_CHECK(num_visited == 20000);
+
+    // A query without matches does not submit work.
+    registry.parallel_for_each<velocity>(pool, [](velocity& v) { v.x = 1.0f; });
+}
+
+CERA_TEST(world_bounds_follow_transforms)
+{
+    ecs::registry registry;
+
+    bounding_box unit = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+
+    std::vector<ecs::entity> entities;
+    for (u32 i = 0; i < 1000; ++i)
+    {
+        ecs::world_transform world;
+        world.matrix.m[3][0] = static_cast<float>(i);
+        entities.push_back(registry.create(world, ecs::local_bounds{ unit }, ecs::world_bounds()));
+    }
+    ecs::entity unbounded = registry.create(ecs::world_transform(), ecs::local_bounds(), ecs::world_bounds{ unit });
+
+    threading::thread_pool pool(2);
+    for (threading::thread_pool* thread_pool : { static_cast<threading::thread_pool*>(nullptr), &pool })
+    {
+        ecs::update_world_bounds(registry, thread_pool);
+
+        bool moved = true;
+        for (u32 i = 0; i < entities.size(); ++i)
+        {
+            const bounding_box& box = registry.get_component<ecs::world_bounds>(entities[i])->box;
+            moved &= box.min.x == i - 1.0f && box.max.x == i + 1.0f && box.min.y == -1.0f && box.max.z == 1.0f;
+        }
+        CERA_CHECK(moved);
+        CERA_CHECK(registry.get_component<ecs::world_bounds>(unbounded)->box.is_empty());
+
+        // The threaded update recomputes the same bounds.
+        for (ecs::entity e : entities)
+        {
+            registry.get_component<ecs::world_bounds>(e)->box = bounding_box::empty();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "test.h"
+#include "test_geometry.h"
+
+#include "frustum_culler.h"
+
+#include <cmath>
+#include <random>
+
+using namespace cera;
+
+namespace
+{
+    // Box against plane test of the frustum planes, one box at a time.
+    bool reference_is_visible(const frustum& frustum, const bounding_box& box)
+    {
+        if (box.is_empty())
+        {
+            return true;
+        }
+
+        float3 center = box.get_center();
+        float3 extents = box.get_extents();
+
+        for (const plane& plane : frustum.planes)
+        {
+            float distance = center.x * plane.normal.x + center.y * plane.normal.y + center.z * plane.normal.z + plane.distance;
+            float radius = extents.x * std::fabs(plane.normal.x) + extents.y * std::fabs(plane.normal.y) + extents.z * std::fabs(plane.normal.z);
+            if (distance + radius < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+CERA_TEST(boxes_in_front_are_visible)
+{
+    frustum frustum = frustum::from_view_projection(test::make_perspective(1.0f, 16.0f / 9.0f, 0.1f, 500.0f));
+
+    frustum_culler culler;
+    culler.add({ { -1.0f, -1.0f, 9.0f }, { 1.0f, 1.0f, 11.0f } });
+    culler.add({ { -1.0f, -1.0f, -11.0f }, { 1.0f, 1.0f, -9.0f } });
+    culler.add({ { 1000.0f, 0.0f, 9.0f }, { 1001.0f, 1.0f, 11.0f } });
+    culler.add({ { -1.0f, -1.0f, 600.0f }, { 1.0f, 1.0f, 601.0f } });
+    culler.add(bounding_box::empty());
+    // Crosses the near plane.
+    culler.add({ { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } });
+
+    std::vector<u8> visibility;
+    u32 num_visible = culler.cull(frustum, visibility);
+
+    CERA_CHECK(visibility.size() == 6);
+    CERA_CHECK(num_visible == 3);
+    CERA_CHECK(visibility[0] == 1);
+    CERA_CHECK(visibility[1] == 0);
+    CERA_CHECK(visibility[2] == 0);
+    CERA_CHECK(visibility[3] == 0);
+    CERA_CHECK(visibility[4] == 1);
+    CERA_CHECK(visibility[5] == 1);
+}
+
+CERA_TEST(simd_matches_reference)
+{
+    float4x4 view_projection = multiply(test::make_look_at({ 10.0f, 20.0f, -30.0f }, { 0.0f, 0.0f, 0.0f }), test::make_perspective(1.0f, 16.0f / 9.0f, 0.1f, 500.0f));
+    frustum frustum = frustum::from_view_projection(view_projection);
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+
+    // Not a multiple of the batch size, the tail is tested too.
+    constexpr u32 count = 100003;
+
+    frustum_culler culler;
+    culler.reserve(count);
+    std::vector<bounding_box> boxes;
+    for (u32 i = 0; i < count; ++i)
+    {
+        float x = position(rng);
+        float y = position(rng);
+        float z = position(rng);
+        bounding_box box = { { x - 1.0f, y - 1.0f, z - 1.0f }, { x + 1.0f, y + 1.0f, z + 1.0f } };
+        if (i % 1000 == 5)
+        {
+            box = bounding_box::empty();
+        }
+
+        boxes.push_back(box);
+        culler.add(box);
+    }
+
+    std::vector<u8> visibility;
+    u32 num_visible = culler.cull(frustum, visibility);
+
+    u32 num_mismatches = 0;
+    u32 num_reference_visible = 0;
+    for (u32 i = 0; i < count; ++i)
+    {
+        bool visible = reference_is_visible(frustum, boxes[i]);
+        num_reference_visible += visible ? 1 : 0;
+        num_mismatches += visibility[i] != (visible ? 1 : 0) ? 1 : 0;
+    }
+
+    CERA_CHECK(num_mismatches == 0);
+    CERA_CHECK(num_visible == num_reference_visible);
+    CERA_CHECK(num_visible > 0 && num_visible < count);
+
+    culler.clear();
+    CERA_CHECK(culler.size() == 0);
+    CERA_CHECK(culler.cull(frustum, visibility) == 0);
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "util/types.h"
+
+#include "bounding_volume.h"
+#include "transform_hierarchy.h"
+
+#include <cmath>
+#include <vector>
+
+namespace cera
+{
+    namespace test
+    {
+        /**
+         * Vertex layout of the generated meshes, the same as vertex_pos_color.
+         */
+        struct test_vertex
+        {
+            float position[3];
+            float color[3];
+        };
+
+        /**
+         * Left handed perspective projection with depth in [0, 1], for row vectors.
+         */
+        inline float4x4 make_perspective(float fovY, float aspectRatio, float nearZ, float farZ)
+        {
+            float y_scale = 1.0f / std::tan(fovY * 0.5f);
+
+            float4x4 m = {};
+            m.m[0][0] = y_scale / aspectRatio;
+            m.m[1][1] = y_scale;
+            m.m[2][2] = farZ / (farZ - nearZ);
+            m.m[2][3] = 1.0f;
+            m.m[3][2] = -nearZ * farZ / (farZ - nearZ);
+            return m;
+        }
+
+        /**
+         * Left handed view matrix, looks from eye to target with +y up.
+         */
+        inline float4x4 make_look_at(const float3& eye, const float3& target)
+        {
+            auto normalize = [](float3 v)
+            {
+                float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+                return float3{ v.x / length, v.y / length, v.z / length };
+            };
+            auto cross = [](const float3& a, const float3& b)
+            {
+                return float3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+            };
+            auto dot = [](const float3& a, const float3& b)
+            {
+                return a.x * b.x + a.y * b.y + a.z * b.z;
+            };
+
+            float3 z = normalize({ target.x - eye.x, target.y - eye.y, target.z - eye.z });
+            float3 x = normalize(cross({ 0.0f, 1.0f, 0.0f }, z));
+            float3 y = cross(z, x);
+
+            float4x4 m = float4x4::identity();
+            m.m[0][0] = x.x; m.m[0][1] = y.x; m.m[0][2] = z.x;
+            m.m[1][0] = x.y; m.m[1][1] = y.y; m.m[1][2] = z.y;
+            m.m[2][0] = x.z; m.m[2][1] = y.z; m.m[2][2] = z.z;
+            m.m[3][0] = -dot(x, eye);
+            m.m[3][1] = -dot(y, eye);
+            m.m[3][2] = -dot(z, eye);
+            return m;
+        }
+
+        /**
+         * Scale followed by a translation.
+         */
+        inline float4x4 make_scale_translation(const float3& scale, const float3& translation)
+        {
+            float4x4 m = float4x4::identity();
+            m.m[0][0] = scale.x;
+            m.m[1][1] = scale.y;
+            m.m[2][2] = scale.z;
+            m.m[3][0] = translation.x;
+            m.m[3][1] = translation.y;
+            m.m[3][2] = translation.z;
+            return m;
+        }
+
+        /**
+         * UV sphere of radius 1 with duplicated seam vertices, the same topology as mesh_factory creates.
+         */
+        inline void make_sphere(u32 tessellation, std::vector<test_vertex>& vertices, std::vector<u32>& indices)
+        {
+            const float pi = 3.14159265f;
+
+            u32 vertical_segments = tessellation;
+            u32 horizontal_segments = tessellation * 2;
+            u32 stride = horizontal_segments + 1;
+
+            for (u32 i = 0; i <= vertical_segments; ++i)
+            {
+                float latitude = i * pi / vertical_segments - pi * 0.5f;
+                for (u32 j = 0; j <= horizontal_segments; ++j)
+                {
+                    float longitude = j * 2.0f * pi / horizontal_segments;
+                    vertices.push_back({ { std::cos(latitude) * std::sin(longitude), std::sin(latitude), std::cos(latitude) * std::cos(longitude) }, { 1.0f, 1.0f, 1.0f } });
+                }
+            }
+
+            for (u32 i = 0; i < vertical_segments; ++i)
+            {
+                for (u32 j = 0; j < horizontal_segments; ++j)
+                {
+                    u32 current_row = i * stride;
+                    u32 next_row = (i + 1) * stride;
+
+                    for (u32 index : { current_row + j + 1, next_row + j, current_row + j, current_row + j + 1, next_row + j + 1, next_row + j })
+                    {
+                        indices.push_back(index);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Flat grid of size x size quads in the xz plane with a height field, vertices are shared between quads.
+         */
+        inline void make_grid(u32 size, std::vector<test_vertex>& vertices, std::vector<u32>& indices)
+        {
+            for (u32 z = 0; z <= size; ++z)
+            {
+                for (u32 x = 0; x <= size; ++x)
+                {
+                    float height = 0.1f * std::sin(x * 0.3f) * std::cos(z * 0.2f);
+                    vertices.push_back({ { static_cast<float>(x), height, static_cast<float>(z) }, { x / float(size), 0.5f, z / float(size) } });
+                }
+            }
+
+            for (u32 z = 0; z < size; ++z)
+            {
+                for (u32 x = 0; x < size; ++x)
+                {
+                    u32 v0 = z * (size + 1) + x;
+                    u32 v1 = v0 + 1;
+                    u32 v2 = v0 + size + 1;
+                    u32 v3 = v2 + 1;
+
+                    for (u32 index : { v0, v2, v1, v1, v2, v3 })
+                    {
+                        indices.push_back(index);
+                    }
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
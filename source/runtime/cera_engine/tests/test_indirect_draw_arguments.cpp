@@ -0,0 +1,56 @@
+#include "test.h"
+
+#include "render/indirect_draw_arguments.h"
+
+using namespace cera;
+
+CERA_TEST(commands_are_packed_root_constants_first)
+{
+    indirect_draw_arguments arguments(2);
+
+    CERA_CHECK(arguments.get_stride() == 7 * sizeof(u32));
+    CERA_CHECK(arguments.get_arguments_offset() == 2 * sizeof(u32));
+    CERA_CHECK(arguments.empty());
+
+    for (u32 i = 0; i < 3; ++i)
+    {
+        draw_indexed_arguments draw;
+        draw.index_count_per_instance = 36 + i;
+        draw.start_index_location = 100 * i;
+        draw.base_vertex_location = -static_cast<s32>(i);
+        draw.start_instance_location = i;
+
+        u32 constants[2] = { i, 10 + i };
+        arguments.add_draw(draw, constants);
+    }
+
+    CERA_CHECK(arguments.get_num_commands() == 3);
+    CERA_CHECK(arguments.get_size() == 3 * arguments.get_stride());
+
+    const u32* data = static_cast<const u32*>(arguments.get_data());
+    CERA_CHECK(data[7] == 1 && data[8] == 11 && data[9] == 37);
+
+    draw_indexed_arguments draw = arguments.get_arguments(2);
+    CERA_CHECK(draw.index_count_per_instance == 38);
+    CERA_CHECK(draw.instance_count == 1);
+    CERA_CHECK(draw.start_index_location == 200);
+    CERA_CHECK(draw.base_vertex_location == -2);
+    CERA_CHECK(draw.start_instance_location == 2);
+    CERA_CHECK(arguments.get_root_constants(2)[1] == 12);
+
+    arguments.clear();
+    CERA_CHECK(arguments.empty() && arguments.get_num_commands() == 0);
+}
+
+CERA_TEST(commands_without_root_constants)
+{
+    indirect_draw_arguments arguments;
+
+    draw_indexed_arguments draw;
+    draw.index_count_per_instance = 6;
+    draw.instance_count = 4;
+    arguments.add_draw(draw);
+
+    CERA_CHECK(arguments.get_stride() == sizeof(draw_indexed_arguments));
+    CERA_CHECK(arguments.get_arguments(0).instance_count == 4);
+}
\ No newline at end of file
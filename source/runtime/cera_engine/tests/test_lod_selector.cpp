@@ -0,0 +1,141 @@
+#include "test.h"
+#include "test_geometry.h"
+
+#include "lod_selector.h"
+
+#include <random>
+
+using namespace cera;
+
+namespace
+{
+    const float lod_errors[4] = { 0.0f, 0.01f, 0.04f, 0.16f };
+
+    float get_test_projection_scale()
+    {
+        return lod_selector::get_projection_scale(test::make_perspective(1.0472f, 16.0f / 9.0f, 0.1f, 1000.0f), 1080.0f);
+    }
+}
+
+CERA_TEST(coarser_levels_with_distance)
+{
+    float projection_scale = get_test_projection_scale();
+
+    lod_selector selector;
+    for (float distance : { 0.5f, 5.0f, 50.0f, 500.0f, 5000.0f })
+    {
+        selector.add({ { 0.0f, 0.0f, distance }, 1.0f }, 1.0f, lod_errors, 4, 0);
+    }
+
+    std::vector<u8> lods;
+    selector.select({ 0.0f, 0.0f, 0.0f }, projection_scale, 1.0f, 0.0f, lods);
+
+    CERA_CHECK(lods.size() == 5);
+    // The camera is inside the first sphere.
+    CERA_CHECK(lods[0] == 0);
+    CERA_CHECK(lods[4] == 3);
+
+    bool increasing = true;
+    for (size_t i = 1; i < lods.size(); ++i)
+    {
+        increasing &= lods[i] >= lods[i - 1];
+    }
+    CERA_CHECK(increasing);
+
+    // Scaled up objects show their errors larger.
+    selector.clear();
+    selector.add({ { 0.0f, 0.0f, 500.0f }, 1.0f }, 1.0f, lod_errors, 4, 0);
+    selector.add({ { 0.0f, 0.0f, 500.0f }, 1.0f }, 100.0f, lod_errors, 4, 0);
+    selector.select({ 0.0f, 0.0f, 0.0f }, projection_scale, 1.0f, 0.0f, lods);
+    CERA_CHECK(lods[1] < lods[0]);
+}
+
+CERA_TEST(simd_matches_scalar_tail)
+{
+    float projection_scale = get_test_projection_scale();
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+
+    // The same objects once in SIMD batches and once in the scalar tail of a selector with 1 object.
+    lod_selector selector;
+    std::vector<bounding_sphere> spheres;
+    for (u32 i = 0; i < 1001; ++i)
+    {
+        spheres.push_back({ { position(rng), 0.0f, position(rng) }, 1.0f });
+        selector.add(spheres.back(), 1.0f, lod_errors, 4, i % 4);
+    }
+
+    std::vector<u8> lods;
+    selector.select({ 0.0f, 2.0f, 0.0f }, projection_scale, 1.0f, 0.25f, lods);
+
+    bool same = true;
+    for (u32 i = 0; i < spheres.size(); ++i)
+    {
+        lod_selector single;
+        single.add(spheres[i], 1.0f, lod_errors, 4, i % 4);
+
+        std::vector<u8> single_lod;
+        single.select({ 0.0f, 2.0f, 0.0f }, projection_scale, 1.0f, 0.25f, single_lod);
+        same &= single_lod[0] == lods[i];
+    }
+    CERA_CHECK(same);
+}
+
+CERA_TEST(hysteresis_prevents_switching)
+{
+    float projection_scale = get_test_projection_scale();
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+
+    std::vector<bounding_sphere> spheres;
+    for (u32 i = 0; i < 10000; ++i)
+    {
+        spheres.push_back({ { position(rng), 0.0f, position(rng) }, 1.0f });
+    }
+
+    auto count_switches = [&](float hysteresis)
+    {
+        std::vector<u8> previous(spheres.size(), 0);
+        std::vector<u8> lods;
+        u32 num_switches = 0;
+
+        lod_selector selector;
+        for (u32 frame = 0; frame < 20; ++frame)
+        {
+            selector.clear();
+            for (u32 i = 0; i < spheres.size(); ++i)
+            {
+                selector.add(spheres[i], 1.0f, lod_errors, 4, previous[i]);
+            }
+
+            // The camera jitters back and forth.
+            selector.select({ (frame & 1) ? 0.5f : -0.5f, 2.0f, 0.0f }, projection_scale, 1.0f, hysteresis, lods);
+
+            for (u32 i = 0; i < spheres.size(); ++i)
+            {
+                num_switches += frame > 1 && lods[i] != previous[i] ? 1 : 0;
+                previous[i] = lods[i];
+            }
+        }
+        return num_switches;
+    };
+
+    CERA_CHECK(count_switches(0.0f) > 0);
+    CERA_CHECK(count_switches(0.25f) == 0);
+}
+
+CERA_TEST(objects_without_levels_use_full_detail)
+{
+    lod_selector selector;
+    selector.add({ { 0.0f, 0.0f, 5000.0f }, 1.0f }, 1.0f, nullptr, 0, 7);
+    selector.add({ { 0.0f, 0.0f, 5000.0f }, 1.0f }, 1.0f, lod_errors, 4, 0);
+
+    std::vector<u8> lods;
+    selector.select({ 0.0f, 0.0f, 0.0f }, get_test_projection_scale(), 1.0f, 0.0f, lods);
+
+    CERA_CHECK(lods.size() == 2);
+    CERA_CHECK(lods[0] == 0);
+    CERA_CHECK(lods[1] == 3);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "test.h"
+
+#include <cstdio>
+
+namespace cera
+{
+    namespace test
+    {
+        namespace internal
+        {
+            int s_num_failures = 0;
+        }
+
+        std::vector<test_case>& get_test_cases()
+        {
+            static std::vector<test_case> s_test_cases;
+            return s_test_cases;
+        }
+
+        void report_failure(const char* file, int line, const char* expression)
+        {
+            printf("%s(%d): check failed: %s\n", file, line, expression);
+            ++internal::s_num_failures;
+        }
+    }
+}
+
+int main()
+{
+    using namespace cera::test;
+
+    int num_failed_tests = 0;
+    for (const test_case& test : get_test_cases())
+    {
+        int num_failures = internal::s_num_failures;
+        test.function();
+
+        bool passed = internal::s_num_failures == num_failures;
+        printf("[%s] %s\n", passed ? "pass" : "FAIL", test.name);
+
+        num_failed_tests += passed ? 0 : 1;
+    }
+
+    printf("%d of %zu tests failed\n", num_failed_tests, get_test_cases().size());
+
+    return num_failed_tests == 0 ? 0 : 1;
+}
\ No newline at end of file
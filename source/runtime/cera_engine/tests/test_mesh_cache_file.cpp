@@ -0,0 +1,181 @@
+#include "test.h"
+#include "test_geometry.h"
+
+#include "mesh_cache_file.h"
+#include "mesh_cooker.h"
+#include "model_importer.h"
+#include "util/file_mapping.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+using namespace cera;
+
+namespace
+{
+    std::filesystem::path get_test_directory()
+    {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "cera_test_mesh_cache_file";
+        std::filesystem::create_directories(directory);
+        return directory;
+    }
+
+    imported_model make_model()
+    {
+        imported_model model;
+        for (u32 i = 0; i < 3; ++i)
+        {
+            std::vector<test::test_vertex> vertices;
+            std::vector<u32> indices;
+            test::make_sphere(16 + 24 * i, vertices, indices);
+
+            imported_mesh mesh;
+            mesh.name = "sphere";
+            for (const test::test_vertex& v : vertices)
+            {
+                mesh.positions.push_back({ v.position[0], v.position[1] + i, v.position[2] });
+            }
+            mesh.indices = indices;
+            model.meshes.push_back(mesh);
+        }
+
+        imported_node root;
+        root.name = "root";
+        root.meshes = { 0 };
+        root.children = { 1 };
+        root.local_transform = test::make_scale_translation({ 1.0f, 1.0f, 1.0f }, { 1.0f, 2.0f, 3.0f });
+
+        imported_node child;
+        child.name = "child";
+        child.meshes = { 1, 2 };
+
+        model.nodes = { root, child };
+        model.root_nodes = { 0 };
+        return model;
+    }
+
+    bool same_views(const cooked_model_view& a, const cooked_model_view& b)
+    {
+        if (a.meshes.size() != b.meshes.size() || a.nodes.size() != b.nodes.size() || a.root_nodes != b.root_nodes)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < a.meshes.size(); ++i)
+        {
+            const cooked_mesh_view& x = a.meshes[i];
+            const cooked_mesh_view& y = b.meshes[i];
+            if (x.format != y.format || x.vertex_stride != y.vertex_stride || x.num_vertices != y.num_vertices || x.index_size != y.index_size
+                || x.num_indices != y.num_indices || x.num_meshlets != y.num_meshlets || x.lods.size() != y.lods.size())
+            {
+                return false;
+            }
+            if (memcmp(x.vertices, y.vertices, size_t(x.num_vertices) * x.vertex_stride) != 0
+                || memcmp(x.indices, y.indices, size_t(x.num_indices) * x.index_size) != 0
+                || memcmp(x.meshlets, y.meshlets, x.num_meshlets * sizeof(meshlet)) != 0
+                || memcmp(&x.box, &y.box, sizeof(x.box)) != 0
+                || memcmp(&x.sphere, &y.sphere, sizeof(x.sphere)) != 0
+                || memcmp(&x.quantization, &y.quantization, sizeof(x.quantization)) != 0)
+            {
+                return false;
+            }
+            for (size_t l = 0; l < x.lods.size(); ++l)
+            {
+                if (x.lods[l].num_indices != y.lods[l].num_indices || x.lods[l].error != y.lods[l].error
+                    || memcmp(x.lods[l].indices, y.lods[l].indices, size_t(x.lods[l].num_indices) * x.index_size) != 0)
+                {
+                    return false;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < a.nodes.size(); ++i)
+        {
+            if (a.nodes[i].name != b.nodes[i].name || a.nodes[i].meshes != b.nodes[i].meshes || a.nodes[i].children != b.nodes[i].children
+                || memcmp(&a.nodes[i].local_transform, &b.nodes[i].local_transform, sizeof(float4x4)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+CERA_TEST(serialized_model_reads_back)
+{
+    imported_model model = make_model();
+
+    for (vertex_format format : { vertex_format::pos_color, vertex_format::packed_pos_color })
+    {
+        cooked_model cooked;
+        mesh_cooker::cook_model(model, format, nullptr, cooked);
+
+        blob data = mesh_cache_io::serialize(cooked);
+        CERA_CHECK(data.size() > sizeof(mesh_cache_file::header));
+
+        cooked_model_view view;
+        CERA_CHECK(mesh_cache_io::read(reinterpret_cast<const u8*>(data.data()), data.size(), view));
+        CERA_CHECK(same_views(mesh_cooker::get_view(cooked), view));
+
+        // Buffers are aligned relative to the start of the file.
+        bool aligned = true;
+        for (const cooked_mesh_view& mesh : view.meshes)
+        {
+            aligned &= (static_cast<const u8*>(mesh.vertices) - reinterpret_cast<const u8*>(data.data())) % mesh_cache_file::data_alignment == 0;
+            aligned &= (static_cast<const u8*>(mesh.indices) - reinterpret_cast<const u8*>(data.data())) % mesh_cache_file::data_alignment == 0;
+        }
+        CERA_CHECK(aligned);
+    }
+}
+
+CERA_TEST(corrupt_data_is_rejected)
+{
+    cooked_model cooked;
+    mesh_cooker::cook_model(make_model(), vertex_format::pos_color, nullptr, cooked);
+
+    blob data = mesh_cache_io::serialize(cooked);
+    const u8* bytes = reinterpret_cast<const u8*>(data.data());
+
+    cooked_model_view view;
+    CERA_CHECK(!mesh_cache_io::read(bytes, data.size() - 1, view));
+    CERA_CHECK(!mesh_cache_io::read(bytes, 10, view));
+    CERA_CHECK(!mesh_cache_io::read(bytes, 0, view));
+
+    // A flipped bit in the records fails the checksum.
+    blob flipped = data;
+    flipped[sizeof(mesh_cache_file::header) + 3] ^= std::byte{ 1 };
+    CERA_CHECK(!mesh_cache_io::read(reinterpret_cast<const u8*>(flipped.data()), flipped.size(), view));
+
+    // Caches of other versions are rejected.
+    blob other_version = data;
+    other_version[offsetof(mesh_cache_file::header, version)] = std::byte{ 0xff };
+    CERA_CHECK(!mesh_cache_io::read(reinterpret_cast<const u8*>(other_version.data()), other_version.size(), view));
+}
+
+CERA_TEST(cook_writes_a_mappable_cache)
+{
+    std::filesystem::path directory = get_test_directory();
+
+    {
+        std::ofstream obj(directory / "quad.obj", std::ios::binary);
+        obj << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\ng second\nf 1 3 4\n";
+    }
+
+    CERA_CHECK(mesh_cache_io::cook(directory / "quad.obj", directory / "quad.mcache", vertex_format::pos_color));
+
+    file_mapping mapping;
+    CERA_CHECK(mapping.open(directory / "quad.mcache"));
+
+    cooked_model_view view;
+    CERA_CHECK(mesh_cache_io::read(mapping.get_data(), mapping.get_size(), view));
+    CERA_CHECK(view.meshes.size() == 2);
+    if (view.meshes.size() == 2)
+    {
+        CERA_CHECK(view.meshes[0].num_indices == 6 && view.meshes[0].num_vertices == 4);
+        CERA_CHECK(view.meshes[1].num_indices == 3);
+    }
+
+    CERA_CHECK(!mesh_cache_io::cook(directory / "missing.obj", directory / "missing.mcache", vertex_format::pos_color));
+}
\ No newline at end of file
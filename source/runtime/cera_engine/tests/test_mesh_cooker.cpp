@@ -0,0 +1,599 @@
+#include "test.h"
+#include "test_geometry.h"
+
+#include "mesh_cooker.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet_builder.h"
+#include "vertex_encoder.h"
+#include "vertex_welder.h"
+#include "frustum_culler.h"
+#include "util/threading/thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <random>
+
+using namespace cera;
+using test::test_vertex;
+
+namespace
+{
+    using triangle = std::array<float, 9>;
+
+    // Triangles by the positions of their vertices, rotated to start at the smallest vertex and sorted.
+    // Two meshes with the same triangles and winding compare equal no matter how vertices and triangles are ordered.
+    std::vector<triangle> get_triangles(const std::vector<test_vertex>& vertices, const u32* indices, size_t numIndices)
+    {
+        std::vector<triangle> triangles;
+        for (size_t i = 0; i < numIndices; i += 3)
+        {
+            std::array<const float*, 3> corners = { vertices[indices[i]].position, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position };
+
+            u32 first = 0;
+            for (u32 k = 1; k < 3; ++k)
+            {
+                if (std::lexicographical_compare(corners[k], corners[k] + 3, corners[first], corners[first] + 3))
+                {
+                    first = k;
+                }
+            }
+
+            triangle t;
+            for (u32 k = 0; k < 3; ++k)
+            {
+                memcpy(&t[k * 3], corners[(first + k) % 3], 3 * sizeof(float));
+            }
+            triangles.push_back(t);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    std::vector<triangle> get_triangles(const std::vector<test_vertex>& vertices, const std::vector<u32>& indices)
+    {
+        return get_triangles(vertices, indices.data(), indices.size());
+    }
+
+    // Split every vertex into one vertex per triangle corner, the way unindexed source data arrives.
+    void unweld(std::vector<test_vertex>& vertices, std::vector<u32>& indices)
+    {
+        std::vector<test_vertex> split;
+        for (u32& index : indices)
+        {
+            split.push_back(vertices[index]);
+            index = static_cast<u32>(split.size() - 1);
+        }
+        vertices.swap(split);
+    }
+
+    // Sphere without the degenerate triangles at the poles.
+    void make_clean_sphere(u32 tessellation, std::vector<test_vertex>& vertices, std::vector<u32>& indices)
+    {
+        test::make_sphere(tessellation, vertices, indices);
+
+        vertex_welder welder;
+        welder_input input;
+        input.num_vertices = vertices.size();
+        input.attributes.push_back({ vertices.data(), sizeof(test_vertex), 3, 1e-6f });
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+
+        welder_result result;
+        welder.weld(input, result);
+        vertices.resize(result.num_vertices);
+        indices.resize(result.num_indices);
+    }
+
+    optimizer_input make_optimizer_input(std::vector<test_vertex>& vertices, std::vector<u32>& indices)
+    {
+        optimizer_input input;
+        input.vertices = vertices.data();
+        input.num_vertices = vertices.size();
+        input.vertex_stride = sizeof(test_vertex);
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+        return input;
+    }
+}
+
+CERA_TEST(welder_merges_duplicates)
+{
+    std::vector<test_vertex> vertices;
+    std::vector<u32> indices;
+    test::make_grid(32, vertices, indices);
+
+    auto expected = get_triangles(vertices, indices);
+    size_t num_vertices = vertices.size();
+
+    unweld(vertices, indices);
+
+    vertex_welder welder;
+    welder_input input;
+    input.num_vertices = vertices.size();
+    input.attributes.push_back({ &vertices[0].position, sizeof(test_vertex), 3, 0.0f });
+    input.attributes.push_back({ &vertices[0].color, sizeof(test_vertex), 3, 0.0f });
+    input.indices = indices.data();
+    input.num_indices = indices.size();
+
+    welder_result result;
+    CERA_CHECK(welder.weld(input, result));
+    CERA_CHECK(result.num_vertices == num_vertices);
+    CERA_CHECK(result.num_indices == indices.size());
+
+    vertices.resize(result.num_vertices);
+    CERA_CHECK(get_triangles(vertices, indices) == expected);
+    CERA_CHECK(welder.get_remap().size() == input.num_vertices);
+}
+
+CERA_TEST(welder_keeps_seams_and_removes_degenerates)
+{
+    // Two triangles sharing an edge, the shared vertices differ in color on one side.
+    std::vector<test_vertex> vertices = {
+        { { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+        { { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+        { { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+        { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+        { { 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+        { { 1.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+        // Within epsilon of vertex 0.
+        { { 0.0f, 0.0f, 1e-6f }, { 1.0f, 0.0f, 0.0f } },
+    };
+    std::vector<u32> indices = { 0, 1, 2, 3, 5, 4, 6, 0, 1 };
+
+    vertex_welder welder;
+    welder_input input;
+    input.num_vertices = vertices.size();
+    input.attributes.push_back({ &vertices[0].position, sizeof(test_vertex), 3, 1e-5f });
+    input.attributes.push_back({ &vertices[0].color, sizeof(test_vertex), 3, 0.0f });
+    input.indices = indices.data();
+    input.num_indices = indices.size();
+
+    welder_result result;
+    CERA_CHECK(welder.weld(input, result));
+    CERA_CHECK(result.num_vertices == 6);
+    // The third triangle collapses to a line.
+    CERA_CHECK(result.num_indices == 6);
+
+    // Out of range indices are rejected and leave the mesh untouched.
+    std::vector<u32> invalid = { 0, 1, 9 };
+    input.indices = invalid.data();
+    input.num_indices = invalid.size();
+    CERA_CHECK(!welder.weld(input, result));
+    CERA_CHECK(invalid[2] == 9);
+}
+
+CERA_TEST(optimizer_keeps_triangles_and_reduces_misses)
+{
+    std::vector<test_vertex> vertices;
+    std::vector<u32> indices;
+    test::make_sphere(64, vertices, indices);
+
+    // Shuffle vertices and triangles.
+    std::mt19937 rng(1);
+    std::vector<u32> permutation(vertices.size());
+    for (u32 i = 0; i < permutation.size(); ++i)
+    {
+        permutation[i] = i;
+    }
+    std::shuffle(permutation.begin(), permutation.end(), rng);
+
+    std::vector<test_vertex> shuffled_vertices(vertices.size());
+    for (u32 i = 0; i < vertices.size(); ++i)
+    {
+        shuffled_vertices[permutation[i]] = vertices[i];
+    }
+
+    std::vector<u32> triangle_order(indices.size() / 3);
+    for (u32 i = 0; i < triangle_order.size(); ++i)
+    {
+        triangle_order[i] = i;
+    }
+    std::shuffle(triangle_order.begin(), triangle_order.end(), rng);
+
+    std::vector<u32> shuffled_indices;
+    for (u32 t : triangle_order)
+    {
+        for (u32 k = 0; k < 3; ++k)
+        {
+            shuffled_indices.push_back(permutation[indices[t * 3 + k]]);
+        }
+    }
+
+    auto expected = get_triangles(shuffled_vertices, shuffled_indices);
+
+    mesh_optimizer optimizer;
+    mesh_optimizer_statistics before;
+    mesh_optimizer_statistics after;
+    CERA_CHECK(optimizer.optimize(make_optimizer_input(shuffled_vertices, shuffled_indices), &before, &after));
+
+    CERA_CHECK(get_triangles(shuffled_vertices, shuffled_indices) == expected);
+    CERA_CHECK(after.acmr < before.acmr);
+    CERA_CHECK(after.acmr < 1.0f);
+    CERA_CHECK(after.overfetch < before.overfetch);
+
+    // Invalid input is rejected.
+    std::vector<test_vertex> few(3);
+    std::vector<u32> invalid = { 0, 1, 5 };
+    CERA_CHECK(!optimizer.optimize(make_optimizer_input(few, invalid)));
+}
+
+CERA_TEST(batch_optimization_is_deterministic)
+{
+    std::vector<std::vector<test_vertex>> vertices(16);
+    std::vector<std::vector<u32>> indices(16);
+    std::vector<optimizer_input> inputs;
+    for (u32 i = 0; i < 16; ++i)
+    {
+        test::make_sphere(16 + i, vertices[i], indices[i]);
+        inputs.push_back(make_optimizer_input(vertices[i], indices[i]));
+    }
+
+    auto threaded_vertices = vertices;
+    auto threaded_indices = indices;
+    std::vector<optimizer_input> threaded_inputs;
+    for (u32 i = 0; i < 16; ++i)
+    {
+        threaded_inputs.push_back(make_optimizer_input(threaded_vertices[i], threaded_indices[i]));
+    }
+
+    threading::thread_pool pool(3);
+    mesh_optimizer::optimize(inputs, mesh_optimizer_settings(), nullptr);
+    mesh_optimizer::optimize(threaded_inputs, mesh_optimizer_settings(), &pool);
+
+    CERA_CHECK(indices == threaded_indices);
+}
+
+CERA_TEST(simplifier_reduces_triangles)
+{
+    std::vector<test_vertex> vertices;
+    std::vector<u32> indices;
+    make_clean_sphere(48, vertices, indices);
+
+    simplifier_input input;
+    input.vertices = vertices.data();
+    input.num_vertices = vertices.size();
+    input.vertex_stride = sizeof(test_vertex);
+    input.position_offset = offsetof(test_vertex, position);
+    input.attribute_offset = offsetof(test_vertex, color);
+    input.num_attributes = 3;
+    input.indices = indices.data();
+    input.num_indices = indices.size();
+
+    mesh_simplifier simplifier;
+    std::vector<simplified_lod> lods;
+    CERA_CHECK(simplifier.generate_lods(input, { 0.5f, 0.25f, 0.125f }, lods));
+    CERA_CHECK(!lods.empty());
+
+    size_t previous_count = indices.size();
+    float previous_error = 0.0f;
+    bool valid = true;
+    for (const simplified_lod& lod : lods)
+    {
+        valid &= lod.indices.size() % 3 == 0 && !lod.indices.empty();
+        valid &= lod.indices.size() < previous_count;
+        valid &= lod.error >= previous_error;
+        for (u32 index : lod.indices)
+        {
+            valid &= index < vertices.size();
+        }
+
+        previous_count = lod.indices.size();
+        previous_error = lod.error;
+    }
+    CERA_CHECK(valid);
+    CERA_CHECK(lods[0].indices.size() <= indices.size() * 6 / 10);
+}
+
+CERA_TEST(meshlets_cover_the_mesh)
+{
+    std::vector<test_vertex> vertices;
+    std::vector<u32> indices;
+    make_clean_sphere(64, vertices, indices);
+    mesh_optimizer().optimize(make_optimizer_input(vertices, indices));
+
+    auto expected = get_triangles(vertices, indices);
+
+    meshlet_builder_input input;
+    input.vertices = vertices.data();
+    input.num_vertices = vertices.size();
+    input.vertex_stride = sizeof(test_vertex);
+    input.indices = indices.data();
+    input.num_indices = indices.size();
+
+    meshlet_builder_settings settings;
+    std::vector<meshlet> meshlets;
+    CERA_CHECK(meshlet_builder(settings).build(input, meshlets));
+    CERA_CHECK(get_triangles(vertices, indices) == expected);
+
+    u32 next_index = 0;
+    bool contiguous = true;
+    bool within_limits = true;
+    bool bounded = true;
+    for (const meshlet& m : meshlets)
+    {
+        contiguous &= m.first_index == next_index;
+        next_index += m.index_count;
+
+        std::vector<u32> used(indices.begin() + m.first_index, indices.begin() + m.first_index + m.index_count);
+        std::sort(used.begin(), used.end());
+        used.erase(std::unique(used.begin(), used.end()), used.end());
+
+        within_limits &= used.size() == m.vertex_count && m.vertex_count <= settings.max_vertices && m.index_count / 3 <= settings.max_triangles;
+
+        for (u32 v : used)
+        {
+            float dx = vertices[v].position[0] - m.sphere.center.x;
+            float dy = vertices[v].position[1] - m.sphere.center.y;
+            float dz = vertices[v].position[2] - m.sphere.center.z;
+            bounded &= std::sqrt(dx * dx + dy * dy + dz * dz) <= m.sphere.radius * 1.0001f + 1e-6f;
+        }
+    }
+    CERA_CHECK(contiguous && next_index == indices.size());
+    CERA_CHECK(within_limits);
+    CERA_CHECK(bounded);
+
+    // Looking at the sphere from outside, meshlets on the far side face away.
+    float3 camera = { 0.0f, 0.0f, -5.0f };
+    frustum frustum = frustum::from_view_projection(multiply(test::make_look_at(camera, { 0.0f, 0.0f, 0.0f }), test::make_perspective(1.0f, 1.0f, 0.1f, 100.0f)));
+
+    std::vector<meshlet_index_range> ranges;
+    u32 num_backfacing = 0;
+    u32 num_visible = cull_meshlets(meshlets, camera, frustum, ranges, num_backfacing);
+    CERA_CHECK(num_backfacing > 0);
+    CERA_CHECK(num_visible > 0 && num_visible + num_backfacing <= meshlets.size());
+    CERA_CHECK(!ranges.empty());
+}
+
+CERA_TEST(encoder_error_bounds)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+    constexpr size_t count = 1001;
+
+    struct input_vertex
+    {
+        float position[3];
+        float normal[3];
+        float color[3];
+    };
+
+    struct packed_vertex
+    {
+        u16 position[4];
+        s16 normal[2];
+        u32 color;
+    };
+
+    std::vector<input_vertex> input(count);
+    for (input_vertex& v : input)
+    {
+        float length = 0.0f;
+        do
+        {
+            for (u32 a = 0; a < 3; ++a)
+            {
+                v.normal[a] = uniform(rng);
+            }
+            length = std::sqrt(v.normal[0] * v.normal[0] + v.normal[1] * v.normal[1] + v.normal[2] * v.normal[2]);
+        } while (length < 1e-3f || length > 1.0f);
+
+        for (u32 a = 0; a < 3; ++a)
+        {
+            v.position[a] = uniform(rng) * (a == 1 ? 3.0f : 100.0f) + 5.0f;
+            v.normal[a] /= length;
+            v.color[a] = uniform(rng) * 0.5f + 0.5f;
+        }
+    }
+
+    std::vector<packed_vertex> output(count);
+    position_quantization quantization = vertex_encoder::compute_position_quantization(input[0].position, count, sizeof(input_vertex));
+    vertex_encoder::encode_positions_unorm16(input[0].position, count, sizeof(input_vertex), quantization, output[0].position, sizeof(packed_vertex));
+    vertex_encoder::encode_directions_octahedral(input[0].normal, count, sizeof(input_vertex), output[0].normal, sizeof(packed_vertex));
+    vertex_encoder::encode_colors_rgba8(input[0].color, count, sizeof(input_vertex), 3, &output[0].color, sizeof(packed_vertex));
+
+    double max_position_error = 0.0;
+    double max_angle = 0.0;
+    double max_color_error = 0.0;
+    bool opaque = true;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float position[3];
+        vertex_encoder::decode_position_unorm16(output[i].position, quantization, position);
+
+        float normal[3];
+        vertex_encoder::decode_direction_octahedral(output[i].normal, normal);
+
+        double dot = 0.0;
+        for (u32 a = 0; a < 3; ++a)
+        {
+            max_position_error = std::max(max_position_error, std::fabs(double(position[a]) - input[i].position[a]) / quantization.scale[a]);
+            dot += double(normal[a]) * input[i].normal[a];
+        }
+        max_angle = std::max(max_angle, std::acos(std::min(dot, 1.0)) * 180.0 / 3.14159265358979);
+
+        u8 color[4];
+        memcpy(color, &output[i].color, sizeof(color));
+        for (u32 a = 0; a < 3; ++a)
+        {
+            max_color_error = std::max(max_color_error, std::fabs(color[a] / 255.0 - input[i].color[a]));
+        }
+        opaque &= color[3] == 255;
+    }
+
+    // Bounds documented in vertex_encoder.h, with some room for float rounding.
+    CERA_CHECK(max_position_error <= 1.0 / 131070.0 + 1e-5);
+    CERA_CHECK(max_angle <= 0.04);
+    CERA_CHECK(max_color_error <= 1.0 / 510.0 + 1e-6);
+    CERA_CHECK(opaque);
+}
+
+CERA_TEST(cook_mesh_produces_gpu_ready_buffers)
+{
+    for (vertex_format format : { vertex_format::pos_color, vertex_format::packed_pos_color })
+    {
+        std::vector<test_vertex> vertices;
+        std::vector<u32> indices;
+        test::make_sphere(32, vertices, indices);
+        unweld(vertices, indices);
+
+        cooker_input input;
+        input.vertices = vertices.data();
+        input.num_vertices = vertices.size();
+        input.vertex_stride = sizeof(test_vertex);
+        input.position_offset = offsetof(test_vertex, position);
+        input.color_offset = offsetof(test_vertex, color);
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+
+        cooked_mesh mesh;
+        CERA_CHECK(mesh_cooker::cook_mesh(input, format, false, mesh));
+
+        CERA_CHECK(mesh.format == format);
+        // Welded back to the shared vertices of the sphere, the cooker welds exactly so seams stay split.
+        CERA_CHECK(mesh.num_vertices <= 33 * 65);
+        CERA_CHECK(mesh.vertices.size() == size_t(mesh.num_vertices) * mesh.vertex_stride);
+        CERA_CHECK(mesh.index_size == sizeof(u16));
+        CERA_CHECK(mesh.indices.size() % (3 * mesh.index_size) == 0);
+        CERA_CHECK(!mesh.lods.empty());
+        CERA_CHECK(!mesh.meshlets.empty());
+
+        CERA_CHECK(std::fabs(mesh.box.max.y - 1.0f) < 1e-4f && std::fabs(mesh.box.min.y + 1.0f) < 1e-4f);
+        CERA_CHECK(mesh.sphere.radius >= 1.0f - 1e-4f);
+
+        bool in_range = true;
+        for (size_t i = 0; i < mesh.indices.size(); i += sizeof(u16))
+        {
+            u16 index;
+            memcpy(&index, mesh.indices.data() + i, sizeof(u16));
+            in_range &= index < mesh.num_vertices;
+        }
+        CERA_CHECK(in_range);
+
+        cooked_mesh_view view = mesh_cooker::get_view(mesh);
+        CERA_CHECK(view.num_indices * mesh.index_size == mesh.indices.size());
+        CERA_CHECK(view.lods.size() == mesh.lods.size());
+        CERA_CHECK(view.num_meshlets == mesh.meshlets.size());
+    }
+
+    cooked_mesh mesh;
+    cooker_input empty;
+    CERA_CHECK(!mesh_cooker::cook_mesh(empty, vertex_format::pos_color, false, mesh));
+}
+
+CERA_TEST(large_meshes_use_32_bit_indices)
+{
+    // Tessellation 180 has 181 * 361 = 65341 vertices, 181 has 182 * 363 = 66066.
+    cooked_mesh meshes[2];
+    for (u32 i = 0; i < 2; ++i)
+    {
+        std::vector<test_vertex> vertices;
+        std::vector<u32> indices;
+        test::make_sphere(180 + i, vertices, indices);
+
+        cooker_input input;
+        input.vertices = vertices.data();
+        input.num_vertices = vertices.size();
+        input.vertex_stride = sizeof(test_vertex);
+        input.position_offset = offsetof(test_vertex, position);
+        input.color_offset = offsetof(test_vertex, color);
+        input.indices = indices.data();
+        input.num_indices = indices.size();
+
+        CERA_CHECK(mesh_cooker::cook_mesh(input, vertex_format::packed_pos_color, false, meshes[i]));
+    }
+
+    const cooked_mesh& small = meshes[0];
+    const cooked_mesh& large = meshes[1];
+    CERA_CHECK(small.num_vertices <= 0xFFFF && small.index_size == sizeof(u16));
+    CERA_CHECK(large.num_vertices > 0xFFFF && large.index_size == sizeof(u32));
+
+    // Indices beyond the 16 bit range are kept, levels of detail use the index size of the mesh.
+    auto in_range = [&large](const blob& indices)
+    {
+        bool result = indices.size() % sizeof(u32) == 0;
+        for (size_t i = 0; i < indices.size(); i += sizeof(u32))
+        {
+            u32 index;
+            memcpy(&index, indices.data() + i, sizeof(u32));
+            result &= index < large.num_vertices;
+        }
+        return result;
+    };
+
+    u32 max_index = 0;
+    for (size_t i = 0; i < large.indices.size(); i += sizeof(u32))
+    {
+        u32 index;
+        memcpy(&index, large.indices.data() + i, sizeof(u32));
+        max_index = std::max(max_index, index);
+    }
+    CERA_CHECK(in_range(large.indices));
+    CERA_CHECK(max_index > 0xFFFF);
+
+    bool lods_in_range = !large.lods.empty();
+    for (const cooked_lod& lod : large.lods)
+    {
+        lods_in_range &= in_range(lod.indices);
+    }
+    CERA_CHECK(lods_in_range);
+
+    // Crossing the limit doubles the memory per index.
+    size_t small_num_indices = small.indices.size() / sizeof(u16);
+    size_t large_num_indices = large.indices.size() / sizeof(u32);
+    CERA_CHECK(small.indices.size() * large_num_indices * 2 == large.indices.size() * small_num_indices);
+    CERA_CHECK(large.indices.size() - large_num_indices * sizeof(u16) == large_num_indices * 2);
+
+    cooked_mesh_view view = mesh_cooker::get_view(large);
+    CERA_CHECK(view.index_size == sizeof(u32) && view.num_indices == large_num_indices);
+}
+
+CERA_TEST(cook_model_is_deterministic)
+{
+    imported_model model;
+    for (u32 i = 0; i < 8; ++i)
+    {
+        std::vector<test_vertex> vertices;
+        std::vector<u32> indices;
+        test::make_sphere(12 + i * 4, vertices, indices);
+
+        imported_mesh mesh;
+        for (const test_vertex& v : vertices)
+        {
+            mesh.positions.push_back({ v.position[0], v.position[1], v.position[2] });
+        }
+        mesh.indices = indices;
+        mesh.color = { 0.5f, 0.25f * i, 1.0f };
+        model.meshes.push_back(mesh);
+    }
+
+    imported_node root;
+    for (u32 i = 0; i < model.meshes.size(); ++i)
+    {
+        root.meshes.push_back(i);
+    }
+    model.nodes.push_back(root);
+    model.root_nodes.push_back(0);
+
+    threading::thread_pool pool(3);
+    cooked_model serial;
+    cooked_model threaded;
+    mesh_cooker::cook_model(model, vertex_format::packed_pos_color, nullptr, serial);
+    mesh_cooker::cook_model(model, vertex_format::packed_pos_color, &pool, threaded);
+
+    CERA_CHECK(serial.meshes.size() == model.meshes.size());
+    CERA_CHECK(serial.nodes.size() == 1 && serial.root_nodes.size() == 1);
+
+    bool same = true;
+    for (size_t i = 0; i < serial.meshes.size(); ++i)
+    {
+        same &= serial.meshes[i].vertices == threaded.meshes[i].vertices;
+        same &= serial.meshes[i].indices == threaded.meshes[i].indices;
+        same &= serial.meshes[i].lods.size() == threaded.meshes[i].lods.size();
+    }
+    CERA_CHECK(same);
+}
\ No newline at end of file
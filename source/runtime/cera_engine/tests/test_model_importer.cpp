@@ -0,0 +1,418 @@
+#include "test.h"
+
+#include "model_importer.h"
+#include "util/json_document.h"
+#include "util/threading/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace cera;
+
+namespace
+{
+    std::filesystem::path get_test_directory()
+    {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "cera_test_model_importer";
+        std::filesystem::create_directories(directory);
+        return directory;
+    }
+
+    void write_file(const std::filesystem::path& path, const std::string& content)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+    }
+
+    void append_u32(std::string& s, u32 value)
+    {
+        s.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    bool same_meshes(const imported_model& a, const imported_model& b)
+    {
+        if (a.meshes.size() != b.meshes.size())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < a.meshes.size(); ++i)
+        {
+            const imported_mesh& x = a.meshes[i];
+            const imported_mesh& y = b.meshes[i];
+            if (x.name != y.name || x.indices != y.indices || x.positions.size() != y.positions.size() || x.normals.size() != y.normals.size())
+            {
+                return false;
+            }
+            if (memcmp(x.positions.data(), y.positions.data(), x.positions.size() * sizeof(float3)) != 0
+                || memcmp(x.normals.data(), y.normals.data(), x.normals.size() * sizeof(float3)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Height field of n x n quads split into groups of rows, odd rows use relative indices so chunks have to be stitched.
+    std::string make_obj(int n, int numGroups)
+    {
+        std::string text;
+        char line[256];
+
+        int rows_per_group = (n + numGroups - 1) / numGroups;
+        int num_vertices = 0;
+        for (int row = 0; row < n; ++row)
+        {
+            if (row % rows_per_group == 0)
+            {
+                snprintf(line, sizeof(line), "g part_%d\r\n", row / rows_per_group);
+                text += line;
+            }
+
+            if (row == 0)
+            {
+                for (int column = 0; column <= n; ++column)
+                {
+                    snprintf(line, sizeof(line), "v %.6f 0 0\nvn 0 1 0\n", column * 0.01f);
+                    text += line;
+                    ++num_vertices;
+                }
+            }
+
+            for (int column = 0; column <= n; ++column)
+            {
+                float height = std::sin(column * 0.1f) * std::cos(row * 0.1f);
+                snprintf(line, sizeof(line), "v %.6f %.6e %.6f\nvn %.5f %.5f %.5f\n", column * 0.01f, height, (row + 1) * 0.01f, -height * 0.3f, 0.9f, height * 0.2f);
+                text += line;
+                ++num_vertices;
+            }
+            text += "# row\n";
+
+            int first = num_vertices - 2 * (n + 1);
+            for (int column = 0; column < n; ++column)
+            {
+                int a = first + column;
+                int b = a + 1;
+                int d = a + n + 1;
+                int e = d + 1;
+                if (row & 1)
+                {
+                    snprintf(line, sizeof(line), "f %d//%d %d//%d %d//%d %d//%d\n", a - num_vertices, a - num_vertices, d - num_vertices, d - num_vertices, e - num_vertices, e - num_vertices, b - num_vertices, b - num_vertices);
+                }
+                else
+                {
+                    snprintf(line, sizeof(line), "f %d/1/%d %d/1/%d %d/1/%d %d/1/%d\n", a + 1, a + 1, d + 1, d + 1, e + 1, e + 1, b + 1, b + 1);
+                }
+                text += line;
+            }
+        }
+        return text;
+    }
+
+    // Buffer of a quad with interleaved positions and normals, 16-bit indices and 8-bit indices of one triangle.
+    std::string make_gltf_buffer()
+    {
+        const float vertices[4][6] = { { 0, 0, 0, 0, 0, 1 }, { 1, 0, 0, 0, 0, 1 }, { 1, 1, 0, 0, 0, 1 }, { 0, 1, 0, 0, 0, 1 } };
+        const u16 indices16[6] = { 0, 1, 2, 2, 3, 0 };
+        const u8 indices8[3] = { 0, 2, 3 };
+
+        std::string buffer;
+        buffer.append(reinterpret_cast<const char*>(vertices), sizeof(vertices));
+        buffer.append(reinterpret_cast<const char*>(indices16), sizeof(indices16));
+        buffer.append(reinterpret_cast<const char*>(indices8), sizeof(indices8));
+        while (buffer.size() % 4 != 0)
+        {
+            buffer.push_back(0);
+        }
+        return buffer;
+    }
+
+    std::string make_gltf_json(const std::string& bufferDefinition)
+    {
+        return R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[0]}],
+            "nodes":[{"name":"root","children":[1,2],"translation":[1,2,3]},
+                     {"name":"a","mesh":0,"rotation":[0,0.7071068,0,0.7071068],"scale":[2,2,2]},
+                     {"name":"b","mesh":1,"matrix":[1,0,0,0,0,1,0,0,0,0,1,0,5,6,7,1]}],
+            "meshes":[{"name":"quad","primitives":[{"attributes":{"POSITION":0,"NORMAL":1},"indices":2,"material":0},{"attributes":{"POSITION":0},"indices":3}]},
+                      {"name":"lines","primitives":[{"attributes":{"POSITION":0},"mode":1}]}],
+            "materials":[{"pbrMetallicRoughness":{"baseColorFactor":[0.5,0.25,1,1]}}],
+            "accessors":[{"bufferView":0,"componentType":5126,"count":4,"type":"VEC3"},
+                         {"bufferView":0,"byteOffset":12,"componentType":5126,"count":4,"type":"VEC3"},
+                         {"bufferView":1,"componentType":5123,"count":6,"type":"SCALAR"},
+                         {"bufferView":2,"componentType":5121,"count":3,"type":"SCALAR"}],
+            "bufferViews":[{"buffer":0,"byteOffset":0,"byteLength":96,"byteStride":24},{"buffer":0,"byteOffset":96,"byteLength":12},{"buffer":0,"byteOffset":108,"byteLength":3}],
+            "buffers":[)" + bufferDefinition + "]}";
+    }
+
+    std::string make_glb(std::string json, const std::string& buffer)
+    {
+        while (json.size() % 4 != 0)
+        {
+            json.push_back(' ');
+        }
+
+        std::string glb;
+        append_u32(glb, 0x46546C67);
+        append_u32(glb, 2);
+        append_u32(glb, static_cast<u32>(12 + 8 + json.size() + 8 + buffer.size()));
+        append_u32(glb, static_cast<u32>(json.size()));
+        append_u32(glb, 0x4E4F534A);
+        glb += json;
+        append_u32(glb, static_cast<u32>(buffer.size()));
+        append_u32(glb, 0x004E4942);
+        glb += buffer;
+        return glb;
+    }
+
+    std::string replace(std::string text, const std::string& from, const std::string& to)
+    {
+        size_t position = text.find(from);
+        if (position != std::string::npos)
+        {
+            text.replace(position, from.size(), to);
+        }
+        return text;
+    }
+}
+
+CERA_TEST(json_document_parses_and_rejects)
+{
+    json_document document;
+    CERA_CHECK(document.parse(R"({"a":[1,2.5e2,-3],"b":{"c":"x\"y","d":true,"e":null},"f":[]})"));
+
+    const json_value* a = document.find_member(document.get_root(), "a");
+    CERA_CHECK(a && a->num_children == 3);
+    CERA_CHECK(a && document.get_element(*a, 1)->number == 250.0);
+
+    const json_value* b = document.find_member(document.get_root(), "b");
+    CERA_CHECK(b && document.get_string(*b, "c") == "x\\\"y");
+    CERA_CHECK(b && document.find_member(*b, "d")->boolean);
+    CERA_CHECK(document.get_number(document.get_root(), "missing", 4.0) == 4.0);
+
+    CERA_CHECK(!document.parse(R"({"a":1,})"));
+    CERA_CHECK(!document.parse("[1 2]"));
+    CERA_CHECK(!document.parse(R"({"a":1} x)"));
+}
+
+CERA_TEST(obj_groups_and_relative_indices)
+{
+    const char* text =
+        "# comment\r\nmtllib x.mtl\r\no first\r\n"
+        "v 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\nv 0 1 0\r\nvt 0 0\r\nvn 0 0 1\r\n"
+        "f 1//1 2//1 3//1 4//1\r\n"
+        "g second\r\nf -4 -2 -1\r\n"
+        "g empty\r\n"
+        "g third\r\nusemtl m\r\nf 1/1 2/1 3/1\r\n  \t\r\n";
+
+    model_importer importer;
+    imported_model model;
+    CERA_CHECK(importer.parse_obj(text, strlen(text), model));
+
+    CERA_CHECK(model.meshes.size() == 3);
+    if (model.meshes.size() == 3)
+    {
+        CERA_CHECK(model.meshes[0].name == "first");
+        CERA_CHECK(model.meshes[0].indices.size() == 6);
+        CERA_CHECK(model.meshes[0].positions.size() == 4 && model.meshes[0].normals.size() == 4);
+
+        CERA_CHECK(model.meshes[1].name == "second");
+        CERA_CHECK(model.meshes[1].normals.empty());
+        CERA_CHECK(model.meshes[1].positions[0].x == 0.0f && model.meshes[1].positions[1].x == 1.0f && model.meshes[1].positions[2].y == 1.0f);
+
+        CERA_CHECK(model.meshes[2].name == "third");
+    }
+    CERA_CHECK(model.nodes.size() == 1 && model.root_nodes.size() == 1 && model.nodes[0].meshes.size() == 3);
+
+    const char* out_of_range = "v 0 0 0\nf 1 2 3\n";
+    CERA_CHECK(!importer.parse_obj(out_of_range, strlen(out_of_range), model));
+
+    const char* bad_number = "v 0 x 0\n";
+    CERA_CHECK(!importer.parse_obj(bad_number, strlen(bad_number), model));
+}
+
+CERA_TEST(obj_chunks_stitch_like_a_single_pass)
+{
+    std::string text = make_obj(300, 7);
+
+    threading::thread_pool pool(3);
+    model_importer serial;
+    model_importer parallel(&pool);
+
+    imported_model a;
+    imported_model b;
+    CERA_CHECK(serial.parse_obj(text.data(), text.size(), a));
+    CERA_CHECK(parallel.parse_obj(text.data(), text.size(), b));
+
+    CERA_CHECK(same_meshes(a, b));
+    CERA_CHECK(a.meshes.size() == 7);
+    CERA_CHECK(a.get_num_triangles() == 300u * 300u * 2u);
+
+    bool in_range = true;
+    for (const imported_mesh& mesh : a.meshes)
+    {
+        for (u32 index : mesh.indices)
+        {
+            in_range &= index < mesh.positions.size();
+        }
+    }
+    CERA_CHECK(in_range);
+}
+
+CERA_TEST(obj_numbers_match_strtof)
+{
+    std::string text;
+    std::vector<float> expected;
+
+    char line[128];
+    u32 x = 1;
+    for (u32 i = 0; i < 30000; ++i)
+    {
+        x = x * 1664525u + 1013904223u;
+        double value = ((x >> 8) / 16777216.0 - 0.5) * std::pow(10.0, static_cast<int>(x % 13) - 6);
+        snprintf(line, sizeof(line), "v %.9g %.7e %.3f\n", value, value, value);
+        text += line;
+        expected.push_back(strtof(line + 2, nullptr));
+    }
+    for (size_t i = 0; i + 2 < expected.size(); i += 3)
+    {
+        snprintf(line, sizeof(line), "f %zu %zu %zu\n", i + 1, i + 2, i + 3);
+        text += line;
+    }
+
+    model_importer importer;
+    imported_model model;
+    CERA_CHECK(importer.parse_obj(text.data(), text.size(), model));
+    CERA_CHECK(model.meshes.size() == 1 && model.meshes[0].positions.size() == expected.size());
+
+    // Vertices are created in the order the faces reference them.
+    u32 max_ulp = 0;
+    for (size_t i = 0; i < model.meshes[0].positions.size() && i < expected.size(); ++i)
+    {
+        s32 a;
+        s32 b;
+        memcpy(&a, &model.meshes[0].positions[i].x, sizeof(a));
+        memcpy(&b, &expected[i], sizeof(b));
+        max_ulp = std::max(max_ulp, static_cast<u32>(std::abs(a - b)));
+    }
+    CERA_CHECK(max_ulp <= 1);
+}
+
+CERA_TEST(gltf_binary_external_and_embedded_buffers)
+{
+    std::filesystem::path directory = get_test_directory();
+    std::string buffer = make_gltf_buffer();
+    std::string json = make_gltf_json(R"({"byteLength":111})");
+    std::string glb = make_glb(json, buffer);
+
+    write_file(directory / "quad.glb", glb);
+
+    threading::thread_pool pool(2);
+    model_importer importer(&pool);
+
+    imported_model model;
+    CERA_CHECK(importer.load(directory / "quad.glb", model));
+    CERA_CHECK(model.meshes.size() == 2);
+    if (model.meshes.size() == 2)
+    {
+        const imported_mesh& quad = model.meshes[0];
+        CERA_CHECK(quad.indices.size() == 6 && quad.normals.size() == 4);
+        CERA_CHECK(quad.normals[2].z == 1.0f && quad.positions[2].y == 1.0f);
+        CERA_CHECK(quad.color.y == 0.25f);
+
+        CERA_CHECK(model.meshes[1].indices == std::vector<u32>({ 0, 2, 3 }));
+        CERA_CHECK(model.meshes[1].normals.empty());
+        CERA_CHECK(model.meshes[1].color.x == 1.0f);
+    }
+
+    CERA_CHECK(model.nodes.size() == 3);
+    CERA_CHECK(model.root_nodes == std::vector<u32>({ 0 }));
+    if (model.nodes.size() == 3)
+    {
+        CERA_CHECK(model.nodes[0].children == std::vector<u32>({ 1, 2 }));
+        CERA_CHECK(model.nodes[1].meshes == std::vector<u32>({ 0, 1 }));
+        // Lines are skipped.
+        CERA_CHECK(model.nodes[2].meshes.empty());
+
+        CERA_CHECK(model.nodes[0].local_transform.m[3][2] == 3.0f);
+        CERA_CHECK(model.nodes[2].local_transform.m[3][0] == 5.0f);
+
+        // 90 degrees about y, scaled by 2: the x axis turns into -z.
+        const auto& rotation = model.nodes[1].local_transform.m;
+        CERA_CHECK(std::fabs(rotation[0][2] + 2.0f) < 1e-4f && std::fabs(rotation[2][0] - 2.0f) < 1e-4f);
+    }
+
+    CERA_CHECK(importer.get_statistics().num_bytes == glb.size());
+    CERA_CHECK(importer.get_statistics().num_triangles == 3);
+
+    // The same buffer in an external file.
+    write_file(directory / "quad.bin", buffer);
+    std::string external = make_gltf_json(R"({"uri":"quad.bin","byteLength":111})");
+    write_file(directory / "external.gltf", external);
+
+    imported_model external_model;
+    CERA_CHECK(importer.load(directory / "external.gltf", external_model));
+    CERA_CHECK(same_meshes(model, external_model));
+    CERA_CHECK(importer.get_statistics().num_bytes == external.size() + buffer.size());
+
+    // The same buffer as a data uri.
+    static const char* base64_digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string base64;
+    for (size_t i = 0; i < buffer.size(); i += 3)
+    {
+        u32 value = static_cast<u8>(buffer[i]) << 16;
+        value |= i + 1 < buffer.size() ? static_cast<u8>(buffer[i + 1]) << 8 : 0;
+        value |= i + 2 < buffer.size() ? static_cast<u8>(buffer[i + 2]) : 0;
+
+        base64 += base64_digits[(value >> 18) & 63];
+        base64 += base64_digits[(value >> 12) & 63];
+        base64 += i + 1 < buffer.size() ? base64_digits[(value >> 6) & 63] : '=';
+        base64 += i + 2 < buffer.size() ? base64_digits[value & 63] : '=';
+    }
+    write_file(directory / "embedded.gltf", make_gltf_json(R"({"uri":"data:application/octet-stream;base64,)" + base64 + R"(","byteLength":111})"));
+
+    imported_model embedded_model;
+    CERA_CHECK(importer.load(directory / "embedded.gltf", embedded_model));
+    CERA_CHECK(same_meshes(model, embedded_model));
+}
+
+CERA_TEST(gltf_rejects_malformed_documents)
+{
+    std::filesystem::path directory = get_test_directory();
+    std::string buffer = make_gltf_buffer();
+    std::string json = make_gltf_json(R"({"byteLength":111})");
+
+    model_importer importer;
+    imported_model model;
+
+    // Accessor reads past the end of its buffer view.
+    std::string too_many = make_glb(replace(json, R"("count":6)", R"("count":9)"), buffer);
+    CERA_CHECK(!importer.parse_gltf(reinterpret_cast<const u8*>(too_many.data()), too_many.size(), directory, model));
+
+    // Counts that are fractional, negative, not finite or too large for the view.
+    bool rejects_counts = true;
+    for (const char* count : { R"("count":3.5)", R"("count":-1)", R"("count":1e300)", R"("count":9007199254740991)" })
+    {
+        std::string invalid = make_glb(replace(json, R"("count":6)", count), buffer);
+        rejects_counts &= !importer.parse_gltf(reinterpret_cast<const u8*>(invalid.data()), invalid.size(), directory, model);
+    }
+    CERA_CHECK(rejects_counts);
+
+    // Interleaved elements that overlap.
+    std::string overlapping = make_glb(replace(json, R"("byteStride":24)", R"("byteStride":8)"), buffer);
+    CERA_CHECK(!importer.parse_gltf(reinterpret_cast<const u8*>(overlapping.data()), overlapping.size(), directory, model));
+
+    // A node that is its own sibling.
+    std::string cycle = make_glb(replace(json, R"("children":[1,2])", R"("children":[1,1])"), buffer);
+    CERA_CHECK(!importer.parse_gltf(reinterpret_cast<const u8*>(cycle.data()), cycle.size(), directory, model));
+
+    std::string truncated = make_glb(json, buffer).substr(0, 40);
+    CERA_CHECK(!importer.parse_gltf(reinterpret_cast<const u8*>(truncated.data()), truncated.size(), directory, model));
+
+    CERA_CHECK(!importer.load(directory / "missing.obj", model));
+    CERA_CHECK(model.meshes.empty());
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "test.h"
+#include "test_geometry.h"
+
+#include "occlusion_culler.h"
+#include "util/threading/thread_pool.h"
+
+#include <cstring>
+#include <random>
+
+using namespace cera;
+
+namespace
+{
+    occluder_geometry make_cube()
+    {
+        occluder_geometry cube;
+        for (u32 i = 0; i < 8; ++i)
+        {
+            cube.positions.push_back({ (i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f });
+        }
+
+        const u32 faces[6][4] = { { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 } };
+        for (const auto& face : faces)
+        {
+            for (u32 index : { face[0], face[1], face[2], face[0], face[2], face[3] })
+            {
+                cube.indices.push_back(index);
+            }
+        }
+        return cube;
+    }
+
+    bounding_box make_box(const float3& center, float halfSize)
+    {
+        return { { center.x - halfSize, center.y - halfSize, center.z - halfSize }, { center.x + halfSize, center.y + halfSize, center.z + halfSize } };
+    }
+
+    const float4x4 view_projection = test::make_perspective(1.2f, 2.0f, 0.1f, 500.0f);
+}
+
+CERA_TEST(wall_hides_boxes_behind_it)
+{
+    occlusion_culler culler(256, 128);
+    CERA_CHECK(culler.get_width() == 256 && culler.get_height() == 128);
+
+    culler.begin_frame(view_projection);
+    // A wall of 40 x 40 at distance 20.
+    culler.add_occluder(make_cube(), test::make_scale_translation({ 40.0f, 40.0f, 1.0f }, { 0.0f, 0.0f, 20.0f }));
+    culler.rasterize();
+
+    CERA_CHECK(culler.get_num_triangles() > 0);
+
+    CERA_CHECK(!culler.is_visible(make_box({ 0.0f, 0.0f, 40.0f }, 1.0f)));
+    CERA_CHECK(!culler.is_visible(make_box({ 5.0f, -3.0f, 100.0f }, 2.0f)));
+    CERA_CHECK(culler.is_visible(make_box({ 0.0f, 0.0f, 10.0f }, 1.0f)));
+    // Beside the wall.
+    CERA_CHECK(culler.is_visible(make_box({ 200.0f, 0.0f, 100.0f }, 5.0f)));
+    // Crosses the near plane.
+    CERA_CHECK(culler.is_visible(make_box({ 0.0f, 0.0f, 0.0f }, 1.0f)));
+}
+
+CERA_TEST(empty_depth_buffer_hides_nothing)
+{
+    occlusion_culler culler(100, 50);
+    // The resolution is rounded up to whole tiles.
+    CERA_CHECK(culler.get_width() == 128 && culler.get_height() == 64);
+
+    culler.begin_frame(view_projection);
+    culler.rasterize();
+
+    CERA_CHECK(culler.get_num_triangles() == 0);
+    CERA_CHECK(culler.is_visible(make_box({ 0.0f, 0.0f, 400.0f }, 1.0f)));
+
+    const float* depth = culler.get_depth_buffer();
+    bool cleared = true;
+    for (u32 i = 0; i < culler.get_width() * culler.get_height(); ++i)
+    {
+        cleared &= depth[i] == 1.0f;
+    }
+    CERA_CHECK(cleared);
+}
+
+CERA_TEST(threaded_rasterization_is_identical)
+{
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> x(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> y(-15.0f, 15.0f);
+    std::uniform_real_distribution<float> z(3.0f, 60.0f);
+    std::uniform_real_distribution<float> size(1.0f, 12.0f);
+
+    occluder_geometry cube = make_cube();
+    std::vector<float4x4> occluders;
+    for (u32 i = 0; i < 128; ++i)
+    {
+        occluders.push_back(test::make_scale_translation({ size(rng), size(rng), 0.5f }, { x(rng), y(rng), z(rng) }));
+    }
+    // A floor that crosses the near plane is clipped.
+    occluders.push_back(test::make_scale_translation({ 200.0f, 0.1f, 200.0f }, { 0.0f, -3.0f, 0.0f }));
+
+    occlusion_culler single(256, 128);
+    single.begin_frame(view_projection);
+    for (const float4x4& world : occluders)
+    {
+        single.add_occluder(cube, world);
+    }
+    single.rasterize();
+
+    threading::thread_pool pool(3);
+    occlusion_culler threaded(256, 128);
+    threaded.begin_frame(view_projection);
+    for (const float4x4& world : occluders)
+    {
+        threaded.add_occluder(cube, world);
+    }
+    threaded.rasterize(&pool);
+
+    CERA_CHECK(single.get_num_triangles() == threaded.get_num_triangles());
+    CERA_CHECK(memcmp(single.get_depth_buffer(), threaded.get_depth_buffer(), 256 * 128 * sizeof(float)) == 0);
+
+    u32 num_covered = 0;
+    for (u32 i = 0; i < 256 * 128; ++i)
+    {
+        num_covered += single.get_depth_buffer()[i] < 1.0f ? 1 : 0;
+    }
+    CERA_CHECK(num_covered > 0 && num_covered < 256 * 128);
+}
+
+CERA_TEST(visibility_is_conservative)
+{
+    occlusion_culler culler(256, 128);
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> x(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> y(-15.0f, 15.0f);
+    std::uniform_real_distribution<float> z(5.0f, 120.0f);
+    std::uniform_real_distribution<float> size(0.3f, 3.0f);
+
+    culler.begin_frame(view_projection);
+    occluder_geometry cube = make_cube();
+    for (u32 i = 0; i < 64; ++i)
+    {
+        culler.add_occluder(cube, test::make_scale_translation({ size(rng) * 4.0f, size(rng) * 4.0f, 0.5f }, { x(rng), y(rng), z(rng) * 0.5f }));
+    }
+    culler.rasterize();
+
+    // Cast a ray through every pixel center the box covers, the box is visible when a ray hits it in front of the depth buffer.
+    u32 width = culler.get_width();
+    u32 height = culler.get_height();
+    const float* depth = culler.get_depth_buffer();
+
+    auto is_visible_brute_force = [&](const bounding_box& box)
+    {
+        for (u32 py = 0; py < height; ++py)
+        {
+            for (u32 px = 0; px < width; ++px)
+            {
+                float ndc_x = ((px + 0.5f) / width) * 2.0f - 1.0f;
+                float ndc_y = 1.0f - ((py + 0.5f) / height) * 2.0f;
+                float3 direction = { ndc_x / view_projection.m[0][0], ndc_y / view_projection.m[1][1], 1.0f };
+
+                float view_z;
+                if (!intersect_ray(box, { 0.0f, 0.0f, 0.0f }, direction, 1e9f, view_z))
+                {
+                    continue;
+                }
+
+                float z_ndc = (view_z * view_projection.m[2][2] + view_projection.m[3][2]) / view_z;
+                if (z_ndc <= depth[py * width + px])
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    u32 num_hidden = 0;
+    u32 num_wrongly_culled = 0;
+    for (u32 i = 0; i < 300; ++i)
+    {
+        float s = size(rng) * 0.3f;
+        bounding_box box = make_box({ x(rng), y(rng), z(rng) }, s);
+
+        bool visible = culler.is_visible(box);
+        num_hidden += visible ? 0 : 1;
+        num_wrongly_culled += !visible && is_visible_brute_force(box) ? 1 : 0;
+    }
+
+    CERA_CHECK(num_hidden > 0);
+    CERA_CHECK(num_wrongly_culled == 0);
+}
\ No newline at end of file
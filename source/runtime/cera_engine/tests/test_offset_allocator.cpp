@@ -0,0 +1,115 @@
+#include "test.h"
+
+#include "render/offset_allocator.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace cera;
+
+CERA_TEST(allocations_merge_when_freed)
+{
+    offset_allocator allocator(100);
+
+    u32 a = allocator.allocate(10);
+    u32 b = allocator.allocate(20);
+    u32 c = allocator.allocate(30);
+
+    CERA_CHECK(a == 0 && b == 10 && c == 30);
+    CERA_CHECK(allocator.get_num_free() == 40);
+    CERA_CHECK(!allocator.has_space(41));
+    CERA_CHECK(allocator.allocate(41) == offset_allocator::invalid_offset);
+
+    allocator.free(b, 20);
+    CERA_CHECK(allocator.get_num_free_ranges() == 2);
+
+    // The smallest range that fits is used.
+    CERA_CHECK(allocator.allocate(15) == 10);
+
+    allocator.free(10, 15);
+    allocator.free(a, 10);
+    allocator.free(c, 30);
+    CERA_CHECK(allocator.get_num_free() == 100);
+    CERA_CHECK(allocator.get_num_free_ranges() == 1);
+
+    // Empty ranges take no space.
+    CERA_CHECK(allocator.allocate(0) == 0);
+    CERA_CHECK(allocator.get_num_free() == 100);
+}
+
+CERA_TEST(random_allocations_match_a_bitmap)
+{
+    constexpr u32 size = 10000;
+
+    std::mt19937 rng(7);
+    offset_allocator allocator(size);
+    std::vector<u8> used(size, 0);
+    std::vector<std::pair<u32, u32>> live;
+
+    auto largest_free_run = [&used]()
+    {
+        u32 run = 0;
+        u32 largest = 0;
+        for (u8 u : used)
+        {
+            run = u ? 0 : run + 1;
+            largest = std::max(largest, run);
+        }
+        return largest;
+    };
+
+    bool overlaps = false;
+    bool out_of_range = false;
+    bool missed_space = false;
+    bool wrong_free_count = false;
+
+    for (u32 iteration = 0; iteration < 50000; ++iteration)
+    {
+        if (live.empty() || rng() % 2)
+        {
+            u32 allocation_size = 1 + rng() % 200;
+            u32 offset = allocator.allocate(allocation_size);
+            if (offset == offset_allocator::invalid_offset)
+            {
+                missed_space |= largest_free_run() >= allocation_size;
+                continue;
+            }
+
+            out_of_range |= offset + allocation_size > size;
+            for (u32 i = offset; i < offset + allocation_size && i < size; ++i)
+            {
+                overlaps |= used[i] != 0;
+                used[i] = 1;
+            }
+            live.push_back({ offset, allocation_size });
+        }
+        else
+        {
+            size_t index = rng() % live.size();
+            auto range = live[index];
+            live[index] = live.back();
+            live.pop_back();
+
+            allocator.free(range.first, range.second);
+            std::fill(used.begin() + range.first, used.begin() + range.first + range.second, 0);
+        }
+
+        if (iteration % 997 == 0)
+        {
+            u32 num_free = static_cast<u32>(std::count(used.begin(), used.end(), 0));
+            wrong_free_count |= num_free != allocator.get_num_free();
+        }
+    }
+
+    CERA_CHECK(!overlaps);
+    CERA_CHECK(!out_of_range);
+    CERA_CHECK(!missed_space);
+    CERA_CHECK(!wrong_free_count);
+
+    for (const auto& range : live)
+    {
+        allocator.free(range.first, range.second);
+    }
+    CERA_CHECK(allocator.get_num_free() == size);
+    CERA_CHECK(allocator.get_num_free_ranges() == 1);
+}
\ No newline at end of file
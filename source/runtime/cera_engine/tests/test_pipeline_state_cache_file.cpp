@@ -0,0 +1,134 @@
+#include "test.h"
+
+#include "render/pipeline_state_cache_file.h"
+#include "util/hash.h"
+
+#include <cstddef>
+#include <filesystem>
+
+using namespace cera;
+
+namespace
+{
+    pipeline_state_cache_file make_file()
+    {
+        pipeline_state_cache_file file;
+        file.device_id = 0x0123456789abcdefull;
+        file.entries = { 1, 0xffffffffffffffffull, 42 };
+        for (u32 i = 0; i < 1000; ++i)
+        {
+            file.library.push_back(static_cast<std::byte>(i * 7));
+        }
+        return file;
+    }
+
+    bool same_files(const pipeline_state_cache_file& a, const pipeline_state_cache_file& b)
+    {
+        return a.device_id == b.device_id && a.entries == b.entries && a.library == b.library;
+    }
+}
+
+CERA_TEST(serialized_cache_reads_back)
+{
+    pipeline_state_cache_file file = make_file();
+
+    blob data = pipeline_state_cache_io::serialize(file);
+    CERA_CHECK(data.size() == sizeof(pipeline_state_cache_file::header) + file.entries.size() * sizeof(u64) + file.library.size());
+
+    pipeline_state_cache_file result;
+    CERA_CHECK(pipeline_state_cache_io::deserialize(data, result));
+    CERA_CHECK(same_files(file, result));
+
+    // An empty cache is valid as well.
+    pipeline_state_cache_file empty;
+    CERA_CHECK(pipeline_state_cache_io::deserialize(pipeline_state_cache_io::serialize(empty), result));
+    CERA_CHECK(same_files(empty, result));
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "cera_test_pipeline_state_cache_file";
+    std::filesystem::create_directories(directory);
+
+    std::wstring path = (directory / "pipelines.cache").wstring();
+    CERA_CHECK(pipeline_state_cache_io::save(path, file));
+    CERA_CHECK(pipeline_state_cache_io::load(path, result));
+    CERA_CHECK(same_files(file, result));
+
+    CERA_CHECK(!pipeline_state_cache_io::load((directory / "missing.cache").wstring(), result));
+}
+
+CERA_TEST(other_magic_or_version_is_rejected)
+{
+    blob data = pipeline_state_cache_io::serialize(make_file());
+    pipeline_state_cache_file result;
+
+    blob other_magic = data;
+    other_magic[offsetof(pipeline_state_cache_file::header, magic)] ^= std::byte{ 0xff };
+    CERA_CHECK(!pipeline_state_cache_io::deserialize(other_magic, result));
+
+    blob other_version = data;
+    other_version[offsetof(pipeline_state_cache_file::header, version)] = std::byte{ 0xff };
+    CERA_CHECK(!pipeline_state_cache_io::deserialize(other_version, result));
+}
+
+CERA_TEST(wrong_checksum_is_rejected)
+{
+    pipeline_state_cache_file file = make_file();
+    blob data = pipeline_state_cache_io::serialize(file);
+    pipeline_state_cache_file result;
+
+    // A flipped bit in the entries, the library or the checksum itself.
+    for (size_t offset : { sizeof(pipeline_state_cache_file::header) + 3, data.size() - 1, offsetof(pipeline_state_cache_file::header, checksum) })
+    {
+        blob flipped = data;
+        flipped[offset] ^= std::byte{ 1 };
+        CERA_CHECK(!pipeline_state_cache_io::deserialize(flipped, result));
+    }
+
+    // The device id is covered too, a library is only valid for the adapter that created it.
+    blob other_device = data;
+    other_device[offsetof(pipeline_state_cache_file::header, device_id)] ^= std::byte{ 1 };
+    CERA_CHECK(!pipeline_state_cache_io::deserialize(other_device, result));
+
+    // Failed reads leave the output untouched.
+    CERA_CHECK(same_files(result, pipeline_state_cache_file()));
+}
+
+CERA_TEST(truncated_data_is_rejected)
+{
+    blob data = pipeline_state_cache_io::serialize(make_file());
+    pipeline_state_cache_file result;
+
+    bool rejected = true;
+    for (size_t size : { size_t(0), size_t(10), sizeof(pipeline_state_cache_file::header), sizeof(pipeline_state_cache_file::header) + 12, data.size() - 1 })
+    {
+        rejected &= !pipeline_state_cache_io::deserialize(blob(data.begin(), data.begin() + size), result);
+    }
+    CERA_CHECK(rejected);
+
+    // Trailing bytes do not belong to the library.
+    blob extended = data;
+    extended.push_back(std::byte{ 0 });
+    CERA_CHECK(!pipeline_state_cache_io::deserialize(extended, result));
+
+    // An entry count that overflows the size computation.
+    blob huge_count = data;
+    for (size_t i = 0; i < sizeof(u64); ++i)
+    {
+        huge_count[offsetof(pipeline_state_cache_file::header, entry_count) + i] = std::byte{ 0xff };
+    }
+    CERA_CHECK(!pipeline_state_cache_io::deserialize(huge_count, result));
+}
+
+CERA_TEST(fnv1a_is_stable)
+{
+    // Published 64-bit FNV-1a test vectors, cache keys on disk depend on these values.
+    CERA_CHECK(hash::fnv1a("") == 0xcbf29ce484222325ull);
+    CERA_CHECK(hash::fnv1a("a") == 0xaf63dc4c8601ec8cull);
+    CERA_CHECK(hash::fnv1a("foobar") == 0x85944171f73967e8ull);
+
+    // Hashing in parts continues from the seed.
+    CERA_CHECK(hash::fnv1a(std::string_view("bar"), hash::fnv1a("foo")) == hash::fnv1a("foobar"));
+
+    // Values are hashed by their little endian bytes.
+    CERA_CHECK(hash::fnv1a_value(u32(0x64636261)) == hash::fnv1a("abcd"));
+    CERA_CHECK(hash::combine(hash::fnv1a("a"), hash::fnv1a("b")) != hash::combine(hash::fnv1a("b"), hash::fnv1a("a")));
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "test.h"
+
+#include "render/pipeline_state_cache.h"
+
+#include <climits>
+
+using namespace cera;
+
+namespace
+{
+    const u8 vertex_shader[] = { 0x44, 0x58, 0x42, 0x43, 0x01, 0x02, 0x03, 0x04 };
+    const u8 pixel_shader[] = { 0x44, 0x58, 0x42, 0x43, 0x05, 0x06, 0x07, 0x08 };
+
+    const D3D12_INPUT_ELEMENT_DESC input_elements[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+    };
+
+    D3D12_RT_FORMAT_ARRAY make_render_target_formats()
+    {
+        D3D12_RT_FORMAT_ARRAY formats = {};
+        formats.NumRenderTargets = 1;
+        formats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        return formats;
+    }
+
+    // Only the subobjects the demo sets, in an order that differs from CD3DX12_PIPELINE_STATE_STREAM1.
+    struct sparse_pipeline_state_stream
+    {
+        CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS rtv_formats;
+        CD3DX12_PIPELINE_STATE_STREAM_PS ps;
+        CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT input_layout;
+        CD3DX12_PIPELINE_STATE_STREAM_VS vs;
+        CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT dsv_format;
+    };
+
+    sparse_pipeline_state_stream make_sparse_stream(const u8* vertexShader, size_t vertexShaderSize)
+    {
+        sparse_pipeline_state_stream stream;
+        stream.rtv_formats = make_render_target_formats();
+        stream.ps = CD3DX12_SHADER_BYTECODE(pixel_shader, sizeof(pixel_shader));
+        stream.input_layout = D3D12_INPUT_LAYOUT_DESC{ input_elements, _countof(input_elements) };
+        stream.vs = CD3DX12_SHADER_BYTECODE(vertexShader, vertexShaderSize);
+        stream.dsv_format = DXGI_FORMAT_D32_FLOAT;
+        return stream;
+    }
+}
+
+CERA_TEST(normalized_stream_has_the_same_key)
+{
+    sparse_pipeline_state_stream stream = make_sparse_stream(vertex_shader, sizeof(vertex_shader));
+    D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(stream), &stream };
+
+    pipeline_state_hash original = hash_pipeline_state_stream(desc);
+
+    // The copy is what the cache compiles, stores in and loads from the pipeline library.
+    pipeline_state_stream_copy copy(desc);
+    CERA_CHECK(copy.is_valid());
+
+    pipeline_state_hash normalized = hash_pipeline_state_stream(copy.get_desc());
+    CERA_CHECK(original.value == normalized.value);
+    CERA_CHECK(original.persistent && normalized.persistent);
+
+    // The copy owns its memory, the key does not change when the caller's stream goes away.
+    stream = make_sparse_stream(pixel_shader, sizeof(pixel_shader));
+    CERA_CHECK(hash_pipeline_state_stream(copy.get_desc()).value == original.value);
+    CERA_CHECK(hash_pipeline_state_stream(desc).value != original.value);
+}
+
+CERA_TEST(explicit_defaults_have_the_same_key)
+{
+    sparse_pipeline_state_stream sparse = make_sparse_stream(vertex_shader, sizeof(vertex_shader));
+    D3D12_PIPELINE_STATE_STREAM_DESC sparse_desc = { sizeof(sparse), &sparse };
+
+    struct explicit_pipeline_state_stream
+    {
+        CD3DX12_PIPELINE_STATE_STREAM_VS vs;
+        CD3DX12_PIPELINE_STATE_STREAM_PS ps;
+        CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT input_layout;
+        CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY topology;
+        CD3DX12_PIPELINE_STATE_STREAM_BLEND_DESC blend;
+        CD3DX12_PIPELINE_STATE_STREAM_RASTERIZER rasterizer;
+        CD3DX12_PIPELINE_STATE_STREAM_SAMPLE_MASK sample_mask;
+        CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT dsv_format;
+        CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS rtv_formats;
+    } full;
+    full.vs = CD3DX12_SHADER_BYTECODE(vertex_shader, sizeof(vertex_shader));
+    full.ps = CD3DX12_SHADER_BYTECODE(pixel_shader, sizeof(pixel_shader));
+    full.input_layout = D3D12_INPUT_LAYOUT_DESC{ input_elements, _countof(input_elements) };
+    full.topology = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    full.blend = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+    full.rasterizer = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    full.sample_mask = UINT_MAX;
+    full.dsv_format = DXGI_FORMAT_D32_FLOAT;
+    full.rtv_formats = make_render_target_formats();
+    D3D12_PIPELINE_STATE_STREAM_DESC full_desc = { sizeof(full), &full };
+
+    CERA_CHECK(hash_pipeline_state_stream(sparse_desc).value == hash_pipeline_state_stream(full_desc).value);
+
+    // A state that differs from the default changes the key.
+    full.rasterizer = CD3DX12_RASTERIZER_DESC(D3D12_FILL_MODE_WIREFRAME, D3D12_CULL_MODE_BACK, FALSE, 0, 0.0f, 0.0f, TRUE, FALSE, FALSE, 0, D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF);
+    CERA_CHECK(hash_pipeline_state_stream(sparse_desc).value != hash_pipeline_state_stream(full_desc).value);
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "test.h"
+
+#include "render/render_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace cera;
+
+CERA_TEST(sort_key_round_trips_fields)
+{
+    u64 key = sort_key::make(3, 17, 1234, 40000, 2.5f);
+
+    CERA_CHECK(sort_key::get_pass(key) == 3);
+    CERA_CHECK(sort_key::get_root_signature(key) == 17);
+    CERA_CHECK(sort_key::get_pipeline_state(key) == 1234);
+    CERA_CHECK(sort_key::get_material(key) == 40000);
+
+    u64 changed = sort_key::set_material(key, 7);
+    CERA_CHECK(sort_key::get_material(changed) == 7);
+    CERA_CHECK(sort_key::get_pass(changed) == 3);
+    CERA_CHECK(sort_key::get_root_signature(changed) == 17);
+    CERA_CHECK(sort_key::get_pipeline_state(changed) == 1234);
+    CERA_CHECK((changed & ((1ull << sort_key::material_shift) - 1)) == (key & ((1ull << sort_key::material_shift) - 1)));
+
+    // Identifiers are truncated to the width of their field and do not spill into the neighbours.
+    u64 truncated = sort_key::make(0, 0, (1u << sort_key::pipeline_state_bits) + 5, 0, 0.0f);
+    CERA_CHECK(sort_key::get_pipeline_state(truncated) == 5);
+    CERA_CHECK(sort_key::get_root_signature(truncated) == 0);
+
+    // The level of detail has its own field, it does not change the material and sorts before the depth.
+    u64 with_lod = sort_key::set_lod(key, 3);
+    CERA_CHECK(sort_key::get_lod(key) == 0);
+    CERA_CHECK(sort_key::get_lod(with_lod) == 3);
+    CERA_CHECK(sort_key::get_material(with_lod) == 40000);
+    CERA_CHECK(sort_key::set_lod(sort_key::make(0, 0, 0, 1, 1000.0f), 0) < sort_key::set_lod(sort_key::make(0, 0, 0, 1, 1.0f), 1));
+    CERA_CHECK(sort_key::get_lod(sort_key::set_lod(key, 100)) == (1u << sort_key::lod_bits) - 1);
+}
+
+CERA_TEST(sort_key_orders_depth_front_to_back)
+{
+    CERA_CHECK(sort_key::quantize_depth(0.5f) < sort_key::quantize_depth(0.6f));
+    CERA_CHECK(sort_key::quantize_depth(1.0f) < sort_key::quantize_depth(2.0f));
+    CERA_CHECK(sort_key::quantize_depth(100.0f) < sort_key::quantize_depth(1000.0f));
+
+    CERA_CHECK(sort_key::quantize_depth(-1.0f) == 0);
+    CERA_CHECK(sort_key::quantize_depth(0.0f) == 0);
+    CERA_CHECK(sort_key::quantize_depth(std::nanf("")) == 0);
+    CERA_CHECK(sort_key::quantize_depth(1e30f) < (1u << sort_key::depth_bits));
+}
+
+CERA_TEST(sort_matches_stable_sort)
+{
+    std::mt19937_64 rng(1);
+
+    for (size_t count : { 0, 1, 2, 7, 1000, 100000 })
+    {
+        render_queue queue;
+        std::vector<std::pair<u64, u32>> reference;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            u64 key = sort_key::make(rng() % 2, rng() % 3, rng() % 40, rng() % 300, (rng() % 1000) / 10.0f);
+            // Some keys use all 64 bits so every radix pass is exercised.
+            if (i % 5 == 0)
+            {
+                key = rng();
+            }
+
+            draw_packet packet;
+            packet.start_instance = static_cast<u32>(i);
+            queue.submit(key, packet);
+
+            reference.push_back({ key, static_cast<u32>(i) });
+        }
+
+        queue.sort();
+
+        std::stable_sort(reference.begin(), reference.end(), [](const auto& a, const auto& b)
+        {
+            return a.first < b.first;
+        });
+
+        CERA_CHECK(queue.size() == count);
+
+        bool same = true;
+        for (size_t i = 0; i < count; ++i)
+        {
+            same &= queue.get_sort_key(i) == reference[i].first;
+            same &= queue.get_packet(i).start_instance == reference[i].second;
+        }
+        CERA_CHECK(same);
+        CERA_CHECK(queue.get_stats().num_packets == count);
+        CERA_CHECK(queue.get_stats().num_state_changes_sorted <= queue.get_stats().num_state_changes_unsorted);
+    }
+}
+
+CERA_TEST(sort_is_stable_for_equal_keys)
+{
+    render_queue queue;
+
+    for (u32 i = 0; i < 300; ++i)
+    {
+        draw_packet packet;
+        packet.start_instance = i;
+        queue.submit(sort_key::make(0, 0, i % 3, 0, 1.0f), packet);
+    }
+
+    queue.sort();
+
+    bool stable = true;
+    for (size_t i = 1; i < queue.size(); ++i)
+    {
+        if (queue.get_sort_key(i) == queue.get_sort_key(i - 1))
+        {
+            stable &= queue.get_packet(i).start_instance > queue.get_packet(i - 1).start_instance;
+        }
+    }
+    CERA_CHECK(stable);
+    CERA_CHECK(queue.get_stats().num_state_changes_sorted == 2);
+}
+
+CERA_TEST(cull_removes_invisible_packets)
+{
+    render_queue queue;
+    std::vector<u8> visibility;
+
+    for (u32 i = 0; i < 10; ++i)
+    {
+        draw_packet packet;
+        packet.start_instance = i;
+        queue.submit(sort_key::make(0, 0, 0, 10 - i, 1.0f), packet);
+
+        visibility.push_back(i % 2);
+    }
+
+    queue.cull(visibility);
+    CERA_CHECK(queue.size() == 5);
+
+    queue.sort();
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        CERA_CHECK(queue.get_packet(i).start_instance % 2 == 1);
+    }
+    // Material ids decrease with the submission index, sorting reverses the order.
+    CERA_CHECK(queue.get_packet(0).start_instance == 9);
+
+    queue.clear();
+    CERA_CHECK(queue.empty());
+}
+
+CERA_TEST(instance_batches_cover_runs_of_equal_state)
+{
+    render_queue queue;
+
+    // Three materials, the last one drawn at two levels of detail.
+    for (u32 i = 0; i < 40; ++i)
+    {
+        draw_packet packet;
+        packet.transform_index = i;
+        packet.lod = i % 4 == 3 ? 1 : 0;
+        queue.submit(sort_key::set_lod(sort_key::make(0, 0, 0, std::min(i % 4, 2u), static_cast<float>(i)), packet.lod), packet);
+    }
+
+    queue.sort();
+
+    std::vector<instance_batch> batches = { instance_batch() };
+    queue.build_instance_batches(batches);
+
+    CERA_CHECK(batches.size() == 4);
+
+    bool contiguous = true;
+    bool same_state = true;
+    u32 next_instance = 0;
+    for (const instance_batch& batch : batches)
+    {
+        contiguous &= batch.start_instance == next_instance && batch.instance_count == 10;
+        for (u32 i = batch.start_instance; i < batch.start_instance + batch.instance_count; ++i)
+        {
+            same_state &= queue.get_packet(i).lod == batch.lod;
+            same_state &= (queue.get_sort_key(i) & sort_key::state_mask) == (queue.get_sort_key(batch.start_instance) & sort_key::state_mask);
+        }
+        next_instance += batch.instance_count;
+    }
+    CERA_CHECK(contiguous && next_instance == queue.size());
+    CERA_CHECK(same_state);
+
+    queue.clear();
+    queue.build_instance_batches(batches);
+    CERA_CHECK(batches.empty());
+}
\ No newline at end of file
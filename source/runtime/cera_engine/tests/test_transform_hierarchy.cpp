@@ -0,0 +1,302 @@
+#include "test.h"
+
+#include "transform_hierarchy.h"
+#include "util/threading/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+
+using namespace cera;
+
+namespace
+{
+    float4x4 make_translation(float x, float y, float z)
+    {
+        float4x4 m = float4x4::identity();
+        m.m[3][0] = x;
+        m.m[3][1] = y;
+        m.m[3][2] = z;
+        return m;
+    }
+
+    bool nearly_equal(const float4x4& a, const float4x4& b, float tolerance = 1e-4f)
+    {
+        for (u32 row = 0; row < 4; ++row)
+        {
+            for (u32 column = 0; column < 4; ++column)
+            {
+                if (std::fabs(a.m[row][column] - b.m[row][column]) > tolerance)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool identical(const float4x4& a, const float4x4& b)
+    {
+        return memcmp(&a, &b, sizeof(float4x4)) == 0;
+    }
+
+    // Random forest, parents are always created before their children.
+    std::vector<transform_hierarchy::handle> build_forest(transform_hierarchy& hierarchy, u32 count, u32 seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<transform_hierarchy::handle> handles;
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            float4x4 local = make_translation((i % 7) * 0.1f, 0.0f, 0.0f);
+            local.m[0][1] = 0.01f * (i % 3);
+
+            transform_hierarchy::handle parent = i < 16 ? transform_hierarchy::invalid_handle : handles[rng() % handles.size()];
+            handles.push_back(hierarchy.create(local, parent));
+        }
+
+        return handles;
+    }
+
+    // World transform computed by walking up the parents.
+    float4x4 reference_world_transform(const transform_hierarchy& hierarchy, transform_hierarchy::handle node)
+    {
+        float4x4 world = hierarchy.get_local_transform(node);
+        for (auto parent = hierarchy.get_parent(node); parent != transform_hierarchy::invalid_handle; parent = hierarchy.get_parent(parent))
+        {
+            world = multiply(world, hierarchy.get_local_transform(parent));
+        }
+        return world;
+    }
+}
+
+CERA_TEST(world_transforms_combine_parents)
+{
+    transform_hierarchy hierarchy;
+
+    auto root = hierarchy.create(make_translation(1.0f, 0.0f, 0.0f));
+    auto child = hierarchy.create(make_translation(0.0f, 2.0f, 0.0f), root);
+    auto grandchild = hierarchy.create(make_translation(0.0f, 0.0f, 3.0f), child);
+
+    CERA_CHECK(hierarchy.needs_update());
+
+    // Outdated transforms are computed on request before the update.
+    CERA_CHECK(nearly_equal(hierarchy.get_world_transform(grandchild), make_translation(1.0f, 2.0f, 3.0f)));
+
+    hierarchy.update();
+    CERA_CHECK(!hierarchy.needs_update());
+    CERA_CHECK(nearly_equal(hierarchy.get_world_transform(grandchild), make_translation(1.0f, 2.0f, 3.0f)));
+
+    hierarchy.set_local_transform(root, make_translation(5.0f, 0.0f, 0.0f));
+    CERA_CHECK(hierarchy.needs_update());
+    hierarchy.update();
+    CERA_CHECK(nearly_equal(hierarchy.get_world_transform(grandchild), make_translation(5.0f, 2.0f, 3.0f)));
+    CERA_CHECK(hierarchy.size() == 3);
+}
+
+CERA_TEST(destroy_and_reparent_keep_handles_valid)
+{
+    transform_hierarchy hierarchy;
+
+    auto a = hierarchy.create(make_translation(1.0f, 0.0f, 0.0f));
+    auto b = hierarchy.create(make_translation(0.0f, 1.0f, 0.0f), a);
+    auto c = hierarchy.create(make_translation(0.0f, 0.0f, 1.0f), b);
+    auto d = hierarchy.create(make_translation(10.0f, 0.0f, 0.0f));
+    hierarchy.update();
+
+    // Children of a destroyed node become roots.
+    hierarchy.destroy(b);
+    hierarchy.update();
+    CERA_CHECK(hierarchy.size() == 3);
+    CERA_CHECK(hierarchy.get_parent(c) == transform_hierarchy::invalid_handle);
+    CERA_CHECK(nearly_equal(hierarchy.get_world_transform(c), make_translation(0.0f, 0.0f, 1.0f)));
+
+    // The parent is stored after the child until the storage is reordered.
+    hierarchy.set_parent(a, d);
+    hierarchy.set_parent(c, a);
+    hierarchy.update();
+    CERA_CHECK(nearly_equal(hierarchy.get_world_transform(c), make_translation(11.0f, 0.0f, 1.0f)));
+
+    // Destroyed handles are reused.
+    auto e = hierarchy.create(make_translation(0.0f, 0.0f, 0.0f), c);
+    hierarchy.update();
+    CERA_CHECK(e == b);
+    CERA_CHECK(nearly_equal(hierarchy.get_world_transform(e), make_translation(11.0f, 0.0f, 1.0f)));
+}
+
+CERA_TEST(destroy_only_releases_its_own_children)
+{
+    transform_hierarchy hierarchy;
+    std::vector<transform_hierarchy::handle> handles = build_forest(hierarchy, 2000, 11);
+    hierarchy.update();
+
+    std::vector<transform_hierarchy::handle> parents;
+    for (auto handle : handles)
+    {
+        parents.push_back(hierarchy.get_parent(handle));
+    }
+
+    // Destroy every third node and move some of the others to another parent first.
+    std::mt19937 rng(13);
+    for (u32 i = 0; i < handles.size(); ++i)
+    {
+        if (i % 5 == 1)
+        {
+            u32 parent = rng() % i;
+            if (handles[parent] != transform_hierarchy::invalid_handle)
+            {
+                hierarchy.set_parent(handles[i], handles[parent]);
+                parents[i] = handles[parent];
+            }
+        }
+
+        if (i % 3 == 0)
+        {
+            hierarchy.destroy(handles[i]);
+
+            for (auto& parent : parents)
+            {
+                parent = parent == handles[i] ? transform_hierarchy::invalid_handle : parent;
+            }
+            handles[i] = transform_hierarchy::invalid_handle;
+        }
+    }
+
+    hierarchy.update();
+    CERA_CHECK(hierarchy.size() == 2000 - 667);
+
+    // Storage was reordered, children of destroyed nodes are roots and their world transforms were recomputed.
+    bool parents_match = true;
+    bool world_matches = true;
+    for (u32 i = 0; i < handles.size(); ++i)
+    {
+        if (handles[i] != transform_hierarchy::invalid_handle)
+        {
+            parents_match &= hierarchy.get_parent(handles[i]) == parents[i];
+            world_matches &= nearly_equal(hierarchy.get_world_transform(handles[i]), reference_world_transform(hierarchy, handles[i]));
+        }
+    }
+    CERA_CHECK(parents_match);
+    CERA_CHECK(world_matches);
+
+    // Tearing down the rest in creation order leaves an empty hierarchy.
+    for (auto handle : handles)
+    {
+        if (handle != transform_hierarchy::invalid_handle)
+        {
+            hierarchy.destroy(handle);
+        }
+    }
+    hierarchy.update();
+    CERA_CHECK(hierarchy.size() == 0);
+}
+
+CERA_TEST(inverse_world_transform)
+{
+    transform_hierarchy hierarchy;
+
+    float4x4 local = make_translation(1.0f, 2.0f, 3.0f);
+    local.m[0][0] = 2.0f;
+    auto root = hierarchy.create(local);
+    auto child = hierarchy.create(make_translation(0.0f, 1.0f, 0.0f), root);
+    hierarchy.update();
+
+    CERA_CHECK(nearly_equal(multiply(hierarchy.get_world_transform(child), hierarchy.get_inverse_world_transform(child)), float4x4::identity()));
+
+    // The cached inverse follows changes of the parent.
+    hierarchy.set_local_transform(root, make_translation(-4.0f, 0.0f, 0.0f));
+    hierarchy.update();
+    CERA_CHECK(nearly_equal(hierarchy.get_inverse_world_transform(child), make_translation(4.0f, -1.0f, 0.0f)));
+
+    float4x4 singular = {};
+    float4x4 result = float4x4::identity();
+    CERA_CHECK(!inverse(singular, result));
+    CERA_CHECK(identical(result, float4x4::identity()));
+}
+
+CERA_TEST(update_matches_reference)
+{
+    transform_hierarchy hierarchy;
+    auto handles = build_forest(hierarchy, 5000, 1);
+    hierarchy.update();
+
+    bool same = true;
+    for (auto handle : handles)
+    {
+        same &= nearly_equal(hierarchy.get_world_transform(handle), reference_world_transform(hierarchy, handle));
+    }
+    CERA_CHECK(same);
+}
+
+CERA_TEST(threaded_update_is_identical)
+{
+    constexpr u32 count = 50000;
+
+    transform_hierarchy reference;
+    auto handles = build_forest(reference, count, 1);
+    reference.update();
+
+    for (u32 num_threads : { 1u, 3u, 7u })
+    {
+        threading::thread_pool pool(num_threads);
+
+        transform_hierarchy hierarchy;
+        build_forest(hierarchy, count, 1);
+        hierarchy.update(pool);
+
+        // Touch every transform so the next update recomputes all levels.
+        for (auto handle : handles)
+        {
+            hierarchy.set_local_transform(handle, hierarchy.get_local_transform(handle));
+        }
+        hierarchy.update(pool);
+
+        bool same = true;
+        for (auto handle : handles)
+        {
+            same &= identical(hierarchy.get_world_transform(handle), reference.get_world_transform(handle));
+        }
+        CERA_CHECK(same);
+        CERA_CHECK(!hierarchy.needs_update());
+    }
+}
+
+CERA_TEST(threaded_update_does_not_wait_for_unrelated_work)
+{
+    threading::thread_pool pool(3);
+
+    // Occupies one worker until the update has returned, or gives up after a few seconds.
+    std::atomic<bool> release(false);
+    std::atomic<bool> blocker_done(false);
+    pool.submit([&release, &blocker_done]()
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!release.load() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+        blocker_done.store(true);
+    });
+
+    transform_hierarchy reference;
+    auto handles = build_forest(reference, 50000, 2);
+    reference.update();
+
+    transform_hierarchy hierarchy;
+    build_forest(hierarchy, 50000, 2);
+    hierarchy.update(pool);
+
+    CERA_CHECK(!blocker_done.load());
+    release.store(true);
+    pool.wait_idle();
+
+    bool same = true;
+    for (auto handle : handles)
+    {
+        same &= identical(hierarchy.get_world_transform(handle), reference.get_world_transform(handle));
+    }
+    CERA_CHECK(same);
+}
\ No newline at end of file
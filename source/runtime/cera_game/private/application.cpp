@@ -20,6 +20,12 @@
 
 namespace cera
 {
+    namespace internal
+    {
+        // Compiled pipeline states of the previous run, relative to the working directory.
+        constexpr const wchar_t* pipeline_state_cache_path = L"pipeline_state_cache.bin";
+    }
+
     namespace adaptors
     {
         // A wrapper struct to allow shared pointers for the window class.
@@ -92,6 +98,12 @@ namespace cera
         , m_request_quit(false)
     {
         m_device = device::create(); 
+
+        // Before anything creates a pipeline state object, a cache miss only costs a compilation.
+        if (m_device)
+        {
+            m_device->load_pipeline_state_cache(internal::pipeline_state_cache_path);
+        }
     }
 
     application::~application()
@@ -198,6 +210,8 @@ namespace cera
         game->unload_content();
         game->destroy();
 
+        m_device->save_pipeline_state_cache(internal::pipeline_state_cache_path);
+
         m_gui.reset();
         m_swapchain.reset();
         m_device.reset();
@@ -1,5 +1,6 @@
 #include "demo.h"
 #include "scene.h"
+#include "scene_node.h"
 
 #include "render/device.h"
 #include "render/command_queue.h"
@@ -14,6 +15,7 @@
 #include "render/mesh_factory.h"
 
 #include "util/log.h"
+#include "util/timing_histogram.h"
 
 #include "imgui.h"
 
@@ -35,9 +37,33 @@ namespace cera
     enum root_parameters
     {
         matrices_cb,         // ConstantBuffer<Mat> MatCB : register(b0);
+        transform_index,     // ConstantBuffer<DrawConstants> DrawConstantsCB : register(b1);
+        world_transforms,    // StructuredBuffer<float4x4> WorldTransforms : register(t0);
         num_root_parameters
     };
 
+    namespace internal
+    {
+        void log_pipeline_state_creation_histogram(const timing_histogram& histogram)
+        {
+            log::info("Pipeline state creation: {0} requests, {1} us total, {2} us max", histogram.get_num_samples(), histogram.get_total_us(), histogram.get_max_us());
+
+            u64 lower_limit_us = 0;
+            for (u32 i = 0; i < timing_histogram::num_buckets; ++i)
+            {
+                if (i < timing_histogram::bucket_limits_us.size())
+                {
+                    log::info("    [{0}, {1}) us: {2}", lower_limit_us, timing_histogram::bucket_limits_us[i], histogram.get_bucket_count(i));
+                    lower_limit_us = timing_histogram::bucket_limits_us[i];
+                }
+                else
+                {
+                    log::info("    >= {0} us: {1}", lower_limit_us, histogram.get_bucket_count(i));
+                }
+            }
+        }
+    }
+
     app_creation_params entry()
     {
         app_creation_params params;
@@ -52,6 +78,7 @@ namespace cera
 
     demo::demo()
         :m_allow_fullscreen_toggle(true)
+        ,m_indirect_draws(true)
         ,m_scissor_rect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX))
         ,m_viewport(CD3DX12_VIEWPORT(0.0f, 0.0f, 0.0f, 0.0f))
         ,m_forward(0)
@@ -101,6 +128,13 @@ namespace cera
         m_cylinder = mesh_factory::create_cylinder(command_list, DirectX::XMFLOAT3(0.0f, 0.0f, 0.85f));
         m_plane = mesh_factory::create_plane(command_list, DirectX::XMFLOAT3(0.85f, 0.85f, 0.85f));
 
+        // Every command of an indirect batch sets the index of its world transform in the transforms of the batch.
+        // Press I to switch to direct draws, they use the vertex shader that only reads the constant buffer.
+        for (const auto& demo_scene : { m_cube, m_sphere, m_cylinder, m_plane })
+        {
+            demo_scene->enable_indirect_draws(root_parameters::transform_index, root_parameters::world_transforms);
+        }
+
         command_queue.execute_command_list(command_list);
 
         // Load the vertex shader.
@@ -111,6 +145,14 @@ namespace cera
             return false;
         }
 
+        // Load the vertex shader of indirect draws.
+        Microsoft::WRL::ComPtr<ID3DBlob> indirect_vertex_shader_blob;
+        if (DX_FAILED(D3DReadFileToBlob(L"IndirectVertexShader.cso", &indirect_vertex_shader_blob)))
+        {
+            log::error("Failed to read compiled indirect vertex shader from file.");
+            return false;
+        }
+
         // Load the pixel shader.
         Microsoft::WRL::ComPtr<ID3DBlob> pixel_shader_blob;
         if (DX_FAILED(D3DReadFileToBlob(L"PixelShader.cso", &pixel_shader_blob)))
@@ -128,6 +170,8 @@ namespace cera
 
         CD3DX12_ROOT_PARAMETER1 root_parameters[root_parameters::num_root_parameters];
         root_parameters[root_parameters::matrices_cb].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+        root_parameters[root_parameters::transform_index].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        root_parameters[root_parameters::world_transforms].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
 
         CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC root_signature_description;
         root_signature_description.Init_1_1(root_parameters::num_root_parameters, root_parameters, 0, nullptr, root_signature_flags);
@@ -167,7 +211,23 @@ namespace cera
         pipeline_state_stream.RTV_formats = rtv_formats;
         pipeline_state_stream.sample_desc = sample_desc;
 
-        m_pipeline_state_object = device->create_pipeline_state_object(pipeline_state_stream);
+        // Compiled in the background, draws are skipped until it is ready instead of stalling the first frame.
+        m_pipeline_state_object = device->create_pipeline_state_object_async(pipeline_state_stream);
+        if (!m_pipeline_state_object)
+        {
+            log::error("Failed to create the pipeline state object.");
+            return false;
+        }
+
+        // Same state with the vertex shader that reads the world transforms bound by the scene.
+        pipeline_state_stream.VS = CD3DX12_SHADER_BYTECODE(indirect_vertex_shader_blob.Get());
+
+        m_indirect_pipeline_state_object = device->create_pipeline_state_object_async(pipeline_state_stream);
+        if (!m_indirect_pipeline_state_object)
+        {
+            log::error("Failed to create the indirect pipeline state object.");
+            return false;
+        }
 
         // Create an off-screen render target with a single color buffer and a depth buffer.
         auto color_desc = CD3DX12_RESOURCE_DESC::Tex2D(back_buffer_format, client_width, client_height, 1, 1, sample_desc.Count, sample_desc.Quality, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
@@ -214,6 +274,12 @@ namespace cera
         m_camera.set_Rotation(cameraRotation);
 
         DirectX::XMMATRIX viewMatrix = m_camera.get_ViewMatrix();
+
+        // Once per frame, the scenes are drawn several times in on_render_scene.
+        for (const auto& demo_scene : { m_cube, m_sphere, m_cylinder, m_plane })
+        {
+            demo_scene->update();
+        }
     }
 
     void demo::on_render(const events::render_args& e)
@@ -226,7 +292,7 @@ namespace cera
             e.command_list->clear_depth_stencil_texture(m_render_target.get_texture(attachment_point::depth_stencil), D3D12_CLEAR_FLAG_DEPTH);
         }
 
-        e.command_list->set_pipeline_state(m_pipeline_state_object);
+        e.command_list->set_pipeline_state(m_indirect_draws ? m_indirect_pipeline_state_object : m_pipeline_state_object);
         e.command_list->set_graphics_root_signature(m_root_signature);
 
         e.command_list->set_viewport(m_viewport);
@@ -253,6 +319,29 @@ namespace cera
         {
             ImGui::ShowDemoWindow(&show_demo_window);
         }
+
+        // Time spent on the render thread to create pipeline states, samples in the last buckets are hitches.
+        const timing_histogram& histogram = application::get()->get_device()->get_pipeline_state_creation_histogram();
+
+        ImGui::Begin("Pipeline states");
+        for (const auto& pipeline_state : { m_pipeline_state_object, m_indirect_pipeline_state_object })
+        {
+            ImGui::Text("%s pipeline state: %s", pipeline_state == m_pipeline_state_object ? "Direct" : "Indirect", pipeline_state->is_ready() ? "ready" : pipeline_state->has_failed() ? "failed" : "compiling");
+        }
+        ImGui::Text("Scene draws: %s (press I to switch)", m_indirect_draws ? "indirect" : "direct");
+        ImGui::Text("Requests: %llu, max: %llu us", static_cast<unsigned long long>(histogram.get_num_samples()), static_cast<unsigned long long>(histogram.get_max_us()));
+        for (u32 i = 0; i < timing_histogram::num_buckets; ++i)
+        {
+            if (i < timing_histogram::bucket_limits_us.size())
+            {
+                ImGui::Text("< %llu us: %llu", static_cast<unsigned long long>(timing_histogram::bucket_limits_us[i]), static_cast<unsigned long long>(histogram.get_bucket_count(i)));
+            }
+            else
+            {
+                ImGui::Text("slower: %llu", static_cast<unsigned long long>(histogram.get_bucket_count(i)));
+            }
+        }
+        ImGui::End();
     }
 
     void demo::on_resize(const events::resize_args& e)
@@ -283,6 +372,20 @@ namespace cera
         case key_code::V:
             application::get()->get_swapchain()->toggle_v_sync();
             break;
+        case key_code::I:
+            m_indirect_draws = !m_indirect_draws;
+            for (const auto& demo_scene : { m_cube, m_sphere, m_cylinder, m_plane })
+            {
+                if (m_indirect_draws)
+                {
+                    demo_scene->enable_indirect_draws(root_parameters::transform_index, root_parameters::world_transforms);
+                }
+                else
+                {
+                    demo_scene->disable_indirect_draws();
+                }
+            }
+            break;
         case key_code::R:
             // Reset camera transform
             m_camera.set_Translation(m_paligned_camera_data->m_initial_camera_pos);
@@ -369,6 +472,8 @@ namespace cera
 
     void demo::unload_content()
     {
+        internal::log_pipeline_state_creation_histogram(application::get()->get_device()->get_pipeline_state_creation_histogram());
+
         m_cube.reset();
         m_sphere.reset();
         m_cylinder.reset();
@@ -378,6 +483,7 @@ namespace cera
 
         m_root_signature.reset();
         m_pipeline_state_object.reset();
+        m_indirect_pipeline_state_object.reset();
     }
 
     void demo::destroy()
@@ -398,76 +504,58 @@ namespace cera
         const DirectX::XMMATRIX view_projection_matrix = view_matrix * m_camera.get_ProjectionMatrix();
 
         // Draw cube
-        // 
-        // Calculate MVP
         DirectX::XMMATRIX translation_matrix = DirectX::XMMatrixTranslation(0.0f, 1.0f, 0.0f);
         DirectX::XMMATRIX rotation_matrix = DirectX::XMMatrixIdentity();
         DirectX::XMMATRIX scale_matrix = DirectX::XMMatrixScaling(2.0f, 2.0f, 2.0f);
         DirectX::XMMATRIX world_matrix = scale_matrix * rotation_matrix * translation_matrix;
-        DirectX::XMMATRIX world_view_projection_matrix = DirectX::XMMatrixMultiply(world_matrix, view_projection_matrix);
-
-        commandList->set_graphics_dynamic_constant_buffer(root_parameters::matrices_cb, world_view_projection_matrix);
 
-        m_cube->draw(commandList);
+        draw_scene(commandList, m_cube, world_matrix, view_projection_matrix);
 
         // Draw plane
-        // 
-        // Calculate MVP
         translation_matrix = DirectX::XMMatrixTranslation(0.0f, 0.0f, 0.0f);
         rotation_matrix = DirectX::XMMatrixIdentity();
         scale_matrix = DirectX::XMMatrixScaling(15.0f, 1.0f, 25.0f);
         world_matrix = scale_matrix * rotation_matrix * translation_matrix;
-        world_view_projection_matrix = DirectX::XMMatrixMultiply(world_matrix, view_projection_matrix);
 
-        commandList->set_graphics_dynamic_constant_buffer(root_parameters::matrices_cb, world_view_projection_matrix);
-
-        m_plane->draw(commandList);
+        draw_scene(commandList, m_plane, world_matrix, view_projection_matrix);
 
         for (int i = 0; i < 5; ++i)
         {
-            DirectX::XMMATRIX left_cyl_world = DirectX::XMMatrixTranslation(-5.0f, 1.5f, -10.0f + i * 5.0f);
-            // Calculate MVP
             rotation_matrix = DirectX::XMMatrixIdentity();
             scale_matrix = DirectX::XMMatrixScaling(1.0f, 3.0f, 1.0f);
-            world_matrix = scale_matrix * rotation_matrix * left_cyl_world;
-            world_view_projection_matrix = DirectX::XMMatrixMultiply(world_matrix, view_projection_matrix);
 
-            commandList->set_graphics_dynamic_constant_buffer(root_parameters::matrices_cb, world_view_projection_matrix);
-
-            m_cylinder->draw(commandList);
+            DirectX::XMMATRIX left_cyl_world = DirectX::XMMatrixTranslation(-5.0f, 1.5f, -10.0f + i * 5.0f);
+            draw_scene(commandList, m_cylinder, scale_matrix * rotation_matrix * left_cyl_world, view_projection_matrix);
 
             DirectX::XMMATRIX right_cyl_world = DirectX::XMMatrixTranslation(+5.0f, 1.5f, -10.0f + i * 5.0f);
-            // Calculate MVP
-            rotation_matrix = DirectX::XMMatrixIdentity();
-            scale_matrix = DirectX::XMMatrixScaling(1.0f, 3.0f, 1.0f);
-            world_matrix = scale_matrix * rotation_matrix * right_cyl_world;
-            world_view_projection_matrix = DirectX::XMMatrixMultiply(world_matrix, view_projection_matrix);
+            draw_scene(commandList, m_cylinder, scale_matrix * rotation_matrix * right_cyl_world, view_projection_matrix);
 
-            commandList->set_graphics_dynamic_constant_buffer(root_parameters::matrices_cb, world_view_projection_matrix);
-
-            m_cylinder->draw(commandList);
-
-            DirectX::XMMATRIX left_sphere_world = DirectX::XMMatrixTranslation(-5.0f, 3.5f, -10.0f + i * 5.0f);
-            // Calculate MVP
-            rotation_matrix = DirectX::XMMatrixIdentity();
             scale_matrix = DirectX::XMMatrixScaling(1.0f, 1.0f, 1.0f);
-            world_matrix = scale_matrix * rotation_matrix * left_sphere_world;
-            world_view_projection_matrix = DirectX::XMMatrixMultiply(world_matrix, view_projection_matrix);
 
-            commandList->set_graphics_dynamic_constant_buffer(root_parameters::matrices_cb, world_view_projection_matrix);
-
-            m_sphere->draw(commandList);
+            DirectX::XMMATRIX left_sphere_world = DirectX::XMMatrixTranslation(-5.0f, 3.5f, -10.0f + i * 5.0f);
+            draw_scene(commandList, m_sphere, scale_matrix * rotation_matrix * left_sphere_world, view_projection_matrix);
 
             DirectX::XMMATRIX right_sphere_world = DirectX::XMMatrixTranslation(+5.0f, 3.5f, -10.0f + i * 5.0f);
-            // Calculate MVP
-            rotation_matrix = DirectX::XMMatrixIdentity();
-            scale_matrix = DirectX::XMMatrixScaling(1.0f, 1.0f, 1.0f);
-            world_matrix = scale_matrix * rotation_matrix * right_sphere_world;
-            world_view_projection_matrix = DirectX::XMMatrixMultiply(world_matrix, view_projection_matrix);
+            draw_scene(commandList, m_sphere, scale_matrix * rotation_matrix * right_sphere_world, view_projection_matrix);
+        }
+    }
 
-            commandList->set_graphics_dynamic_constant_buffer(root_parameters::matrices_cb, world_view_projection_matrix);
+    void demo::draw_scene(const std::shared_ptr<command_list>& commandList, const std::shared_ptr<scene>& demoScene, const DirectX::XMMATRIX& worldMatrix, const DirectX::XMMATRIX& viewProjectionMatrix)
+    {
+        // The world matrix is the transform of the root node. Indirect draws read it from the world transforms of
+        // the scene, the constant buffer only holds the view projection. The direct vertex shader does not read the
+        // world transforms, it gets the world view projection in the constant buffer.
+        demoScene->get_root_node()->set_local_transform(worldMatrix);
 
-            m_sphere->draw(commandList);
+        if (m_indirect_draws)
+        {
+            commandList->set_graphics_dynamic_constant_buffer(root_parameters::matrices_cb, viewProjectionMatrix);
         }
+        else
+        {
+            commandList->set_graphics_dynamic_constant_buffer(root_parameters::matrices_cb, DirectX::XMMatrixMultiply(worldMatrix, viewProjectionMatrix));
+        }
+
+        demoScene->draw(commandList);
     }
 }
\ No newline at end of file
@@ -40,12 +40,16 @@ namespace cera
 
     private:
         void on_render_scene(const std::shared_ptr<command_list>& commandList);
+        void draw_scene(const std::shared_ptr<command_list>& commandList, const std::shared_ptr<scene>& demoScene, const DirectX::XMMATRIX& worldMatrix, const DirectX::XMMATRIX& viewProjectionMatrix);
 
     private:
         bool m_allow_fullscreen_toggle;
 
         std::shared_ptr<root_signature> m_root_signature;
         std::shared_ptr<pipeline_state_object> m_pipeline_state_object;
+        // Reads the world transforms of the scene, used while the scenes record indirect draws.
+        std::shared_ptr<pipeline_state_object> m_indirect_pipeline_state_object;
+        bool m_indirect_draws;
 
         render_target m_render_target;
 
@@ -0,0 +1,42 @@
+// The world transform comes from the scene, the constant buffer only holds the camera.
+struct ViewProjection
+{
+    matrix VP;
+};
+
+ConstantBuffer<ViewProjection> ViewProjectionCB : register(b0);
+
+// Set by every command of an indirect draw.
+struct DrawConstants
+{
+    uint TransformIndex;
+};
+
+ConstantBuffer<DrawConstants> DrawConstantsCB : register(b1);
+
+// World transforms of the scene nodes drawn by the indirect draw.
+StructuredBuffer<matrix> WorldTransforms : register(t0);
+
+struct VertexPosColor
+{
+    float3 Position : POSITION;
+    float3 Color    : COLOR;
+};
+
+struct VertexShaderOutput
+{
+	float4 Color    : COLOR;
+    float4 Position : SV_Position;
+};
+
+VertexShaderOutput main(VertexPosColor IN)
+{
+    VertexShaderOutput OUT;
+
+    float4 world_position = mul(WorldTransforms[DrawConstantsCB.TransformIndex], float4(IN.Position, 1.0f));
+
+    OUT.Position = mul(ViewProjectionCB.VP, world_position);
+    OUT.Color = float4(IN.Color, 1.0f);
+
+    return OUT;
+}
\ No newline at end of file